@@ -0,0 +1,445 @@
+#include <stdio.h>
+#include <time.h>
+#include <algorithm>
+#include <QAtomicInt>
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QThread>
+#include <QTimer>
+#include <QVector>
+#include <dbus/dbus.h>
+
+#include "dbusmonitorthread.h"
+#include "privatebusdaemon.h"
+#include "utils.h"
+
+// Measures how many messages/s DBusMonitorThread sustains on a private
+//   dbus-daemon: N emitter threads send signals at a given rate, consumer
+//   on the main thread checks sequence numbers and measures latency.
+//   With --ramp the rate is doubled every phase until messages are lost
+//   or the daemon disconnects the monitor, which is the drop point.
+
+
+static const char BENCH_PATH[] = "/org/qdbusmonitor/Bench";
+static const char BENCH_INTERFACE[] = "org.qdbusmonitor.Bench";
+static const char BENCH_MEMBER[] = "Tick";
+
+// emitters flush their connection after this many messages
+static const int FLUSH_INTERVAL = 64;
+
+// after emitters stop, consumer waits until nothing arrives for this long
+static const int DRAIN_QUIET_MS = 500;
+
+
+enum class Shape {
+    String, // one string argument of payload bytes
+    Array,  // array of int32, payload / 4 elements
+    Dict,   // a{sv} with payload / 16 entries
+};
+
+
+static qint64 monotonicNs(clockid_t clock = CLOCK_MONOTONIC)
+{
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return static_cast<qint64>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+}
+
+
+static void appendPayload(DBusMessage *msg, Shape shape, int payload, const QByteArray &filler)
+{
+    DBusMessageIter iter;
+    dbus_message_iter_init_append(msg, &iter);
+
+    switch (shape) {
+    case Shape::String: {
+        const char *str = filler.constData();
+        dbus_message_iter_append_basic(&iter, DBUS_TYPE_STRING, &str);
+        break;
+    }
+    case Shape::Array: {
+        DBusMessageIter sub;
+        dbus_message_iter_open_container(&iter, DBUS_TYPE_ARRAY, DBUS_TYPE_INT32_AS_STRING, &sub);
+        for (dbus_int32_t i = 0; i < payload / 4; i++) {
+            dbus_message_iter_append_basic(&sub, DBUS_TYPE_INT32, &i);
+        }
+        dbus_message_iter_close_container(&iter, &sub);
+        break;
+    }
+    case Shape::Dict: {
+        DBusMessageIter dict;
+        dbus_message_iter_open_container(&iter, DBUS_TYPE_ARRAY, "{sv}", &dict);
+        for (int i = 0; i < payload / 16; i++) {
+            DBusMessageIter entry, variant;
+            const QByteArray key = "Property" + QByteArray::number(i);
+            const char *keyStr = key.constData();
+            const dbus_uint32_t value = static_cast<dbus_uint32_t>(i);
+            dbus_message_iter_open_container(&dict, DBUS_TYPE_DICT_ENTRY, nullptr, &entry);
+            dbus_message_iter_append_basic(&entry, DBUS_TYPE_STRING, &keyStr);
+            dbus_message_iter_open_container(&entry, DBUS_TYPE_VARIANT, DBUS_TYPE_UINT32_AS_STRING, &variant);
+            dbus_message_iter_append_basic(&variant, DBUS_TYPE_UINT32, &value);
+            dbus_message_iter_close_container(&entry, &variant);
+            dbus_message_iter_close_container(&dict, &entry);
+        }
+        dbus_message_iter_close_container(&iter, &dict);
+        break;
+    }
+    }
+}
+
+
+// One client connection sending signals at a fixed rate (0 = as fast as possible).
+//   Arguments: emitter id, sequence number, send time, payload.
+class Emitter: public QThread
+{
+public:
+    Emitter(const QString &address, uint id, double rate, Shape shape, int payload)
+        : m_address(address.toUtf8())
+        , m_id(id)
+        , m_rate(rate)
+        , m_shape(shape)
+        , m_payload(payload)
+    {
+    }
+
+    void stop() { m_stop.store(1); }
+    quint64 sent() const { return m_sent; }  // valid after wait()
+    qint64 cpuNs() const { return m_cpuNs; }  // valid after wait()
+    QString errorString() const { return m_errorString; }
+
+protected:
+    void run() override
+    {
+        DBusError err;
+        dbus_error_init(&err);
+        DBusConnection *conn = dbus_connection_open_private(m_address.constData(), &err);
+        if (!conn || !dbus_bus_register(conn, &err)) {
+            m_errorString = QString::fromUtf8(err.message);
+            dbus_error_free(&err);
+            if (conn) {
+                dbus_connection_close(conn);
+                dbus_connection_unref(conn);
+            }
+            return;
+        }
+        dbus_connection_set_exit_on_disconnect(conn, FALSE);
+
+        const QByteArray filler(m_payload, 'x');
+        QElapsedTimer timer;
+        timer.start();
+
+        while (!m_stop.load()) {
+            if (m_rate > 0) {
+                const double due = m_rate * static_cast<double>(timer.nsecsElapsed()) / 1e9;
+                if (static_cast<double>(m_sent) >= due) {
+                    dbus_connection_flush(conn);
+                    QThread::usleep(200);
+                    continue;
+                }
+            }
+
+            DBusMessage *msg = dbus_message_new_signal(BENCH_PATH, BENCH_INTERFACE, BENCH_MEMBER);
+            if (!msg) {
+                Utils::fatal_oom("new signal");
+            }
+            const dbus_uint64_t seq = m_sent;
+            const dbus_int64_t sendNs = monotonicNs();
+            dbus_message_append_args(msg,
+                                     DBUS_TYPE_UINT32, &m_id,
+                                     DBUS_TYPE_UINT64, &seq,
+                                     DBUS_TYPE_INT64, &sendNs,
+                                     DBUS_TYPE_INVALID);
+            appendPayload(msg, m_shape, m_payload, filler);
+            const bool ok = dbus_connection_send(conn, msg, nullptr);
+            dbus_message_unref(msg);
+            if (!ok) {
+                m_errorString = QStringLiteral("Send failed");
+                break;
+            }
+            m_sent++;
+            if (m_sent % FLUSH_INTERVAL == 0) {
+                dbus_connection_flush(conn);
+            }
+        }
+
+        dbus_connection_flush(conn);
+        dbus_connection_close(conn);
+        dbus_connection_unref(conn);
+        m_cpuNs = monotonicNs(CLOCK_THREAD_CPUTIME_ID);
+    }
+
+private:
+    QByteArray m_address;
+    dbus_uint32_t m_id;
+    double m_rate;
+    Shape m_shape;
+    int m_payload;
+    QAtomicInt m_stop;
+    quint64 m_sent = 0;
+    qint64 m_cpuNs = 0;
+    QString m_errorString;
+};
+
+
+// Everything consumer sees during one phase, only touched on main thread
+struct PhaseStats {
+    quint64 received = 0;
+    quint64 gaps = 0;              // messages missing between received sequence numbers
+    QVector<quint64> nextSeq;      // per emitter
+    QVector<qint64> sendLatency;   // ns, emitter send() to consumer
+    QVector<qint64> captureLatency; // ms, capture timestamp to consumer
+
+    void reset(int emitters)
+    {
+        received = 0;
+        gaps = 0;
+        nextSeq.fill(0, emitters);
+        sendLatency.clear();
+        captureLatency.clear();
+    }
+};
+
+
+struct PhaseResult {
+    double targetRate = 0;
+    quint64 sent = 0;
+    quint64 received = 0;
+    double seconds = 0;
+    bool disconnected = false;
+
+    quint64 lost() const { return sent > received ? sent - received : 0; }
+    double lossRatio() const { return sent ? static_cast<double>(lost()) / sent : 0; }
+};
+
+
+static qint64 percentile(const QVector<qint64> &sorted, double p)
+{
+    if (sorted.isEmpty()) {
+        return 0;
+    }
+    const int idx = qBound(0, static_cast<int>(p * (sorted.size() - 1) + 0.5), sorted.size() - 1);
+    return sorted.at(idx);
+}
+
+static void printLatency(const char *name, QVector<qint64> &samples, double divisor, const char *unit)
+{
+    std::sort(samples.begin(), samples.end());
+    printf("  %-22s p50 %8.3f  p90 %8.3f  p99 %8.3f  max %8.3f %s\n", name,
+           percentile(samples, 0.50) / divisor,
+           percentile(samples, 0.90) / divisor,
+           percentile(samples, 0.99) / divisor,
+           percentile(samples, 1.00) / divisor, unit);
+}
+
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+    qRegisterMetaType<DBusMessageObject>();
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("D-Bus monitor throughput benchmark"));
+    parser.addHelpOption();
+    const QCommandLineOption emittersOption(QStringLiteral("emitters"),
+            QStringLiteral("Number of emitter threads (default 4)."), QStringLiteral("n"), QStringLiteral("4"));
+    const QCommandLineOption rateOption(QStringLiteral("rate"),
+            QStringLiteral("Messages per second per emitter, 0 for unlimited (default 1000)."),
+            QStringLiteral("msgs"), QStringLiteral("1000"));
+    const QCommandLineOption durationOption(QStringLiteral("duration"),
+            QStringLiteral("Seconds per phase (default 5)."), QStringLiteral("s"), QStringLiteral("5"));
+    const QCommandLineOption payloadOption(QStringLiteral("payload"),
+            QStringLiteral("Approximate payload bytes per message (default 64)."),
+            QStringLiteral("bytes"), QStringLiteral("64"));
+    const QCommandLineOption shapeOption(QStringLiteral("shape"),
+            QStringLiteral("Payload shape: string, array or dict (default string)."),
+            QStringLiteral("shape"), QStringLiteral("string"));
+    const QCommandLineOption rampOption(QStringLiteral("ramp"),
+            QStringLiteral("Double the rate every phase until messages are dropped."));
+    const QCommandLineOption decodeThreadsOption(QStringLiteral("decode-threads"),
+            QStringLiteral("Monitor decode threads, 0 decodes on capture thread (default depends on cores)."),
+            QStringLiteral("n"));
+    const QCommandLineOption daemonOption(QStringLiteral("dbus-daemon"),
+            QStringLiteral("dbus-daemon executable to use."), QStringLiteral("path"));
+    parser.addOptions({emittersOption, rateOption, durationOption, payloadOption,
+                       shapeOption, rampOption, decodeThreadsOption, daemonOption});
+    parser.process(app);
+
+    const int emitterCount = qMax(1, parser.value(emittersOption).toInt());
+    double rate = qMax(0.0, parser.value(rateOption).toDouble());
+    const int durationMs = qMax(1, parser.value(durationOption).toInt()) * 1000;
+    const int payload = qMax(0, parser.value(payloadOption).toInt());
+    const bool ramp = parser.isSet(rampOption);
+
+    Shape shape = Shape::String;
+    const QString shapeName = parser.value(shapeOption);
+    if (shapeName == QLatin1String("array")) {
+        shape = Shape::Array;
+    } else if (shapeName == QLatin1String("dict")) {
+        shape = Shape::Dict;
+    } else if (shapeName != QLatin1String("string")) {
+        fprintf(stderr, "Unknown shape: %s\n", qPrintable(shapeName));
+        return 1;
+    }
+    if (ramp && rate <= 0) {
+        fprintf(stderr, "--ramp needs a non-zero starting --rate\n");
+        return 1;
+    }
+
+    PrivateBusDaemon daemon;
+    if (parser.isSet(daemonOption)) {
+        daemon.setExecutable(parser.value(daemonOption));
+    }
+    if (!daemon.start()) {
+        fprintf(stderr, "Failed to start dbus-daemon: %s\n", qPrintable(daemon.errorString()));
+        return 1;
+    }
+
+    DBusMonitorThread monitor;
+    if (parser.isSet(decodeThreadsOption)) {
+        monitor.setDecodeThreads(parser.value(decodeThreadsOption).toInt());
+    }
+
+    PhaseStats stats;
+    bool disconnected = false;
+    QObject::connect(&monitor, &DBusMonitorThread::messageReceived, &app,
+                     [&stats] (const DBusMessageObject &messageObj) {
+        const qint64 nowNs = monotonicNs();
+        const QVariantList args = messageObj.contents.toList();
+        if (args.size() < 3) {
+            return;
+        }
+        const int id = static_cast<int>(args.at(0).toUInt());
+        const quint64 seq = args.at(1).toULongLong();
+        if (id < 0 || id >= stats.nextSeq.size() || seq < stats.nextSeq.at(id)) {
+            return; // duplicate or reordered
+        }
+        stats.gaps += seq - stats.nextSeq.at(id);
+        stats.nextSeq[id] = seq + 1;
+        stats.received++;
+        stats.sendLatency.append(nowNs - args.at(2).toLongLong());
+        stats.captureLatency.append(QDateTime::currentMSecsSinceEpoch() - messageObj.timestamp.toMSecsSinceEpoch());
+    });
+    QObject::connect(&monitor, &DBusMonitorThread::dbusDisconnected, &app, [&disconnected] () {
+        disconnected = true;
+    });
+
+    const QStringList rules = {
+        QStringLiteral("type='signal',interface='%1'").arg(QLatin1String(BENCH_INTERFACE))
+    };
+    if (!monitor.startOnAddress(daemon.address(), rules)) {
+        fprintf(stderr, "Failed to start monitor on %s\n", qPrintable(daemon.address()));
+        return 1;
+    }
+    // let it become monitor before anything is sent
+    while (!monitor.isMonitorActive() && monitor.isRunning()) {
+        app.processEvents(QEventLoop::AllEvents, 10);
+    }
+
+    printf("%d emitters, %s payload of %d bytes, %d s per phase, %d decode threads, bus %s\n",
+           emitterCount, qPrintable(shapeName), payload, durationMs / 1000, monitor.decodeThreads(),
+           qPrintable(daemon.address()));
+
+    PhaseResult lastGood;
+    PhaseResult dropPoint;
+    bool dropped = false;
+
+    while (true) {
+        stats.reset(emitterCount);
+        PhaseResult result;
+        result.targetRate = rate * emitterCount;
+
+        // capture and decode threads are whatever this process spends
+        //   besides emitters and consumer
+        const qint64 processCpuStart = monotonicNs(CLOCK_PROCESS_CPUTIME_ID);
+        qint64 emittersCpu = 0;
+        const qint64 consumerCpuStart = monotonicNs(CLOCK_THREAD_CPUTIME_ID);
+
+        QVector<Emitter *> emitters;
+        for (int i = 0; i < emitterCount; i++) {
+            emitters.append(new Emitter(daemon.address(), static_cast<uint>(i), rate, shape, payload));
+            emitters.last()->start();
+        }
+
+        QElapsedTimer phaseTimer;
+        phaseTimer.start();
+        QEventLoop loop;
+        QTimer::singleShot(durationMs, &loop, &QEventLoop::quit);
+        loop.exec();
+
+        for (Emitter *emitter: emitters) {
+            emitter->stop();
+        }
+        for (Emitter *emitter: emitters) {
+            emitter->wait();
+            if (!emitter->errorString().isEmpty()) {
+                fprintf(stderr, "Emitter failed: %s\n", qPrintable(emitter->errorString()));
+            }
+            result.sent += emitter->sent();
+            emittersCpu += emitter->cpuNs();
+            delete emitter;
+        }
+        result.seconds = static_cast<double>(phaseTimer.nsecsElapsed()) / 1e9;
+
+        // drain whatever is still in flight
+        quint64 lastReceived = ~0ULL;
+        while (stats.received != lastReceived && stats.received < result.sent && !disconnected) {
+            lastReceived = stats.received;
+            QEventLoop drainLoop;
+            QTimer::singleShot(DRAIN_QUIET_MS, &drainLoop, &QEventLoop::quit);
+            drainLoop.exec();
+        }
+
+        const qint64 consumerCpu = monotonicNs(CLOCK_THREAD_CPUTIME_ID) - consumerCpuStart;
+        const qint64 monitorCpu = monotonicNs(CLOCK_PROCESS_CPUTIME_ID) - processCpuStart
+                - emittersCpu - consumerCpu;
+        result.received = stats.received;
+        result.disconnected = disconnected;
+
+        printf("\ntarget %.0f msg/s: sent %llu (%.0f msg/s), received %llu (%.0f msg/s), lost %llu (%.3f%%)%s\n",
+               result.targetRate,
+               static_cast<unsigned long long>(result.sent), result.sent / result.seconds,
+               static_cast<unsigned long long>(result.received), result.received / result.seconds,
+               static_cast<unsigned long long>(result.lost()), 100.0 * result.lossRatio(),
+               result.disconnected ? ", monitor DISCONNECTED" : "");
+        if (stats.gaps > 0) {
+            printf("  %llu messages missing between received ones\n",
+                   static_cast<unsigned long long>(stats.gaps));
+        }
+        if (stats.received > 0) {
+            printLatency("send -> consumer", stats.sendLatency, 1e6, "ms");
+            printLatency("capture -> consumer", stats.captureLatency, 1, "ms");
+            printf("  monitor threads CPU    %8.2f us/msg\n", monitorCpu / 1e3 / stats.received);
+            printf("  consumer thread CPU    %8.2f us/msg\n", consumerCpu / 1e3 / stats.received);
+        }
+
+        // a lost message in a million is still noise, not saturation
+        if (result.disconnected || result.lossRatio() > 1e-6) {
+            dropped = true;
+            dropPoint = result;
+        } else {
+            lastGood = result;
+        }
+        if (!ramp || dropped || rate <= 0) {
+            break;
+        }
+        rate *= 2;
+    }
+
+    printf("\n");
+    if (lastGood.sent > 0) {
+        printf("sustained: %.0f msg/s without loss\n", lastGood.received / lastGood.seconds);
+    }
+    if (dropped) {
+        printf("drop point: target %.0f msg/s, %s\n", dropPoint.targetRate,
+               dropPoint.disconnected ? "monitor disconnected by daemon" : "messages lost");
+    } else if (ramp) {
+        printf("drop point: not reached\n");
+    }
+
+    monitor.stop();
+    monitor.wait();
+    return 0;
+}
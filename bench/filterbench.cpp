@@ -0,0 +1,196 @@
+#include <stdio.h>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QVector>
+#include <dbus/dbus.h>
+
+#include "messagefilter.h"
+#include "messagecontentsparser.h"
+#include "utils.h"
+
+// Measures cost of MessageFilter evaluation per message, compared with
+//   the cost of decoding message contents, which filtering allows to skip.
+
+
+struct SampleMessage {
+    DBusMessage *msg = nullptr;
+    DBusMessageObject obj;  // how it looks after parsing and resolving
+};
+
+
+static SampleMessage makeSignal(const char *sender, const char *path, const char *iface,
+                                const char *member, const char *arg0)
+{
+    SampleMessage ret;
+    ret.msg = dbus_message_new_signal(path, iface, member);
+    if (!ret.msg) {
+        Utils::fatal_oom("new signal");
+    }
+    dbus_message_set_sender(ret.msg, sender);
+    dbus_message_set_serial(ret.msg, 10);
+    dbus_uint32_t num = 42;
+    dbus_message_append_args(ret.msg, DBUS_TYPE_STRING, &arg0, DBUS_TYPE_UINT32, &num, DBUS_TYPE_INVALID);
+
+    ret.obj.type = DBUS_MESSAGE_TYPE_SIGNAL;
+    ret.obj.senderAddress = QString::fromUtf8(sender);
+    ret.obj.senderNames = QStringList{QStringLiteral("org.kde.plasmashell")};
+    ret.obj.senderPid = 1234;
+    ret.obj.senderExe = QStringLiteral("/usr/bin/plasmashell");
+    ret.obj.path = QString::fromUtf8(path);
+    ret.obj.interface = QString::fromUtf8(iface);
+    ret.obj.member = QString::fromUtf8(member);
+    ret.obj.contents = QVariantList{QString::fromUtf8(arg0), 42u};
+    return ret;
+}
+
+static SampleMessage makeMethodCall(const char *sender, const char *destination, const char *path,
+                                    const char *iface, const char *member)
+{
+    SampleMessage ret;
+    ret.msg = dbus_message_new_method_call(destination, path, iface, member);
+    if (!ret.msg) {
+        Utils::fatal_oom("new method call");
+    }
+    dbus_message_set_sender(ret.msg, sender);
+    dbus_message_set_serial(ret.msg, 11);
+    const char *propName = "Volume";
+    dbus_message_append_args(ret.msg, DBUS_TYPE_STRING, &iface, DBUS_TYPE_STRING, &propName, DBUS_TYPE_INVALID);
+
+    ret.obj.type = DBUS_MESSAGE_TYPE_METHOD_CALL;
+    ret.obj.senderAddress = QString::fromUtf8(sender);
+    ret.obj.senderPid = 4321;
+    ret.obj.senderExe = QStringLiteral("/usr/bin/pavucontrol");
+    ret.obj.destinationAddress = QStringLiteral(":1.7");
+    ret.obj.destinationNames = QStringList{QString::fromUtf8(destination)};
+    ret.obj.destinationPid = 777;
+    ret.obj.destinationExe = QStringLiteral("/usr/bin/pulseaudio");
+    ret.obj.path = QString::fromUtf8(path);
+    ret.obj.interface = QString::fromUtf8(iface);
+    ret.obj.member = QString::fromUtf8(member);
+    ret.obj.contents = QVariantList{QString::fromUtf8(iface), QString::fromUtf8(propName)};
+    return ret;
+}
+
+static SampleMessage makeReply(int type, const char *sender, const char *destination)
+{
+    SampleMessage ret;
+    ret.msg = dbus_message_new(type);
+    if (!ret.msg) {
+        Utils::fatal_oom("new reply");
+    }
+    dbus_message_set_sender(ret.msg, sender);
+    dbus_message_set_destination(ret.msg, destination);
+    dbus_message_set_serial(ret.msg, 12);
+    dbus_message_set_reply_serial(ret.msg, 11);
+    if (type == DBUS_MESSAGE_TYPE_ERROR) {
+        dbus_message_set_error_name(ret.msg, DBUS_ERROR_FAILED);
+        ret.obj.errorName = QStringLiteral(DBUS_ERROR_FAILED);
+    }
+
+    ret.obj.type = type;
+    ret.obj.senderAddress = QString::fromUtf8(sender);
+    ret.obj.destinationAddress = QString::fromUtf8(destination);
+    return ret;
+}
+
+
+static void benchRules(const QVector<SampleMessage> &samples, const QStringList &rules, int iterations)
+{
+    MessageFilter filter;
+    QString errorString;
+    if (!filter.setRules(rules, &errorString)) {
+        fprintf(stderr, "Failed to compile filter: %s\n", qPrintable(errorString));
+        return;
+    }
+
+    int accepted = 0;
+    int needsDetails = 0;
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < iterations; i++) {
+        const SampleMessage &sample = samples.at(i % samples.size());
+        switch (filter.matchHeader(sample.msg)) {
+        case MessageFilter::Match::Accepted:
+            accepted++;
+            break;
+        case MessageFilter::Match::NeedsDetails:
+            needsDetails++;
+            if (filter.matchMessage(sample.obj, sample.msg)) {
+                accepted++;
+            }
+            break;
+        case MessageFilter::Match::Rejected:
+            break;
+        }
+    }
+    const qint64 ns = timer.nsecsElapsed();
+
+    printf("%8.1f ns/msg  accepted %5.1f%%  details %5.1f%%  %s\n",
+           static_cast<double>(ns) / iterations,
+           100.0 * accepted / iterations,
+           100.0 * needsDetails / iterations,
+           rules.isEmpty() ? "(no filter)" : qPrintable(rules.join(QLatin1String(" ; "))));
+}
+
+static void benchDecode(const QVector<SampleMessage> &samples, int iterations)
+{
+    int total = 0;
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < iterations; i++) {
+        const SampleMessage &sample = samples.at(i % samples.size());
+        DBusMessageIter iter;
+        dbus_message_iter_init(sample.msg, &iter);
+        total += parseMessageContents(&iter).size();
+    }
+    const qint64 ns = timer.nsecsElapsed();
+    printf("%8.1f ns/msg  parseMessageContents() for comparison (%d args)\n",
+           static_cast<double>(ns) / iterations, total);
+}
+
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+
+    int iterations = 2000000;
+    if (app.arguments().size() > 1) {
+        iterations = qMax(1, app.arguments().at(1).toInt());
+    }
+
+    QVector<SampleMessage> samples;
+    samples.append(makeSignal(":1.42", "/org/freedesktop/Notifications", "org.freedesktop.DBus.Properties",
+                              "PropertiesChanged", "org.freedesktop.Notifications"));
+    samples.append(makeSignal(":1.42", "/StatusNotifierWatcher", "org.kde.StatusNotifierWatcher",
+                              "StatusNotifierItemRegistered", "org.kde.StatusNotifierItem-1234-1"));
+    samples.append(makeMethodCall(":1.100", "org.PulseAudio1", "/org/pulseaudio/core1",
+                                  "org.freedesktop.DBus.Properties", "Get"));
+    samples.append(makeReply(DBUS_MESSAGE_TYPE_METHOD_RETURN, ":1.7", ":1.100"));
+    samples.append(makeReply(DBUS_MESSAGE_TYPE_ERROR, ":1.7", ":1.100"));
+
+    printf("filter evaluation, %d iterations over %d sample messages\n", iterations, samples.size());
+
+    benchRules(samples, QStringList(), iterations);
+    benchRules(samples, QStringList{QStringLiteral("type='signal'")}, iterations);
+    benchRules(samples, QStringList{QStringLiteral("type='error'")}, iterations);
+    benchRules(samples, QStringList{QStringLiteral(
+        "type='signal',interface='org.freedesktop.DBus.Properties',member='PropertiesChanged'")}, iterations);
+    benchRules(samples, QStringList{QStringLiteral("sender=':1.42'")}, iterations);
+    benchRules(samples, QStringList{QStringLiteral("path_namespace='/org/freedesktop'")}, iterations);
+    benchRules(samples, QStringList{QStringLiteral("arg0namespace='org.kde'")}, iterations);
+    benchRules(samples, QStringList{QStringLiteral("type='signal',arg1='42'")}, iterations);
+    benchRules(samples, QStringList{QStringLiteral("destination='org.PulseAudio1'")}, iterations);
+    benchRules(samples, QStringList{QStringLiteral("exe='plasmashell'")}, iterations);
+    benchRules(samples, QStringList{
+                   QStringLiteral("type='error'"),
+                   QStringLiteral("interface='org.kde.StatusNotifierWatcher'"),
+                   QStringLiteral("member='Get',path='/org/pulseaudio/core1'"),
+                   QStringLiteral("sender_pid=1234"),
+               }, iterations);
+    benchDecode(samples, iterations);
+
+    for (const SampleMessage &sample: samples) {
+        dbus_message_unref(sample.msg);
+    }
+    return 0;
+}
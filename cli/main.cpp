@@ -1,9 +1,455 @@
+#include <stdio.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
 #include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QSocketNotifier>
+#include <QAtomicInteger>
+#include <QtNumeric>
+
+#include "dbusmonitorthread.h"
+#include "capturewriter.h"
+#include "messagefilter.h"
+#include "messageformat.h"
+#include "traffictop.h"
+#include "busmetrics.h"
+#include "metricsfilewriter.h"
+#include "messagemerger.h"
+#include "privatebusdaemon.h"
+#include "topscreen.h"
+
+
+// SIGINT/SIGTERM are delivered through a socket pair,
+//   so that the event loop quits and all buffers are flushed
+static int g_signalFds[2] = {-1, -1};
+
+static void unixSignalHandler(int)
+{
+    const char c = 1;
+    const ssize_t ret = ::write(g_signalFds[0], &c, sizeof(c));
+    Q_UNUSED(ret)
+}
+
+static bool installSignalHandlers(QCoreApplication *app)
+{
+    if (::socketpair(AF_UNIX, SOCK_STREAM, 0, g_signalFds) != 0) {
+        return false;
+    }
+    QSocketNotifier *notifier = new QSocketNotifier(g_signalFds[1], QSocketNotifier::Read, app);
+    QObject::connect(notifier, &QSocketNotifier::activated, app, [notifier, app] () {
+        notifier->setEnabled(false);
+        char c = 0;
+        const ssize_t ret = ::read(g_signalFds[1], &c, sizeof(c));
+        Q_UNUSED(ret)
+        app->quit();
+    });
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = unixSignalHandler;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = SA_RESTART;
+    sigaction(SIGINT, &sa, nullptr);
+    sigaction(SIGTERM, &sa, nullptr);
+    // broken pipe is reported as write error instead
+    ::signal(SIGPIPE, SIG_IGN);
+    return true;
+}
+
+
+// "100M" and the like, returns -1 if invalid
+static qint64 parseSize(const QString &value)
+{
+    static const QString suffixes = QStringLiteral("KMGT");
+    QString number = value.trimmed();
+    qint64 multiplier = 1;
+    const int unit = number.isEmpty() ? -1 : suffixes.indexOf(number.at(number.size() - 1).toUpper());
+    if (unit >= 0) {
+        multiplier = Q_INT64_C(1) << (10 * (unit + 1));
+        number.chop(1);
+    }
+    bool ok = false;
+    const qint64 size = number.toLongLong(&ok);
+    if (!ok || size < 0) {
+        return -1;
+    }
+    return size * multiplier;
+}
+
 
 int main(int argc, char **argv)
 {
     QCoreApplication app(argc, argv);
-    
-    return app.exec();
-}
+    QCoreApplication::setApplicationName(QStringLiteral("qdbusmonitor-cli"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Captures D-Bus traffic to a file or standard output."));
+    parser.addHelpOption();
+
+    const QCommandLineOption sessionOption(QStringLiteral("session"),
+            QStringLiteral("Monitor the session bus (default)."));
+    const QCommandLineOption systemOption(QStringLiteral("system"),
+            QStringLiteral("Monitor the system bus. With --session too, both are captured into one timeline."));
+    const QCommandLineOption addressOption(QStringLiteral("address"),
+            QStringLiteral("Monitor the bus at this address, e.g. unix:path=/run/container/bus."),
+            QStringLiteral("address"));
+    const QCommandLineOption privateBusOption(QStringLiteral("private-bus"),
+            QStringLiteral("Start a throwaway dbus-daemon and monitor it; its address is printed "
+                           "to standard error, for testing clients against it."));
+    const QCommandLineOption filterOption(QStringList{QStringLiteral("f"), QStringLiteral("filter")},
+            QStringLiteral("Match rule, may be repeated. A message is captured if it matches any rule."),
+            QStringLiteral("rule"));
+    const QCommandLineOption formatOption(QStringList{QStringLiteral("F"), QStringLiteral("format")},
+            QStringLiteral("Output format: text, json, csv, pcap, binary or capture (block-compressed, seekable)."),
+            QStringLiteral("format"), QStringLiteral("text"));
+    const QCommandLineOption outputOption(QStringList{QStringLiteral("o"), QStringLiteral("output")},
+            QStringLiteral("Output file, - for standard output."),
+            QStringLiteral("file"), QStringLiteral("-"));
+    const QCommandLineOption rotateSizeOption(QStringLiteral("rotate-size"),
+            QStringLiteral("Start a new output file when current one reaches this size (K, M, G suffixes)."),
+            QStringLiteral("size"));
+    const QCommandLineOption rotateTimeOption(QStringLiteral("rotate-time"),
+            QStringLiteral("Start a new output file every this many seconds."),
+            QStringLiteral("seconds"));
+    const QCommandLineOption maxTotalOption(QStringLiteral("max-total"),
+            QStringLiteral("Delete oldest rotated files to keep their total size below this."),
+            QStringLiteral("size"));
+    const QCommandLineOption queueSizeOption(QStringLiteral("queue-size"),
+            QStringLiteral("Messages waiting for output at most, beyond that they are dropped."),
+            QStringLiteral("count"), QString::number(MessageQueue::DefaultCapacity));
+    const QCommandLineOption overflowOption(QStringLiteral("overflow"),
+            QStringLiteral("What to drop when output queue is full: drop-newest, drop-oldest or sample."),
+            QStringLiteral("policy"), QStringLiteral("drop-newest"));
+    const QCommandLineOption sampleOption(QStringLiteral("sample"),
+            QStringLiteral("Record only this share of messages of a type or interface, e.g. signal=0.1 or "
+                           "org.freedesktop.DBus.Properties=0.01. May be repeated. Errors are always "
+                           "recorded, replies together with their calls."),
+            QStringLiteral("spec"));
+    const QCommandLineOption sampleAutoOption(QStringLiteral("sample-auto"),
+            QStringLiteral("Sample signals and method calls when more than this many messages per second arrive."),
+            QStringLiteral("rate"));
+    const QCommandLineOption topOption(QStringLiteral("top"),
+            QStringLiteral("Show top talkers on the terminal instead of printing messages. "
+                           "Messages are still written if --output is given."));
+    const QCommandLineOption topSortOption(QStringLiteral("top-sort"),
+            QStringLiteral("Sort top talkers by messages or bytes."),
+            QStringLiteral("key"), QStringLiteral("messages"));
+    const QCommandLineOption metricsFileOption(QStringLiteral("metrics-file"),
+            QStringLiteral("Periodically write Prometheus metrics to this file (for node_exporter textfile collector)."),
+            QStringLiteral("file"));
+    const QCommandLineOption metricsIntervalOption(QStringLiteral("metrics-interval"),
+            QStringLiteral("Seconds between metrics file updates."),
+            QStringLiteral("seconds"), QStringLiteral("5"));
+    const QCommandLineOption countOption(QStringList{QStringLiteral("c"), QStringLiteral("count")},
+            QStringLiteral("Stop after capturing this many messages."),
+            QStringLiteral("n"));
+
+    parser.addOption(sessionOption);
+    parser.addOption(systemOption);
+    parser.addOption(addressOption);
+    parser.addOption(privateBusOption);
+    parser.addOption(filterOption);
+    parser.addOption(formatOption);
+    parser.addOption(outputOption);
+    parser.addOption(rotateSizeOption);
+    parser.addOption(rotateTimeOption);
+    parser.addOption(maxTotalOption);
+    parser.addOption(queueSizeOption);
+    parser.addOption(overflowOption);
+    parser.addOption(sampleOption);
+    parser.addOption(sampleAutoOption);
+    parser.addOption(topOption);
+    parser.addOption(topSortOption);
+    parser.addOption(metricsFileOption);
+    parser.addOption(metricsIntervalOption);
+    parser.addOption(countOption);
+    parser.process(app);
+
+    MessageFormat::Format format = MessageFormat::Format::Text;
+    if (!MessageFormat::formatFromString(parser.value(formatOption), &format)) {
+        fprintf(stderr, "Unknown output format: %s\n", qPrintable(parser.value(formatOption)));
+        return 1;
+    }
+
+    MessageFilter filter;
+    QString errorString;
+    QStringList rules;
+    for (const QString &value: parser.values(filterOption)) {
+        rules.append(MessageFilter::splitRules(value));
+    }
+    if (!filter.setRules(rules, &errorString)) {
+        fprintf(stderr, "Invalid filter: %s\n", qPrintable(errorString));
+        return 1;
+    }
+
+    quint64 maxCount = 0;
+    if (parser.isSet(countOption)) {
+        bool ok = false;
+        maxCount = parser.value(countOption).toULongLong(&ok);
+        if (!ok) {
+            fprintf(stderr, "Invalid message count\n");
+            return 1;
+        }
+    }
+
+    CaptureRotation rotation;
+    if (parser.isSet(rotateSizeOption)) {
+        rotation.maxSegmentSize = parseSize(parser.value(rotateSizeOption));
+    }
+    if (parser.isSet(rotateTimeOption)) {
+        bool ok = false;
+        rotation.maxSegmentAge = parser.value(rotateTimeOption).toLongLong(&ok) * 1000;
+        if (!ok) {
+            rotation.maxSegmentAge = -1;
+        }
+    }
+    if (parser.isSet(maxTotalOption)) {
+        rotation.maxTotalSize = parseSize(parser.value(maxTotalOption));
+    }
+    if (rotation.maxSegmentSize < 0 || rotation.maxSegmentAge < 0 || rotation.maxTotalSize < 0) {
+        fprintf(stderr, "Invalid rotation limit\n");
+        return 1;
+    }
+    if (rotation.maxTotalSize > 0 && !rotation.isEnabled()) {
+        fprintf(stderr, "--max-total requires --rotate-size or --rotate-time\n");
+        return 1;
+    }
 
+    const bool showTop = parser.isSet(topOption);
+    const bool writeOutput = !showTop || parser.isSet(outputOption);
+    if (showTop && writeOutput && parser.value(outputOption) == QLatin1String("-")) {
+        fprintf(stderr, "--top uses standard output, write messages to a file\n");
+        return 1;
+    }
+    const QString topSort = parser.value(topSortOption);
+    if (topSort != QLatin1String("messages") && topSort != QLatin1String("bytes")) {
+        fprintf(stderr, "Unknown sort key: %s\n", qPrintable(topSort));
+        return 1;
+    }
+
+    bool queueSizeOk = false;
+    const int queueSize = parser.value(queueSizeOption).toInt(&queueSizeOk);
+    if (!queueSizeOk || queueSize <= 0) {
+        fprintf(stderr, "Invalid queue size\n");
+        return 1;
+    }
+    MessageQueue::OverflowPolicy overflowPolicy = MessageQueue::OverflowPolicy::DropNewest;
+    if (!MessageQueue::policyFromString(parser.value(overflowOption), &overflowPolicy)) {
+        fprintf(stderr, "Unknown overflow policy: %s\n", qPrintable(parser.value(overflowOption)));
+        return 1;
+    }
+
+    SamplingConfig sampling;
+    for (const QString &spec: parser.values(sampleOption)) {
+        QString errorString;
+        if (!sampling.addSpec(spec, &errorString)) {
+            fprintf(stderr, "%s\n", qPrintable(errorString));
+            return 1;
+        }
+    }
+    if (parser.isSet(sampleAutoOption)) {
+        bool ok = false;
+        sampling.autoMaxRate = parser.value(sampleAutoOption).toDouble(&ok);
+        if (!ok || !qIsFinite(sampling.autoMaxRate) || sampling.autoMaxRate <= 0) {
+            fprintf(stderr, "Invalid sampling rate\n");
+            return 1;
+        }
+    }
+
+    const bool exportMetrics = parser.isSet(metricsFileOption);
+    bool metricsIntervalOk = false;
+    const int metricsInterval = parser.value(metricsIntervalOption).toInt(&metricsIntervalOk);
+    if (exportMetrics && (!metricsIntervalOk || metricsInterval <= 0)) {
+        fprintf(stderr, "Invalid metrics interval\n");
+        return 1;
+    }
+
+    qRegisterMetaType<DBusMessageObject>();
+
+    CaptureWriter writer;
+    writer.setRotation(rotation);
+    writer.setQueueLimit(queueSize, overflowPolicy);
+    if (writeOutput && !writer.open(parser.value(outputOption), format)) {
+        fprintf(stderr, "Cannot open output: %s\n", qPrintable(writer.errorString()));
+        return 1;
+    }
+
+    TrafficTop top;
+    TopScreen topScreen(&top);
+    topScreen.setSortKey(topSort == QLatin1String("bytes") ? TrafficTop::SortByBytes
+                                                           : TrafficTop::SortByMessages);
+
+    PrivateBusDaemon privateBus;
+    if (parser.isSet(privateBusOption)) {
+        if (!privateBus.start()) {
+            fprintf(stderr, "Cannot start private bus: %s\n", qPrintable(privateBus.errorString()));
+            return 1;
+        }
+        fprintf(stderr, "DBUS_SESSION_BUS_ADDRESS=%s\n", qPrintable(privateBus.address()));
+    }
+    QString address = parser.value(addressOption);
+    if (privateBus.isRunning()) {
+        address = privateBus.address();
+    }
+
+    const bool useSystem = parser.isSet(systemOption);
+    const bool useAddress = !address.isEmpty();
+    const bool useSession = parser.isSet(sessionOption) || (!useSystem && !useAddress);
+
+    DBusMonitorThread sessionMonitor;
+    DBusMonitorThread systemMonitor;
+    DBusMonitorThread addressMonitor;
+    QList<DBusMonitorThread *> monitors;
+    if (useSession) {
+        monitors.append(&sessionMonitor);
+    }
+    if (useSystem) {
+        monitors.append(&systemMonitor);
+    }
+    if (useAddress) {
+        monitors.append(&addressMonitor);
+    }
+    // files read back later keep who owned which name, even when filtered
+    const bool recordNameOwners = writeOutput && (format == MessageFormat::Format::Binary
+                                                  || format == MessageFormat::Format::CaptureFile);
+    for (DBusMonitorThread *monitor: monitors) {
+        monitor->setFilter(filter);
+        monitor->setSampling(sampling);
+        monitor->setRecordNameOwners(recordNameOwners);
+    }
+
+    // used only with several buses
+    MessageMerger merger;
+    merger.setQueueLimit(queueSize, overflowPolicy);
+
+    BusMetrics metrics;
+    MetricsFileWriter metricsWriter(&metrics);
+    metricsWriter.setFileName(parser.value(metricsFileOption));
+    QObject::connect(&metricsWriter, &MetricsFileWriter::aboutToWrite, [&metrics, &monitors, &writer, &merger] () {
+        DBusResolverStats resolverStats;
+        for (const DBusMonitorThread *monitor: monitors) {
+            resolverStats += monitor->resolverStats();
+        }
+        metrics.setQueueStats(static_cast<quint64>(writer.queuedCount()),
+                              writer.droppedCount() + merger.droppedCount());
+        metrics.setResolverStats(resolverStats);
+    });
+
+    // runs on capture thread (or merger thread for several buses),
+    //   only appends message to writer queue and updates counters
+    QAtomicInteger<quint64> captured;
+    const auto onMessage = [&writer, &top, &metrics, &captured, &app, maxCount, writeOutput, showTop, exportMetrics]
+                           (const DBusMessageObject &messageObj) {
+        if (!messageObj.isGap()) {
+            // with -c, messages emitted before quit() is handled are not written
+            const quint64 count = static_cast<quint64>(captured.fetchAndAddRelaxed(1)) + 1;
+            if (maxCount > 0 && count > maxCount) {
+                return;
+            }
+            if (count == maxCount) {
+                QMetaObject::invokeMethod(&app, "quit", Qt::QueuedConnection);
+            }
+        } else if (maxCount > 0 && static_cast<quint64>(captured.load()) >= maxCount) {
+            return;
+        }
+        if (writeOutput) {
+            writer.enqueue(messageObj);
+        }
+        if (showTop) {
+            top.add(messageObj);
+        }
+        if (exportMetrics) {
+            metrics.add(messageObj);
+        }
+    };
+
+    if (monitors.size() > 1) {
+        for (DBusMonitorThread *monitor: monitors) {
+            merger.addSource(monitor);
+        }
+        QObject::connect(&merger, &MessageMerger::messageReceived, &writer, onMessage, Qt::DirectConnection);
+    } else {
+        QObject::connect(monitors.first(), &DBusMonitorThread::messageReceived, &writer, onMessage,
+                         Qt::DirectConnection);
+    }
+
+    for (DBusMonitorThread *monitor: monitors) {
+        QObject::connect(monitor, &DBusMonitorThread::dbusDisconnected, &app, [&app, monitor] () {
+            fprintf(stderr, "Disconnected from %s bus\n", qPrintable(monitor->busName()));
+            app.exit(2);
+        }, Qt::QueuedConnection);
+    }
+
+    QObject::connect(&writer, &CaptureWriter::writeError, &app, [&app] (const QString &error) {
+        fprintf(stderr, "Write error: %s\n", qPrintable(error));
+        app.exit(1);
+    }, Qt::QueuedConnection);
+
+    installSignalHandlers(&app);
+
+    const auto stopMonitors = [&monitors, &merger] () {
+        for (DBusMonitorThread *monitor: monitors) {
+            monitor->stop();
+        }
+        for (DBusMonitorThread *monitor: monitors) {
+            monitor->wait();
+        }
+        merger.finish();
+    };
+
+    // let dbus-daemon drop what the filter surely rejects
+    const QStringList daemonRules = filter.daemonMatchRules();
+    bool started = true;
+    if (useSession) {
+        started = started && sessionMonitor.startOnSessionBus(daemonRules);
+    }
+    if (useSystem) {
+        started = started && systemMonitor.startOnSystemBus(daemonRules);
+    }
+    if (useAddress) {
+        started = started && addressMonitor.startOnAddress(address, daemonRules);
+    }
+    if (!started) {
+        fprintf(stderr, "Failed to start monitor\n");
+        stopMonitors();
+        writer.finish();
+        return 1;
+    }
+
+    if (showTop) {
+        topScreen.start(1000);
+    }
+    if (exportMetrics) {
+        metricsWriter.start(metricsInterval * 1000);
+    }
+
+    const int ret = app.exec();
+
+    stopMonitors();
+    writer.finish();
+    if (exportMetrics) {
+        metricsWriter.writeNow();
+    }
+
+    quint64 capturedCount = captured.load();
+    if (maxCount > 0) {
+        capturedCount = qMin(capturedCount, maxCount);
+    }
+    fprintf(stderr, "Captured %llu messages\n", static_cast<unsigned long long>(capturedCount));
+    const quint64 dropped = writer.droppedCount() + merger.droppedCount();
+    if (dropped > 0) {
+        fprintf(stderr, "Dropped %llu messages because output could not keep up\n",
+                static_cast<unsigned long long>(dropped));
+    }
+    quint64 sampledOut = 0;
+    for (const DBusMonitorThread *monitor: monitors) {
+        sampledOut += monitor->sampledOutCount();
+    }
+    if (sampledOut > 0) {
+        fprintf(stderr, "Sampled out %llu messages\n", static_cast<unsigned long long>(sampledOut));
+    }
+    return ret;
+}
@@ -0,0 +1,82 @@
+#include <stdio.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include "topscreen.h"
+
+
+static int terminalRows()
+{
+    struct winsize ws;
+    if (::ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_row > 0) {
+        return ws.ws_row;
+    }
+    return 24;
+}
+
+static QByteArray formatRate(double value)
+{
+    char buf[32] = {0};
+    if (value >= 1024.0 * 1024.0) {
+        snprintf(buf, sizeof(buf), "%8.1fM", value / (1024.0 * 1024.0));
+    } else if (value >= 1024.0) {
+        snprintf(buf, sizeof(buf), "%8.1fK", value / 1024.0);
+    } else {
+        snprintf(buf, sizeof(buf), "%8.1f ", value);
+    }
+    return QByteArray(buf);
+}
+
+
+TopScreen::TopScreen(TrafficTop *top, QObject *parent)
+    : QObject(parent)
+    , m_top(top)
+{
+    connect(&m_timer, &QTimer::timeout, this, &TopScreen::refresh);
+}
+
+void TopScreen::start(int intervalMs)
+{
+    m_timer.start(intervalMs);
+    refresh();
+}
+
+void TopScreen::setSortKey(TrafficTop::SortKey sortKey)
+{
+    m_sortKey = sortKey;
+}
+
+void TopScreen::refresh()
+{
+    // title + blank line, then header and blank line per section
+    const int sections = TrafficTop::DimensionCount;
+    const int rowsPerSection = qMax(3, (terminalRows() - 2 - sections * 2) / sections);
+
+    QByteArray screen;
+    screen.reserve(8192);
+    screen.append("\033[H\033[2J"); // home, clear
+    screen.append("qdbusmonitor-cli top: ");
+    screen.append(formatRate(m_top->messageRate()).trimmed());
+    screen.append(" msg/s, ");
+    screen.append(formatRate(m_top->byteRate()).trimmed());
+    screen.append("B/s\n");
+
+    for (int i = 0; i < sections; i++) {
+        const TrafficTop::Dimension dimension = static_cast<TrafficTop::Dimension>(i);
+        screen.append("\n     MSG/S       B/S  ");
+        screen.append(TrafficTop::dimensionName(dimension).toUpper().toUtf8());
+        screen.append('\n');
+        for (const TrafficTop::Entry &entry: m_top->top(dimension, rowsPerSection, m_sortKey)) {
+            screen.append(' ');
+            screen.append(formatRate(entry.messageRate));
+            screen.append(' ');
+            screen.append(formatRate(entry.byteRate));
+            screen.append(' ');
+            screen.append(entry.key.toUtf8());
+            screen.append('\n');
+        }
+    }
+
+    fwrite(screen.constData(), 1, static_cast<size_t>(screen.size()), stdout);
+    fflush(stdout);
+}
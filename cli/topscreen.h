@@ -0,0 +1,29 @@
+#ifndef TOPSCREEN_H
+#define TOPSCREEN_H
+
+#include <QObject>
+#include <QTimer>
+
+#include "traffictop.h"
+
+
+// Periodically redraws TrafficTop tables on the terminal, like top(1)
+class TopScreen: public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit TopScreen(TrafficTop *top, QObject *parent = nullptr);
+    void start(int intervalMs);
+    void setSortKey(TrafficTop::SortKey sortKey);
+
+private:
+    void refresh();
+
+private:
+    TrafficTop *m_top = nullptr;
+    TrafficTop::SortKey m_sortKey = TrafficTop::SortByMessages;
+    QTimer m_timer;
+};
+
+#endif // TOPSCREEN_H
@@ -0,0 +1,114 @@
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "bufferedwriter.h"
+
+
+BufferedWriter::BufferedWriter(int bufferSize)
+    : m_bufferSize(bufferSize)
+{
+    // reserved capacity survives resize(0), so buffer is allocated only once
+    m_buffer.reserve(m_bufferSize);
+}
+
+BufferedWriter::~BufferedWriter()
+{
+    close();
+}
+
+bool BufferedWriter::open(const QString &fileName)
+{
+    close();
+    m_bytesWritten = 0;
+    m_errorString.clear();
+
+    bool ok = false;
+    if (fileName == QLatin1String("-")) {
+        ok = m_file.open(fileno(stdout), QIODevice::WriteOnly | QIODevice::Unbuffered);
+    } else {
+        m_file.setFileName(fileName);
+        ok = m_file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Unbuffered);
+    }
+    if (!ok) {
+        m_errorString = m_file.errorString();
+    }
+    return ok;
+}
+
+bool BufferedWriter::isOpen() const
+{
+    return m_file.isOpen();
+}
+
+void BufferedWriter::close()
+{
+    if (m_file.isOpen()) {
+        flush();
+        m_file.close();
+    }
+}
+
+bool BufferedWriter::write(const char *data, int size)
+{
+    if (m_buffer.size() + size > m_bufferSize) {
+        if (!flush()) {
+            return false;
+        }
+        if (size >= m_bufferSize) {
+            // does not fit anyway, write through
+            if (m_file.write(data, size) != size) {
+                m_errorString = m_file.errorString();
+                return false;
+            }
+            m_bytesWritten += size;
+            return true;
+        }
+    }
+    m_buffer.append(data, size);
+    return true;
+}
+
+bool BufferedWriter::write(const QByteArray &data)
+{
+    return write(data.constData(), data.size());
+}
+
+bool BufferedWriter::flush()
+{
+    if (m_buffer.isEmpty()) {
+        return true;
+    }
+    const qint64 written = m_file.write(m_buffer.constData(), m_buffer.size());
+    if (written != m_buffer.size()) {
+        m_errorString = m_file.errorString();
+        m_buffer.resize(0);
+        return false;
+    }
+    m_bytesWritten += written;
+    m_buffer.resize(0);
+    return true;
+}
+
+bool BufferedWriter::sync()
+{
+    if (!flush()) {
+        return false;
+    }
+    // fails with EINVAL on pipes and terminals, nothing to sync there
+    if (::fsync(m_file.handle()) != 0 && errno != EINVAL) {
+        m_errorString = QString::fromLocal8Bit(strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+qint64 BufferedWriter::bytesWritten() const
+{
+    return m_bytesWritten;
+}
+
+QString BufferedWriter::errorString() const
+{
+    return m_errorString;
+}
@@ -0,0 +1,47 @@
+#ifndef BUFFEREDWRITER_H
+#define BUFFEREDWRITER_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+
+#include "libqdbusmonitor.h"
+
+
+/**
+ * Output file with one large buffer in front of it, so that many small
+ * records become few large write() calls. File is opened unbuffered,
+ * this class is the only buffering layer. Not thread-safe.
+ */
+class LIBQDBUSMONITOR_API BufferedWriter
+{
+public:
+    static const int DefaultBufferSize = 1024 * 1024;
+
+public:
+    explicit BufferedWriter(int bufferSize = DefaultBufferSize);
+    ~BufferedWriter();
+
+    // "-" means standard output
+    bool open(const QString &fileName);
+    bool isOpen() const;
+    void close();
+
+    bool write(const char *data, int size);
+    bool write(const QByteArray &data);
+    bool flush();
+    // flush() and fsync(), so that data survives a crash
+    bool sync();
+
+    qint64 bytesWritten() const;
+    QString errorString() const;
+
+private:
+    QFile m_file;
+    QByteArray m_buffer;
+    int m_bufferSize = DefaultBufferSize;
+    qint64 m_bytesWritten = 0;
+    QString m_errorString;
+};
+
+#endif // BUFFEREDWRITER_H
@@ -0,0 +1,141 @@
+#include <dbus/dbus.h>
+#include "busmetrics.h"
+
+
+// upper bounds of latency histogram buckets, seconds
+static const double LATENCY_BUCKETS[] = {
+    0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10, 25
+};
+static const int LATENCY_BUCKET_COUNT = sizeof(LATENCY_BUCKETS) / sizeof(LATENCY_BUCKETS[0]);
+
+static const char *const TYPE_LABELS[] = {
+    "invalid", "method_call", "method_return", "error", "signal"
+};
+
+
+BusMetrics::BusMetrics()
+    : m_latencyBuckets(LATENCY_BUCKET_COUNT + 1, 0) // last one is +Inf
+{
+}
+
+void BusMetrics::add(const DBusMessageObject &messageObj)
+{
+    // lost messages are counted by queues
+    if (messageObj.isGap()) {
+        return;
+    }
+    const int type = (messageObj.type > 0 && messageObj.type <= DBUS_MESSAGE_TYPE_SIGNAL) ? messageObj.type : 0;
+
+    QMutexLocker guard(&m_mutex);
+    m_messages[type] += messageObj.weight;
+    m_bytes[type] += messageObj.size * messageObj.weight;
+
+    CallTracker::Reply reply;
+    if (type == DBUS_MESSAGE_TYPE_METHOD_CALL) {
+        if (!m_calls.addCall(messageObj)) {
+            m_untrackedCalls++;
+        }
+    } else if ((type == DBUS_MESSAGE_TYPE_METHOD_RETURN || type == DBUS_MESSAGE_TYPE_ERROR)
+               && m_calls.takeReply(messageObj, &reply)) {
+        const double latency = reply.latencyMs / 1000.0;
+        int bucket = 0;
+        while (bucket < LATENCY_BUCKET_COUNT && latency > LATENCY_BUCKETS[bucket]) {
+            bucket++;
+        }
+        m_latencyBuckets[bucket] += reply.weight;
+        m_latencySum += latency * reply.weight;
+        m_latencyCount += reply.weight;
+    }
+}
+
+void BusMetrics::setQueueStats(quint64 queued, quint64 dropped)
+{
+    QMutexLocker guard(&m_mutex);
+    m_queued = queued;
+    m_dropped = dropped;
+}
+
+void BusMetrics::setResolverStats(const DBusResolverStats &stats)
+{
+    QMutexLocker guard(&m_mutex);
+    m_resolver = stats;
+}
+
+
+static void appendHeader(QByteArray &out, const char *name, const char *type, const char *help)
+{
+    out.append("# HELP ").append(name).append(' ').append(help).append('\n');
+    out.append("# TYPE ").append(name).append(' ').append(type).append('\n');
+}
+
+static void appendSample(QByteArray &out, const char *name, const char *labels, quint64 value)
+{
+    out.append(name);
+    if (labels) {
+        out.append('{').append(labels).append('}');
+    }
+    out.append(' ').append(QByteArray::number(value)).append('\n');
+}
+
+// weighted counts are not integers when sampling
+static void appendSample(QByteArray &out, const char *name, const char *labels, double value)
+{
+    out.append(name);
+    if (labels) {
+        out.append('{').append(labels).append('}');
+    }
+    out.append(' ').append(QByteArray::number(value, 'g', 15)).append('\n');
+}
+
+
+QByteArray BusMetrics::prometheusText()
+{
+    QByteArray out;
+    out.reserve(4096);
+
+    QMutexLocker guard(&m_mutex);
+
+    appendHeader(out, "qdbusmonitor_messages_total", "counter", "Messages captured, by type.");
+    for (int type = 1; type <= DBUS_MESSAGE_TYPE_SIGNAL; type++) {
+        const QByteArray labels = QByteArray("type=\"") + TYPE_LABELS[type] + '"';
+        appendSample(out, "qdbusmonitor_messages_total", labels.constData(), m_messages[type]);
+    }
+    appendHeader(out, "qdbusmonitor_bytes_total", "counter", "Bytes of captured messages, by type.");
+    for (int type = 1; type <= DBUS_MESSAGE_TYPE_SIGNAL; type++) {
+        const QByteArray labels = QByteArray("type=\"") + TYPE_LABELS[type] + '"';
+        appendSample(out, "qdbusmonitor_bytes_total", labels.constData(), m_bytes[type]);
+    }
+    appendHeader(out, "qdbusmonitor_queued_messages", "gauge", "Messages waiting to be written.");
+    appendSample(out, "qdbusmonitor_queued_messages", nullptr, m_queued);
+    appendHeader(out, "qdbusmonitor_dropped_messages_total", "counter", "Messages dropped because of overload.");
+    appendSample(out, "qdbusmonitor_dropped_messages_total", nullptr, m_dropped);
+
+    appendHeader(out, "qdbusmonitor_resolver_lookups_total", "counter",
+                 "Lookups in sender/destination caches, by cache and result.");
+    appendSample(out, "qdbusmonitor_resolver_lookups_total", "cache=\"name\",result=\"hit\"", m_resolver.nameHits);
+    appendSample(out, "qdbusmonitor_resolver_lookups_total", "cache=\"name\",result=\"miss\"", m_resolver.nameMisses);
+    appendSample(out, "qdbusmonitor_resolver_lookups_total", "cache=\"pid\",result=\"hit\"", m_resolver.pidHits);
+    appendSample(out, "qdbusmonitor_resolver_lookups_total", "cache=\"pid\",result=\"miss\"", m_resolver.pidMisses);
+    appendSample(out, "qdbusmonitor_resolver_lookups_total", "cache=\"exe\",result=\"hit\"", m_resolver.exeHits);
+    appendSample(out, "qdbusmonitor_resolver_lookups_total", "cache=\"exe\",result=\"miss\"", m_resolver.exeMisses);
+
+    appendHeader(out, "qdbusmonitor_pending_calls", "gauge", "Method calls waiting for reply.");
+    appendSample(out, "qdbusmonitor_pending_calls", nullptr, static_cast<quint64>(m_calls.pendingCount()));
+    appendHeader(out, "qdbusmonitor_unanswered_calls_total", "counter",
+                 "Method calls without reply, forgotten after timeout or not tracked at all.");
+    appendSample(out, "qdbusmonitor_unanswered_calls_total", nullptr, m_calls.expiredCount() + m_untrackedCalls);
+
+    appendHeader(out, "qdbusmonitor_call_latency_seconds", "histogram", "Time from method call to its reply.");
+    double cumulative = 0;
+    for (int i = 0; i <= LATENCY_BUCKET_COUNT; i++) {
+        cumulative += m_latencyBuckets.at(i);
+        const QByteArray le = (i < LATENCY_BUCKET_COUNT) ? QByteArray::number(LATENCY_BUCKETS[i])
+                                                         : QByteArrayLiteral("+Inf");
+        const QByteArray labels = QByteArray("le=\"") + le + '"';
+        appendSample(out, "qdbusmonitor_call_latency_seconds_bucket", labels.constData(), cumulative);
+    }
+    out.append("qdbusmonitor_call_latency_seconds_sum ").append(QByteArray::number(m_latencySum, 'g', 10)).append('\n');
+    appendSample(out, "qdbusmonitor_call_latency_seconds_count", nullptr, m_latencyCount);
+
+    return out;
+}
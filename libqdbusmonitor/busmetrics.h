@@ -0,0 +1,54 @@
+#ifndef BUSMETRICS_H
+#define BUSMETRICS_H
+
+#include <QByteArray>
+#include <QMutex>
+#include <QVector>
+
+#include "libqdbusmonitor.h"
+#include "calltracker.h"
+#include "dbusmessageobject.h"
+#include "dbusmonitorthread.h"
+
+
+/**
+ * Counters for Prometheus-style monitoring of the bus.
+ *
+ * add() is called on capture thread for every message. It counts
+ * messages and bytes by type and pairs method calls with their replies
+ * in a CallTracker to fill a call latency histogram.
+ * Everything else is gauges set by the owner just before export.
+ * Counters are monotonic, rates are left to the collector. Sampled
+ * messages count with their weight, so counters estimate real traffic.
+ */
+class LIBQDBUSMONITOR_API BusMetrics
+{
+public:
+    BusMetrics();
+
+    void add(const DBusMessageObject &messageObj);
+
+    void setQueueStats(quint64 queued, quint64 dropped);
+    void setResolverStats(const DBusResolverStats &stats);
+
+    // text exposition format, can be called from any thread
+    QByteArray prometheusText();
+
+private:
+    QMutex m_mutex;
+    // indexed by DBUS_MESSAGE_TYPE_*, 0 is "invalid"
+    double m_messages[5] = {0, 0, 0, 0, 0};
+    double m_bytes[5] = {0, 0, 0, 0, 0};
+
+    CallTracker m_calls;
+    quint64 m_untrackedCalls = 0;
+    QVector<double> m_latencyBuckets;            // cumulative counts are computed on export
+    double m_latencySum = 0;
+    double m_latencyCount = 0;
+
+    quint64 m_queued = 0;
+    quint64 m_dropped = 0;
+    DBusResolverStats m_resolver;
+};
+
+#endif // BUSMETRICS_H
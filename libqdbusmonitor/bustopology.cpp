@@ -0,0 +1,175 @@
+#include <dbus/dbus.h>
+#include "bustopology.h"
+
+
+// idle edges and nodes are looked for at most this often
+static const qint64 EXPIRE_INTERVAL_MS = 5000;
+
+
+uint qHash(const BusTopology::EdgeKey &key, uint seed)
+{
+    return qHash(key.from, seed) ^ qHash(key.to, seed + 1) ^ qHash(key.interface, seed + 2);
+}
+
+
+BusTopology::BusTopology(int idleTimeoutMs)
+    : m_idleTimeoutMs(qMax(idleTimeoutMs, 1))
+{
+}
+
+void BusTopology::add(const DBusMessageObject &messageObj)
+{
+    if (messageObj.isGap() || messageObj.senderAddress.isEmpty()) {
+        return;
+    }
+    const qint64 ts = messageObj.timestamp.toMSecsSinceEpoch();
+    const double weight = messageObj.weight;
+
+    QMutexLocker guard(&m_mutex);
+    m_lastSeen = qMax(m_lastSeen, ts);
+    if (m_lastSeen - m_lastExpire >= EXPIRE_INTERVAL_MS) {
+        expireLocked(m_lastSeen);
+    }
+
+    Node &sender = nodeLocked(messageObj.senderAddress);
+    if (!messageObj.senderNames.isEmpty()) {
+        sender.names = messageObj.senderNames;
+    }
+    if (messageObj.senderPid != 0) {
+        sender.pid = messageObj.senderPid;
+        sender.exe = messageObj.senderExe;
+    }
+    sender.messagesSent += weight;
+    sender.lastSeen = qMax(sender.lastSeen, ts);
+    if (!messageObj.destinationAddress.isEmpty()) {
+        Node &destination = nodeLocked(messageObj.destinationAddress);
+        if (!messageObj.destinationNames.isEmpty()) {
+            destination.names = messageObj.destinationNames;
+        }
+        if (messageObj.destinationPid != 0) {
+            destination.pid = messageObj.destinationPid;
+            destination.exe = messageObj.destinationExe;
+        }
+        destination.messagesReceived += weight;
+        destination.lastSeen = qMax(destination.lastSeen, ts);
+    }
+
+    if (messageObj.type != DBUS_MESSAGE_TYPE_METHOD_CALL && messageObj.type != DBUS_MESSAGE_TYPE_SIGNAL) {
+        return;
+    }
+    const EdgeKey key{messageObj.senderAddress, messageObj.destinationAddress, messageObj.interface};
+    auto it = m_edges.find(key);
+    if (it == m_edges.end()) {
+        if (m_edges.size() >= MaxEdges) {
+            m_droppedEdges++;
+            return;
+        }
+        Edge edge;
+        edge.from = key.from;
+        edge.to = key.to;
+        edge.interface = key.interface;
+        edge.firstSeen = ts;
+        it = m_edges.insert(key, edge);
+    }
+    it.value().messages += weight;
+    it.value().lastSeen = qMax(it.value().lastSeen, ts);
+}
+
+void BusTopology::clear()
+{
+    QMutexLocker guard(&m_mutex);
+    m_nodes.clear();
+    m_edges.clear();
+    m_lastSeen = 0;
+    m_lastExpire = 0;
+    m_droppedEdges = 0;
+}
+
+int BusTopology::idleTimeoutMs() const
+{
+    return m_idleTimeoutMs;
+}
+
+QVector<BusTopology::Node> BusTopology::nodes()
+{
+    QMutexLocker guard(&m_mutex);
+    QVector<Node> ret;
+    ret.reserve(m_nodes.size());
+    for (auto it = m_nodes.constBegin(); it != m_nodes.constEnd(); ++it) {
+        ret.append(it.value());
+    }
+    return ret;
+}
+
+QVector<BusTopology::Edge> BusTopology::edges()
+{
+    QMutexLocker guard(&m_mutex);
+    QVector<Edge> ret;
+    ret.reserve(m_edges.size());
+    for (auto it = m_edges.constBegin(); it != m_edges.constEnd(); ++it) {
+        ret.append(it.value());
+    }
+    return ret;
+}
+
+QVector<BusTopology::Edge> BusTopology::edgesFrom(const QString &address)
+{
+    QMutexLocker guard(&m_mutex);
+    QVector<Edge> ret;
+    for (auto it = m_edges.constBegin(); it != m_edges.constEnd(); ++it) {
+        if (it.value().from == address) {
+            ret.append(it.value());
+        }
+    }
+    return ret;
+}
+
+int BusTopology::edgeCount()
+{
+    QMutexLocker guard(&m_mutex);
+    return m_edges.size();
+}
+
+quint64 BusTopology::droppedEdges()
+{
+    QMutexLocker guard(&m_mutex);
+    return m_droppedEdges;
+}
+
+qint64 BusTopology::lastSeen()
+{
+    QMutexLocker guard(&m_mutex);
+    return m_lastSeen;
+}
+
+BusTopology::Node &BusTopology::nodeLocked(const QString &address)
+{
+    const auto it = m_nodes.find(address);
+    if (it != m_nodes.end()) {
+        return it.value();
+    }
+    Node &node = m_nodes[address];
+    node.address = address;
+    return node;
+}
+
+void BusTopology::expireLocked(qint64 nowMs)
+{
+    m_lastExpire = nowMs;
+    const qint64 cutoff = nowMs - m_idleTimeoutMs;
+    for (auto it = m_edges.begin(); it != m_edges.end(); ) {
+        if (it.value().lastSeen < cutoff) {
+            it = m_edges.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    // every edge refreshes both its nodes, so an idle node has no live edges
+    for (auto it = m_nodes.begin(); it != m_nodes.end(); ) {
+        if (it.value().lastSeen < cutoff) {
+            it = m_nodes.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
@@ -0,0 +1,97 @@
+#ifndef BUSTOPOLOGY_H
+#define BUSTOPOLOGY_H
+
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include "libqdbusmonitor.h"
+#include "dbusmessageobject.h"
+
+
+/**
+ * Who talks to whom on the bus.
+ *
+ * Edges are keyed by (sender connection, destination connection,
+ * interface) and carry a weighted message count and first and last seen
+ * times. Method calls and signals make edges, replies and errors only go
+ * back along them and are not counted. Broadcast signals have an empty
+ * destination. Nodes are connections (unique names) with their
+ * well-known names and executable.
+ *
+ * Meant to run for as long as capture does: edges idle for longer than
+ * idleTimeoutMs are dropped, then nodes without edges. At most MaxEdges
+ * are kept; new edges beyond that are only counted in droppedEdges()
+ * until aging frees space. Times are taken from message timestamps, so
+ * replayed captures age the same way as live ones. Readers get copies
+ * and may run on any thread.
+ */
+class LIBQDBUSMONITOR_API BusTopology
+{
+public:
+    struct Node {
+        QString     address;      // unique name
+        QStringList names;
+        QString     exe;
+        uint        pid = 0;
+        double      messagesSent = 0;
+        double      messagesReceived = 0;
+        qint64      lastSeen = 0; // ms since epoch
+    };
+
+    struct Edge {
+        QString from;
+        QString to;               // empty for broadcast signals
+        QString interface;
+        double  messages = 0;
+        qint64  firstSeen = 0;    // ms since epoch
+        qint64  lastSeen = 0;
+    };
+
+    static const int MaxEdges = 32 * 1024;
+    static const int DefaultIdleTimeoutMs = 10 * 60 * 1000;
+
+public:
+    explicit BusTopology(int idleTimeoutMs = DefaultIdleTimeoutMs);
+
+    void add(const DBusMessageObject &messageObj);
+    void clear();
+
+    int idleTimeoutMs() const;
+
+    QVector<Node> nodes();
+    QVector<Edge> edges();
+    // what address depends on: its outgoing edges
+    QVector<Edge> edgesFrom(const QString &address);
+    int edgeCount();
+    quint64 droppedEdges();
+    // newest message time seen, edges age relative to it
+    qint64 lastSeen();
+
+private:
+    struct EdgeKey {
+        QString from;
+        QString to;
+        QString interface;
+        bool operator==(const EdgeKey &o) const {
+            return from == o.from && to == o.to && interface == o.interface;
+        }
+    };
+    friend uint qHash(const EdgeKey &key, uint seed);
+
+    Node &nodeLocked(const QString &address);
+    void expireLocked(qint64 nowMs);
+
+private:
+    QMutex m_mutex;
+    const int m_idleTimeoutMs;
+    QHash<QString, Node> m_nodes;
+    QHash<EdgeKey, Edge> m_edges;
+    qint64 m_lastSeen = 0;
+    qint64 m_lastExpire = 0;
+    quint64 m_droppedEdges = 0;
+};
+
+#endif // BUSTOPOLOGY_H
@@ -0,0 +1,78 @@
+#include "calltracker.h"
+
+
+// pending calls are scanned for expired ones at most this often
+static const qint64 EXPIRE_INTERVAL_MS = 5000;
+
+
+uint qHash(const CallTracker::PendingCall &call, uint seed)
+{
+    return qHash(call.caller, seed) ^ qHash(call.bus, seed + 1) ^ call.serial;
+}
+
+
+CallTracker::CallTracker()
+{
+}
+
+bool CallTracker::addCall(const DBusMessageObject &messageObj)
+{
+    if (messageObj.noReply) {
+        return true;
+    }
+    const qint64 ts = messageObj.timestamp.toMSecsSinceEpoch();
+    if (ts - m_lastExpire >= EXPIRE_INTERVAL_MS) {
+        expire(ts);
+    }
+    if (m_pendingCalls.size() >= MaxPendingCalls) {
+        return false;
+    }
+    m_pendingCalls.insert(PendingCall{messageObj.bus, messageObj.senderAddress, messageObj.serial},
+                          CallInfo{ts, messageObj.weight});
+    return true;
+}
+
+bool CallTracker::takeReply(const DBusMessageObject &messageObj, Reply *reply)
+{
+    // reply goes back to the caller
+    const auto it = m_pendingCalls.find(PendingCall{messageObj.bus, messageObj.destinationAddress,
+                                                    messageObj.replySerial});
+    if (it == m_pendingCalls.end()) {
+        return false;
+    }
+    reply->latencyMs = qMax<qint64>(messageObj.timestamp.toMSecsSinceEpoch() - it.value().timestamp, 0);
+    reply->weight = it.value().weight;
+    m_pendingCalls.erase(it);
+    return true;
+}
+
+void CallTracker::clear()
+{
+    m_pendingCalls.clear();
+    m_lastExpire = 0;
+    m_expiredCalls = 0;
+}
+
+int CallTracker::pendingCount() const
+{
+    return m_pendingCalls.size();
+}
+
+quint64 CallTracker::expiredCount() const
+{
+    return m_expiredCalls;
+}
+
+void CallTracker::expire(qint64 nowMs)
+{
+    // lost replies, or ones captured only partly with a daemon-side filter
+    m_lastExpire = nowMs;
+    for (auto it = m_pendingCalls.begin(); it != m_pendingCalls.end(); ) {
+        if (nowMs - it.value().timestamp > CallTimeoutMs) {
+            it = m_pendingCalls.erase(it);
+            m_expiredCalls++;
+        } else {
+            ++it;
+        }
+    }
+}
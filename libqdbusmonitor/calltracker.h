@@ -0,0 +1,72 @@
+#ifndef CALLTRACKER_H
+#define CALLTRACKER_H
+
+#include <QHash>
+#include <QString>
+
+#include "libqdbusmonitor.h"
+#include "dbusmessageobject.h"
+
+
+/**
+ * Pairs method calls with their replies to measure call latency.
+ *
+ * A call is remembered by bus, caller address and serial until a method
+ * return or error with that reply serial comes back to the caller; calls
+ * flagged NO_REPLY_EXPECTED are not remembered at all. Calls
+ * without reply are forgotten after CallTimeoutMs of message time, and
+ * at most MaxPendingCalls are remembered at once. Reply takes the weight
+ * of its call, a sampled call is sampled together with its reply.
+ * Not thread-safe.
+ */
+class LIBQDBUSMONITOR_API CallTracker
+{
+public:
+    static const int CallTimeoutMs = 60 * 1000;
+    static const int MaxPendingCalls = 64 * 1024;
+
+    struct Reply {
+        qint64 latencyMs = 0;
+        double weight = 0;   // of the call
+    };
+
+public:
+    CallTracker();
+
+    // returns false if call expects a reply but is not remembered
+    //   because too many are pending
+    bool addCall(const DBusMessageObject &messageObj);
+    // returns false if call of this reply is not known
+    bool takeReply(const DBusMessageObject &messageObj, Reply *reply);
+    void clear();
+
+    int pendingCount() const;
+    // calls forgotten without reply so far
+    quint64 expiredCount() const;
+
+private:
+    // unique names and serials repeat across buses
+    struct PendingCall {
+        QString bus;
+        QString caller;
+        uint    serial;
+        bool operator==(const PendingCall &o) const {
+            return serial == o.serial && caller == o.caller && bus == o.bus;
+        }
+    };
+    friend uint qHash(const PendingCall &call, uint seed);
+
+    struct CallInfo {
+        qint64 timestamp;   // ms since epoch
+        double weight;
+    };
+
+    void expire(qint64 nowMs);
+
+private:
+    QHash<PendingCall, CallInfo> m_pendingCalls;
+    qint64 m_lastExpire = 0;
+    quint64 m_expiredCalls = 0;
+};
+
+#endif // CALLTRACKER_H
@@ -0,0 +1,448 @@
+#include <errno.h>
+#include <limits>
+#include <string.h>
+#include <unistd.h>
+#include <QLoggingCategory>
+#include <QtEndian>
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#include "capturefile.h"
+#include "messageformat.h"
+
+
+Q_LOGGING_CATEGORY(logCapture, "monitor.capturefile")
+
+
+static const char FILE_MAGIC[8] = {'Q', 'D', 'B', 'M', 'C', 'A', 'P', '\0'};
+static const quint32 FILE_VERSION = 1;
+static const int FILE_HEADER_SIZE = 16;
+
+static const quint32 BLOCK_MAGIC = 0x4b4c4251; // "QBLK"
+static const quint32 INDEX_MAGIC = 0x58444951; // "QIDX"
+static const quint32 END_MAGIC   = 0x444e4551; // "QEND"
+static const int BLOCK_HEADER_SIZE = 36;
+static const int INDEX_ENTRY_SIZE = 32;
+static const int TRAILER_SIZE = 16;
+
+enum BlockCodec : quint8 {
+    CodecNone = 0,
+    CodecZlib = 1,
+    CodecZstd = 2,
+};
+
+
+static inline void putU32(char *p, quint32 v) { qToLittleEndian<quint32>(v, reinterpret_cast<uchar *>(p)); }
+static inline void putI64(char *p, qint64 v) { qToLittleEndian<qint64>(v, reinterpret_cast<uchar *>(p)); }
+static inline quint32 getU32(const char *p) { return qFromLittleEndian<quint32>(reinterpret_cast<const uchar *>(p)); }
+static inline qint64 getI64(const char *p) { return qFromLittleEndian<qint64>(reinterpret_cast<const uchar *>(p)); }
+
+
+static QByteArray compressBlock(const QByteArray &raw, quint8 *codec)
+{
+#ifdef HAVE_ZSTD
+    QByteArray out;
+    out.resize(static_cast<int>(ZSTD_compressBound(static_cast<size_t>(raw.size()))));
+    const size_t len = ZSTD_compress(out.data(), static_cast<size_t>(out.size()),
+                                     raw.constData(), static_cast<size_t>(raw.size()), 3);
+    if (!ZSTD_isError(len)) {
+        out.resize(static_cast<int>(len));
+        *codec = CodecZstd;
+        return out;
+    }
+    qCWarning(logCapture) << "zstd compression failed:" << ZSTD_getErrorName(len);
+#endif
+    *codec = CodecZlib;
+    return qCompress(raw, 6);
+}
+
+// rawSize must already be checked against CaptureFileWriter::MaxBlockSize
+static bool decompressBlock(const QByteArray &stored, quint8 codec, quint32 rawSize, QByteArray *raw)
+{
+    switch (codec) {
+    case CodecNone:
+        *raw = stored;
+        break;
+    case CodecZlib:
+        // qUncompress() allocates whatever size the data starts with
+        if (stored.size() < 4
+                || qFromBigEndian<quint32>(reinterpret_cast<const uchar *>(stored.constData())) != rawSize) {
+            return false;
+        }
+        *raw = qUncompress(stored);
+        break;
+    case CodecZstd:
+#ifdef HAVE_ZSTD
+    {
+        raw->resize(static_cast<int>(rawSize));
+        const size_t len = ZSTD_decompress(raw->data(), static_cast<size_t>(raw->size()),
+                                           stored.constData(), static_cast<size_t>(stored.size()));
+        if (ZSTD_isError(len)) {
+            return false;
+        }
+        raw->resize(static_cast<int>(len));
+        break;
+    }
+#else
+        qCWarning(logCapture) << "Capture file block is zstd-compressed, but built without zstd";
+        return false;
+#endif
+    default:
+        return false;
+    }
+    return static_cast<quint32>(raw->size()) == rawSize;
+}
+
+
+CaptureFileWriter::CaptureFileWriter(int blockSize)
+    : m_blockSize(qBound(1, blockSize, MaxBlockSize / 4))
+{
+    m_block.reserve(m_blockSize + m_blockSize / 4);
+}
+
+CaptureFileWriter::~CaptureFileWriter()
+{
+    close();
+}
+
+bool CaptureFileWriter::open(const QString &fileName)
+{
+    close();
+    m_errorString.clear();
+    m_index.clear();
+    m_block.resize(0);
+    m_pending = CaptureBlockInfo();
+
+    m_file.setFileName(fileName);
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        m_errorString = m_file.errorString();
+        return false;
+    }
+
+    char header[FILE_HEADER_SIZE] = {0};
+    memcpy(header, FILE_MAGIC, sizeof(FILE_MAGIC));
+    putU32(header + 8, FILE_VERSION);
+    return writeRaw(header, sizeof(header));
+}
+
+bool CaptureFileWriter::isOpen() const
+{
+    return m_file.isOpen();
+}
+
+bool CaptureFileWriter::close(bool sync)
+{
+    if (!m_file.isOpen()) {
+        return true;
+    }
+    bool ok = flushBlock();
+
+    if (ok) {
+        QByteArray index;
+        index.resize(8 + m_index.size() * INDEX_ENTRY_SIZE + TRAILER_SIZE);
+        index.fill('\0');
+        char *p = index.data();
+        putU32(p, INDEX_MAGIC);
+        putU32(p + 4, static_cast<quint32>(m_index.size()));
+        p += 8;
+        for (const CaptureBlockInfo &block: m_index) {
+            putI64(p, block.offset);
+            putI64(p + 8, block.firstTimestamp);
+            putI64(p + 16, block.lastTimestamp);
+            putU32(p + 24, block.messageCount);
+            p += INDEX_ENTRY_SIZE;
+        }
+        putI64(p, m_file.pos());
+        putU32(p + 8, END_MAGIC);
+        ok = writeRaw(index.constData(), index.size());
+    }
+
+    if (ok && sync) {
+        if (!m_file.flush() || ::fsync(m_file.handle()) != 0) {
+            m_errorString = QString::fromLocal8Bit(strerror(errno));
+            ok = false;
+        }
+    }
+
+    m_file.close();
+    return ok;
+}
+
+bool CaptureFileWriter::append(const DBusMessageObject &messageObj)
+{
+    const int blockSize = m_block.size();
+    MessageFormat::appendBinary(m_block, messageObj);
+    // half of the limit leaves room for compression overhead of stored size
+    if (m_block.size() > MaxBlockSize / 2) {
+        // start a new block with it, unless it is too large alone
+        m_block.resize(blockSize);
+        if (blockSize == 0) {
+            m_errorString = QStringLiteral("Message too large for a capture block");
+            return false;
+        }
+        if (!flushBlock()) {
+            return false;
+        }
+        return append(messageObj);
+    }
+
+    const qint64 ts = messageObj.timestamp.toMSecsSinceEpoch();
+    // wall clock and merged buses, so not necessarily in order
+    if (m_pending.messageCount == 0) {
+        m_pending.firstTimestamp = ts;
+        m_pending.lastTimestamp = ts;
+        m_pendingAge.start();
+    } else {
+        m_pending.firstTimestamp = qMin(m_pending.firstTimestamp, ts);
+        m_pending.lastTimestamp = qMax(m_pending.lastTimestamp, ts);
+    }
+    m_pending.messageCount++;
+
+    if (m_block.size() >= m_blockSize) {
+        return flushBlock();
+    }
+    return true;
+}
+
+bool CaptureFileWriter::flushBlock()
+{
+    if (m_pending.messageCount == 0 || !m_file.isOpen()) {
+        return true;
+    }
+
+    quint8 codec = CodecNone;
+    const QByteArray stored = compressBlock(m_block, &codec);
+
+    char header[BLOCK_HEADER_SIZE] = {0};
+    putU32(header, BLOCK_MAGIC);
+    header[4] = static_cast<char>(codec);
+    putU32(header + 8, m_pending.messageCount);
+    putU32(header + 12, static_cast<quint32>(m_block.size()));
+    putU32(header + 16, static_cast<quint32>(stored.size()));
+    putI64(header + 20, m_pending.firstTimestamp);
+    putI64(header + 28, m_pending.lastTimestamp);
+
+    m_pending.offset = m_file.pos();
+    const bool ok = writeRaw(header, sizeof(header)) && writeRaw(stored.constData(), stored.size());
+    if (ok) {
+        m_index.append(m_pending);
+    }
+
+    m_pending = CaptureBlockInfo();
+    m_block.resize(0);
+    return ok;
+}
+
+qint64 CaptureFileWriter::pendingBlockAge() const
+{
+    if (m_pending.messageCount == 0) {
+        return -1;
+    }
+    return m_pendingAge.elapsed();
+}
+
+qint64 CaptureFileWriter::fileSize() const
+{
+    return m_file.isOpen() ? m_file.pos() : 0;
+}
+
+QString CaptureFileWriter::errorString() const
+{
+    return m_errorString;
+}
+
+bool CaptureFileWriter::writeRaw(const char *data, int size)
+{
+    if (m_file.write(data, size) != size) {
+        m_errorString = m_file.errorString();
+        return false;
+    }
+    return true;
+}
+
+
+bool CaptureFileReader::open(const QString &fileName)
+{
+    close();
+    m_file.setFileName(fileName);
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        m_errorString = m_file.errorString();
+        return false;
+    }
+
+    const QByteArray header = m_file.read(FILE_HEADER_SIZE);
+    if (header.size() != FILE_HEADER_SIZE || memcmp(header.constData(), FILE_MAGIC, sizeof(FILE_MAGIC)) != 0) {
+        m_errorString = QStringLiteral("Not a capture file");
+        m_file.close();
+        return false;
+    }
+    if (getU32(header.constData() + 8) != FILE_VERSION) {
+        m_errorString = QStringLiteral("Unsupported capture file version");
+        m_file.close();
+        return false;
+    }
+
+    if (!readIndex()) {
+        qCDebug(logCapture) << "No index in" << fileName << ", scanning blocks";
+        if (!scanBlocks()) {
+            m_file.close();
+            return false;
+        }
+    }
+    return true;
+}
+
+void CaptureFileReader::close()
+{
+    m_file.close();
+    m_blocks.clear();
+    m_errorString.clear();
+}
+
+const QVector<CaptureBlockInfo> &CaptureFileReader::blocks() const
+{
+    return m_blocks;
+}
+
+bool CaptureFileReader::readIndex()
+{
+    const qint64 size = m_file.size();
+    if (size < FILE_HEADER_SIZE + TRAILER_SIZE + 8) {
+        return false;
+    }
+    m_file.seek(size - TRAILER_SIZE);
+    const QByteArray trailer = m_file.read(TRAILER_SIZE);
+    if (trailer.size() != TRAILER_SIZE || getU32(trailer.constData() + 8) != END_MAGIC) {
+        return false;
+    }
+    const qint64 indexOffset = getI64(trailer.constData());
+    if (indexOffset < FILE_HEADER_SIZE || indexOffset > size - TRAILER_SIZE - 8) {
+        return false;
+    }
+
+    m_file.seek(indexOffset);
+    const QByteArray index = m_file.read(size - TRAILER_SIZE - indexOffset);
+    if (index.size() < 8 || getU32(index.constData()) != INDEX_MAGIC) {
+        return false;
+    }
+    // count comes from the file, check it in 64 bits before using it
+    const qint64 count64 = getU32(index.constData() + 4);
+    if (static_cast<qint64>(index.size()) != 8 + count64 * INDEX_ENTRY_SIZE) {
+        return false;
+    }
+    const int count = static_cast<int>(count64);
+
+    m_blocks.clear();
+    m_blocks.reserve(count);
+    const char *p = index.constData() + 8;
+    for (int i = 0; i < count; i++) {
+        CaptureBlockInfo block;
+        block.offset = getI64(p);
+        block.firstTimestamp = getI64(p + 8);
+        block.lastTimestamp = getI64(p + 16);
+        block.messageCount = getU32(p + 24);
+        m_blocks.append(block);
+        p += INDEX_ENTRY_SIZE;
+    }
+    return true;
+}
+
+bool CaptureFileReader::scanBlocks()
+{
+    // only headers are read, payloads are skipped
+    m_blocks.clear();
+    qint64 offset = FILE_HEADER_SIZE;
+    const qint64 size = m_file.size();
+    while (offset + BLOCK_HEADER_SIZE <= size) {
+        m_file.seek(offset);
+        const QByteArray header = m_file.read(BLOCK_HEADER_SIZE);
+        if (header.size() != BLOCK_HEADER_SIZE || getU32(header.constData()) != BLOCK_MAGIC) {
+            break;
+        }
+        const qint64 storedSize = getU32(header.constData() + 16);
+        if (storedSize > CaptureFileWriter::MaxBlockSize) {
+            break; // garbage, not a block
+        }
+        if (offset + BLOCK_HEADER_SIZE + storedSize > size) {
+            break; // truncated last block
+        }
+        CaptureBlockInfo block;
+        block.offset = offset;
+        block.messageCount = getU32(header.constData() + 8);
+        block.firstTimestamp = getI64(header.constData() + 20);
+        block.lastTimestamp = getI64(header.constData() + 28);
+        m_blocks.append(block);
+        offset += BLOCK_HEADER_SIZE + storedSize;
+    }
+    return true;
+}
+
+bool CaptureFileReader::readBlock(int blockIndex, QVector<DBusMessageObject> *messages)
+{
+    if (blockIndex < 0 || blockIndex >= m_blocks.size()) {
+        return false;
+    }
+    m_file.seek(m_blocks.at(blockIndex).offset);
+    const QByteArray header = m_file.read(BLOCK_HEADER_SIZE);
+    if (header.size() != BLOCK_HEADER_SIZE || getU32(header.constData()) != BLOCK_MAGIC) {
+        m_errorString = QStringLiteral("Corrupted block header");
+        return false;
+    }
+    const quint8 codec = static_cast<quint8>(header.at(4));
+    const quint32 rawSize = getU32(header.constData() + 12);
+    const quint32 storedSize = getU32(header.constData() + 16);
+    const quint32 maxSize = CaptureFileWriter::MaxBlockSize;
+    if (rawSize > maxSize || storedSize > maxSize) {
+        m_errorString = QStringLiteral("Corrupted block header");
+        return false;
+    }
+
+    const QByteArray stored = m_file.read(storedSize);
+    QByteArray raw;
+    if (static_cast<quint32>(stored.size()) != storedSize || !decompressBlock(stored, codec, rawSize, &raw)) {
+        m_errorString = QStringLiteral("Corrupted block data");
+        return false;
+    }
+
+    int pos = 0;
+    DBusMessageObject messageObj;
+    while (pos < raw.size()) {
+        if (!MessageFormat::readBinary(raw, &pos, &messageObj)) {
+            m_errorString = QStringLiteral("Corrupted message record");
+            return false;
+        }
+        messages->append(messageObj);
+    }
+    return true;
+}
+
+bool CaptureFileReader::readRange(const QDateTime &from, const QDateTime &to, QVector<DBusMessageObject> *messages)
+{
+    const qint64 fromMs = from.isValid() ? from.toMSecsSinceEpoch() : std::numeric_limits<qint64>::min();
+    const qint64 toMs = to.isValid() ? to.toMSecsSinceEpoch() : std::numeric_limits<qint64>::max();
+
+    QVector<DBusMessageObject> blockMessages;
+    for (int i = 0; i < m_blocks.size(); i++) {
+        const CaptureBlockInfo &block = m_blocks.at(i);
+        if (block.lastTimestamp < fromMs || block.firstTimestamp > toMs) {
+            continue;
+        }
+        blockMessages.clear();
+        if (!readBlock(i, &blockMessages)) {
+            return false;
+        }
+        for (const DBusMessageObject &messageObj: blockMessages) {
+            const qint64 ts = messageObj.timestamp.toMSecsSinceEpoch();
+            if (ts >= fromMs && ts <= toMs) {
+                messages->append(messageObj);
+            }
+        }
+    }
+    return true;
+}
+
+QString CaptureFileReader::errorString() const
+{
+    return m_errorString;
+}
@@ -0,0 +1,117 @@
+#ifndef CAPTUREFILE_H
+#define CAPTUREFILE_H
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QString>
+#include <QVector>
+
+#include "libqdbusmonitor.h"
+#include "dbusmessageobject.h"
+
+
+/**
+ * Native block-compressed capture file.
+ *
+ *   file header:  "QDBMCAP\0", u32 version, u32 reserved
+ *   block:        u32 'QBLK', u8 codec, 3 reserved bytes, u32 message count,
+ *                 u32 raw size, u32 stored size, i64 first timestamp,
+ *                 i64 last timestamp (ms since epoch), stored payload
+ *   index:        u32 'QIDX', u32 block count, then per block:
+ *                 u64 offset, i64 first timestamp, i64 last timestamp,
+ *                 u32 message count, u32 reserved
+ *   trailer:      u64 index offset, u32 'QEND', u32 reserved
+ *
+ * All integers are little-endian. Block payload is a sequence of records
+ * from MessageFormat::appendBinary(), compressed independently of other
+ * blocks with zstd (if built with it) or zlib. If the file was not closed
+ * properly, it has no index, and reader rebuilds it from block headers.
+ * Block timestamps are the earliest and latest of its messages, which
+ * need not come in time order.
+ *
+ * Records are length-prefixed and new message fields are only appended
+ * to them, so they do not change the version; any other layout change does.
+ *
+ * Sizes in block headers are not trusted: a block larger than
+ * CaptureFileWriter::MaxBlockSize, raw or stored, is rejected as
+ * corrupted, and writer never makes one.
+ */
+
+struct CaptureBlockInfo {
+    qint64  offset = 0;          // of block header in file
+    qint64  firstTimestamp = 0;  // ms since epoch
+    qint64  lastTimestamp = 0;
+    quint32 messageCount = 0;
+};
+
+
+class LIBQDBUSMONITOR_API CaptureFileWriter
+{
+public:
+    static const int DefaultBlockSize = 256 * 1024;
+    // largest raw or stored block size that is written or read
+    static const int MaxBlockSize = 64 * 1024 * 1024;
+
+public:
+    // at most a quarter of MaxBlockSize, a block can overshoot it by a record
+    explicit CaptureFileWriter(int blockSize = DefaultBlockSize);
+    ~CaptureFileWriter();
+
+    bool open(const QString &fileName);
+    bool isOpen() const;
+    // writes pending block, index and trailer, optionally fsync()s the file
+    bool close(bool sync = false);
+
+    // fails for a message that does not fit in a block by itself
+    bool append(const DBusMessageObject &messageObj);
+    // compresses and writes pending messages as a block, even if it is small
+    bool flushBlock();
+    // milliseconds since the oldest message in pending block was appended, -1 if none
+    qint64 pendingBlockAge() const;
+
+    qint64 fileSize() const;
+    QString errorString() const;
+
+private:
+    bool writeRaw(const char *data, int size);
+
+private:
+    QFile m_file;
+    int m_blockSize = DefaultBlockSize;
+    QByteArray m_block;
+    CaptureBlockInfo m_pending;
+    QElapsedTimer m_pendingAge;
+    QVector<CaptureBlockInfo> m_index;
+    QString m_errorString;
+};
+
+
+class LIBQDBUSMONITOR_API CaptureFileReader
+{
+public:
+    CaptureFileReader() = default;
+
+    bool open(const QString &fileName);
+    void close();
+
+    // ordered by offset, which is also capture order
+    const QVector<CaptureBlockInfo> &blocks() const;
+    bool readBlock(int blockIndex, QVector<DBusMessageObject> *messages);
+    // decompresses only blocks overlapping [from, to]
+    bool readRange(const QDateTime &from, const QDateTime &to, QVector<DBusMessageObject> *messages);
+
+    QString errorString() const;
+
+private:
+    bool readIndex();
+    bool scanBlocks();
+
+private:
+    QFile m_file;
+    QVector<CaptureBlockInfo> m_blocks;
+    QString m_errorString;
+};
+
+#endif // CAPTUREFILE_H
@@ -0,0 +1,433 @@
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QLoggingCategory>
+#include "capturewriter.h"
+#include "bufferedwriter.h"
+#include "capturefile.h"
+
+
+Q_LOGGING_CATEGORY(logWriter, "monitor.writer")
+
+
+// serialized messages are collected into chunks of about this size
+//   before being passed to BufferedWriter
+static const int WRITE_CHUNK_SIZE = 64 * 1024;
+
+// how often writer thread wakes up when there is no traffic
+static const unsigned long IDLE_WAKEUP_MS = 1000;
+
+// partially filled capture file block is written after this time
+static const qint64 BLOCK_MAX_AGE_MS = 5000;
+
+// with size rotation, segment size is checked after this many messages
+static const int ROTATION_CHECK_INTERVAL = 256;
+
+
+// Where CaptureWriter puts serialized messages. All methods
+//   except open() are called only on writer thread.
+class CaptureSink
+{
+public:
+    virtual ~CaptureSink() = default;
+    virtual bool open(const QString &fileName) = 0;
+    virtual bool write(const DBusMessageObject *messages, int count) = 0;
+    // called when queue is empty
+    virtual bool idle() = 0;
+    virtual bool close(bool sync) = 0;
+    // approximate, used for rotation
+    virtual qint64 size() const = 0;
+    virtual QString errorString() const = 0;
+};
+
+
+// Text, JSON lines or plain binary records through BufferedWriter
+class StreamSink: public CaptureSink
+{
+public:
+    explicit StreamSink(MessageFormat::Format format)
+        : m_format(format)
+    {
+        m_chunk.reserve(WRITE_CHUNK_SIZE * 2);
+    }
+
+    bool open(const QString &fileName) override
+    {
+        if (!m_out.open(fileName)) {
+            return false;
+        }
+        return writeChunk(MessageFormat::fileHeader(m_format));
+    }
+
+    bool write(const DBusMessageObject *messages, int count) override
+    {
+        for (int i = 0; i < count; i++) {
+            MessageFormat::append(m_chunk, messages[i], m_format);
+            if (m_chunk.size() >= WRITE_CHUNK_SIZE) {
+                const bool ok = writeChunk(m_chunk);
+                m_chunk.resize(0);
+                if (!ok) {
+                    return false;
+                }
+            }
+        }
+        if (!m_chunk.isEmpty()) {
+            const bool ok = writeChunk(m_chunk);
+            m_chunk.resize(0);
+            return ok;
+        }
+        return true;
+    }
+
+    bool idle() override
+    {
+        // push data out to readers of a pipe
+        return m_out.flush();
+    }
+
+    bool close(bool sync) override
+    {
+        const bool ok = sync ? m_out.sync() : m_out.flush();
+        m_out.close();
+        return ok;
+    }
+
+    qint64 size() const override
+    {
+        return m_size;
+    }
+
+    QString errorString() const override
+    {
+        return m_out.errorString();
+    }
+
+private:
+    bool writeChunk(const QByteArray &chunk)
+    {
+        m_size += chunk.size();
+        return m_out.write(chunk);
+    }
+
+private:
+    MessageFormat::Format m_format;
+    BufferedWriter m_out;
+    QByteArray m_chunk;
+    qint64 m_size = 0;
+};
+
+
+// Compressed blocks through CaptureFileWriter
+class BlockFileSink: public CaptureSink
+{
+public:
+    bool open(const QString &fileName) override
+    {
+        if (fileName == QLatin1String("-")) {
+            m_errorString = QStringLiteral("Capture file format cannot be written to standard output");
+            return false;
+        }
+        return m_out.open(fileName);
+    }
+
+    bool write(const DBusMessageObject *messages, int count) override
+    {
+        for (int i = 0; i < count; i++) {
+            if (!m_out.append(messages[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool idle() override
+    {
+        // without this a quiet bus would keep the last messages
+        //   only in memory until the block fills up
+        if (m_out.pendingBlockAge() >= BLOCK_MAX_AGE_MS) {
+            return m_out.flushBlock();
+        }
+        return true;
+    }
+
+    bool close(bool sync) override
+    {
+        return m_out.close(sync);
+    }
+
+    qint64 size() const override
+    {
+        // compressed size, pending block is not counted
+        return m_out.fileSize();
+    }
+
+    QString errorString() const override
+    {
+        return m_errorString.isEmpty() ? m_out.errorString() : m_errorString;
+    }
+
+private:
+    CaptureFileWriter m_out;
+    QString m_errorString;
+};
+
+
+CaptureWriter::CaptureWriter(QObject *parent)
+    : QThread(parent)
+{
+}
+
+CaptureWriter::~CaptureWriter()
+{
+    finish();
+}
+
+void CaptureWriter::setRotation(const CaptureRotation &rotation)
+{
+    if (isRunning()) {
+        qCWarning(logWriter) << "Rotation cannot be changed while running";
+        return;
+    }
+    m_rotation = rotation;
+}
+
+CaptureRotation CaptureWriter::rotation() const
+{
+    return m_rotation;
+}
+
+void CaptureWriter::setQueueLimit(int capacity, MessageQueue::OverflowPolicy policy)
+{
+    if (isRunning()) {
+        qCWarning(logWriter) << "Queue limit cannot be changed while running";
+        return;
+    }
+    m_queue.setCapacity(capacity);
+    m_queue.setOverflowPolicy(policy);
+}
+
+bool CaptureWriter::open(const QString &fileName, MessageFormat::Format format)
+{
+    if (isRunning()) {
+        qCWarning(logWriter) << "Already running!";
+        return false;
+    }
+    if (m_rotation.isEnabled() && fileName == QLatin1String("-")) {
+        m_errorString = QStringLiteral("Standard output cannot be rotated");
+        return false;
+    }
+    m_fileName = fileName;
+    m_format = format;
+    if (!openSegment()) {
+        m_errorString = m_sink->errorString();
+        m_sink.reset();
+        return false;
+    }
+    m_written.store(0);
+
+    m_mutex.lock();
+    m_finishing = false;
+    m_mutex.unlock();
+
+    start();
+    return true;
+}
+
+void CaptureWriter::finish()
+{
+    if (!isRunning()) {
+        return;
+    }
+    m_mutex.lock();
+    m_finishing = true;
+    m_mutex.unlock();
+    m_queue.wakeUp();
+    wait();
+}
+
+quint64 CaptureWriter::messagesWritten() const
+{
+    return m_written.load();
+}
+
+int CaptureWriter::queuedCount() const
+{
+    return m_queue.size();
+}
+
+quint64 CaptureWriter::droppedCount() const
+{
+    return m_queue.droppedCount();
+}
+
+QString CaptureWriter::errorString() const
+{
+    QMutexLocker guard(&m_mutex);
+    return m_errorString;
+}
+
+void CaptureWriter::enqueue(const DBusMessageObject &messageObj)
+{
+    // held while pushing, so nothing is queued after writer saw m_finishing
+    QMutexLocker guard(&m_mutex);
+    if (m_finishing) {
+        return;
+    }
+    m_queue.push(messageObj);
+}
+
+CaptureSink *CaptureWriter::createSink() const
+{
+    if (m_format == MessageFormat::Format::CaptureFile) {
+        return new BlockFileSink();
+    }
+    return new StreamSink(m_format);
+}
+
+QString CaptureWriter::nextSegmentFileName()
+{
+    // small segments can be rotated within one millisecond, so a sequence
+    //   number follows; an existing file is never reopened (and truncated)
+    const QFileInfo info(m_fileName);
+    const QString stamp = QDateTime::currentDateTime().toString(QStringLiteral("yyyyMMdd-HHmmss-zzz"));
+    QString path;
+    do {
+        QString name = info.completeBaseName() + QLatin1Char('-') + stamp + QLatin1Char('-')
+                + QStringLiteral("%1").arg(m_segmentSequence, 4, 10, QLatin1Char('0'));
+        m_segmentSequence = (m_segmentSequence + 1) % 10000;
+        if (!info.suffix().isEmpty()) {
+            name += QLatin1Char('.') + info.suffix();
+        }
+        path = info.dir().filePath(name);
+    } while (QFile::exists(path));
+    return path;
+}
+
+bool CaptureWriter::openSegment()
+{
+    m_segmentFileName = m_rotation.isEnabled() ? nextSegmentFileName() : m_fileName;
+    m_sink.reset(createSink());
+    if (!m_sink->open(m_segmentFileName)) {
+        return false;
+    }
+    m_segmentAge.start();
+    m_segmentMessages = 0;
+    if (m_rotation.isEnabled()) {
+        pruneSegments();
+    }
+    return true;
+}
+
+bool CaptureWriter::rotateSegment()
+{
+    if (!m_sink->close(true)) {
+        return false;
+    }
+    qCDebug(logWriter) << "Finished segment" << m_segmentFileName;
+    Q_EMIT segmentFinished(m_segmentFileName);
+    return openSegment();
+}
+
+void CaptureWriter::pruneSegments()
+{
+    if (m_rotation.maxTotalSize <= 0) {
+        return;
+    }
+    const QFileInfo info(m_fileName);
+    QString pattern = info.completeBaseName() + QStringLiteral("-????????-??????-???-????");
+    if (!info.suffix().isEmpty()) {
+        pattern += QLatin1Char('.') + info.suffix();
+    }
+    // names sort in creation order
+    const QFileInfoList segments = info.dir().entryInfoList(QStringList{pattern}, QDir::Files, QDir::Name);
+
+    qint64 totalSize = 0;
+    for (const QFileInfo &segment: segments) {
+        totalSize += segment.size();
+    }
+    const QString current = QFileInfo(m_segmentFileName).absoluteFilePath();
+    for (const QFileInfo &segment: segments) {
+        if (totalSize <= m_rotation.maxTotalSize) {
+            break;
+        }
+        if (segment.absoluteFilePath() == current) {
+            continue;
+        }
+        if (QFile::remove(segment.absoluteFilePath())) {
+            qCDebug(logWriter) << "Removed old segment" << segment.fileName();
+            totalSize -= segment.size();
+        } else {
+            qCWarning(logWriter) << "Failed to remove old segment" << segment.fileName();
+        }
+    }
+}
+
+void CaptureWriter::run()
+{
+    QVector<DBusMessageObject> batch;
+    bool ok = true;
+
+    const auto rotationDue = [this] () -> bool {
+        if (m_segmentMessages == 0) {
+            return false; // never produce empty segments
+        }
+        return (m_rotation.maxSegmentSize > 0 && m_sink->size() >= m_rotation.maxSegmentSize)
+            || (m_rotation.maxSegmentAge > 0 && m_segmentAge.elapsed() >= m_rotation.maxSegmentAge);
+    };
+
+    while (ok) {
+        bool finishing = false;
+        {
+            QMutexLocker guard(&m_mutex);
+            finishing = m_finishing;
+        }
+        batch = m_queue.takeAll(finishing ? 0 : IDLE_WAKEUP_MS);
+        if (batch.isEmpty() && finishing) {
+            break; // everything is written
+        }
+
+        // large batch is written in slices, so that segments do not overshoot
+        int pos = 0;
+        while (ok && pos < batch.size()) {
+            int count = batch.size() - pos;
+            if (m_rotation.maxSegmentSize > 0) {
+                count = qMin(count, ROTATION_CHECK_INTERVAL);
+            }
+            ok = m_sink->write(batch.constData() + pos, count);
+            pos += count;
+            m_segmentMessages += static_cast<quint64>(count);
+            m_written.fetchAndAddRelaxed(static_cast<quint64>(count));
+            if (ok && rotationDue()) {
+                ok = rotateSegment();
+            }
+        }
+        batch.clear();
+
+        if (ok && m_queue.size() == 0) {
+            ok = m_sink->idle();
+            // time limit is also checked on a quiet bus
+            if (ok && rotationDue()) {
+                ok = rotateSegment();
+            }
+        }
+    }
+
+    if (ok) {
+        ok = m_sink->close(m_rotation.isEnabled());
+        if (ok && m_rotation.isEnabled()) {
+            Q_EMIT segmentFinished(m_segmentFileName);
+        }
+    }
+    if (!ok) {
+        const QString errorString = m_sink->errorString();
+        qCWarning(logWriter) << "Write failed:" << errorString;
+        {
+            QMutexLocker guard(&m_mutex);
+            m_errorString = errorString;
+            m_finishing = true;
+        }
+        m_queue.takeAll();
+        Q_EMIT writeError(errorString);
+        m_sink->close(false);
+    }
+}
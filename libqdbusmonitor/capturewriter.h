@@ -0,0 +1,111 @@
+#ifndef CAPTUREWRITER_H
+#define CAPTUREWRITER_H
+
+#include <QThread>
+#include <QMutex>
+#include <QAtomicInteger>
+#include <QScopedPointer>
+#include <QElapsedTimer>
+
+#include "libqdbusmonitor.h"
+#include "dbusmessageobject.h"
+#include "messageformat.h"
+#include "messagequeue.h"
+
+
+class CaptureSink;
+
+
+// Limits for splitting capture into segment files, 0 means no limit
+struct CaptureRotation {
+    qint64 maxSegmentSize = 0;   // bytes
+    qint64 maxSegmentAge = 0;    // milliseconds
+    qint64 maxTotalSize = 0;     // bytes, oldest segments are deleted to stay below
+    bool isEnabled() const { return maxSegmentSize > 0 || maxSegmentAge > 0; }
+};
+
+
+/**
+ * Writes captured messages to a file on its own thread.
+ *
+ * enqueue() can be called from any thread, it is meant to be connected to
+ * DBusMonitorThread::messageReceived with Qt::DirectConnection, so that
+ * capture thread only appends message to a queue. Writer thread takes
+ * the whole queue at once, serializes it into BufferedWriter, and flushes
+ * it only when buffer is full or when there is nothing more to write.
+ * Queue is bounded (see MessageQueue): if disk cannot keep up, messages
+ * are dropped and a gap marker is written in their place.
+ *
+ * With MessageFormat::Format::CaptureFile messages go to CaptureFileWriter
+ * instead; compression also happens on writer thread, and a partially
+ * filled block is written out after a few seconds without traffic.
+ *
+ * With rotation enabled, output file name is a template: segments are
+ * named "<base>-<yyyyMMdd-HHmmss-zzz>-<NNNN>.<suffix>" next to it. Segments are
+ * closed, fsync()ed and pruned on writer thread as well, so none of this
+ * ever blocks the thread that calls enqueue().
+ */
+class LIBQDBUSMONITOR_API CaptureWriter: public QThread
+{
+    Q_OBJECT
+
+public:
+    explicit CaptureWriter(QObject *parent = nullptr);
+    ~CaptureWriter() override;
+
+    // must be called before open()
+    void setRotation(const CaptureRotation &rotation);
+    CaptureRotation rotation() const;
+    // must be called before open()
+    void setQueueLimit(int capacity, MessageQueue::OverflowPolicy policy);
+
+    // "-" means standard output; starts the writer thread
+    bool open(const QString &fileName, MessageFormat::Format format);
+    // writes everything queued so far, closes file and stops the thread
+    void finish();
+
+    quint64 messagesWritten() const;
+    // messages enqueued, but not taken by writer thread yet
+    int queuedCount() const;
+    // lost because queue was full
+    quint64 droppedCount() const;
+    QString errorString() const;
+
+public Q_SLOTS:
+    void enqueue(const DBusMessageObject &messageObj);
+
+Q_SIGNALS:
+    void writeError(const QString &errorString);
+    // emitted from writer thread after a segment is synced and closed
+    void segmentFinished(const QString &fileName);
+
+protected:
+    void run() override;
+
+private:
+    CaptureSink *createSink() const;
+    QString nextSegmentFileName();
+    bool openSegment();
+    bool rotateSegment();
+    void pruneSegments();
+
+private:
+    mutable QMutex m_mutex;     // protects m_finishing and m_errorString
+    MessageQueue m_queue;
+    bool m_finishing = false;
+
+    MessageFormat::Format m_format = MessageFormat::Format::Text;
+    QString m_fileName;
+    CaptureRotation m_rotation;
+
+    // used only by writer thread while it is running
+    QScopedPointer<CaptureSink> m_sink;
+    QString m_segmentFileName;
+    QElapsedTimer m_segmentAge;
+    quint64 m_segmentMessages = 0;
+    int m_segmentSequence = 0;      // last part of segment names
+    QAtomicInteger<quint64> m_written;
+    QString m_errorString;
+};
+
+#endif // CAPTUREWRITER_H
@@ -0,0 +1,54 @@
+# Use pkg-config to get the directories and then use these values
+# in the FIND_PATH() and FIND_LIBRARY() calls
+find_package(PkgConfig QUIET)
+if(PKG_CONFIG_FOUND)
+    pkg_check_modules(PKG_Zstd QUIET libzstd)
+endif()
+
+set(Zstd_VERSION ${PKG_Zstd_VERSION})
+
+find_path(Zstd_INCLUDE_DIR
+    NAMES
+        zstd.h
+    HINTS
+        ${PKG_Zstd_INCLUDE_DIRS}
+)
+
+find_library(Zstd_LIBRARY
+    NAMES
+        zstd
+    HINTS
+        ${PKG_Zstd_LIBRARY_DIRS}
+)
+
+include(FindPackageHandleStandardArgs)
+find_package_handle_standard_args(Zstd
+    FOUND_VAR
+        Zstd_FOUND
+    REQUIRED_VARS
+        Zstd_LIBRARY
+        Zstd_INCLUDE_DIR
+    VERSION_VAR
+        Zstd_VERSION
+)
+
+if(Zstd_FOUND AND NOT TARGET Zstd::Zstd)
+    add_library(Zstd::Zstd UNKNOWN IMPORTED)
+    set_target_properties(Zstd::Zstd PROPERTIES
+        IMPORTED_LOCATION "${Zstd_LIBRARY}"
+        INTERFACE_INCLUDE_DIRECTORIES "${Zstd_INCLUDE_DIR}"
+    )
+endif()
+
+mark_as_advanced(Zstd_LIBRARY Zstd_INCLUDE_DIR)
+
+# compatibility variables
+set(Zstd_LIBRARIES ${Zstd_LIBRARY})
+set(Zstd_INCLUDE_DIRS ${Zstd_INCLUDE_DIR})
+set(Zstd_VERSION_STRING ${Zstd_VERSION})
+
+include(FeatureSummary)
+set_package_properties(Zstd PROPERTIES
+    URL "https://facebook.github.io/zstd/"
+    DESCRIPTION "Fast real-time compression algorithm."
+)
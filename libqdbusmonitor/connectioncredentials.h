@@ -0,0 +1,34 @@
+#ifndef CONNECTIONCREDENTIALS_H
+#define CONNECTIONCREDENTIALS_H
+
+#include <QSharedPointer>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include "libqdbusmonitor.h"
+
+
+// Who is behind a bus connection: what the bus daemon tells with
+//   GetConnectionCredentials, and what procfs tells about that pid.
+struct LIBQDBUSMONITOR_API ConnectionCredentials {
+    uint          pid = 0;
+    bool          hasUid = false;
+    uint          uid = 0;
+    QVector<uint> groupIds;
+    QString       securityLabel;   // SELinux context or AppArmor profile
+    // from procfs: exe as soon as bus replies, empty if process is gone
+    //   by then; the rest later, only when procRead
+    QString       exe;
+    bool          procRead = false;
+    QStringList   cmdline;
+    QString       cgroup;
+    QString       systemdUnit;     // innermost .service or .scope of cgroup
+
+    bool operator==(const ConnectionCredentials &o) const;
+    bool operator!=(const ConnectionCredentials &o) const { return !(*this == o); }
+};
+
+// credentials never change once read, so messages share them
+typedef QSharedPointer<const ConnectionCredentials> ConnectionCredentialsPtr;
+
+#endif // CONNECTIONCREDENTIALS_H
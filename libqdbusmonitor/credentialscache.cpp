@@ -0,0 +1,135 @@
+#include <QRunnable>
+#include "credentialscache.h"
+#include "utils.h"
+
+
+bool ConnectionCredentials::operator==(const ConnectionCredentials &o) const
+{
+    return (pid == o.pid)
+            && (hasUid == o.hasUid)
+            && (uid == o.uid)
+            && (groupIds == o.groupIds)
+            && (securityLabel == o.securityLabel)
+            && (procRead == o.procRead)
+            && (exe == o.exe)
+            && (cmdline == o.cmdline)
+            && (cgroup == o.cgroup)
+            && (systemdUnit == o.systemdUnit);
+}
+
+
+class ProcReadTask: public QRunnable
+{
+public:
+    typedef QVector<QPair<QString, ConnectionCredentialsPtr>> Batch;
+
+    ProcReadTask(CredentialsCache *cache, const Batch &batch)
+        : m_cache(cache)
+        , m_batch(batch)
+    {
+    }
+
+    void run() override
+    {
+        m_cache->readProcs(m_batch);
+    }
+
+private:
+    CredentialsCache *m_cache;
+    Batch m_batch;
+};
+
+
+CredentialsCache::CredentialsCache()
+{
+    // one batch after another, they are small
+    m_procPool.setMaxThreadCount(1);
+}
+
+CredentialsCache::~CredentialsCache()
+{
+    m_procPool.waitForDone();
+}
+
+ConnectionCredentialsPtr CredentialsCache::lookup(const QString &address) const
+{
+    if (address.isEmpty()) {
+        return ConnectionCredentialsPtr();
+    }
+    QMutexLocker guard(&m_mutex);
+    return m_entries.value(address);
+}
+
+void CredentialsCache::insert(const QString &address, const ConnectionCredentials &credentials)
+{
+    const ConnectionCredentialsPtr entry(new ConnectionCredentials(credentials));
+    QMutexLocker guard(&m_mutex);
+    m_entries.insert(address, entry);
+    if (entry->pid > 0 && !entry->procRead) {
+        m_procQueue.append(qMakePair(address, entry));
+    }
+}
+
+void CredentialsCache::retire(const QString &address, quint64 sequence)
+{
+    QMutexLocker guard(&m_mutex);
+    m_retired.append(qMakePair(address, sequence));
+}
+
+void CredentialsCache::purgeRetired(quint64 decodedSequence)
+{
+    QMutexLocker guard(&m_mutex);
+    int count = 0;
+    while (count < m_retired.size() && m_retired.at(count).second <= decodedSequence) {
+        m_entries.remove(m_retired.at(count).first);
+        count++;
+    }
+    if (count > 0) {
+        m_retired.remove(0, count);
+    }
+}
+
+void CredentialsCache::clear()
+{
+    QMutexLocker guard(&m_mutex);
+    m_entries.clear();
+    m_retired.clear();
+    m_procQueue.clear();
+}
+
+void CredentialsCache::startProcReads()
+{
+    Batch batch;
+    {
+        QMutexLocker guard(&m_mutex);
+        if (m_procQueue.isEmpty()) {
+            return;
+        }
+        batch.swap(m_procQueue);
+    }
+    m_procPool.start(new ProcReadTask(this, batch));
+}
+
+void CredentialsCache::readProcs(const Batch &batch)
+{
+    // all file reads first, then one lock for the whole batch
+    Batch results;
+    results.reserve(batch.size());
+    for (const auto &item: batch) {
+        ConnectionCredentials *credentials = new ConnectionCredentials(*item.second);
+        credentials->procRead = true;
+        credentials->cmdline = Utils::pid2cmdline(credentials->pid);
+        credentials->cgroup = Utils::pid2cgroup(credentials->pid);
+        credentials->systemdUnit = Utils::cgroup2unit(credentials->cgroup);
+        results.append(qMakePair(item.first, ConnectionCredentialsPtr(credentials)));
+    }
+
+    QMutexLocker guard(&m_mutex);
+    for (int i = 0; i < results.size(); i++) {
+        // connection may have gone away meanwhile
+        const auto it = m_entries.find(results.at(i).first);
+        if (it != m_entries.end() && it.value() == batch.at(i).second) {
+            it.value() = results.at(i).second;
+        }
+    }
+}
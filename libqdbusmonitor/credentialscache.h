@@ -0,0 +1,63 @@
+#ifndef CREDENTIALSCACHE_H
+#define CREDENTIALSCACHE_H
+
+#include <QHash>
+#include <QMutex>
+#include <QPair>
+#include <QString>
+#include <QThreadPool>
+#include <QVector>
+
+#include "libqdbusmonitor.h"
+#include "connectioncredentials.h"
+
+
+/**
+ * Credentials of bus connections by unique name.
+ *
+ * Capture thread asks the bus about every connection with one
+ * GetConnectionCredentials call and inserts the reply before it submits
+ * any message of that connection, together with the executable, read
+ * right away so that short-lived processes are still caught. The rest of
+ * procfs (cmdline, cgroup) is not read right away: startProcReads() takes
+ * everything inserted since its last call and reads it on a background
+ * thread in one go, then replaces the entries under a single lock.
+ * Capture thread calls it once per dispatch round.
+ *
+ * Decode workers enrich a message with one lookup() per endpoint, which
+ * returns a shared, immutable entry and never waits. Connections that are
+ * gone are retire()d with the decode sequence of the next message and
+ * dropped only once everything captured before is decoded, so their last
+ * messages still find them.
+ */
+class LIBQDBUSMONITOR_API CredentialsCache
+{
+public:
+    CredentialsCache();
+    ~CredentialsCache();
+
+    // null when not known
+    ConnectionCredentialsPtr lookup(const QString &address) const;
+
+    void insert(const QString &address, const ConnectionCredentials &credentials);
+    // dropped once purgeRetired() is given a later sequence
+    void retire(const QString &address, quint64 sequence);
+    void purgeRetired(quint64 decodedSequence);
+    void clear();
+
+    void startProcReads();
+
+private:
+    friend class ProcReadTask;
+    typedef QVector<QPair<QString, ConnectionCredentialsPtr>> Batch;
+    void readProcs(const Batch &batch);
+
+private:
+    mutable QMutex m_mutex;
+    QHash<QString, ConnectionCredentialsPtr> m_entries;
+    QVector<QPair<QString, quint64>> m_retired;     // in sequence order
+    Batch m_procQueue;
+    QThreadPool m_procPool;
+};
+
+#endif // CREDENTIALSCACHE_H
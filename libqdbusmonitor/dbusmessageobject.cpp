@@ -1,14 +1,21 @@
+#include <QDataStream>
 #include "dbusmessageobject.h"
+#include "utils.h"
 
 
 bool DBusMessageObject::operator==(const DBusMessageObject &o) const
 {
     return (timestamp == o.timestamp)
+            && (bus == o.bus)
             && (type == o.type)
             && (serial == o.serial)
             && (replySerial == o.replySerial)
             && (senderPid == o.senderPid)
             && (destinationPid == o.destinationPid)
+            && (size == o.size)
+            && (dropped == o.dropped)
+            && (weight == o.weight)
+            && (noReply == o.noReply)
             && (typeString == o.typeString)
             && (senderAddress == o.senderAddress)
             && (senderNames == o.senderNames)
@@ -22,7 +29,97 @@ bool DBusMessageObject::operator==(const DBusMessageObject &o) const
             && (errorName == o.errorName);
 }
 
+DBusMessageObject DBusMessageObject::gapMarker(const QDateTime &timestamp, quint64 dropped)
+{
+    DBusMessageObject ret;
+    ret.timestamp = timestamp;
+    ret.type = GapType;
+    ret.typeString = Utils::dbusMessageTypeToString(GapType);
+    ret.dropped = dropped;
+    return ret;
+}
+
 bool DBusMessageObject::operator!=(const DBusMessageObject &o) const
 {
     return !((*this) == o);
 }
+
+
+QDataStream &operator<<(QDataStream &stream, const DBusMessageObject &messageObj)
+{
+    stream << messageObj.timestamp
+           << static_cast<qint32>(messageObj.type)
+           << static_cast<quint32>(messageObj.serial)
+           << static_cast<quint32>(messageObj.replySerial)
+           << static_cast<quint32>(messageObj.senderPid)
+           << static_cast<quint32>(messageObj.destinationPid)
+           << messageObj.senderAddress
+           << messageObj.senderNames
+           << messageObj.senderExe
+           << messageObj.destinationAddress
+           << messageObj.destinationNames
+           << messageObj.destinationExe
+           << messageObj.path
+           << messageObj.interface
+           << messageObj.member
+           << messageObj.errorName
+           << messageObj.contents
+           << static_cast<quint32>(messageObj.size)
+           << messageObj.bus
+           << messageObj.dropped
+           << messageObj.weight
+           << messageObj.noReply;
+    return stream;
+}
+
+QDataStream &operator>>(QDataStream &stream, DBusMessageObject &messageObj)
+{
+    qint32 type = 0;
+    quint32 serial = 0, replySerial = 0, senderPid = 0, destinationPid = 0, size = 0;
+    stream >> messageObj.timestamp
+           >> type
+           >> serial
+           >> replySerial
+           >> senderPid
+           >> destinationPid
+           >> messageObj.senderAddress
+           >> messageObj.senderNames
+           >> messageObj.senderExe
+           >> messageObj.destinationAddress
+           >> messageObj.destinationNames
+           >> messageObj.destinationExe
+           >> messageObj.path
+           >> messageObj.interface
+           >> messageObj.member
+           >> messageObj.errorName
+           >> messageObj.contents;
+    // Fields below were appended to the record later. Records are length
+    //   prefixed (see MessageFormat::appendBinary()), so older ones just end
+    //   earlier and keep defaults, and fields newer than these are skipped.
+    //   New fields only ever go to the end.
+    messageObj.bus.clear();
+    messageObj.dropped = 0;
+    messageObj.weight = 1;
+    messageObj.noReply = false;
+    if (!stream.atEnd()) {
+        stream >> size >> messageObj.bus;
+    }
+    if (!stream.atEnd()) {
+        stream >> messageObj.dropped;
+    }
+    if (!stream.atEnd()) {
+        stream >> messageObj.weight;
+    }
+    if (!stream.atEnd()) {
+        stream >> messageObj.noReply;
+    }
+    messageObj.type = type;
+    messageObj.serial = serial;
+    messageObj.replySerial = replySerial;
+    messageObj.senderPid = senderPid;
+    messageObj.destinationPid = destinationPid;
+    messageObj.size = size;
+    // not stored, easily restored
+    messageObj.typeString = Utils::dbusMessageTypeToString(type);
+    return stream;
+}
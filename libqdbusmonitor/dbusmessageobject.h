@@ -6,6 +6,7 @@
 #include <QDateTime>
 #include <QVariantList>
 #include "libqdbusmonitor.h"
+#include "connectioncredentials.h"
 
 class LIBQDBUSMONITOR_API DBusMessageObject
 {
@@ -20,13 +21,24 @@ public:
     bool operator==(const DBusMessageObject &o) const;
     bool operator!=(const DBusMessageObject &o) const;
 
+    // Stands for messages lost between capture and a consumer, see MessageQueue.
+    //   Not a D-Bus message type; only timestamp and dropped are set.
+    enum { GapType = -1 };
+    static DBusMessageObject gapMarker(const QDateTime &timestamp, quint64 dropped);
+    bool isGap() const { return type == GapType; }
+
 public:
     QDateTime timestamp;
+    QString   bus;               // which bus it was captured on, see DBusMonitorThread::busName()
     int       type = 0;
     uint      serial = 0;
     uint      replySerial = 0;
     uint      senderPid = 0;
     uint      destinationPid = 0;
+    uint      size = 0;          // marshalled message size in bytes
+    quint64   dropped = 0;       // gap markers only: how many messages were lost here
+    double    weight = 1;        // with sampling, how many captured messages this one stands for
+    bool      noReply = false;   // method calls only: NO_REPLY_EXPECTED flag, caller wants no reply
     QString   typeString;
     QString   senderAddress;
     QStringList senderNames;
@@ -40,8 +52,18 @@ public:
     QString   errorName; // only used for error mesages
     // message contents can be very very varying
     QVariantList contents;
+    // shared with CredentialsCache, null if not known; pid and exe above
+    //   are copied from these. Derived data: not serialized and not compared,
+    //   capture files keep pid and exe
+    ConnectionCredentialsPtr senderCredentials;
+    ConnectionCredentialsPtr destinationCredentials;
 };
 
 Q_DECLARE_METATYPE(DBusMessageObject)
 
+class QDataStream;
+
+LIBQDBUSMONITOR_API QDataStream &operator<<(QDataStream &stream, const DBusMessageObject &messageObj);
+LIBQDBUSMONITOR_API QDataStream &operator>>(QDataStream &stream, DBusMessageObject &messageObj);
+
 #endif // DBUSMESSAGEOBJECT_H
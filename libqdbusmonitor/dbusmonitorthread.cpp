@@ -8,17 +8,30 @@ DBusMonitorThread::DBusMonitorThread(QObject *parent)
 {
 }
 
+DBusMonitorThread::~DBusMonitorThread()
+{
+    stop();
+    wait();
+    delete d_ptr;
+}
+
+
+bool DBusMonitorThread::startOnSessionBus(const QStringList &matchRules)
+{
+    Q_D(DBusMonitorThread);
+    return d->startBus(DBUS_BUS_SESSION, matchRules);
+}
 
-bool DBusMonitorThread::startOnSessionBus()
+bool DBusMonitorThread::startOnSystemBus(const QStringList &matchRules)
 {
     Q_D(DBusMonitorThread);
-    return d->startBus(DBUS_BUS_SESSION);
+    return d->startBus(DBUS_BUS_SYSTEM, matchRules);
 }
 
-bool DBusMonitorThread::startOnSystemBus()
+bool DBusMonitorThread::startOnAddress(const QString &address, const QStringList &matchRules)
 {
     Q_D(DBusMonitorThread);
-    return d->startBus(DBUS_BUS_SYSTEM);
+    return d->startAddress(address, matchRules);
 }
 
 bool DBusMonitorThread::isMonitorActive() const
@@ -27,6 +40,104 @@ bool DBusMonitorThread::isMonitorActive() const
     return d->m_monitor_active;
 }
 
+void DBusMonitorThread::stop()
+{
+    Q_D(DBusMonitorThread);
+    requestInterruption();
+    d->wakeUp();
+}
+
+QString DBusMonitorThread::busName() const
+{
+    Q_D(const DBusMonitorThread);
+    return d->m_busName;
+}
+
+void DBusMonitorThread::setDecodeThreads(int count)
+{
+    Q_D(DBusMonitorThread);
+    if (isRunning()) {
+        return;
+    }
+    d->m_decodeThreads = qMax(0, count);
+}
+
+int DBusMonitorThread::decodeThreads() const
+{
+    Q_D(const DBusMonitorThread);
+    return d->m_decodeThreads;
+}
+
+void DBusMonitorThread::setSampling(const SamplingConfig &config)
+{
+    Q_D(DBusMonitorThread);
+    if (isRunning()) {
+        return;
+    }
+    d->m_sampler.setConfig(config);
+}
+
+SamplingConfig DBusMonitorThread::sampling() const
+{
+    Q_D(const DBusMonitorThread);
+    return d->m_sampler.config();
+}
+
+quint64 DBusMonitorThread::sampledOutCount() const
+{
+    Q_D(const DBusMonitorThread);
+    return d->m_sampler.sampledOutCount();
+}
+
+void DBusMonitorThread::setFilter(const MessageFilter &filter)
+{
+    Q_D(DBusMonitorThread);
+    QMutexLocker guard(&d->m_filterMutex);
+    d->m_pendingFilter = filter;
+    d->m_filterChanged.storeRelease(1);
+}
+
+MessageFilter DBusMonitorThread::filter() const
+{
+    Q_D(const DBusMonitorThread);
+    QMutexLocker guard(&d->m_filterMutex);
+    return d->m_pendingFilter;
+}
+
+DBusResolverStats DBusMonitorThread::resolverStats() const
+{
+    Q_D(const DBusMonitorThread);
+    DBusResolverStats stats;
+    stats.nameHits = d->m_nameHits.load();
+    stats.nameMisses = d->m_nameMisses.load();
+    stats.pidHits = d->m_pidHits.load();
+    stats.pidMisses = d->m_pidMisses.load();
+    stats.exeHits = d->m_exeHits.load();
+    stats.exeMisses = d->m_exeMisses.load();
+    return stats;
+}
+
+const NameOwnerHistory &DBusMonitorThread::nameOwnerHistory() const
+{
+    Q_D(const DBusMonitorThread);
+    return d->m_ownerHistory;
+}
+
+void DBusMonitorThread::setRecordNameOwners(bool record)
+{
+    Q_D(DBusMonitorThread);
+    if (isRunning()) {
+        return;
+    }
+    d->m_recordNameOwners = record;
+}
+
+bool DBusMonitorThread::recordNameOwners() const
+{
+    Q_D(const DBusMonitorThread);
+    return d->m_recordNameOwners;
+}
+
 void DBusMonitorThread::run()
 {
     Q_D(DBusMonitorThread);
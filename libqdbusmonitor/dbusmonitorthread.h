@@ -5,10 +5,38 @@
 
 #include "libqdbusmonitor.h"
 #include "dbusmessageobject.h"
+#include "messagefilter.h"
+#include "messagesampler.h"
+#include "nameownerhistory.h"
 
 
 class DBusMonitorThreadPrivate;
 
+
+// Lookups of message endpoints in capture thread caches; "pid" counts
+//   credentials cache lookups, "exe" the hits with executable known
+struct DBusResolverStats {
+    quint64 nameHits = 0;
+    quint64 nameMisses = 0;
+    quint64 pidHits = 0;
+    quint64 pidMisses = 0;
+    quint64 exeHits = 0;
+    quint64 exeMisses = 0;
+
+    DBusResolverStats &operator+=(const DBusResolverStats &o) {
+        nameHits += o.nameHits;
+        nameMisses += o.nameMisses;
+        pidHits += o.pidHits;
+        pidMisses += o.pidMisses;
+        exeHits += o.exeHits;
+        exeMisses += o.exeMisses;
+        return *this;
+    }
+};
+
+
+// Several instances can run at once, each with its own private bus
+//   connection and thread; see MessageMerger to combine their output.
 class LIBQDBUSMONITOR_API DBusMonitorThread: public QThread
 {
     Q_OBJECT
@@ -16,10 +44,50 @@ class LIBQDBUSMONITOR_API DBusMonitorThread: public QThread
 
 public:
     explicit DBusMonitorThread(QObject *parent = nullptr);
+    ~DBusMonitorThread() override;
 
-    bool startOnSessionBus();
-    bool startOnSystemBus();
+    // Match rules are passed to dbus-daemon, so that it does not even send us
+    //   messages which do not match any of them. Empty list means everything.
+    bool startOnSessionBus(const QStringList &matchRules = QStringList());
+    bool startOnSystemBus(const QStringList &matchRules = QStringList());
+    // any bus by address, e.g. "unix:path=/run/user/1000/bus" or a private test bus
+    bool startOnAddress(const QString &address, const QStringList &matchRules = QStringList());
     bool isMonitorActive() const;
+    // Stops capture at once, can be called from any thread; wait() for the
+    //   thread to finish. Capture thread sleeps until the bus has data, so
+    //   plain requestInterruption() is noticed only on the next message.
+    void stop();
+    // "session", "system" or bus address, set when started; stored in every captured message
+    QString busName() const;
+
+    // Threads which parse and resolve captured messages, capture thread
+    //   itself only keeps track of bus names. 0 does everything on capture
+    //   thread. Default depends on number of cores; set before starting.
+    void setDecodeThreads(int count);
+    int decodeThreads() const;
+
+    // Records only part of the traffic, see MessageSampler; set before
+    //   starting. Sampling happens after filtering.
+    void setSampling(const SamplingConfig &config);
+    SamplingConfig sampling() const;
+    // messages left out by sampling, can be called from any thread
+    quint64 sampledOutCount() const;
+
+    // can be changed at any time, applied by capture thread to the next message
+    void setFilter(const MessageFilter &filter);
+    MessageFilter filter() const;
+
+    // can be called from any thread
+    DBusResolverStats resolverStats() const;
+    // Owners of well-known names since start, to resolve names as they
+    //   were at some earlier time; lives as long as this object
+    const NameOwnerHistory &nameOwnerHistory() const;
+    // Emits NameOwnerChanged signals of the bus driver for well-known names
+    //   whatever filter and sampling say, after one such signal for every
+    //   name owned at start, so that NameOwnerHistory::add() can rebuild
+    //   history from output, e.g. a capture file; set before starting
+    void setRecordNameOwners(bool record);
+    bool recordNameOwners() const;
 
 protected:
     void run() override;
@@ -27,6 +95,8 @@ protected:
 Q_SIGNALS:
     void isMonitorActiveChanged();
     void dbusDisconnected();
+    // Emitted from capture thread or a decode thread, in capture order and
+    //   never from two threads at once
     void messageReceived(DBusMessageObject messageObj);
 
 private:
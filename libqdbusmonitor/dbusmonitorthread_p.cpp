@@ -1,9 +1,21 @@
+#include <string.h>
 #include <QLoggingCategory>
+#include <QVector>
 #include "dbusmonitorthread_p.h"
 #include "dbusmonitorthread.h"
 #include "messagecontentsparser.h"
 #include "utils.h"
 
+#ifdef Q_OS_LINUX
+#include <errno.h>
+#include <limits.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#endif
+
 
 Q_LOGGING_CATEGORY(logMon, "monitor.thread")
 
@@ -22,13 +34,90 @@ Q_LOGGING_CATEGORY(logMon, "monitor.thread")
 static bool DBUSMONITOR_DEBUG = false;
 
 
+// how long capture thread waits for credentials of connections;
+//   bus daemon answers from memory, this only guards against a stuck one
+static const int CREDENTIALS_TIMEOUT_MS = 1000;
+
+#ifdef Q_OS_LINUX
+// events taken from one epoll_wait()
+static const int MAX_EPOLL_EVENTS = 8;
+// how many times a readable socket is read again in one wakeup,
+//   dispatching in between keeps libdbus receive buffer small
+static const int MAX_READS_PER_WAKEUP = 64;
+#endif
+
+
+static inline uint align8(uint offset)
+{
+    return (offset + 7) & ~7u;
+}
+
+// header field holding a string or object path: code, signature, length, value and NUL
+static uint addStringField(uint offset, const char *value)
+{
+    if (!value) {
+        return offset;
+    }
+    return align8(offset) + 8 + static_cast<uint>(strlen(value)) + 1;
+}
+
+// libdbus has no accessor for it, and marshalling a copy only to measure
+//   it is too slow; header is 16 fixed bytes, then fields each aligned
+//   to 8, then padding to 8 (see Message Format in D-Bus specification)
+static uint messageWireSize(DBusMessage *message, const MessageWireSize &body)
+{
+    uint offset = 16;
+    offset = addStringField(offset, dbus_message_get_path(message));
+    offset = addStringField(offset, dbus_message_get_interface(message));
+    offset = addStringField(offset, dbus_message_get_member(message));
+    offset = addStringField(offset, dbus_message_get_error_name(message));
+    offset = addStringField(offset, dbus_message_get_destination(message));
+    offset = addStringField(offset, dbus_message_get_sender(message));
+    if (dbus_message_get_reply_serial(message) != 0) {
+        offset = align8(offset) + 8;
+    }
+    const char *signature = dbus_message_get_signature(message);
+    if (signature && signature[0] != '\0') {
+        offset = align8(offset) + 4 + 1 + static_cast<uint>(strlen(signature)) + 1;
+    }
+    if (body.unixFds > 0) {
+        offset = align8(offset) + 8;
+    }
+    return align8(offset) + body.bodySize;
+}
+
+
 DBusMonitorThreadPrivate::DBusMonitorThreadPrivate(DBusMonitorThread *parent)
     : owner(parent)
 {
+    // messages are referenced and read on decode workers
+    dbus_threads_init_default();
+
+    // leave a core for capture thread and one for consumers
+    const int cores = QThread::idealThreadCount();
+    m_decodeThreads = (cores > 2) ? qMin(cores - 2, 4) : 0;
+    m_pipeline.setFunctions(
+        [this] (DecodeJob &job) { return decode(job); },
+        [this] (const DBusMessageObject &messageObj) { Q_EMIT owner->messageReceived(messageObj); });
+#ifdef Q_OS_LINUX
+    m_wakeFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (m_wakeFd < 0) {
+        qCWarning(logMon) << "eventfd() failed:" << strerror(errno);
+    }
+#endif
 }
 
+DBusMonitorThreadPrivate::~DBusMonitorThreadPrivate()
+{
+#ifdef Q_OS_LINUX
+    if (m_wakeFd >= 0) {
+        ::close(m_wakeFd);
+    }
+#endif
+}
 
-bool DBusMonitorThreadPrivate::becomeMonitor()
+
+bool DBusMonitorThreadPrivate::becomeMonitor(const QStringList &matchRules)
 {
     DBusError error = DBUS_ERROR_INIT;
     DBusMessage *msg = nullptr;
@@ -51,6 +140,14 @@ bool DBusMonitorThreadPrivate::becomeMonitor()
         Utils::fatal_oom("opening string array");
     }
 
+    for (const QString &rule: matchRules) {
+        const QByteArray ruleUtf8 = rule.toUtf8();
+        const char *str_ptr = ruleUtf8.constData();
+        if (!dbus_message_iter_append_basic(&array_appender, DBUS_TYPE_STRING, &str_ptr)) {
+            Utils::fatal_oom("appending match rule");
+        }
+    }
+
     if (!dbus_message_iter_close_container(&appender, &array_appender) ||
             !dbus_message_iter_append_basic(&appender, DBUS_TYPE_UINT32, &zero)) {
         Utils::fatal_oom("finishing arguments");
@@ -77,7 +174,36 @@ bool DBusMonitorThreadPrivate::becomeMonitor()
 }
 
 
-bool DBusMonitorThreadPrivate::startBus(DBusBusType type)
+bool DBusMonitorThreadPrivate::addEavesdropMatches(const QStringList &matchRules)
+{
+    QStringList rules = matchRules;
+    if (rules.isEmpty()) {
+        rules.append(QString()); // match everything
+    }
+
+    for (const QString &rule: rules) {
+        DBusError derror = DBUS_ERROR_INIT;
+        const QString eavesdropRule = rule.isEmpty()
+                ? QStringLiteral("eavesdrop=true")
+                : QString(QStringLiteral("eavesdrop=true,") + rule);
+        dbus_bus_add_match(m_dconn, eavesdropRule.toUtf8().constData(), &derror);
+        if (dbus_error_is_set(&derror)) {
+            // hack for even older dbus server, which does not know eavesdrop
+            dbus_error_free(&derror);
+            dbus_bus_add_match(m_dconn, rule.toUtf8().constData(), &derror);
+            if (dbus_error_is_set(&derror)) {
+                qCWarning(logMon) << "Falling back to eavesdropping failed for rule:" << rule;
+                qCWarning(logMon) << "Error: " << derror.message;
+                dbus_error_free(&derror);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+
+bool DBusMonitorThreadPrivate::startBus(DBusBusType type, const QStringList &matchRules)
 {
     if (m_dconn || m_dconn2) {
         qCDebug(logMon) << "Already running!";
@@ -91,12 +217,17 @@ bool DBusMonitorThreadPrivate::startBus(DBusBusType type)
     DBusError derror;
     dbus_error_init(&derror);
 
-    m_dconn = dbus_bus_get(type, &derror);
+    // private, so that other monitor instances in this process
+    //   (and anyone using the shared connection) are not affected by BecomeMonitor
+    m_dconn = dbus_bus_get_private(type, &derror);
     if (!m_dconn) {
         qCWarning(logMon) << "Failed to open dbus connction:" << derror.message;
         dbus_error_free(&derror);
         return false;
     }
+    // report it with dbusDisconnected() instead of exiting the whole process
+    dbus_connection_set_exit_on_disconnect(m_dconn, FALSE);
+    m_busName = (type == DBUS_BUS_SYSTEM) ? QStringLiteral("system") : QStringLiteral("session");
 
     // open second private connection to bus
     dbus_error_init(&derror);
@@ -110,6 +241,62 @@ bool DBusMonitorThreadPrivate::startBus(DBusBusType type)
         return false;
     }
 
+    return setupMonitor(matchRules);
+}
+
+
+// Connects to a bus by address and registers on it (sends Hello),
+//   what dbus_bus_get_private() does for well-known buses
+static DBusConnection *openPrivateAddress(const QByteArray &address)
+{
+    DBusError derror = DBUS_ERROR_INIT;
+    DBusConnection *conn = dbus_connection_open_private(address.constData(), &derror);
+    if (!conn) {
+        qCWarning(logMon) << "Failed to connect to" << address << ":" << derror.message;
+        dbus_error_free(&derror);
+        return nullptr;
+    }
+    if (!dbus_bus_register(conn, &derror)) {
+        qCWarning(logMon) << "Failed to register on bus" << address << ":" << derror.message;
+        dbus_error_free(&derror);
+        dbus_connection_close(conn);
+        dbus_connection_unref(conn);
+        return nullptr;
+    }
+    dbus_connection_set_exit_on_disconnect(conn, FALSE);
+    return conn;
+}
+
+
+bool DBusMonitorThreadPrivate::startAddress(const QString &address, const QStringList &matchRules)
+{
+    if (m_dconn || m_dconn2) {
+        qCDebug(logMon) << "Already running!";
+        return false;
+    }
+
+    DBUSMONITOR_DEBUG = !qgetenv("DBUSMONITOR_DEBUG").isEmpty();
+
+    const QByteArray addressUtf8 = address.toUtf8();
+    m_dconn = openPrivateAddress(addressUtf8);
+    if (!m_dconn) {
+        return false;
+    }
+    m_dconn2 = openPrivateAddress(addressUtf8);
+    if (!m_dconn2) {
+        closeDbusConn();
+        return false;
+    }
+    m_busName = address;
+
+    return setupMonitor(matchRules);
+}
+
+
+bool DBusMonitorThreadPrivate::setupMonitor(const QStringList &matchRules)
+{
+    DBusError derror;
+
     m_myName = QString::fromUtf8(dbus_bus_get_unique_name(m_dconn));
     m_myName2 = QString::fromUtf8(dbus_bus_get_unique_name(m_dconn2));
     qCDebug(logMon) << "Connected to D_Bus as: " << m_myName << m_myName2;
@@ -167,28 +354,27 @@ bool DBusMonitorThreadPrivate::startBus(DBusBusType type)
         qCDebug(logMon) << " known bus names: " << knownNames;
     }
 
-    // for each known name request its owner and pid
+    // for each known name request its owner, for each connection its credentials;
+    //   only here, before capture: later NameOwnerChanged tells about every change
+    m_credentials.clear();
+    m_ownerHistory.clear();
+    m_startTime = QDateTime::currentMSecsSinceEpoch();
+    QStringList connections;
     for (const QString &busName: knownNames) {
-        // query name owner
-        if (!Utils::isNumericAddress(busName)) {
-            const QString nameOwner = queryNameOwner(busName);
-            if (!nameOwner.isEmpty()) {
-                addNameOwner(busName, nameOwner);
-                if (DBUSMONITOR_DEBUG) {
-                    qCDebug(logMon) << "  name owner:" << busName << nameOwner;
-                }
-            }
+        if (Utils::isNumericAddress(busName)) {
+            connections.append(busName);
+            continue;
         }
-
-        // query name PID
-        uint namePid = queryBusNameUnixPid(busName);
-        if (namePid > 0) {
-            addNamePid(busName, namePid);
+        const QString nameOwner = queryNameOwner(busName);
+        if (!nameOwner.isEmpty()) {
+            addNameOwner(busName, nameOwner);
+            m_ownerHistory.setOwner(busName, nameOwner, m_startTime);
             if (DBUSMONITOR_DEBUG) {
-                qCDebug(logMon) << "  name pid:" << busName << namePid;
+                qCDebug(logMon) << "  name owner:" << busName << nameOwner;
             }
         }
     }
+    queryCredentials(connections);
 
     // Receive o.fd.Peer messages as normal messages, rather than having
     // libdbus handle them internally, which is the wrong thing for a monitor
@@ -200,18 +386,19 @@ bool DBusMonitorThreadPrivate::startBus(DBusBusType type)
         return false;
     }
 
-    if (!becomeMonitor()) {
+    QStringList rules = matchRules;
+    if (!rules.isEmpty()) {
+        // bus names tracking needs these, even if user is not interested in them
+        rules.append(QStringLiteral("type='signal',sender='" DBUS_SERVICE_DBUS "',interface='" DBUS_INTERFACE_DBUS "'"));
+        rules.append(QStringLiteral("type='method_call',interface='" DBUS_INTERFACE_DBUS "',member='Hello'"));
+        qCDebug(logMon) << "Daemon-side match rules:" << rules;
+    }
+
+    if (!becomeMonitor(rules)) {
         // hack for old dbus server
-        dbus_bus_add_match(m_dconn, "eavesdrop=true", &derror);
-        if (dbus_error_is_set(&derror)) {
-            dbus_error_free(&derror);
-            dbus_bus_add_match(m_dconn, "", &derror);
-            if (dbus_error_is_set(&derror)) {
-                qCWarning(logMon) << "Falling back to eavesdropping failed!";
-                qCWarning(logMon) << "Error: " << derror.message;
-                closeDbusConn();
-                return false;
-            }
+        if (!addEavesdropMatches(rules)) {
+            closeDbusConn();
+            return false;
         }
     }
 
@@ -223,6 +410,7 @@ bool DBusMonitorThreadPrivate::startBus(DBusBusType type)
 void DBusMonitorThreadPrivate::closeDbusConn()
 {
     if (m_dconn) {
+        dbus_connection_close(m_dconn);
         dbus_connection_unref(m_dconn);
         m_dconn = nullptr;
     }
@@ -238,34 +426,108 @@ void DBusMonitorThreadPrivate::closeDbusConn()
     m_monitor_active = false;
 }
 
-uint DBusMonitorThreadPrivate::queryBusNameUnixPid(const QString &busName)
+DBusPendingCall *DBusMonitorThreadPrivate::requestCredentials(const QString &busAddr)
 {
-    uint namePid = 0;
-    DBusError derror = DBUS_ERROR_INIT;
     DBusMessage *dmsg = dbus_message_new_method_call(
-                DBUS_SERVICE_DBUS, DBUS_PATH_DBUS, DBUS_INTERFACE_DBUS, "GetConnectionUnixProcessID");
+                DBUS_SERVICE_DBUS, DBUS_PATH_DBUS, DBUS_INTERFACE_DBUS, "GetConnectionCredentials");
     if (!dmsg) {
         Utils::fatal_oom("create new message");
     }
-    std::string stds = busName.toStdString();
-    const char *str_ptr = stds.c_str();
+    const QByteArray addrUtf8 = busAddr.toUtf8();
+    const char *str_ptr = addrUtf8.constData();
     dbus_message_append_args(dmsg, DBUS_TYPE_STRING, &str_ptr, DBUS_TYPE_INVALID);
-    dbus_error_init(&derror);
-    DBusMessage *dreply = dbus_connection_send_with_reply_and_block(m_dconn2, dmsg, 15000, &derror);
-    if (dreply) {
-        dbus_error_init(&derror);
-        if (!dbus_message_get_args(dreply, &derror, DBUS_TYPE_UINT32, &namePid, DBUS_TYPE_INVALID)) {
-            qCWarning(logMon) << "Failed to read name owner pid:" << derror.message;
-            dbus_error_free(&derror);
-        }
-        dbus_message_unref(dreply);
-    } else {
-        qCWarning(logMon) << "WARNING: Call to GetConnectionUnixProcessID() failed! null reply!"
-                          << derror.message;
-        dbus_error_free(&derror);
+    DBusPendingCall *pending = nullptr;
+    if (!dbus_connection_send_with_reply(m_dconn2, dmsg, &pending, CREDENTIALS_TIMEOUT_MS) || !pending) {
+        qCWarning(logMon) << "Failed to request credentials of" << busAddr;
+        pending = nullptr;
     }
     dbus_message_unref(dmsg);
-    return namePid;
+    return pending;
+}
+
+void DBusMonitorThreadPrivate::queryCredentials(const QStringList &busAddrs)
+{
+    // all requests go out at once, so many connections cost one round trip
+    QVector<DBusPendingCall *> pendings;
+    pendings.reserve(busAddrs.size());
+    for (const QString &busAddr: busAddrs) {
+        pendings.append(requestCredentials(busAddr));
+    }
+    for (int i = 0; i < busAddrs.size(); i++) {
+        DBusPendingCall *pending = pendings.at(i);
+        if (!pending) {
+            continue;
+        }
+        dbus_pending_call_block(pending);
+        DBusMessage *dreply = dbus_pending_call_steal_reply(pending);
+        dbus_pending_call_unref(pending);
+        if (dreply) {
+            storeCredentials(busAddrs.at(i), dreply);
+            dbus_message_unref(dreply);
+        }
+    }
+}
+
+void DBusMonitorThreadPrivate::storeCredentials(const QString &busAddr, DBusMessage *dreply)
+{
+    if (dbus_message_get_type(dreply) == DBUS_MESSAGE_TYPE_ERROR) {
+        // usually connection is already gone
+        qCDebug(logMon) << "No credentials for" << busAddr << dbus_message_get_error_name(dreply);
+        return;
+    }
+
+    // a{sv}, keys as in D-Bus specification; unknown ones are skipped
+    ConnectionCredentials credentials;
+    DBusMessageIter args, dict;
+    dbus_message_iter_init(dreply, &args);
+    if (dbus_message_iter_get_arg_type(&args) == DBUS_TYPE_ARRAY) {
+        dbus_message_iter_recurse(&args, &dict);
+        while (dbus_message_iter_get_arg_type(&dict) == DBUS_TYPE_DICT_ENTRY) {
+            DBusMessageIter entry, variant;
+            dbus_message_iter_recurse(&dict, &entry);
+            const char *key = nullptr;
+            dbus_message_iter_get_basic(&entry, &key);
+            dbus_message_iter_next(&entry);
+            dbus_message_iter_recurse(&entry, &variant);
+            const int vtype = dbus_message_iter_get_arg_type(&variant);
+            if (vtype == DBUS_TYPE_UINT32 && strcmp(key, "ProcessID") == 0) {
+                dbus_message_iter_get_basic(&variant, &credentials.pid);
+            } else if (vtype == DBUS_TYPE_UINT32 && strcmp(key, "UnixUserID") == 0) {
+                dbus_message_iter_get_basic(&variant, &credentials.uid);
+                credentials.hasUid = true;
+            } else if (vtype == DBUS_TYPE_ARRAY && strcmp(key, "UnixGroupIDs") == 0) {
+                DBusMessageIter items;
+                dbus_message_iter_recurse(&variant, &items);
+                while (dbus_message_iter_get_arg_type(&items) == DBUS_TYPE_UINT32) {
+                    uint gid = 0;
+                    dbus_message_iter_get_basic(&items, &gid);
+                    credentials.groupIds.append(gid);
+                    dbus_message_iter_next(&items);
+                }
+            } else if (vtype == DBUS_TYPE_ARRAY && strcmp(key, "LinuxSecurityLabel") == 0
+                       && dbus_message_iter_get_element_type(&variant) == DBUS_TYPE_BYTE) {
+                DBusMessageIter items;
+                const char *bytes = nullptr;
+                int len = 0;
+                dbus_message_iter_recurse(&variant, &items);
+                dbus_message_iter_get_fixed_array(&items, &bytes, &len);
+                // includes terminating NUL
+                credentials.securityLabel = QString::fromUtf8(bytes, static_cast<int>(qstrnlen(bytes, static_cast<uint>(len))));
+            }
+            dbus_message_iter_next(&dict);
+        }
+    }
+
+    // one readlink now, while process is most likely still there
+    if (credentials.pid > 0) {
+        credentials.exe = Utils::pid2filename(credentials.pid);
+    }
+
+    if (DBUSMONITOR_DEBUG) {
+        qCDebug(logMon) << "  credentials:" << busAddr << "pid" << credentials.pid
+                        << "uid" << credentials.uid << credentials.securityLabel;
+    }
+    m_credentials.insert(busAddr, credentials);
 }
 
 QString DBusMonitorThreadPrivate::queryNameOwner(const QString &busName)
@@ -298,69 +560,111 @@ QString DBusMonitorThreadPrivate::queryNameOwner(const QString &busName)
 
 void DBusMonitorThreadPrivate::addNameOwner(const QString &busName, const QString &busAddr)
 {
-    if (m_addrNames.contains(busAddr)) {
-        QStringList &namesList = m_addrNames[busAddr];
+    if (m_names.addrNames.contains(busAddr)) {
+        QStringList &namesList = m_names.addrNames[busAddr];
         namesList.append(busName);
     } else {
         QStringList namesList{busName};
-        m_addrNames[busAddr] = namesList;
+        m_names.addrNames[busAddr] = namesList;
     }
+    m_names.nameOwners[busName] = busAddr;
 }
 
 void DBusMonitorThreadPrivate::removeNameOwner(const QString &busAddr, const QString &busName)
 {
-    if (m_addrNames.contains(busAddr)) {
-        QStringList &namesList = m_addrNames[busAddr];
+    if (m_names.addrNames.contains(busAddr)) {
+        QStringList &namesList = m_names.addrNames[busAddr];
         namesList.removeAll(busName);
+        if (namesList.isEmpty()) {
+            m_names.addrNames.remove(busAddr);
+        }
+    }
+    const auto it = m_names.nameOwners.find(busName);
+    if (it != m_names.nameOwners.end() && it.value() == busAddr) {
+        m_names.nameOwners.erase(it);
     }
 }
 
-
-void DBusMonitorThreadPrivate::addNamePid(const QString &busName, uint pid)
+void DBusMonitorThreadPrivate::nameOwnerChanged(const QString &busName, const QString &oldOwner,
+                                                const QString &newOwner, qint64 timeMs)
 {
-    m_addrPids[busName] = pid;
+    if (Utils::isNumericAddress(busName)) {
+        if (newOwner.isEmpty()) {
+            // client disconnected, its address will not be seen again;
+            //   messages already submitted may still look it up
+            m_credentials.retire(busName, m_pipeline.nextSequence());
+        }
+        return;
+    }
+    if (!oldOwner.isEmpty()) {
+        removeNameOwner(oldOwner, busName);
+    }
+    if (!newOwner.isEmpty()) {
+        addNameOwner(busName, newOwner);
+    }
+    m_ownerHistory.setOwner(busName, newOwner, timeMs);
+    qCDebug(logMon) << "name owner changed:" << busName << oldOwner << "->" << newOwner;
 }
 
 
-QStringList DBusMonitorThreadPrivate::resolveDBusAddressToName(const QString &addr)
+QStringList DBusMonitorThreadPrivate::resolveDBusAddressToName(const BusNames &names, const QString &addr) const
 {
     if (addr.isEmpty()) {
         return QStringList();
     }
-    if (m_addrNames.contains(addr)) {
-        return m_addrNames[addr];
+    const auto it = names.addrNames.constFind(addr);
+    if (it != names.addrNames.constEnd()) {
+        m_nameHits.fetchAndAddRelaxed(1);
+        return it.value();
     }
+    m_nameMisses.fetchAndAddRelaxed(1);
     // qCDebug(logMon) << "Failed to resolve bus addr to name:" << addr;
     // ^^ This is perfectly normal, not every address should have a name on bus
     return QStringList();
 }
 
-QString DBusMonitorThreadPrivate::resolveNameAddress(const QString &name)
+QString DBusMonitorThreadPrivate::resolveNameAddress(const BusNames &names, const QString &name) const
 {
     if (name.isEmpty()) {
         return QString();
     }
-    for (const QString &addr: m_addrNames.keys()) {
-        const QStringList &names = m_addrNames[addr];
-        if (names.contains(name)) {
-            return addr;
-        }
+    const auto it = names.nameOwners.constFind(name);
+    if (it != names.nameOwners.constEnd()) {
+        return it.value();
     }
     qCDebug(logMon) << "Failed to resolve name bus addr:" << name;
     // ^^ This is wrong, every name should have a numeric address
     return QString();
 }
 
-uint DBusMonitorThreadPrivate::resolvePid(const QString &addr)
+ConnectionCredentialsPtr DBusMonitorThreadPrivate::resolveCredentials(const QString &addr) const
 {
     if (addr.isEmpty()) {
-        return 0;
+        return ConnectionCredentialsPtr();
     }
-    if (m_addrPids.contains(addr)) {
-        return m_addrPids[addr];
+    const ConnectionCredentialsPtr credentials = m_credentials.lookup(addr);
+    if (!credentials) {
+        m_pidMisses.fetchAndAddRelaxed(1);
+        return credentials;
     }
-    qCDebug(logMon) << "Cannot resolve PID for:" << addr;
-    return 0;
+    m_pidHits.fetchAndAddRelaxed(1);
+    if (!credentials->exe.isEmpty()) {
+        m_exeHits.fetchAndAddRelaxed(1);
+    } else {
+        m_exeMisses.fetchAndAddRelaxed(1);
+    }
+    return credentials;
+}
+
+
+void DBusMonitorThreadPrivate::syncFilter()
+{
+    if (m_filterChanged.loadAcquire() == 0) {
+        return;
+    }
+    QMutexLocker guard(&m_filterMutex);
+    m_filter = m_pendingFilter;
+    m_filterChanged.storeRelease(0);
 }
 
 
@@ -377,68 +681,86 @@ DBusHandlerResult DBusMonitorThreadPrivate::monitorFunc(
         return DBUS_HANDLER_RESULT_HANDLED;
     }
 
-    // get base message properties
-    DBusMessageObject messageObj;
-    messageObj.timestamp = QDateTime::currentDateTime();
-    messageObj.senderAddress = QString::fromUtf8(dbus_message_get_sender(message));
-    messageObj.destinationAddress = QString::fromUtf8(dbus_message_get_destination(message));
-    // destinationAddress may be in form of numeric address ":x.y" or in form of bus name "org.kde.xxxx"
-    messageObj.type = dbus_message_get_type (message);
-    messageObj.typeString = Utils::dbusMessageTypeToString(messageObj.type);
-
     // handle messages from DBus about new clients
     if (dbus_message_is_method_call(message, DBUS_INTERFACE_DBUS, "Hello")) {
         // new bus client connected
-        qCDebug(logMon) << "new client connected:" << messageObj.senderAddress;
-        uint namePid = owner->d_ptr->queryBusNameUnixPid(messageObj.senderAddress);
-        if (namePid > 0) {
-            qCDebug(logMon) << "   new client PID:" << namePid;
-            owner->d_ptr->addNamePid(messageObj.senderAddress, namePid);
-        } else {
-            qCWarning(logMon) << "   failed to query unix PID for new client!";
-        }
+        const QString clientAddress = QString::fromUtf8(dbus_message_get_sender(message));
+        qCDebug(logMon) << "new client connected:" << clientAddress;
+        // one round trip, before any message of this client is decoded
+        owner->d_ptr->queryCredentials(QStringList{clientAddress});
     }
 
-    // handle messages from DBus about new names
-    if (dbus_message_is_signal(message, DBUS_INTERFACE_DBUS, "NameAcquired")) {
-        // NameAcquired(STRING name)
-        char *str_ptr = nullptr;
+    // handle messages from DBus about names changing owners; broadcast to
+    //   everyone and tells both owners, so no need to ask the bus
+    bool wellKnownOwnerChange = false;
+    if (dbus_message_is_signal(message, DBUS_INTERFACE_DBUS, "NameOwnerChanged")
+            && dbus_message_has_sender(message, DBUS_SERVICE_DBUS)) {
+        // NameOwnerChanged(STRING name, STRING old_owner, STRING new_owner)
+        char *name_ptr = nullptr;
+        char *old_ptr = nullptr;
+        char *new_ptr = nullptr;
         DBusError derror = DBUS_ERROR_INIT;
-        if (dbus_message_get_args(message, &derror, DBUS_TYPE_STRING, &str_ptr, DBUS_TYPE_INVALID)) {
-            const QString newName = QString::fromUtf8(str_ptr);
-            // name may be numeric, if so, no need to resolve it
-            if (!Utils::isNumericAddress(newName)) {
-                const QString nameOwner = owner->d_ptr->queryNameOwner(newName);
-                if (!nameOwner.isEmpty()) {
-                    owner->d_ptr->addNameOwner(newName, nameOwner);
-                    qCDebug(logMon) << "new name on bus: " << newName << nameOwner;
-                }
-            }
+        if (dbus_message_get_args(message, &derror, DBUS_TYPE_STRING, &name_ptr,
+                                  DBUS_TYPE_STRING, &old_ptr, DBUS_TYPE_STRING, &new_ptr,
+                                  DBUS_TYPE_INVALID)) {
+            const QString busName = QString::fromUtf8(name_ptr);
+            owner->d_ptr->nameOwnerChanged(busName, QString::fromUtf8(old_ptr),
+                                           QString::fromUtf8(new_ptr), QDateTime::currentMSecsSinceEpoch());
+            wellKnownOwnerChange = !Utils::isNumericAddress(busName);
+        } else {
+            dbus_error_free(&derror);
         }
     }
 
-    // handle messages from DBus about names gone
-    if (dbus_message_is_signal(message, DBUS_INTERFACE_DBUS, "NameLost")) {
-        // NameLost(STRING name)
-        char *str_ptr = nullptr;
-        DBusError derror = DBUS_ERROR_INIT;
-        if (dbus_message_get_args(message, &derror, DBUS_TYPE_STRING, &str_ptr, DBUS_TYPE_INVALID)) {
-            const QString busName = QString::fromUtf8(str_ptr);
-            const QString busAddr = QString::fromUtf8(dbus_message_get_destination(message));
-            //qCDebug(logMon) << "NameLost:" << busName << busAddr;
-            // NameLost: ":1.1319" :1.1319
-            // NameLost: "org.dharkael.Flameshot" :1.1225
-
-            // name may be numeric, if so, no need to delete it
-            if (!Utils::isNumericAddress(busName)) {
-                owner->d_ptr->removeNameOwner(busAddr, busName);
-                qCDebug(logMon) << "remove name:" << busName << "from" << busAddr;
-            }
-        }
+    // Bus names bookkeeping above has to see every message, but everything
+    //   below is skipped for messages which user filter can reject by header
+    owner->d_ptr->syncFilter();
+    // whatever filter and sampling say, output has to tell about every owner
+    const bool record = wellKnownOwnerChange && owner->d_ptr->m_recordNameOwners;
+    const MessageFilter::Match filterMatch = record ? MessageFilter::Match::Accepted
+                                                    : owner->d_ptr->m_filter.matchHeader(message);
+    if (filterMatch == MessageFilter::Match::Rejected) {
+        return DBUS_HANDLER_RESULT_HANDLED;
+    }
+    const double weight = record ? 1 : owner->d_ptr->m_sampler.sample(message);
+    if (weight <= 0) {
+        return DBUS_HANDLER_RESULT_HANDLED;
     }
 
+    // the rest is done on decode workers
+    DecodeJob job;
+    job.message = dbus_message_ref(message);
+    job.timestamp = QDateTime::currentDateTime();
+    job.filter = owner->d_ptr->m_filter;
+    job.needsDetails = (filterMatch == MessageFilter::Match::NeedsDetails);
+    job.weight = weight;
+    job.names = owner->d_ptr->m_names;
+    owner->d_ptr->m_pipeline.submit(std::move(job));
+
+    // Monitors must not allow libdbus to reply to messages, so we eat the message. See DBus bug 1719.
+    return DBUS_HANDLER_RESULT_HANDLED;
+}
+
+
+bool DBusMonitorThreadPrivate::decode(DecodeJob &job) const
+{
+    DBusMessage *message = job.message;
+    DBusMessageObject &messageObj = job.messageObj;
+
+    // get base message properties
+    messageObj.timestamp = job.timestamp;
+    messageObj.bus = m_busName;
+    messageObj.senderAddress = QString::fromUtf8(dbus_message_get_sender(message));
+    messageObj.destinationAddress = QString::fromUtf8(dbus_message_get_destination(message));
+    // destinationAddress may be in form of numeric address ":x.y" or in form of bus name "org.kde.xxxx"
+    messageObj.type = dbus_message_get_type (message);
+    messageObj.typeString = Utils::dbusMessageTypeToString(messageObj.type);
+    messageObj.weight = job.weight;
+
     switch (messageObj.type) {
         case DBUS_MESSAGE_TYPE_METHOD_CALL:
+            messageObj.noReply = dbus_message_get_no_reply(message);
+            Q_FALLTHROUGH();
         case DBUS_MESSAGE_TYPE_SIGNAL:
             messageObj.serial = dbus_message_get_serial(message);
             messageObj.path = QString::fromUtf8(dbus_message_get_path(message));
@@ -460,7 +782,9 @@ DBusHandlerResult DBusMonitorThreadPrivate::monitorFunc(
     // get message contents
     DBusMessageIter iter;
     dbus_message_iter_init(message, &iter);
-    messageObj.contents = parseMessageContents(&iter);
+    MessageWireSize bodySize;
+    messageObj.contents = parseMessageContents(&iter, &bodySize);
+    messageObj.size = messageWireSize(message, bodySize);
     if (DBUSMONITOR_DEBUG) {
         // only method calls and signals can contain useful contents?
         qCDebug(logMon) << messageObj.typeString << "contents:" << messageObj.contents;
@@ -468,59 +792,394 @@ DBusHandlerResult DBusMonitorThreadPrivate::monitorFunc(
 
     // resolve addresses to numeric
     if (!Utils::isNumericAddress(messageObj.senderAddress)) {
-        messageObj.senderAddress = owner->d_ptr->resolveNameAddress(messageObj.senderAddress);
+        messageObj.senderAddress = resolveNameAddress(job.names, messageObj.senderAddress);
     }
     if (!Utils::isNumericAddress(messageObj.destinationAddress)) {
-        messageObj.destinationAddress = owner->d_ptr->resolveNameAddress(messageObj.destinationAddress);
+        messageObj.destinationAddress = resolveNameAddress(job.names, messageObj.destinationAddress);
     }
 
-    bool thisIsMyMessage = false;
-    if ((messageObj.senderAddress == owner->d_ptr->m_myName)
-            || (messageObj.destinationAddress == owner->d_ptr->m_myName)) {
-        thisIsMyMessage = true;
+    // do not show messages from/to monitor itself
+    if ((messageObj.senderAddress == m_myName) || (messageObj.destinationAddress == m_myName)
+            || (messageObj.senderAddress == m_myName2) || (messageObj.destinationAddress == m_myName2)) {
+        return false;
+    }
+
+    messageObj.senderNames = resolveDBusAddressToName(job.names, messageObj.senderAddress);
+    messageObj.destinationNames = resolveDBusAddressToName(job.names, messageObj.destinationAddress);
+
+    // one lookup per endpoint; credentials of every connection seen
+    //   connecting are known before its first message is submitted
+    messageObj.senderCredentials = resolveCredentials(messageObj.senderAddress);
+    if (messageObj.senderCredentials) {
+        messageObj.senderPid = messageObj.senderCredentials->pid;
+        messageObj.senderExe = messageObj.senderCredentials->exe;
     }
-    if ((messageObj.senderAddress == owner->d_ptr->m_myName2)
-            || (messageObj.destinationAddress == owner->d_ptr->m_myName2)) {
-        thisIsMyMessage = true;
+    messageObj.destinationCredentials = resolveCredentials(messageObj.destinationAddress);
+    if (messageObj.destinationCredentials) {
+        messageObj.destinationPid = messageObj.destinationCredentials->pid;
+        messageObj.destinationExe = messageObj.destinationCredentials->exe;
     }
 
-    messageObj.senderPid = owner->d_ptr->resolvePid(messageObj.senderAddress);
-    messageObj.senderNames = owner->d_ptr->resolveDBusAddressToName(messageObj.senderAddress);
-    messageObj.destinationPid = owner->d_ptr->resolvePid(messageObj.destinationAddress);
-    messageObj.destinationNames = owner->d_ptr->resolveDBusAddressToName(messageObj.destinationAddress);
+    // filter terms on pid, exe or well-known names need resolved message
+    if (job.needsDetails && !job.filter.matchMessage(messageObj, message)) {
+        return false;
+    }
+    return true;
+}
+
 
+void DBusMonitorThreadPrivate::wakeUp()
+{
 #ifdef Q_OS_LINUX
-    if (messageObj.senderPid > 0) {
-        messageObj.senderExe = Utils::pid2filename(messageObj.senderPid);
-    }
-    if (messageObj.destinationPid > 0) {
-        messageObj.destinationExe = Utils::pid2filename(messageObj.destinationPid);
+    if (m_wakeFd >= 0) {
+        const uint64_t one = 1;
+        if (::write(m_wakeFd, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+            qCWarning(logMon) << "Failed to wake up capture thread:" << strerror(errno);
+        }
     }
 #endif
+}
+
+
+#ifdef Q_OS_LINUX
+
+dbus_bool_t DBusMonitorThreadPrivate::addWatch(DBusWatch *watch, void *data)
+{
+    DBusMonitorThreadPrivate *d = static_cast<DBusMonitorThreadPrivate *>(data);
+    const int fd = dbus_watch_get_unix_fd(watch);
+    d->m_watches[fd].append(watch);
+    return d->updateWatchedFd(fd);
+}
 
-    // maybe some other processing required
-    if (!thisIsMyMessage) {
-        // do not show messages from/to monitor itself
-        Q_EMIT owner->messageReceived(messageObj);
+void DBusMonitorThreadPrivate::removeWatch(DBusWatch *watch, void *data)
+{
+    DBusMonitorThreadPrivate *d = static_cast<DBusMonitorThreadPrivate *>(data);
+    const int fd = dbus_watch_get_unix_fd(watch);
+    auto it = d->m_watches.find(fd);
+    if (it == d->m_watches.end()) {
+        return;
+    }
+    it.value().removeAll(watch);
+    if (it.value().isEmpty()) {
+        d->m_watches.erase(it);
     }
+    d->updateWatchedFd(fd);
+}
 
-    // Monitors must not allow libdbus to reply to messages, so we eat the message. See DBus bug 1719.
-    return DBUS_HANDLER_RESULT_HANDLED;
+void DBusMonitorThreadPrivate::toggleWatch(DBusWatch *watch, void *data)
+{
+    DBusMonitorThreadPrivate *d = static_cast<DBusMonitorThreadPrivate *>(data);
+    d->updateWatchedFd(dbus_watch_get_unix_fd(watch));
 }
 
+// registers fd in epoll for the union of its enabled watches
+bool DBusMonitorThreadPrivate::updateWatchedFd(int fd)
+{
+    uint events = 0;
+    bool registered = false;
+    const auto it = m_watches.constFind(fd);
+    if (it != m_watches.constEnd()) {
+        registered = true;
+        for (DBusWatch *watch: it.value()) {
+            if (!dbus_watch_get_enabled(watch)) {
+                continue;
+            }
+            const uint flags = dbus_watch_get_flags(watch);
+            if (flags & DBUS_WATCH_READABLE) {
+                events |= EPOLLIN;
+            }
+            if (flags & DBUS_WATCH_WRITABLE) {
+                events |= EPOLLOUT;
+            }
+        }
+    }
+
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = events;
+    ev.data.fd = fd;
+    // fd stays registered with empty mask while it has disabled watches,
+    //   EPOLLERR and EPOLLHUP are still reported then
+    if (!registered) {
+        if (epoll_ctl(m_epollFd, EPOLL_CTL_DEL, fd, nullptr) < 0 && errno != ENOENT && errno != EBADF) {
+            qCWarning(logMon) << "epoll_ctl(DEL) failed:" << strerror(errno);
+        }
+        return true;
+    }
+    if (epoll_ctl(m_epollFd, EPOLL_CTL_MOD, fd, &ev) == 0) {
+        return true;
+    }
+    if (errno == ENOENT && epoll_ctl(m_epollFd, EPOLL_CTL_ADD, fd, &ev) == 0) {
+        return true;
+    }
+    qCWarning(logMon) << "epoll_ctl() failed:" << strerror(errno);
+    return false;
+}
 
-void DBusMonitorThreadPrivate::run()
+dbus_bool_t DBusMonitorThreadPrivate::addTimeout(DBusTimeout *timeout, void *data)
 {
-    m_monitor_active = true;
-    Q_EMIT owner->isMonitorActiveChanged();
+    DBusMonitorThreadPrivate *d = static_cast<DBusMonitorThreadPrivate *>(data);
+    d->m_timeouts.append(Timeout{timeout, d->m_clock.elapsed() + dbus_timeout_get_interval(timeout)});
+    return TRUE;
+}
+
+void DBusMonitorThreadPrivate::removeTimeout(DBusTimeout *timeout, void *data)
+{
+    DBusMonitorThreadPrivate *d = static_cast<DBusMonitorThreadPrivate *>(data);
+    for (int i = 0; i < d->m_timeouts.size(); i++) {
+        if (d->m_timeouts.at(i).timeout == timeout) {
+            d->m_timeouts.removeAt(i);
+            return;
+        }
+    }
+}
+
+void DBusMonitorThreadPrivate::toggleTimeout(DBusTimeout *timeout, void *data)
+{
+    DBusMonitorThreadPrivate *d = static_cast<DBusMonitorThreadPrivate *>(data);
+    // interval restarts when timeout is enabled again
+    for (Timeout &t: d->m_timeouts) {
+        if (t.timeout == timeout) {
+            t.deadline = d->m_clock.elapsed() + dbus_timeout_get_interval(timeout);
+            return;
+        }
+    }
+}
+
+int DBusMonitorThreadPrivate::nextTimeoutMs() const
+{
+    qint64 ret = -1;
+    const qint64 now = m_clock.elapsed();
+    for (const Timeout &t: m_timeouts) {
+        if (!dbus_timeout_get_enabled(t.timeout)) {
+            continue;
+        }
+        const qint64 left = qMax<qint64>(0, t.deadline - now);
+        if (ret < 0 || left < ret) {
+            ret = left;
+        }
+    }
+    return static_cast<int>(qMin<qint64>(ret, INT_MAX));
+}
 
+void DBusMonitorThreadPrivate::handleTimeouts()
+{
+    const qint64 now = m_clock.elapsed();
+    // handlers may add or remove timeouts
+    QList<DBusTimeout *> expired;
+    for (Timeout &t: m_timeouts) {
+        if (dbus_timeout_get_enabled(t.timeout) && t.deadline <= now) {
+            t.deadline = now + dbus_timeout_get_interval(t.timeout);
+            expired.append(t.timeout);
+        }
+    }
+    for (DBusTimeout *timeout: expired) {
+        bool alive = false;
+        for (const Timeout &t: m_timeouts) {
+            alive = alive || (t.timeout == timeout);
+        }
+        if (alive) {
+            dbus_timeout_handle(timeout);
+        }
+    }
+}
+
+void DBusMonitorThreadPrivate::dispatchAll()
+{
+    while (dbus_connection_dispatch(m_dconn) == DBUS_DISPATCH_DATA_REMAINS) {
+    }
+    // only replies to our own calls arrive there
+    while (dbus_connection_dispatch(m_dconn2) == DBUS_DISPATCH_DATA_REMAINS) {
+    }
+    m_credentials.startProcReads();
+    m_credentials.purgeRetired(m_pipeline.decodedSequence());
+}
+
+void DBusMonitorThreadPrivate::handleWatches(int fd, uint events)
+{
+    uint flags = 0;
+    if (events & EPOLLIN) {
+        flags |= DBUS_WATCH_READABLE;
+    }
+    if (events & EPOLLOUT) {
+        flags |= DBUS_WATCH_WRITABLE;
+    }
+    if (events & EPOLLERR) {
+        flags |= DBUS_WATCH_ERROR;
+    }
+    if (events & EPOLLHUP) {
+        flags |= DBUS_WATCH_HANGUP;
+    }
+
+    // libdbus reads a limited amount per call, so keep reading
+    //   while the socket has data, instead of waking up again for it
+    for (int round = 0; round < MAX_READS_PER_WAKEUP; round++) {
+        // handling a watch may remove (and free) any watch
+        const QList<DBusWatch *> watches = m_watches.value(fd);
+        for (DBusWatch *watch: watches) {
+            if (!m_watches.value(fd).contains(watch) || !dbus_watch_get_enabled(watch)) {
+                continue;
+            }
+            const uint watchFlags = dbus_watch_get_flags(watch) | DBUS_WATCH_ERROR | DBUS_WATCH_HANGUP;
+            if (flags & watchFlags) {
+                dbus_watch_handle(watch, flags & watchFlags);
+            }
+        }
+        dispatchAll();
+
+        if (!(flags & DBUS_WATCH_READABLE) || (flags & (DBUS_WATCH_ERROR | DBUS_WATCH_HANGUP))) {
+            break;
+        }
+        int available = 0;
+        if (ioctl(fd, FIONREAD, &available) < 0 || available <= 0) {
+            break;
+        }
+        flags = DBUS_WATCH_READABLE;
+    }
+}
+
+#endif // Q_OS_LINUX
+
+
+void DBusMonitorThreadPrivate::runPollingLoop()
+{
     while (dbus_connection_read_write_dispatch(m_dconn, 250)) {
+        dbus_connection_read_write_dispatch(m_dconn2, 0);
+        m_credentials.startProcReads();
+        m_credentials.purgeRetired(m_pipeline.decodedSequence());
         if (owner->isInterruptionRequested()) {
             qCDebug(logMon) << "Interruption requested, breaking DBus loop";
             break;
         }
     }
+}
+
+#ifdef Q_OS_LINUX
+
+bool DBusMonitorThreadPrivate::runEpollLoop()
+{
+    if (m_wakeFd < 0) {
+        return false;
+    }
+    m_epollFd = epoll_create1(EPOLL_CLOEXEC);
+    struct epoll_event wakeEvent;
+    memset(&wakeEvent, 0, sizeof(wakeEvent));
+    wakeEvent.events = EPOLLIN;
+    wakeEvent.data.fd = m_wakeFd;
+    if (m_epollFd < 0 || epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_wakeFd, &wakeEvent) < 0) {
+        qCWarning(logMon) << "Cannot set up epoll:" << strerror(errno);
+        if (m_epollFd >= 0) {
+            ::close(m_epollFd);
+            m_epollFd = -1;
+        }
+        return false;
+    }
+
+    // forget stop requests of a previous run; stop() also requests
+    //   interruption, so one made since start() is still seen below
+    uint64_t counter = 0;
+    while (::read(m_wakeFd, &counter, sizeof(counter)) > 0) {
+    }
+
+    m_clock.start();
+    // second connection carries credentials requests and their replies;
+    //   adding a watch fails if its fd cannot be added to epoll
+    bool ok = true;
+    for (DBusConnection *conn: {m_dconn, m_dconn2}) {
+        ok = ok && dbus_connection_set_watch_functions(conn, addWatch, removeWatch, toggleWatch, this, nullptr)
+                && dbus_connection_set_timeout_functions(conn, addTimeout, removeTimeout, toggleTimeout, this, nullptr);
+    }
+
+    bool stop = !ok;
+    if (!ok) {
+        qCWarning(logMon) << "Cannot watch bus connections with epoll";
+    }
+    while (!stop) {
+        // messages read while setting up or in blocking calls are buffered already
+        dispatchAll();
+        if (owner->isInterruptionRequested() || !dbus_connection_get_is_connected(m_dconn)) {
+            break;
+        }
+
+        struct epoll_event events[MAX_EPOLL_EVENTS];
+        const int n = epoll_wait(m_epollFd, events, MAX_EPOLL_EVENTS, nextTimeoutMs());
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            qCWarning(logMon) << "epoll_wait() failed:" << strerror(errno);
+            break;
+        }
+        for (int i = 0; i < n; i++) {
+            if (events[i].data.fd == m_wakeFd) {
+                qCDebug(logMon) << "Stop requested, breaking DBus loop";
+                stop = true;
+            } else {
+                handleWatches(events[i].data.fd, events[i].events);
+            }
+        }
+        handleTimeouts();
+    }
+
+    for (DBusConnection *conn: {m_dconn, m_dconn2}) {
+        dbus_connection_set_watch_functions(conn, nullptr, nullptr, nullptr, nullptr, nullptr);
+        dbus_connection_set_timeout_functions(conn, nullptr, nullptr, nullptr, nullptr, nullptr);
+    }
+    ::close(m_epollFd);
+    m_epollFd = -1;
+    m_watches.clear();
+    m_timeouts.clear();
+    return ok;
+}
+
+#endif // Q_OS_LINUX
+
+
+void DBusMonitorThreadPrivate::submitNameOwners()
+{
+    // as if every name owned at start was acquired right then
+    const QDateTime timestamp = QDateTime::fromMSecsSinceEpoch(m_startTime);
+    const char *old_ptr = "";
+    for (auto it = m_names.nameOwners.constBegin(); it != m_names.nameOwners.constEnd(); ++it) {
+        DBusMessage *message = dbus_message_new_signal(DBUS_PATH_DBUS, DBUS_INTERFACE_DBUS, "NameOwnerChanged");
+        if (!message) {
+            Utils::fatal_oom("create new message");
+        }
+        const QByteArray name = it.key().toUtf8();
+        const QByteArray nameOwner = it.value().toUtf8();
+        const char *name_ptr = name.constData();
+        const char *new_ptr = nameOwner.constData();
+        dbus_message_set_sender(message, DBUS_SERVICE_DBUS);
+        dbus_message_append_args(message, DBUS_TYPE_STRING, &name_ptr, DBUS_TYPE_STRING, &old_ptr,
+                                 DBUS_TYPE_STRING, &new_ptr, DBUS_TYPE_INVALID);
+        DecodeJob job;
+        job.message = message;
+        job.timestamp = timestamp;
+        job.names = m_names;
+        m_pipeline.submit(std::move(job));
+    }
+}
+
+void DBusMonitorThreadPrivate::run()
+{
+    m_pipeline.start(m_decodeThreads);
+    m_monitor_active = true;
+    Q_EMIT owner->isMonitorActiveChanged();
+    if (m_recordNameOwners) {
+        submitNameOwners();
+    }
+
+#ifdef Q_OS_LINUX
+    if (!runEpollLoop()) {
+        qCWarning(logMon) << "Falling back to polling the bus connection";
+        runPollingLoop();
+    }
+#else
+    runPollingLoop();
+#endif
 
+    // everything captured so far is still emitted
+    m_pipeline.stop();
     closeDbusConn();
     Q_EMIT owner->isMonitorActiveChanged();
 }
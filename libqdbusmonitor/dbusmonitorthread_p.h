@@ -5,26 +5,58 @@
 #include <QString>
 #include <QHash>
 #include <QList>
+#include <QStringList>
+#include <QMutex>
+#include <QAtomicInt>
+#include <QAtomicInteger>
+#include <QElapsedTimer>
+
+#include "messagefilter.h"
+#include "decodepipeline.h"
+#include "messagesampler.h"
+#include "credentialscache.h"
+#include "nameownerhistory.h"
 
 class DBusMonitorThread;
 
 
+
 class DBusMonitorThreadPrivate {
 public:
     explicit DBusMonitorThreadPrivate(DBusMonitorThread *parent);
-    bool becomeMonitor();
-    bool startBus(DBusBusType type = DBUS_BUS_SESSION);
+    ~DBusMonitorThreadPrivate();
+    bool becomeMonitor(const QStringList &matchRules);
+    bool addEavesdropMatches(const QStringList &matchRules);
+    bool startBus(DBusBusType type = DBUS_BUS_SESSION, const QStringList &matchRules = QStringList());
+    bool startAddress(const QString &address, const QStringList &matchRules = QStringList());
+    // common part after both connections are open
+    bool setupMonitor(const QStringList &matchRules);
     void closeDbusConn();
 
-    uint queryBusNameUnixPid(const QString &busName);
+    // synchronous, used only before capture starts
     QString queryNameOwner(const QString &busName);
+    // blocks until the bus replied about all of them, replies go to m_credentials
+    void queryCredentials(const QStringList &busAddrs);
+    DBusPendingCall *requestCredentials(const QString &busAddr);
+    void storeCredentials(const QString &busAddr, DBusMessage *dreply);
 
     void addNameOwner(const QString &busName, const QString &busAddr);
     void removeNameOwner(const QString &busAddr, const QString &busName);
-    void addNamePid(const QString &busName, uint pid);
-    QStringList resolveDBusAddressToName(const QString &addr);
-    QString resolveNameAddress(const QString &name);
-    uint resolvePid(const QString &addr);
+    // from NameOwnerChanged signal, on capture thread
+    void nameOwnerChanged(const QString &busName, const QString &oldOwner,
+                          const QString &newOwner, qint64 timeMs);
+    // called from decode workers, only touch given names and credentials cache
+    QStringList resolveDBusAddressToName(const BusNames &names, const QString &addr) const;
+    QString resolveNameAddress(const BusNames &names, const QString &name) const;
+    ConnectionCredentialsPtr resolveCredentials(const QString &addr) const;
+    void syncFilter();
+
+    // synthetic NameOwnerChanged signals for names owned at start
+    void submitNameOwners();
+
+    // everything after bookkeeping and header filtering, on a decode worker;
+    //   returns false if message should not be emitted
+    bool decode(DecodeJob &job) const;
 
     static DBusHandlerResult monitorFunc(
             DBusConnection *connection,
@@ -32,6 +64,27 @@ public:
             void           *user_data);
 
     void run();
+    // makes run() return, can be called from any thread
+    void wakeUp();
+    // portable capture loop, notices stop() within a poll interval
+    void runPollingLoop();
+
+#ifdef Q_OS_LINUX
+    // capture loop is epoll driven by libdbus watches and timeouts;
+    //   returns false if it could not be set up, before reading anything
+    bool runEpollLoop();
+    static dbus_bool_t addWatch(DBusWatch *watch, void *data);
+    static void removeWatch(DBusWatch *watch, void *data);
+    static void toggleWatch(DBusWatch *watch, void *data);
+    static dbus_bool_t addTimeout(DBusTimeout *timeout, void *data);
+    static void removeTimeout(DBusTimeout *timeout, void *data);
+    static void toggleTimeout(DBusTimeout *timeout, void *data);
+    bool updateWatchedFd(int fd);
+    void handleWatches(int fd, uint events);
+    void handleTimeouts();
+    int nextTimeoutMs() const;
+    void dispatchAll();
+#endif
 
 public:
     DBusConnection *m_dconn = nullptr;
@@ -39,8 +92,46 @@ public:
     DBusMonitorThread *owner = nullptr;
     QString m_myName;
     QString m_myName2;
-    QHash<QString, QStringList> m_addrNames;
-    QHash<QString, uint> m_addrPids;
+    QString m_busName;
+    // changed by capture thread only, decode jobs take copies
+    BusNames m_names;
+    // unique addresses are never reused, so credentials never change;
+    //   filled by capture thread, read by decode workers
+    CredentialsCache m_credentials;
+    // every ownership change of well-known names since start,
+    //   filled by capture thread, read from anywhere
+    NameOwnerHistory m_ownerHistory;
+    qint64 m_startTime = 0;     // when name owners were asked for, ms since epoch
+    bool m_recordNameOwners = false;
+    int m_decodeThreads = 0;
+    DecodePipeline m_pipeline;
+    MessageSampler m_sampler;   // used by capture thread only
     bool m_monitor_active = false;
+#ifdef Q_OS_LINUX
+    int m_wakeFd = -1;      // eventfd, lives as long as this object
+    int m_epollFd = -1;     // only while run() runs
+    // read and write watches of a connection usually share one fd
+    QHash<int, QList<DBusWatch *>> m_watches;
+    struct Timeout {
+        DBusTimeout *timeout;
+        qint64 deadline;    // on m_clock, ms
+    };
+    QList<Timeout> m_timeouts;
+    QElapsedTimer m_clock;
+#endif
+    // filter is set from any thread into m_pendingFilter,
+    //   capture thread picks it up only when m_filterChanged is raised
+    mutable QMutex m_filterMutex;
+    MessageFilter m_pendingFilter;
+    QAtomicInt m_filterChanged;
+    MessageFilter m_filter;
+    // written by decode workers, read from anywhere;
+    //   pid counts credentials lookups, exe the ones with executable known
+    mutable QAtomicInteger<quint64> m_nameHits;
+    mutable QAtomicInteger<quint64> m_nameMisses;
+    mutable QAtomicInteger<quint64> m_pidHits;
+    mutable QAtomicInteger<quint64> m_pidMisses;
+    mutable QAtomicInteger<quint64> m_exeHits;
+    mutable QAtomicInteger<quint64> m_exeMisses;
 };
 #endif // DBUSMONITORTHREAD_P_H
@@ -0,0 +1,172 @@
+#include <QThread>
+#include "decodepipeline.h"
+
+
+class DecodePipeline::Worker: public QThread
+{
+public:
+    explicit Worker(DecodePipeline *pipeline)
+        : m_pipeline(pipeline)
+    {
+    }
+
+protected:
+    void run() override
+    {
+        m_pipeline->work();
+    }
+
+private:
+    DecodePipeline *m_pipeline;
+};
+
+
+DecodePipeline::DecodePipeline()
+{
+}
+
+DecodePipeline::~DecodePipeline()
+{
+    stop();
+}
+
+void DecodePipeline::setFunctions(const DecodeFunction &decode, const OutputFunction &output)
+{
+    m_decode = decode;
+    m_output = output;
+}
+
+void DecodePipeline::start(int workerCount)
+{
+    stop();
+    m_nextSequence = 0;
+    m_nextOutput = 0;
+    m_stopping = false;
+    for (int i = 0; i < workerCount; i++) {
+        Worker *worker = new Worker(this);
+        m_workers.append(worker);
+        worker->start();
+    }
+}
+
+void DecodePipeline::stop()
+{
+    if (m_workers.isEmpty()) {
+        return;
+    }
+    m_mutex.lock();
+    m_stopping = true;
+    m_jobAvailable.wakeAll();
+    m_mutex.unlock();
+
+    // workers leave only when queue is empty, and the last finished
+    //   job emits everything still waiting in reorder buffer
+    for (QThread *worker: m_workers) {
+        worker->wait();
+        delete worker;
+    }
+    m_workers.clear();
+}
+
+int DecodePipeline::workerCount() const
+{
+    return m_workers.size();
+}
+
+void DecodePipeline::submit(DecodeJob &&job)
+{
+    if (m_workers.isEmpty()) {
+        job.sequence = m_nextSequence++;
+        job.accepted = m_decode(job);
+        dbus_message_unref(job.message);
+        job.message = nullptr;
+        if (job.accepted) {
+            m_output(job.messageObj);
+        }
+        return;
+    }
+
+    QMutexLocker guard(&m_mutex);
+    while (m_inFlight >= MaxJobsInFlight) {
+        m_slotAvailable.wait(&m_mutex);
+    }
+    job.sequence = m_nextSequence++;
+    m_jobs.enqueue(std::move(job));
+    m_inFlight++;
+    m_jobAvailable.wakeOne();
+}
+
+quint64 DecodePipeline::nextSequence() const
+{
+    return m_nextSequence;
+}
+
+quint64 DecodePipeline::decodedSequence()
+{
+    if (m_workers.isEmpty()) {
+        return m_nextSequence;
+    }
+    QMutexLocker guard(&m_reorderMutex);
+    return m_nextOutput;
+}
+
+void DecodePipeline::work()
+{
+    while (true) {
+        DecodeJob job;
+        {
+            QMutexLocker guard(&m_mutex);
+            while (m_jobs.isEmpty() && !m_stopping) {
+                m_jobAvailable.wait(&m_mutex);
+            }
+            if (m_jobs.isEmpty()) {
+                return;
+            }
+            job = m_jobs.dequeue();
+        }
+
+        job.accepted = m_decode(job);
+        dbus_message_unref(job.message);
+        job.message = nullptr;
+        finished(std::move(job));
+    }
+}
+
+void DecodePipeline::finished(DecodeJob &&job)
+{
+    QMutexLocker guard(&m_reorderMutex);
+    m_done.insert(job.sequence, std::move(job));
+    if (m_emitting) {
+        return; // another worker is emitting and will pick it up
+    }
+    m_emitting = true;
+
+    QList<DecodeJob> ready;
+    while (true) {
+        auto it = m_done.begin();
+        while (it != m_done.end() && it.key() == m_nextOutput) {
+            ready.append(std::move(it.value()));
+            it = m_done.erase(it);
+            m_nextOutput++;
+        }
+        if (ready.isEmpty()) {
+            break;
+        }
+
+        // no lock held while consumers run
+        guard.unlock();
+        for (const DecodeJob &readyJob: ready) {
+            if (readyJob.accepted) {
+                m_output(readyJob.messageObj);
+            }
+        }
+        {
+            QMutexLocker jobsGuard(&m_mutex);
+            m_inFlight -= ready.size();
+            m_slotAvailable.wakeAll();
+        }
+        ready.clear();
+        guard.relock();
+    }
+    m_emitting = false;
+}
@@ -0,0 +1,110 @@
+#ifndef DECODEPIPELINE_H
+#define DECODEPIPELINE_H
+
+#include <dbus/dbus.h>
+#include <functional>
+#include <QDateTime>
+#include <QHash>
+#include <QList>
+#include <QMap>
+#include <QMutex>
+#include <QQueue>
+#include <QStringList>
+#include <QWaitCondition>
+
+#include "dbusmessageobject.h"
+#include "messagefilter.h"
+
+
+class QThread;
+
+
+// What name resolution knows about the bus at some moment. Copies are
+//   cheap (implicitly shared), so every decode job carries its own and
+//   resolves names as they were when the message was dispatched.
+struct BusNames {
+    QHash<QString, QStringList> addrNames;
+    QHash<QString, QString> nameOwners;     // reverse of addrNames
+};
+
+
+// One message on its way from capture thread to messageReceived()
+struct DecodeJob {
+    quint64 sequence = 0;
+    DBusMessage *message = nullptr;  // referenced, pipeline unrefs it after decoding
+    QDateTime timestamp;             // taken on capture thread
+    MessageFilter filter;            // as it was when message was captured
+    bool needsDetails = false;       // filter.matchMessage() is still needed
+    double weight = 1;               // given by sampler
+    BusNames names;
+    DBusMessageObject messageObj;    // result
+    bool accepted = false;
+};
+
+
+/**
+ * Decodes captured messages on a pool of worker threads and hands them
+ * out in capture order.
+ *
+ * Capture thread submit()s jobs, which get consecutive sequence numbers.
+ * Any idle worker takes the next job and runs the decode function on it.
+ * Finished jobs wait in a reorder buffer until all earlier ones are done;
+ * whichever worker completes the oldest outstanding job then emits
+ * everything that became ready, so output function is called in order
+ * and never from two threads at once. When too many jobs are in flight,
+ * submit() blocks, so capture slows down instead of memory growing.
+ * With no workers, submit() decodes and emits right away.
+ */
+class DecodePipeline
+{
+public:
+    static const int MaxJobsInFlight = 4096;
+
+    typedef std::function<bool(DecodeJob &)> DecodeFunction;
+    typedef std::function<void(const DBusMessageObject &)> OutputFunction;
+
+public:
+    DecodePipeline();
+    ~DecodePipeline();
+
+    void setFunctions(const DecodeFunction &decode, const OutputFunction &output);
+
+    void start(int workerCount);
+    // waits until every submitted job is emitted, then stops workers
+    void stop();
+    int workerCount() const;
+
+    // capture thread only
+    void submit(DecodeJob &&job);
+    // sequence the next submitted job gets
+    quint64 nextSequence() const;
+    // every job before this sequence is decoded
+    quint64 decodedSequence();
+
+private:
+    class Worker;
+    friend class Worker;
+
+    void work();
+    void finished(DecodeJob &&job);
+
+private:
+    DecodeFunction m_decode;
+    OutputFunction m_output;
+    QList<QThread *> m_workers;
+
+    QMutex m_mutex;                 // protects job queue
+    QWaitCondition m_jobAvailable;
+    QWaitCondition m_slotAvailable;
+    QQueue<DecodeJob> m_jobs;
+    int m_inFlight = 0;             // submitted, but not emitted yet
+    quint64 m_nextSequence = 0;
+    bool m_stopping = false;
+
+    QMutex m_reorderMutex;          // protects reorder buffer
+    QMap<quint64, DecodeJob> m_done;
+    quint64 m_nextOutput = 0;
+    bool m_emitting = false;
+};
+
+#endif // DECODEPIPELINE_H
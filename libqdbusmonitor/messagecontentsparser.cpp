@@ -233,7 +233,82 @@ static QVariant print_fd (int fd, int depth)
 }
 #endif
 
-static QVariant print_iter(DBusMessageIter *iter, dbus_bool_t literal, int depth)
+// pads to alignment of next value, then adds its size; body starts
+//   8-aligned, so offsets within it align the same as in the message
+static void wire_add(MessageWireSize *size, uint alignment, uint bytes)
+{
+    if (size) {
+        size->bodySize = ((size->bodySize + alignment - 1) & ~(alignment - 1)) + bytes;
+    }
+}
+
+static uint wire_alignment(int type)
+{
+    switch (type) {
+    case DBUS_TYPE_INT16:
+    case DBUS_TYPE_UINT16:
+        return 2;
+    case DBUS_TYPE_INT32:
+    case DBUS_TYPE_UINT32:
+    case DBUS_TYPE_BOOLEAN:
+    case DBUS_TYPE_STRING:
+    case DBUS_TYPE_OBJECT_PATH:
+    case DBUS_TYPE_UNIX_FD:
+    case DBUS_TYPE_ARRAY:
+        return 4;
+    case DBUS_TYPE_INT64:
+    case DBUS_TYPE_UINT64:
+    case DBUS_TYPE_DOUBLE:
+    case DBUS_TYPE_STRUCT:
+    case DBUS_TYPE_DICT_ENTRY:
+        return 8;
+    default:
+        return 1;   // byte, signature, variant
+    }
+}
+
+static uint wire_signature_length(DBusMessageIter *iter);
+
+// signature length of array element type, without the 'a'
+static uint wire_element_signature_length(DBusMessageIter *iter)
+{
+    DBusMessageIter subiter;
+    dbus_message_iter_recurse(iter, &subiter);
+    if (dbus_message_iter_get_arg_type(&subiter) != DBUS_TYPE_INVALID) {
+        return wire_signature_length(&subiter);
+    }
+    const int elementType = dbus_message_iter_get_element_type(iter);
+    if (dbus_type_is_basic(elementType) || elementType == DBUS_TYPE_VARIANT) {
+        return 1;
+    }
+    // empty array of containers, rare enough to ask libdbus
+    char *signature = dbus_message_iter_get_signature(iter);
+    const uint len = signature ? static_cast<uint>(qstrlen(signature)) - 1 : 1;
+    dbus_free(signature);
+    return len;
+}
+
+// signature length of the single complete type at iter
+static uint wire_signature_length(DBusMessageIter *iter)
+{
+    const int type = dbus_message_iter_get_arg_type(iter);
+    if (type == DBUS_TYPE_ARRAY) {
+        return 1 + wire_element_signature_length(iter);
+    }
+    if (type != DBUS_TYPE_STRUCT && type != DBUS_TYPE_DICT_ENTRY) {
+        return 1;
+    }
+    uint len = 2; // parentheses or braces
+    DBusMessageIter subiter;
+    dbus_message_iter_recurse(iter, &subiter);
+    while (dbus_message_iter_get_arg_type(&subiter) != DBUS_TYPE_INVALID) {
+        len += wire_signature_length(&subiter);
+        dbus_message_iter_next(&subiter);
+    }
+    return len;
+}
+
+static QVariant print_iter(DBusMessageIter *iter, dbus_bool_t literal, int depth, MessageWireSize *size)
 {
     QVariantList ret;
 
@@ -254,6 +329,7 @@ static QVariant print_iter(DBusMessageIter *iter, dbus_bool_t literal, int depth
             char *val;
             QString arg;
             dbus_message_iter_get_basic(iter, &val);
+            wire_add(size, 4, 4 + static_cast<uint>(qstrlen(val)) + 1);
             if (!literal) {
                 arg.append(QLatin1String("string \""));
             }
@@ -270,6 +346,7 @@ static QVariant print_iter(DBusMessageIter *iter, dbus_bool_t literal, int depth
             char *val;
             QString arg;
             dbus_message_iter_get_basic(iter, &val);
+            wire_add(size, 1, 1 + static_cast<uint>(qstrlen(val)) + 1);
             if (!literal) {
                 arg.append(QLatin1String("signature \""));
             }
@@ -286,6 +363,7 @@ static QVariant print_iter(DBusMessageIter *iter, dbus_bool_t literal, int depth
             char *val;
             QString arg;
             dbus_message_iter_get_basic(iter, &val);
+            wire_add(size, 4, 4 + static_cast<uint>(qstrlen(val)) + 1);
             if (!literal) {
                 arg.append(QLatin1String("object path \""));
             }
@@ -301,6 +379,7 @@ static QVariant print_iter(DBusMessageIter *iter, dbus_bool_t literal, int depth
         {
             dbus_int16_t val;
             dbus_message_iter_get_basic(iter, &val);
+            wire_add(size, 2, 2);
             varArgument = QVariant(static_cast<int>(val));
             break;
         }
@@ -309,6 +388,7 @@ static QVariant print_iter(DBusMessageIter *iter, dbus_bool_t literal, int depth
         {
             dbus_uint16_t val;
             dbus_message_iter_get_basic(iter, &val);
+            wire_add(size, 2, 2);
             varArgument = QVariant(static_cast<uint>(val));
             break;
         }
@@ -317,6 +397,7 @@ static QVariant print_iter(DBusMessageIter *iter, dbus_bool_t literal, int depth
         {
             dbus_int32_t val;
             dbus_message_iter_get_basic(iter, &val);
+            wire_add(size, 4, 4);
             varArgument = QVariant(static_cast<int>(val));
             break;
         }
@@ -325,6 +406,7 @@ static QVariant print_iter(DBusMessageIter *iter, dbus_bool_t literal, int depth
         {
             dbus_uint32_t val;
             dbus_message_iter_get_basic(iter, &val);
+            wire_add(size, 4, 4);
             varArgument = QVariant(static_cast<uint>(val));
             break;
         }
@@ -333,6 +415,7 @@ static QVariant print_iter(DBusMessageIter *iter, dbus_bool_t literal, int depth
         {
             dbus_int64_t val;
             dbus_message_iter_get_basic(iter, &val);
+            wire_add(size, 8, 8);
             varArgument = QVariant(static_cast<qint64>(val));
             break;
         }
@@ -341,6 +424,7 @@ static QVariant print_iter(DBusMessageIter *iter, dbus_bool_t literal, int depth
         {
             dbus_uint64_t val;
             dbus_message_iter_get_basic(iter, &val);
+            wire_add(size, 8, 8);
             varArgument = QVariant(static_cast<quint64>(val));
             break;
         }
@@ -349,6 +433,7 @@ static QVariant print_iter(DBusMessageIter *iter, dbus_bool_t literal, int depth
         {
             double val;
             dbus_message_iter_get_basic(iter, &val);
+            wire_add(size, 8, 8);
             varArgument = QVariant(val);
             break;
         }
@@ -357,6 +442,7 @@ static QVariant print_iter(DBusMessageIter *iter, dbus_bool_t literal, int depth
         {
             unsigned char val;
             dbus_message_iter_get_basic(iter, &val);
+            wire_add(size, 1, 1);
             varArgument = QVariant(static_cast<uint>(val));
             break;
         }
@@ -365,6 +451,7 @@ static QVariant print_iter(DBusMessageIter *iter, dbus_bool_t literal, int depth
         {
             dbus_bool_t val;
             dbus_message_iter_get_basic(iter, &val);
+            wire_add(size, 4, 4);
             if (val) {
                 varArgument = QVariant(true);
             } else {
@@ -378,10 +465,14 @@ static QVariant print_iter(DBusMessageIter *iter, dbus_bool_t literal, int depth
             DBusMessageIter subiter;
             // QString arg;
             dbus_message_iter_recurse (iter, &subiter);
+            if (size) {
+                // signature of contained value, then the value
+                wire_add(size, 1, 1 + wire_signature_length(&subiter) + 1);
+            }
             // arg = QStringLiteral("variant: ");
-            // arg.append(print_iter(&subiter, literal, depth + 1).toString());
+            // arg.append(print_iter(&subiter, literal, depth + 1, size).toString());
             // varArgument = arg;
-            varArgument = print_iter(&subiter, literal, depth + 1); // or maybe this way
+            varArgument = print_iter(&subiter, literal, depth + 1, size); // or maybe this way
             break;
         }
         case DBUS_TYPE_ARRAY:
@@ -393,6 +484,10 @@ static QVariant print_iter(DBusMessageIter *iter, dbus_bool_t literal, int depth
 
             dbus_message_iter_recurse (iter, &subiter);
 
+            // length, then padding to element alignment even when empty
+            wire_add(size, 4, 4);
+            wire_add(size, wire_alignment(dbus_message_iter_get_element_type(iter)), 0);
+
             current_type = dbus_message_iter_get_arg_type(&subiter);
 
             // no special case for array of bytes
@@ -405,8 +500,8 @@ static QVariant print_iter(DBusMessageIter *iter, dbus_bool_t literal, int depth
 
             //arg = QStringLiteral("array [");
             while (current_type != DBUS_TYPE_INVALID) {
-                //arg.append(print_iter(&subiter, literal, depth + 1).toString());
-                QVariant recursedArray = print_iter(&subiter, literal, depth + 1);
+                //arg.append(print_iter(&subiter, literal, depth + 1, size).toString());
+                QVariant recursedArray = print_iter(&subiter, literal, depth + 1, size);
                 if (recursedArray.canConvert(QMetaType::QVariantList)) {
                     array = recursedArray.value<QVariantList>();
                 }
@@ -429,10 +524,11 @@ static QVariant print_iter(DBusMessageIter *iter, dbus_bool_t literal, int depth
             // QString arg;
             QVariantMap mapp;
             dbus_message_iter_recurse(iter, &subiter);
+            wire_add(size, 8, 0);
 
-            const QVariant mapKey = print_iter(&subiter, literal, depth + 1);
+            const QVariant mapKey = print_iter(&subiter, literal, depth + 1, size);
             dbus_message_iter_next(&subiter);
-            const QVariant mapValue = print_iter(&subiter, literal, depth + 1);
+            const QVariant mapValue = print_iter(&subiter, literal, depth + 1, size);
             mapp.insert(mapKey.toString(), mapValue);
             qCDebug(logMessageParser) << "dict: " << mapKey << mapKey.type() << "=" << mapValue;
             varArgument = QVariant::fromValue<QVariantMap>(mapp);
@@ -446,10 +542,11 @@ static QVariant print_iter(DBusMessageIter *iter, dbus_bool_t literal, int depth
             QVariantList structEntryList;
 
             dbus_message_iter_recurse (iter, &subiter);
+            wire_add(size, 8, 0);
 
             // arg = QStringLiteral("struct {\n");
             while ((current_type = dbus_message_iter_get_arg_type (&subiter)) != DBUS_TYPE_INVALID) {
-                QVariant structField = print_iter(&subiter, literal, depth + 1);
+                QVariant structField = print_iter(&subiter, literal, depth + 1, size);
                 //qCDebug(logMessageParser) << "struct: element = " << structField;
                 // arg.append(struct_field.toString());
                 structEntryList.append(structField);
@@ -470,6 +567,10 @@ static QVariant print_iter(DBusMessageIter *iter, dbus_bool_t literal, int depth
         {
             int fd;
             dbus_message_iter_get_basic(iter, &fd);
+            wire_add(size, 4, 4);
+            if (size) {
+                size->unixFds++;
+            }
 
             varArgument = print_fd(fd, depth + 1);
 
@@ -509,9 +610,12 @@ static QVariant print_iter(DBusMessageIter *iter, dbus_bool_t literal, int depth
 }
 
 
-QVariantList parseMessageContents(DBusMessageIter *iter)
+QVariantList parseMessageContents(DBusMessageIter *iter, MessageWireSize *wireSize)
 {
-    QVariant arg = print_iter(iter, TRUE, 1);
+    if (wireSize) {
+        *wireSize = MessageWireSize();
+    }
+    QVariant arg = print_iter(iter, TRUE, 1, wireSize);
     QVariantList ret;
     if (arg.canConvert(QMetaType::QVariantList)) {
         ret = arg.toList();
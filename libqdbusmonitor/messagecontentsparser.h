@@ -6,6 +6,13 @@
 
 typedef struct DBusMessageIter DBusMessageIter;
 
-QVariantList parseMessageContents(DBusMessageIter *iter);
+// Marshalled body size, counted while parsing so that the message does
+//   not have to be marshalled again just to be measured
+struct MessageWireSize {
+    uint bodySize = 0;
+    uint unixFds = 0;
+};
+
+QVariantList parseMessageContents(DBusMessageIter *iter, MessageWireSize *wireSize = nullptr);
 
 #endif
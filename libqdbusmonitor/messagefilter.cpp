@@ -0,0 +1,685 @@
+#include <algorithm>
+#include <QHash>
+#include <QVector>
+#include <QLoggingCategory>
+#include <dbus/dbus.h>
+
+#include "messagefilter.h"
+
+
+Q_LOGGING_CATEGORY(logFilter, "monitor.filter")
+
+
+namespace {
+
+struct FilterTerm {
+    // Order matters: terms are evaluated from cheapest to most expensive kind,
+    //   and all kinds after Arg0Namespace can only be decided after resolving
+    enum Kind {
+        Type,
+        Interface,
+        Member,
+        Path,
+        PathNamespace,
+        ErrorName,
+        Sender,
+        Destination,
+        Arg,
+        ArgPath,
+        Arg0Namespace,
+        Pid,
+        SenderPid,
+        DestinationPid,
+        Exe,
+        SenderExe,
+        DestinationExe,
+    };
+
+    Kind       kind = Type;
+    int        typeMask = 0;
+    int        argIndex = 0;
+    bool       isNumber = false;
+    qint64     number = 0;
+    QByteArray value;     // UTF-8, compared against raw message header
+    QString    valueStr;  // compared against resolved DBusMessageObject
+};
+
+struct FilterRule {
+    QString text;
+    QVector<FilterTerm> terms;
+    QStringList daemonTerms; // subset of terms understood by dbus-daemon
+};
+
+enum class TermResult {
+    False,
+    True,
+    Unknown,
+};
+
+} // namespace
+
+
+class MessageFilterData: public QSharedData
+{
+public:
+    QVector<FilterRule> rules;
+};
+
+
+template <typename S, typename C>
+static bool nameInNamespace(const S &name, const S &ns, C separator)
+{
+    if (name.size() == ns.size()) {
+        return name == ns;
+    }
+    return (name.size() > ns.size()) && name.startsWith(ns) && (name.at(ns.size()) == separator);
+}
+
+template <typename S, typename C>
+static bool argPathMatches(const S &arg, const S &rule, C slash)
+{
+    // argNpath='/aa/bb/' matches '/aa/bb/', '/aa/bb/cc' and '/aa/', but not '/aa/b'
+    if (arg == rule) {
+        return true;
+    }
+    if (rule.endsWith(slash) && arg.startsWith(rule)) {
+        return true;
+    }
+    return arg.endsWith(slash) && rule.startsWith(arg);
+}
+
+static bool pathInNamespace(const QByteArray &path, const QByteArray &ns)
+{
+    if (ns.size() == 1 && ns.at(0) == '/') {
+        return true;
+    }
+    return nameInNamespace(path, ns, '/');
+}
+
+static bool pathInNamespace(const QString &path, const QString &ns)
+{
+    if (ns == QLatin1String("/")) {
+        return true;
+    }
+    return nameInNamespace(path, ns, QLatin1Char('/'));
+}
+
+static bool exeMatches(const QString &exe, const QString &value)
+{
+    if (exe.isEmpty()) {
+        return false;
+    }
+    if (value.contains(QLatin1Char('/'))) {
+        return exe == value;
+    }
+    return exe.midRef(exe.lastIndexOf(QLatin1Char('/')) + 1) == value;
+}
+
+static inline QByteArray rawString(const char *s)
+{
+    // no copy, only wraps libdbus-owned string
+    return QByteArray::fromRawData(s, static_cast<int>(qstrlen(s)));
+}
+
+static inline TermResult toResult(bool b)
+{
+    return b ? TermResult::True : TermResult::False;
+}
+
+static TermResult matchArgStringHeader(const FilterTerm &term, const QByteArray &arg)
+{
+    switch (term.kind) {
+    case FilterTerm::Arg:           return toResult(arg == term.value);
+    case FilterTerm::ArgPath:       return toResult(argPathMatches(arg, term.value, '/'));
+    case FilterTerm::Arg0Namespace: return toResult(nameInNamespace(arg, term.value, '.'));
+    default: break;
+    }
+    return TermResult::False;
+}
+
+static TermResult matchArgHeader(DBusMessage *message, const FilterTerm &term)
+{
+    DBusMessageIter iter;
+    if (!dbus_message_iter_init(message, &iter)) {
+        return TermResult::False;
+    }
+    for (int i = 0; i < term.argIndex; i++) {
+        if (!dbus_message_iter_next(&iter)) {
+            return TermResult::False;
+        }
+    }
+
+    const int argType = dbus_message_iter_get_arg_type(&iter);
+    if (argType == DBUS_TYPE_STRING || argType == DBUS_TYPE_OBJECT_PATH || argType == DBUS_TYPE_SIGNATURE) {
+        const char *str_ptr = nullptr;
+        dbus_message_iter_get_basic(&iter, &str_ptr);
+        return matchArgStringHeader(term, rawString(str_ptr));
+    }
+
+    // only plain argN is extended to non-string values
+    if (term.kind != FilterTerm::Arg) {
+        return TermResult::False;
+    }
+
+    DBusBasicValue val;
+    switch (argType) {
+    case DBUS_TYPE_BOOLEAN:
+        dbus_message_iter_get_basic(&iter, &val);
+        return toResult(term.value == (val.bool_val ? "true" : "false"));
+    case DBUS_TYPE_BYTE:
+        dbus_message_iter_get_basic(&iter, &val);
+        return toResult(term.isNumber && term.number == static_cast<qint64>(val.byt));
+    case DBUS_TYPE_INT16:
+        dbus_message_iter_get_basic(&iter, &val);
+        return toResult(term.isNumber && term.number == static_cast<qint64>(val.i16));
+    case DBUS_TYPE_UINT16:
+        dbus_message_iter_get_basic(&iter, &val);
+        return toResult(term.isNumber && term.number == static_cast<qint64>(val.u16));
+    case DBUS_TYPE_INT32:
+        dbus_message_iter_get_basic(&iter, &val);
+        return toResult(term.isNumber && term.number == static_cast<qint64>(val.i32));
+    case DBUS_TYPE_UINT32:
+        dbus_message_iter_get_basic(&iter, &val);
+        return toResult(term.isNumber && term.number == static_cast<qint64>(val.u32));
+    case DBUS_TYPE_INT64:
+        dbus_message_iter_get_basic(&iter, &val);
+        return toResult(term.isNumber && term.number == static_cast<qint64>(val.i64));
+    case DBUS_TYPE_UINT64:
+        dbus_message_iter_get_basic(&iter, &val);
+        return toResult(term.isNumber && (term.number >= 0)
+                        && static_cast<quint64>(term.number) == static_cast<quint64>(val.u64));
+    case DBUS_TYPE_DOUBLE: {
+        bool ok = false;
+        const double d = term.valueStr.toDouble(&ok);
+        dbus_message_iter_get_basic(&iter, &val);
+        return toResult(ok && qFuzzyCompare(d, val.dbl));
+    }
+    default:
+        break;
+    }
+    return TermResult::False;
+}
+
+static TermResult matchTermHeader(DBusMessage *message, const FilterTerm &term)
+{
+    switch (term.kind) {
+    case FilterTerm::Type:
+        return toResult((term.typeMask & (1 << dbus_message_get_type(message))) != 0);
+
+    case FilterTerm::Interface: {
+        const char *s = dbus_message_get_interface(message);
+        return toResult(s && (rawString(s) == term.value));
+    }
+    case FilterTerm::Member: {
+        const char *s = dbus_message_get_member(message);
+        return toResult(s && (rawString(s) == term.value));
+    }
+    case FilterTerm::Path: {
+        const char *s = dbus_message_get_path(message);
+        return toResult(s && (rawString(s) == term.value));
+    }
+    case FilterTerm::PathNamespace: {
+        const char *s = dbus_message_get_path(message);
+        return toResult(s && pathInNamespace(rawString(s), term.value));
+    }
+    case FilterTerm::ErrorName: {
+        const char *s = dbus_message_get_error_name(message);
+        return toResult(s && (rawString(s) == term.value));
+    }
+
+    case FilterTerm::Sender:
+    case FilterTerm::Destination: {
+        const char *s = (term.kind == FilterTerm::Sender) ? dbus_message_get_sender(message)
+                                                          : dbus_message_get_destination(message);
+        if (!s) {
+            return TermResult::False;
+        }
+        const QByteArray addr = rawString(s);
+        if (addr == term.value) {
+            return TermResult::True;
+        }
+        // two different unique names can never match each other,
+        //   but well-known names have to be resolved first
+        if (term.value.startsWith(':') && addr.startsWith(':')) {
+            return TermResult::False;
+        }
+        return TermResult::Unknown;
+    }
+
+    case FilterTerm::Arg:
+    case FilterTerm::ArgPath:
+    case FilterTerm::Arg0Namespace:
+        return matchArgHeader(message, term);
+
+    default:
+        break;
+    }
+    // pid and exe are only known after resolving
+    return TermResult::Unknown;
+}
+
+static bool matchArgResolved(const DBusMessageObject &obj, const FilterTerm &term)
+{
+    if (term.argIndex >= obj.contents.size()) {
+        return false;
+    }
+    const QVariant &arg = obj.contents.at(term.argIndex);
+    if (arg.type() == QVariant::String) {
+        const QString s = arg.toString();
+        switch (term.kind) {
+        case FilterTerm::Arg:           return s == term.valueStr;
+        case FilterTerm::ArgPath:       return argPathMatches(s, term.valueStr, QLatin1Char('/'));
+        case FilterTerm::Arg0Namespace: return nameInNamespace(s, term.valueStr, QLatin1Char('.'));
+        default: return false;
+        }
+    }
+    if (term.kind != FilterTerm::Arg) {
+        return false;
+    }
+    switch (arg.type()) {
+    case QVariant::Int:
+    case QVariant::UInt:
+    case QVariant::LongLong:
+        return term.isNumber && (arg.toLongLong() == term.number);
+    case QVariant::ULongLong:
+        return term.isNumber && (term.number >= 0)
+                && (arg.toULongLong() == static_cast<quint64>(term.number));
+    case QVariant::Bool:
+    case QVariant::Double:
+        return arg.toString() == term.valueStr;
+    default:
+        break;
+    }
+    return false;
+}
+
+static bool matchTermResolved(const DBusMessageObject &obj, const FilterTerm &term)
+{
+    switch (term.kind) {
+    case FilterTerm::Type:           return (term.typeMask & (1 << obj.type)) != 0;
+    case FilterTerm::Interface:      return obj.interface == term.valueStr;
+    case FilterTerm::Member:         return obj.member == term.valueStr;
+    case FilterTerm::Path:           return obj.path == term.valueStr;
+    case FilterTerm::PathNamespace:  return pathInNamespace(obj.path, term.valueStr);
+    case FilterTerm::ErrorName:      return obj.errorName == term.valueStr;
+    case FilterTerm::Sender:
+        return (obj.senderAddress == term.valueStr) || obj.senderNames.contains(term.valueStr);
+    case FilterTerm::Destination:
+        return (obj.destinationAddress == term.valueStr) || obj.destinationNames.contains(term.valueStr);
+    case FilterTerm::Arg:
+    case FilterTerm::ArgPath:
+    case FilterTerm::Arg0Namespace:
+        return matchArgResolved(obj, term);
+    case FilterTerm::Pid:
+        return (obj.senderPid == static_cast<uint>(term.number))
+                || (obj.destinationPid == static_cast<uint>(term.number));
+    case FilterTerm::SenderPid:      return obj.senderPid == static_cast<uint>(term.number);
+    case FilterTerm::DestinationPid: return obj.destinationPid == static_cast<uint>(term.number);
+    case FilterTerm::Exe:
+        return exeMatches(obj.senderExe, term.valueStr) || exeMatches(obj.destinationExe, term.valueStr);
+    case FilterTerm::SenderExe:      return exeMatches(obj.senderExe, term.valueStr);
+    case FilterTerm::DestinationExe: return exeMatches(obj.destinationExe, term.valueStr);
+    }
+    return false;
+}
+
+
+static int parseTypeMask(const QString &value)
+{
+    int mask = 0;
+    const QStringList types = value.split(QLatin1Char('|'), QString::SkipEmptyParts);
+    for (const QString &t: types) {
+        const QString typeName = t.trimmed().replace(QLatin1Char(' '), QLatin1Char('_'));
+        int messageType = dbus_message_type_from_string(typeName.toUtf8().constData());
+        if (messageType == DBUS_MESSAGE_TYPE_INVALID) {
+            return 0;
+        }
+        mask |= (1 << messageType);
+    }
+    return mask;
+}
+
+static bool parseKeyValues(const QString &rule, QList<QPair<QString, QString>> &pairs, QString *errorString)
+{
+    // key1='value1',key2='value2'; outside of quotes \' is a literal apostrophe
+    int i = 0;
+    const int len = rule.size();
+    while (i < len) {
+        while (i < len && rule.at(i).isSpace()) {
+            i++;
+        }
+        if (i >= len) {
+            break;
+        }
+
+        const int eq = rule.indexOf(QLatin1Char('='), i);
+        if (eq < 0) {
+            if (errorString) {
+                *errorString = QStringLiteral("Missing '=' after key: %1").arg(rule.mid(i));
+            }
+            return false;
+        }
+        const QString key = rule.mid(i, eq - i).trimmed();
+        i = eq + 1;
+
+        QString value;
+        bool inQuotes = false;
+        for (; i < len; i++) {
+            const QChar ch = rule.at(i);
+            if (ch == QLatin1Char('\'')) {
+                inQuotes = !inQuotes;
+            } else if (!inQuotes && ch == QLatin1Char(',')) {
+                break;
+            } else if (!inQuotes && ch == QLatin1Char('\\')
+                       && (i + 1 < len) && rule.at(i + 1) == QLatin1Char('\'')) {
+                value.append(QLatin1Char('\''));
+                i++;
+            } else {
+                value.append(ch);
+            }
+        }
+        if (inQuotes) {
+            if (errorString) {
+                *errorString = QStringLiteral("Unterminated quote in value of key: %1").arg(key);
+            }
+            return false;
+        }
+        i++; // skip ','
+
+        pairs.append(qMakePair(key, value));
+    }
+    return true;
+}
+
+static QString quoteMatchValue(const QString &value)
+{
+    // there is no escaping inside quotes, so close quote, add \' and reopen
+    QString escaped = value;
+    escaped.replace(QLatin1String("'"), QLatin1String("'\\''"));
+    return QLatin1Char('\'') + escaped + QLatin1Char('\'');
+}
+
+static bool isDaemonTerm(const FilterTerm &term)
+{
+    switch (term.kind) {
+    case FilterTerm::Type:
+        // only single type is allowed in a match rule, and with underscores
+        return (term.typeMask & (term.typeMask - 1)) == 0
+                && !term.valueStr.contains(QLatin1Char(' '));
+    case FilterTerm::Interface:
+    case FilterTerm::Member:
+    case FilterTerm::Path:
+    case FilterTerm::PathNamespace:
+    case FilterTerm::Sender:
+    case FilterTerm::Destination:
+    case FilterTerm::Arg0Namespace:
+        return true;
+    case FilterTerm::ArgPath:
+        // daemon matches strings and object paths, we also signatures;
+        //   a signature cannot match a value with '/'
+        return term.value.startsWith('/');
+    case FilterTerm::Arg: {
+        // Daemon compares argN only to string arguments, matchArgHeader()
+        //   also to object paths, signatures, numbers and booleans. Only
+        //   a value none of those can be equal to is left for the daemon.
+        if (term.isNumber || term.value == "true" || term.value == "false" || term.value.startsWith('/')) {
+            return false;
+        }
+        bool isDouble = false;
+        term.valueStr.toDouble(&isDouble);
+        return !isDouble && !dbus_signature_validate(term.value.constData(), nullptr);
+    }
+    default:
+        break;
+    }
+    return false;
+}
+
+static bool compileTerm(const QString &key, const QString &value, FilterTerm &term, QString *errorString)
+{
+    static const QHash<QString, FilterTerm::Kind> simpleKeys = {
+        {QStringLiteral("interface"),       FilterTerm::Interface},
+        {QStringLiteral("member"),          FilterTerm::Member},
+        {QStringLiteral("path"),            FilterTerm::Path},
+        {QStringLiteral("path_namespace"),  FilterTerm::PathNamespace},
+        {QStringLiteral("error"),           FilterTerm::ErrorName},
+        {QStringLiteral("sender"),          FilterTerm::Sender},
+        {QStringLiteral("destination"),     FilterTerm::Destination},
+        {QStringLiteral("exe"),             FilterTerm::Exe},
+        {QStringLiteral("sender_exe"),      FilterTerm::SenderExe},
+        {QStringLiteral("destination_exe"), FilterTerm::DestinationExe},
+        {QStringLiteral("pid"),             FilterTerm::Pid},
+        {QStringLiteral("sender_pid"),      FilterTerm::SenderPid},
+        {QStringLiteral("destination_pid"), FilterTerm::DestinationPid},
+    };
+
+    term.value = value.toUtf8();
+    term.valueStr = value;
+    term.number = value.toLongLong(&term.isNumber);
+
+    if (key == QLatin1String("type")) {
+        term.kind = FilterTerm::Type;
+        term.typeMask = parseTypeMask(value);
+        if (term.typeMask == 0) {
+            if (errorString) {
+                *errorString = QStringLiteral("Unknown message type: %1").arg(value);
+            }
+            return false;
+        }
+        return true;
+    }
+
+    if (simpleKeys.contains(key)) {
+        term.kind = simpleKeys.value(key);
+        if ((term.kind == FilterTerm::Pid || term.kind == FilterTerm::SenderPid
+             || term.kind == FilterTerm::DestinationPid) && !term.isNumber) {
+            if (errorString) {
+                *errorString = QStringLiteral("PID must be a number: %1").arg(value);
+            }
+            return false;
+        }
+        return true;
+    }
+
+    if (key.startsWith(QLatin1String("arg"))) {
+        int pos = 3;
+        while (pos < key.size() && key.at(pos).isDigit()) {
+            pos++;
+        }
+        bool ok = false;
+        term.argIndex = key.midRef(3, pos - 3).toInt(&ok);
+        const QStringRef suffix = key.midRef(pos);
+        if (ok && term.argIndex <= 63) {
+            if (suffix.isEmpty()) {
+                term.kind = FilterTerm::Arg;
+                return true;
+            }
+            if (suffix == QLatin1String("path")) {
+                term.kind = FilterTerm::ArgPath;
+                return true;
+            }
+            if (suffix == QLatin1String("namespace") && term.argIndex == 0) {
+                term.kind = FilterTerm::Arg0Namespace;
+                return true;
+            }
+        }
+    }
+
+    if (errorString) {
+        *errorString = QStringLiteral("Unknown match rule key: %1").arg(key);
+    }
+    return false;
+}
+
+
+MessageFilter::MessageFilter()
+    : d(new MessageFilterData)
+{
+}
+
+MessageFilter::MessageFilter(const MessageFilter &other) = default;
+
+MessageFilter &MessageFilter::operator=(const MessageFilter &other) = default;
+
+MessageFilter::~MessageFilter() = default;
+
+
+bool MessageFilter::setRules(const QStringList &rules, QString *errorString)
+{
+    MessageFilter compiled;
+    for (const QString &rule: rules) {
+        if (!compiled.addRule(rule, errorString)) {
+            return false;
+        }
+    }
+    *this = compiled;
+    return true;
+}
+
+bool MessageFilter::addRule(const QString &rule, QString *errorString)
+{
+    QList<QPair<QString, QString>> pairs;
+    if (!parseKeyValues(rule, pairs, errorString)) {
+        return false;
+    }
+
+    FilterRule compiled;
+    compiled.text = rule.trimmed();
+    for (const auto &kv: pairs) {
+        // eavesdrop is meaningless for a monitor
+        if (kv.first == QLatin1String("eavesdrop")) {
+            continue;
+        }
+        FilterTerm term;
+        if (!compileTerm(kv.first, kv.second, term, errorString)) {
+            return false;
+        }
+        compiled.terms.append(term);
+        if (isDaemonTerm(term)) {
+            compiled.daemonTerms.append(kv.first + QLatin1Char('=') + quoteMatchValue(kv.second));
+        }
+    }
+
+    std::stable_sort(compiled.terms.begin(), compiled.terms.end(),
+                     [](const FilterTerm &a, const FilterTerm &b) {
+        return a.kind < b.kind;
+    });
+
+    qCDebug(logFilter) << "compiled rule:" << compiled.text << "terms:" << compiled.terms.size();
+    d->rules.append(compiled);
+    return true;
+}
+
+void MessageFilter::clear()
+{
+    d->rules.clear();
+}
+
+bool MessageFilter::isEmpty() const
+{
+    return d->rules.isEmpty();
+}
+
+QStringList MessageFilter::rules() const
+{
+    QStringList ret;
+    for (const FilterRule &rule: d->rules) {
+        ret.append(rule.text);
+    }
+    return ret;
+}
+
+QStringList MessageFilter::daemonMatchRules() const
+{
+    QStringList ret;
+    for (const FilterRule &rule: d->rules) {
+        if (rule.daemonTerms.isEmpty()) {
+            // this rule needs all traffic, so the daemon cannot drop anything
+            return QStringList();
+        }
+        ret.append(rule.daemonTerms.join(QLatin1Char(',')));
+    }
+    return ret;
+}
+
+
+MessageFilter::Match MessageFilter::matchHeader(DBusMessage *message) const
+{
+    if (d->rules.isEmpty()) {
+        return Match::Accepted;
+    }
+
+    bool needsDetails = false;
+    for (const FilterRule &rule: d->rules) {
+        TermResult ruleResult = TermResult::True;
+        for (const FilterTerm &term: rule.terms) {
+            const TermResult r = matchTermHeader(message, term);
+            if (r == TermResult::False) {
+                ruleResult = TermResult::False;
+                break;
+            }
+            if (r == TermResult::Unknown) {
+                ruleResult = TermResult::Unknown;
+            }
+        }
+        if (ruleResult == TermResult::True) {
+            return Match::Accepted;
+        }
+        if (ruleResult == TermResult::Unknown) {
+            needsDetails = true;
+        }
+    }
+    return needsDetails ? Match::NeedsDetails : Match::Rejected;
+}
+
+bool MessageFilter::matchMessage(const DBusMessageObject &messageObj, DBusMessage *message) const
+{
+    // lost messages might have matched, so loss is shown in any view
+    if (d->rules.isEmpty() || messageObj.isGap()) {
+        return true;
+    }
+
+    for (const FilterRule &rule: d->rules) {
+        bool ruleMatched = true;
+        for (const FilterTerm &term: rule.terms) {
+            // raw header is authoritative for everything it can decide
+            TermResult r = message ? matchTermHeader(message, term) : TermResult::Unknown;
+            if (r == TermResult::Unknown) {
+                r = toResult(matchTermResolved(messageObj, term));
+            }
+            if (r == TermResult::False) {
+                ruleMatched = false;
+                break;
+            }
+        }
+        if (ruleMatched) {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+QStringList MessageFilter::splitRules(const QString &text)
+{
+    QStringList ret;
+    QString current;
+    bool inQuotes = false;
+    for (const QChar ch: text) {
+        if (ch == QLatin1Char('\'')) {
+            inQuotes = !inQuotes;
+        }
+        if (!inQuotes && (ch == QLatin1Char(';') || ch == QLatin1Char('\n'))) {
+            if (!current.trimmed().isEmpty()) {
+                ret.append(current.trimmed());
+            }
+            current.clear();
+            continue;
+        }
+        current.append(ch);
+    }
+    if (!current.trimmed().isEmpty()) {
+        ret.append(current.trimmed());
+    }
+    return ret;
+}
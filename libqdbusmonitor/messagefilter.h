@@ -0,0 +1,77 @@
+#ifndef MESSAGEFILTER_H
+#define MESSAGEFILTER_H
+
+#include <QSharedDataPointer>
+#include <QString>
+#include <QStringList>
+
+#include "libqdbusmonitor.h"
+#include "dbusmessageobject.h"
+
+typedef struct DBusMessage DBusMessage;
+
+class MessageFilterData;
+
+
+/**
+ * User-defined message filter, compiled from one or more D-Bus match rules.
+ *
+ * Every rule is a list of key='value' terms, just like in dbus-monitor or
+ * AddMatch. A message passes the filter if it matches any of the rules;
+ * an empty filter passes everything. Besides standard match rule keys
+ * (type, sender, destination, interface, member, path, path_namespace,
+ * argN, argNpath, arg0namespace) some extensions are understood:
+ *
+ *  - type may list several types: type='signal|error'
+ *  - error='org.freedesktop.DBus.Error.Failed' matches error name
+ *  - pid, sender_pid, destination_pid match resolved process ids
+ *  - exe, sender_exe, destination_exe match resolved executable, either
+ *    full path or only file name if value has no '/'
+ *  - argN also matches non-string basic arguments by value: arg1='42'
+ *
+ * Terms are sorted by evaluation cost at compile time. matchHeader() only
+ * looks at raw message header (and arguments, if requested), so it can run
+ * before any parsing or name resolution happens.
+ */
+class LIBQDBUSMONITOR_API MessageFilter
+{
+public:
+    enum class Match {
+        Rejected,
+        Accepted,
+        NeedsDetails, // header is not enough, call matchMessage() on resolved message
+    };
+
+public:
+    MessageFilter();
+    MessageFilter(const MessageFilter &other);
+    MessageFilter &operator=(const MessageFilter &other);
+    ~MessageFilter();
+
+    bool setRules(const QStringList &rules, QString *errorString = nullptr);
+    bool addRule(const QString &rule, QString *errorString = nullptr);
+    void clear();
+
+    bool isEmpty() const;
+    QStringList rules() const;
+
+    // Rules reduced to keys dbus-daemon understands, to be passed to
+    //   DBusMonitorThread::startOnSessionBus() as a pre-filter. They may match
+    //   more than the filter itself. Empty list means no pre-filtering possible.
+    QStringList daemonMatchRules() const;
+
+    Match matchHeader(DBusMessage *message) const;
+    // if raw message is given, it is used for all terms it can decide;
+    //   gap markers always match
+    bool matchMessage(const DBusMessageObject &messageObj, DBusMessage *message = nullptr) const;
+
+    // split user input like "type='signal';interface='a.b'" into rules
+    static QStringList splitRules(const QString &text);
+
+private:
+    QSharedDataPointer<MessageFilterData> d;
+};
+
+Q_DECLARE_METATYPE(MessageFilter)
+
+#endif // MESSAGEFILTER_H
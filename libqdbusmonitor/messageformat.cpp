@@ -0,0 +1,527 @@
+#include <dbus/dbus.h>
+#include <stdio.h>
+#include <QDataStream>
+#include <QtNumeric>
+#include <QtEndian>
+
+#include "messageformat.h"
+
+
+namespace MessageFormat {
+
+
+static const char BINARY_MAGIC[8] = {'Q', 'D', 'B', 'M', 'O', 'N', '\0', '\1'};
+static const QDataStream::Version BINARY_STREAM_VERSION = QDataStream::Qt_5_6;
+
+static const char CSV_HEADER[] =
+        "timestamp,bus,type,serial,reply_serial,sender,sender_names,sender_pid,sender_exe,"
+        "destination,destination_names,destination_pid,destination_exe,path,interface,member,"
+        "error_name,size,weight,dropped,args\n";
+
+// classic libpcap, microsecond timestamps
+static const quint32 PCAP_MAGIC = 0xa1b2c3d4;
+static const quint32 PCAP_SNAPLEN = 128 * 1024 * 1024; // D-Bus maximum message size
+static const quint32 LINKTYPE_DBUS = 231;
+
+
+bool formatFromString(const QString &name, Format *format)
+{
+    if (name == QLatin1String("text")) {
+        *format = Format::Text;
+    } else if (name == QLatin1String("json") || name == QLatin1String("jsonl")) {
+        *format = Format::JsonLines;
+    } else if (name == QLatin1String("binary") || name == QLatin1String("bin")) {
+        *format = Format::Binary;
+    } else if (name == QLatin1String("capture")) {
+        *format = Format::CaptureFile;
+    } else if (name == QLatin1String("csv")) {
+        *format = Format::Csv;
+    } else if (name == QLatin1String("pcap")) {
+        *format = Format::Pcap;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+
+QByteArray fileHeader(Format format)
+{
+    switch (format) {
+    case Format::Binary:
+        return QByteArray(BINARY_MAGIC, sizeof(BINARY_MAGIC));
+    case Format::Csv:
+        return QByteArray(CSV_HEADER);
+    case Format::Pcap: {
+        uchar header[24];
+        qToLittleEndian<quint32>(PCAP_MAGIC, header);
+        qToLittleEndian<quint16>(2, header + 4);  // version 2.4
+        qToLittleEndian<quint16>(4, header + 6);
+        qToLittleEndian<quint32>(0, header + 8);  // thiszone
+        qToLittleEndian<quint32>(0, header + 12); // sigfigs
+        qToLittleEndian<quint32>(PCAP_SNAPLEN, header + 16);
+        qToLittleEndian<quint32>(LINKTYPE_DBUS, header + 20);
+        return QByteArray(reinterpret_cast<const char *>(header), sizeof(header));
+    }
+    default:
+        return QByteArray();
+    }
+}
+
+
+static void appendJsonString(QByteArray &out, const QString &s)
+{
+    out.append('"');
+    const QByteArray utf8 = s.toUtf8();
+    for (const char c: utf8) {
+        switch (c) {
+        case '"':  out.append("\\\""); break;
+        case '\\': out.append("\\\\"); break;
+        case '\n': out.append("\\n");  break;
+        case '\r': out.append("\\r");  break;
+        case '\t': out.append("\\t");  break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                char buf[8] = {0};
+                snprintf(buf, sizeof(buf), "\\u%04x", static_cast<unsigned>(c));
+                out.append(buf);
+            } else {
+                out.append(c);
+            }
+            break;
+        }
+    }
+    out.append('"');
+}
+
+static void appendJsonStringList(QByteArray &out, const QStringList &list)
+{
+    out.append('[');
+    for (int i = 0; i < list.size(); i++) {
+        if (i > 0) {
+            out.append(',');
+        }
+        appendJsonString(out, list.at(i));
+    }
+    out.append(']');
+}
+
+// JSON has no NaN or infinity
+static void appendJsonDouble(QByteArray &out, double value)
+{
+    if (qIsFinite(value)) {
+        out.append(QByteArray::number(value, 'g', 17));
+    } else {
+        out.append("null");
+    }
+}
+
+// only what is known, ",\"<key>\":{...}" or nothing
+static void appendJsonCredentials(QByteArray &out, const char *key, const ConnectionCredentialsPtr &credentials)
+{
+    if (!credentials) {
+        return;
+    }
+    out.append(",\"").append(key).append("\":{");
+    bool first = true;
+    const auto field = [&out, &first] (const char *name) {
+        out.append(first ? "\"" : ",\"").append(name).append("\":");
+        first = false;
+    };
+    if (credentials->hasUid) {
+        field("uid");
+        out.append(QByteArray::number(credentials->uid));
+    }
+    if (!credentials->groupIds.isEmpty()) {
+        field("gids");
+        out.append('[');
+        for (int i = 0; i < credentials->groupIds.size(); i++) {
+            if (i > 0) {
+                out.append(',');
+            }
+            out.append(QByteArray::number(credentials->groupIds.at(i)));
+        }
+        out.append(']');
+    }
+    if (!credentials->securityLabel.isEmpty()) {
+        field("securityLabel");
+        appendJsonString(out, credentials->securityLabel);
+    }
+    if (credentials->procRead) {
+        field("cmdline");
+        appendJsonStringList(out, credentials->cmdline);
+        field("cgroup");
+        appendJsonString(out, credentials->cgroup);
+        field("unit");
+        appendJsonString(out, credentials->systemdUnit);
+    }
+    out.append('}');
+}
+
+static void appendVariant(QByteArray &out, const QVariant &v)
+{
+    switch (v.type()) {
+    case QVariant::Invalid:
+        out.append("null");
+        break;
+    case QVariant::Bool:
+        out.append(v.toBool() ? "true" : "false");
+        break;
+    case QVariant::Int:
+    case QVariant::LongLong:
+        out.append(QByteArray::number(v.toLongLong()));
+        break;
+    case QVariant::UInt:
+    case QVariant::ULongLong:
+        out.append(QByteArray::number(v.toULongLong()));
+        break;
+    case QVariant::Double:
+        appendJsonDouble(out, v.toDouble());
+        break;
+    case QVariant::List: {
+        const QVariantList list = v.toList();
+        out.append('[');
+        for (int i = 0; i < list.size(); i++) {
+            if (i > 0) {
+                out.append(',');
+            }
+            appendVariant(out, list.at(i));
+        }
+        out.append(']');
+        break;
+    }
+    case QVariant::Map: {
+        const QVariantMap map = v.toMap();
+        out.append('{');
+        for (auto it = map.constBegin(); it != map.constEnd(); ++it) {
+            if (it != map.constBegin()) {
+                out.append(',');
+            }
+            appendJsonString(out, it.key());
+            out.append(':');
+            appendVariant(out, it.value());
+        }
+        out.append('}');
+        break;
+    }
+    default:
+        appendJsonString(out, v.toString());
+        break;
+    }
+}
+
+static void appendEndpoint(QByteArray &out, const QString &addr, const QStringList &names,
+                           uint pid, const QString &exe)
+{
+    if (addr.isEmpty()) {
+        out.append('*');
+        return;
+    }
+    out.append(addr.toUtf8());
+    if (!names.isEmpty()) {
+        out.append(" (");
+        out.append(names.join(QLatin1Char(',')).toUtf8());
+        out.append(')');
+    }
+    if (pid > 0) {
+        out.append(" [");
+        out.append(exe.toUtf8());
+        out.append(' ');
+        out.append(QByteArray::number(pid));
+        out.append(']');
+    }
+}
+
+
+void appendText(QByteArray &out, const DBusMessageObject &messageObj)
+{
+    out.append(messageObj.timestamp.toString(Qt::ISODateWithMs).toUtf8());
+    out.append(' ');
+    if (!messageObj.bus.isEmpty()) {
+        out.append('[');
+        out.append(messageObj.bus.toUtf8());
+        out.append("] ");
+    }
+    out.append(messageObj.typeString.toUtf8());
+    if (messageObj.isGap()) {
+        out.append(": ");
+        out.append(QByteArray::number(messageObj.dropped));
+        out.append(" messages dropped\n");
+        return;
+    }
+    out.append(' ');
+    appendEndpoint(out, messageObj.senderAddress, messageObj.senderNames,
+                   messageObj.senderPid, messageObj.senderExe);
+    out.append(" -> ");
+    appendEndpoint(out, messageObj.destinationAddress, messageObj.destinationNames,
+                   messageObj.destinationPid, messageObj.destinationExe);
+    if (messageObj.serial > 0) {
+        out.append(" serial=");
+        out.append(QByteArray::number(messageObj.serial));
+    }
+    if (messageObj.replySerial > 0) {
+        out.append(" reply_serial=");
+        out.append(QByteArray::number(messageObj.replySerial));
+    }
+    if (!messageObj.path.isEmpty()) {
+        out.append(" path=");
+        out.append(messageObj.path.toUtf8());
+    }
+    if (!messageObj.interface.isEmpty()) {
+        out.append(" interface=");
+        out.append(messageObj.interface.toUtf8());
+    }
+    if (!messageObj.member.isEmpty()) {
+        out.append(" member=");
+        out.append(messageObj.member.toUtf8());
+    }
+    if (!messageObj.errorName.isEmpty()) {
+        out.append(" error=");
+        out.append(messageObj.errorName.toUtf8());
+    }
+    if (messageObj.weight != 1) {
+        out.append(" weight=");
+        out.append(QByteArray::number(messageObj.weight, 'g', 6));
+    }
+    if (!messageObj.contents.isEmpty()) {
+        out.append(" args=");
+        appendVariant(out, messageObj.contents);
+    }
+    out.append('\n');
+}
+
+
+void appendJson(QByteArray &out, const DBusMessageObject &messageObj)
+{
+    out.append("{\"timestamp\":");
+    appendJsonString(out, messageObj.timestamp.toString(Qt::ISODateWithMs));
+    out.append(",\"bus\":");
+    appendJsonString(out, messageObj.bus);
+    out.append(",\"type\":");
+    appendJsonString(out, messageObj.typeString);
+    out.append(",\"serial\":");
+    out.append(QByteArray::number(messageObj.serial));
+    out.append(",\"replySerial\":");
+    out.append(QByteArray::number(messageObj.replySerial));
+    out.append(",\"size\":");
+    out.append(QByteArray::number(messageObj.size));
+    if (messageObj.isGap()) {
+        out.append(",\"dropped\":");
+        out.append(QByteArray::number(messageObj.dropped));
+    }
+    if (messageObj.weight != 1) {
+        out.append(",\"weight\":");
+        appendJsonDouble(out, messageObj.weight);
+    }
+    out.append(",\"sender\":");
+    appendJsonString(out, messageObj.senderAddress);
+    out.append(",\"senderNames\":");
+    appendJsonStringList(out, messageObj.senderNames);
+    out.append(",\"senderPid\":");
+    out.append(QByteArray::number(messageObj.senderPid));
+    out.append(",\"senderExe\":");
+    appendJsonString(out, messageObj.senderExe);
+    appendJsonCredentials(out, "senderCredentials", messageObj.senderCredentials);
+    out.append(",\"destination\":");
+    appendJsonString(out, messageObj.destinationAddress);
+    out.append(",\"destinationNames\":");
+    appendJsonStringList(out, messageObj.destinationNames);
+    out.append(",\"destinationPid\":");
+    out.append(QByteArray::number(messageObj.destinationPid));
+    out.append(",\"destinationExe\":");
+    appendJsonString(out, messageObj.destinationExe);
+    appendJsonCredentials(out, "destinationCredentials", messageObj.destinationCredentials);
+    out.append(",\"path\":");
+    appendJsonString(out, messageObj.path);
+    out.append(",\"interface\":");
+    appendJsonString(out, messageObj.interface);
+    out.append(",\"member\":");
+    appendJsonString(out, messageObj.member);
+    out.append(",\"errorName\":");
+    appendJsonString(out, messageObj.errorName);
+    out.append(",\"args\":");
+    appendVariant(out, messageObj.contents);
+    out.append("}\n");
+}
+
+
+void appendBinary(QByteArray &out, const DBusMessageObject &messageObj)
+{
+    QByteArray record;
+    {
+        QDataStream stream(&record, QIODevice::WriteOnly);
+        stream.setVersion(BINARY_STREAM_VERSION);
+        stream << messageObj;
+    }
+    uchar lenBytes[4];
+    qToLittleEndian<quint32>(static_cast<quint32>(record.size()), lenBytes);
+    out.append(reinterpret_cast<const char *>(lenBytes), sizeof(lenBytes));
+    out.append(record);
+}
+
+
+bool readBinary(const QByteArray &data, int *pos, DBusMessageObject *messageObj)
+{
+    if (*pos + 4 > data.size()) {
+        return false;
+    }
+    const quint32 len = qFromLittleEndian<quint32>(
+                reinterpret_cast<const uchar *>(data.constData() + *pos));
+    if (static_cast<qint64>(*pos) + 4 + len > static_cast<qint64>(data.size())) {
+        return false;
+    }
+
+    const QByteArray record = QByteArray::fromRawData(data.constData() + *pos + 4, static_cast<int>(len));
+    QDataStream stream(record);
+    stream.setVersion(BINARY_STREAM_VERSION);
+    stream >> *messageObj;
+    if (stream.status() != QDataStream::Ok) {
+        return false;
+    }
+    *pos += 4 + static_cast<int>(len);
+    return true;
+}
+
+
+static void appendCsvField(QByteArray &out, const QByteArray &value)
+{
+    bool quote = false;
+    for (const char c: value) {
+        if (c == ',' || c == '"' || c == '\n' || c == '\r') {
+            quote = true;
+            break;
+        }
+    }
+    if (!quote) {
+        out.append(value);
+        return;
+    }
+    out.append('"');
+    for (const char c: value) {
+        if (c == '"') {
+            out.append('"');
+        }
+        out.append(c);
+    }
+    out.append('"');
+}
+
+static void appendCsvField(QByteArray &out, const QString &value)
+{
+    appendCsvField(out, value.toUtf8());
+}
+
+
+void appendCsv(QByteArray &out, const DBusMessageObject &messageObj)
+{
+    appendCsvField(out, messageObj.timestamp.toString(Qt::ISODateWithMs));
+    out.append(',');
+    appendCsvField(out, messageObj.bus);
+    out.append(',');
+    appendCsvField(out, messageObj.typeString);
+    out.append(',');
+    out.append(QByteArray::number(messageObj.serial));
+    out.append(',');
+    out.append(QByteArray::number(messageObj.replySerial));
+    out.append(',');
+    appendCsvField(out, messageObj.senderAddress);
+    out.append(',');
+    appendCsvField(out, messageObj.senderNames.join(QLatin1Char(' ')));
+    out.append(',');
+    out.append(QByteArray::number(messageObj.senderPid));
+    out.append(',');
+    appendCsvField(out, messageObj.senderExe);
+    out.append(',');
+    appendCsvField(out, messageObj.destinationAddress);
+    out.append(',');
+    appendCsvField(out, messageObj.destinationNames.join(QLatin1Char(' ')));
+    out.append(',');
+    out.append(QByteArray::number(messageObj.destinationPid));
+    out.append(',');
+    appendCsvField(out, messageObj.destinationExe);
+    out.append(',');
+    appendCsvField(out, messageObj.path);
+    out.append(',');
+    appendCsvField(out, messageObj.interface);
+    out.append(',');
+    appendCsvField(out, messageObj.member);
+    out.append(',');
+    appendCsvField(out, messageObj.errorName);
+    out.append(',');
+    out.append(QByteArray::number(messageObj.size));
+    out.append(',');
+    out.append(QByteArray::number(messageObj.weight, 'g', 17));
+    out.append(',');
+    out.append(QByteArray::number(messageObj.dropped));
+    out.append(',');
+    QByteArray args;
+    appendVariant(args, messageObj.contents);
+    appendCsvField(out, args);
+    out.append('\n');
+}
+
+
+static void setHeaderField(DBusMessage *message, dbus_bool_t (*setter)(DBusMessage *, const char *),
+                           const QString &value)
+{
+    if (!value.isEmpty()) {
+        setter(message, value.toUtf8().constData());
+    }
+}
+
+void appendPcap(QByteArray &out, const DBusMessageObject &messageObj)
+{
+    if (messageObj.type <= DBUS_MESSAGE_TYPE_INVALID || messageObj.type > DBUS_MESSAGE_TYPE_SIGNAL) {
+        return;
+    }
+    DBusMessage *message = dbus_message_new(messageObj.type);
+    if (!message) {
+        return;
+    }
+    setHeaderField(message, dbus_message_set_sender, messageObj.senderAddress);
+    setHeaderField(message, dbus_message_set_destination, messageObj.destinationAddress);
+    setHeaderField(message, dbus_message_set_path, messageObj.path);
+    setHeaderField(message, dbus_message_set_interface, messageObj.interface);
+    setHeaderField(message, dbus_message_set_member, messageObj.member);
+    setHeaderField(message, dbus_message_set_error_name, messageObj.errorName);
+    if (messageObj.serial != 0) {
+        dbus_message_set_serial(message, messageObj.serial);
+    }
+    if (messageObj.replySerial != 0) {
+        dbus_message_set_reply_serial(message, messageObj.replySerial);
+    }
+    dbus_message_set_no_reply(message, messageObj.noReply);
+
+    char *data = nullptr;
+    int len = 0;
+    if (dbus_message_marshal(message, &data, &len)) {
+        const qint64 ms = messageObj.timestamp.toMSecsSinceEpoch();
+        uchar record[16];
+        qToLittleEndian<quint32>(static_cast<quint32>(ms / 1000), record);
+        qToLittleEndian<quint32>(static_cast<quint32>(ms % 1000) * 1000, record + 4);
+        qToLittleEndian<quint32>(static_cast<quint32>(len), record + 8);
+        qToLittleEndian<quint32>(qMax(static_cast<quint32>(len), static_cast<quint32>(messageObj.size)), record + 12);
+        out.append(reinterpret_cast<const char *>(record), sizeof(record));
+        out.append(data, len);
+        dbus_free(data);
+    }
+    dbus_message_unref(message);
+}
+
+
+void append(QByteArray &out, const DBusMessageObject &messageObj, Format format)
+{
+    switch (format) {
+    case Format::Text:      appendText(out, messageObj);   break;
+    case Format::JsonLines: appendJson(out, messageObj);   break;
+    case Format::Csv:       appendCsv(out, messageObj);    break;
+    case Format::Pcap:      appendPcap(out, messageObj);   break;
+    case Format::Binary:
+    case Format::CaptureFile:
+        appendBinary(out, messageObj);
+        break;
+    }
+}
+
+
+} // namespace MessageFormat
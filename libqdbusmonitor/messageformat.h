@@ -0,0 +1,44 @@
+#ifndef MESSAGEFORMAT_H
+#define MESSAGEFORMAT_H
+
+#include <QByteArray>
+#include <QString>
+
+#include "libqdbusmonitor.h"
+#include "dbusmessageobject.h"
+
+
+namespace MessageFormat {
+
+enum class Format {
+    Text,       // one human-readable line per message
+    JsonLines,  // one JSON object per line
+    Binary,     // file header, then length-prefixed QDataStream records
+    CaptureFile, // Binary records in compressed blocks, see capturefile.h
+    Csv,        // header row, then one row per message, arguments as JSON
+    Pcap,       // libpcap file, link type DBUS; headers only, see appendPcap()
+};
+
+LIBQDBUSMONITOR_API bool formatFromString(const QString &name, Format *format);
+
+// written once at the start of output, may be empty
+LIBQDBUSMONITOR_API QByteArray fileHeader(Format format);
+
+// serialize one message and append it to out, does not clear out
+LIBQDBUSMONITOR_API void append(QByteArray &out, const DBusMessageObject &messageObj, Format format);
+
+LIBQDBUSMONITOR_API void appendText(QByteArray &out, const DBusMessageObject &messageObj);
+LIBQDBUSMONITOR_API void appendJson(QByteArray &out, const DBusMessageObject &messageObj);
+LIBQDBUSMONITOR_API void appendBinary(QByteArray &out, const DBusMessageObject &messageObj);
+LIBQDBUSMONITOR_API void appendCsv(QByteArray &out, const DBusMessageObject &messageObj);
+// Decoded arguments cannot be marshalled back, so records carry a
+//   re-marshalled header with empty body; original length is the real
+//   message size, which tools show as a truncated packet. Gaps are skipped.
+LIBQDBUSMONITOR_API void appendPcap(QByteArray &out, const DBusMessageObject &messageObj);
+
+// reads one record written by appendBinary() from data at *pos, advances *pos
+LIBQDBUSMONITOR_API bool readBinary(const QByteArray &data, int *pos, DBusMessageObject *messageObj);
+
+}
+
+#endif // MESSAGEFORMAT_H
@@ -0,0 +1,155 @@
+#include <algorithm>
+#include <vector>
+#include <QDateTime>
+#include <QPointer>
+#include "messagemerger.h"
+#include "dbusmonitorthread.h"
+
+
+// how often queues of sources are collected
+static const unsigned long MERGE_INTERVAL_MS = 20;
+
+
+struct MessageMerger::Source
+{
+    Source(int capacity, MessageQueue::OverflowPolicy policy)
+        : queue(capacity, policy)
+    {
+    }
+
+    QPointer<DBusMonitorThread> monitor;
+    MessageQueue queue;
+    // used only by merger thread
+    qint64 lastTimestamp = 0;   // of messages, ms since epoch
+    qint64 lastDelivery = 0;    // when anything was last taken from queue
+};
+
+struct MessageMerger::Item
+{
+    qint64 timestamp;
+    quint64 sequence;           // keeps arrival order for equal timestamps
+    DBusMessageObject messageObj;
+};
+
+
+MessageMerger::MessageMerger(QObject *parent)
+    : QThread(parent)
+{
+}
+
+MessageMerger::~MessageMerger()
+{
+    finish();
+}
+
+void MessageMerger::setQueueLimit(int capacity, MessageQueue::OverflowPolicy policy)
+{
+    QMutexLocker guard(&m_mutex);
+    m_queueCapacity = capacity;
+    m_overflowPolicy = policy;
+}
+
+void MessageMerger::addSource(DBusMonitorThread *monitor)
+{
+    QMutexLocker guard(&m_mutex);
+    QSharedPointer<Source> source(new Source(m_queueCapacity, m_overflowPolicy));
+    source->monitor = monitor;
+
+    // runs on capture thread of that monitor
+    connect(monitor, &DBusMonitorThread::messageReceived, this, [source] (const DBusMessageObject &messageObj) {
+        source->queue.push(messageObj);
+    }, Qt::DirectConnection);
+
+    m_sources.append(source);
+    m_finishing = false;
+    guard.unlock();
+    if (!isRunning()) {
+        start();
+    }
+}
+
+void MessageMerger::finish()
+{
+    if (!isRunning()) {
+        return;
+    }
+    m_mutex.lock();
+    m_finishing = true;
+    m_wakeUp.wakeOne();
+    m_mutex.unlock();
+    wait();
+}
+
+quint64 MessageMerger::droppedCount() const
+{
+    QMutexLocker guard(&m_mutex);
+    quint64 dropped = 0;
+    for (const QSharedPointer<Source> &source: m_sources) {
+        dropped += source->queue.droppedCount();
+    }
+    return dropped;
+}
+
+void MessageMerger::run()
+{
+    // min-heap by (timestamp, sequence)
+    const auto later = [] (const Item &a, const Item &b) {
+        return (a.timestamp != b.timestamp) ? (a.timestamp > b.timestamp) : (a.sequence > b.sequence);
+    };
+    std::vector<Item> heap;
+    QVector<DBusMessageObject> batch;
+    quint64 sequence = 0;
+
+    for (;;) {
+        QVector<QSharedPointer<Source>> sources;
+        bool finishing = false;
+        {
+            QMutexLocker guard(&m_mutex);
+            if (!m_finishing) {
+                m_wakeUp.wait(&m_mutex, MERGE_INTERVAL_MS);
+            }
+            sources = m_sources;
+            finishing = m_finishing;
+        }
+
+        const qint64 now = QDateTime::currentMSecsSinceEpoch();
+        qint64 watermark = now;
+        for (const QSharedPointer<Source> &source: sources) {
+            batch = source->queue.takeAll();
+            if (!batch.isEmpty()) {
+                source->lastDelivery = now;
+            }
+            for (DBusMessageObject &messageObj: batch) {
+                Item item;
+                item.timestamp = messageObj.timestamp.toMSecsSinceEpoch();
+                item.sequence = sequence++;
+                item.messageObj = std::move(messageObj);
+                source->lastTimestamp = qMax(source->lastTimestamp, item.timestamp);
+                heap.push_back(std::move(item));
+                std::push_heap(heap.begin(), heap.end(), later);
+            }
+            batch.clear();
+
+            // stopped source will not deliver anything more; a running one
+            //   delivers in order, so nothing older than what it delivered last,
+            //   unless it is silent and may just have nothing to deliver
+            if (source->monitor && source->monitor->isRunning()) {
+                if (now - source->lastDelivery < IdleSourceMs) {
+                    watermark = qMin(watermark, source->lastTimestamp);
+                } else {
+                    watermark = qMin(watermark, qMax(source->lastTimestamp, now - IdleSourceMs));
+                }
+            }
+        }
+
+        while (!heap.empty() && (finishing || heap.front().timestamp <= watermark)) {
+            std::pop_heap(heap.begin(), heap.end(), later);
+            Q_EMIT messageReceived(heap.back().messageObj);
+            heap.pop_back();
+        }
+
+        if (finishing) {
+            break;
+        }
+    }
+}
@@ -0,0 +1,74 @@
+#ifndef MESSAGEMERGER_H
+#define MESSAGEMERGER_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QVector>
+#include <QSharedPointer>
+
+#include "libqdbusmonitor.h"
+#include "dbusmessageobject.h"
+#include "messagequeue.h"
+
+
+class DBusMonitorThread;
+
+
+/**
+ * Merges messages from several DBusMonitorThread instances into one
+ * stream ordered by capture timestamp.
+ *
+ * Each source appends to its own bounded MessageQueue, so capture threads
+ * never wait for each other, and a slow consumer makes sources drop
+ * messages (recorded as gap markers) instead of growing memory. Merger
+ * thread collects the queues every few milliseconds into a heap and
+ * emits a message once no source can produce anything older. Every
+ * source delivers in capture order, so that is the oldest of the last
+ * timestamps of running sources. A source that delivered nothing for
+ * IdleSourceMs is taken to be silent, not late, and holds output back
+ * by at most that much; so output of a quiet bus lags behind capture
+ * by about IdleSourceMs.
+ */
+class LIBQDBUSMONITOR_API MessageMerger: public QThread
+{
+    Q_OBJECT
+
+public:
+    static const int IdleSourceMs = 100;
+
+public:
+    explicit MessageMerger(QObject *parent = nullptr);
+    ~MessageMerger() override;
+
+    // queue of each source, must be called before addSource()
+    void setQueueLimit(int capacity, MessageQueue::OverflowPolicy policy);
+    // call before sources are started; merger thread is started on first call
+    void addSource(DBusMonitorThread *monitor);
+    // emits everything still pending and stops the thread,
+    //   call it after all sources are stopped
+    void finish();
+
+    // lost in queues of all sources, can be called from any thread
+    quint64 droppedCount() const;
+
+Q_SIGNALS:
+    // emitted from merger thread, in timestamp order
+    void messageReceived(DBusMessageObject messageObj);
+
+protected:
+    void run() override;
+
+private:
+    struct Source;
+    struct Item;
+
+    mutable QMutex m_mutex;     // protects m_sources list and m_finishing
+    QWaitCondition m_wakeUp;
+    QVector<QSharedPointer<Source>> m_sources;
+    bool m_finishing = false;
+    int m_queueCapacity = MessageQueue::DefaultCapacity;
+    MessageQueue::OverflowPolicy m_overflowPolicy = MessageQueue::OverflowPolicy::DropNewest;
+};
+
+#endif // MESSAGEMERGER_H
@@ -0,0 +1,176 @@
+#include "messagequeue.h"
+
+
+// dropped slots at the head are reclaimed once there are this many
+static const int COMPACT_THRESHOLD = 4096;
+
+
+MessageQueue::MessageQueue(int capacity, OverflowPolicy policy)
+    : m_capacity(qMax(1, capacity))
+    , m_policy(policy)
+{
+}
+
+bool MessageQueue::policyFromString(const QString &name, OverflowPolicy *policy)
+{
+    if (name == QLatin1String("drop-newest")) {
+        *policy = OverflowPolicy::DropNewest;
+    } else if (name == QLatin1String("drop-oldest")) {
+        *policy = OverflowPolicy::DropOldest;
+    } else if (name == QLatin1String("sample")) {
+        *policy = OverflowPolicy::Sample;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+void MessageQueue::setCapacity(int capacity)
+{
+    QMutexLocker guard(&m_mutex);
+    m_capacity = qMax(1, capacity);
+}
+
+int MessageQueue::capacity() const
+{
+    QMutexLocker guard(&m_mutex);
+    return m_capacity;
+}
+
+void MessageQueue::setOverflowPolicy(OverflowPolicy policy)
+{
+    QMutexLocker guard(&m_mutex);
+    m_policy = policy;
+}
+
+MessageQueue::OverflowPolicy MessageQueue::overflowPolicy() const
+{
+    QMutexLocker guard(&m_mutex);
+    return m_policy;
+}
+
+bool MessageQueue::push(const DBusMessageObject &messageObj)
+{
+    QMutexLocker guard(&m_mutex);
+    const bool wasEmpty = isEmptyLocked();
+
+    if (m_messages < m_capacity) {
+        m_items.append(messageObj);
+        m_messages++;
+        m_overflows = 0;
+    } else {
+        bool keep = false;
+        switch (m_policy) {
+        case OverflowPolicy::DropNewest:
+            keep = false;
+            break;
+        case OverflowPolicy::DropOldest:
+            keep = true;
+            break;
+        case OverflowPolicy::Sample:
+            keep = (m_overflows % SampleInterval) == 0;
+            break;
+        }
+        m_overflows++;
+        if (keep) {
+            // capacity may have been lowered, make room for this one
+            while (m_messages >= m_capacity) {
+                dropOldestLocked();
+            }
+            m_items.append(messageObj);
+            m_messages++;
+        } else {
+            dropNewestLocked(messageObj);
+        }
+    }
+
+    if (m_head >= COMPACT_THRESHOLD && m_head >= m_items.size() / 2) {
+        m_items.remove(0, m_head);
+        m_head = 0;
+    }
+
+    if (wasEmpty) {
+        m_notEmpty.wakeAll();
+    }
+    return wasEmpty;
+}
+
+QVector<DBusMessageObject> MessageQueue::takeAll(unsigned long timeoutMs)
+{
+    QMutexLocker guard(&m_mutex);
+    if (isEmptyLocked() && timeoutMs > 0 && !m_wakeUp) {
+        m_notEmpty.wait(&m_mutex, timeoutMs);
+    }
+    m_wakeUp = false;
+
+    QVector<DBusMessageObject> ret;
+    if (m_head > 0) {
+        m_items.remove(0, m_head);
+        m_head = 0;
+    }
+    ret.swap(m_items);
+    m_messages = 0;
+    m_overflows = 0;
+    return ret;
+}
+
+void MessageQueue::wakeUp()
+{
+    QMutexLocker guard(&m_mutex);
+    m_wakeUp = true;
+    m_notEmpty.wakeAll();
+}
+
+int MessageQueue::size() const
+{
+    QMutexLocker guard(&m_mutex);
+    return m_messages;
+}
+
+quint64 MessageQueue::droppedCount() const
+{
+    QMutexLocker guard(&m_mutex);
+    return m_dropped;
+}
+
+bool MessageQueue::isEmptyLocked() const
+{
+    return m_head >= m_items.size();
+}
+
+void MessageQueue::dropNewestLocked(const DBusMessageObject &messageObj)
+{
+    m_dropped++;
+    if (!isEmptyLocked() && m_items.last().isGap()) {
+        m_items.last().dropped++;
+    } else {
+        m_items.append(DBusMessageObject::gapMarker(messageObj.timestamp, 1));
+    }
+}
+
+void MessageQueue::dropOldestLocked()
+{
+    // [gap?] oldest [gap?] ... becomes [gap] ...
+    quint64 dropped = 0;
+    QDateTime timestamp;
+    if (m_items.at(m_head).isGap()) {
+        dropped = m_items.at(m_head).dropped;
+        timestamp = m_items.at(m_head).timestamp;
+        m_items[m_head++] = DBusMessageObject();
+    }
+    if (!timestamp.isValid()) {
+        timestamp = m_items.at(m_head).timestamp;
+    }
+    m_items[m_head++] = DBusMessageObject();
+    m_messages--;
+    m_dropped++;
+    dropped++;
+
+    if (!isEmptyLocked() && m_items.at(m_head).isGap()) {
+        DBusMessageObject &next = m_items[m_head];
+        next.dropped += dropped;
+        next.timestamp = timestamp;
+    } else {
+        m_items[--m_head] = DBusMessageObject::gapMarker(timestamp, dropped);
+    }
+}
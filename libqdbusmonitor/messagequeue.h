@@ -0,0 +1,84 @@
+#ifndef MESSAGEQUEUE_H
+#define MESSAGEQUEUE_H
+
+#include <QMutex>
+#include <QWaitCondition>
+#include <QVector>
+
+#include "libqdbusmonitor.h"
+#include "dbusmessageobject.h"
+
+
+/**
+ * Bounded queue between capture and one consumer (writer, GUI model).
+ *
+ * push() never blocks on a full queue, capture thread must keep up with
+ * the bus. Instead, overflow policy decides which message is lost:
+ *  - DropNewest: the incoming one;
+ *  - DropOldest: the one at the head of the queue;
+ *  - Sample: one of every SampleInterval incoming messages replaces the
+ *    oldest one, others are dropped, so consumer still sees a thinned
+ *    out picture of the burst.
+ * Every run of lost messages is replaced by one gap marker (see
+ * DBusMessageObject::gapMarker()) at the place where they were, so that
+ * consumer knows where and how many messages are missing. Markers do not
+ * count towards capacity, two markers are never adjacent.
+ * All methods are thread-safe.
+ */
+class LIBQDBUSMONITOR_API MessageQueue
+{
+public:
+    enum class OverflowPolicy {
+        DropNewest,
+        DropOldest,
+        Sample,
+    };
+
+    static const int DefaultCapacity = 100000;
+    static const int SampleInterval = 16;
+
+public:
+    explicit MessageQueue(int capacity = DefaultCapacity,
+                          OverflowPolicy policy = OverflowPolicy::DropNewest);
+
+    // "drop-newest", "drop-oldest" or "sample"
+    static bool policyFromString(const QString &name, OverflowPolicy *policy);
+
+    // applied to the next push(), queued messages are kept
+    void setCapacity(int capacity);
+    int capacity() const;
+    void setOverflowPolicy(OverflowPolicy policy);
+    OverflowPolicy overflowPolicy() const;
+
+    // returns true if queue was empty, that is consumer may need a wake up
+    bool push(const DBusMessageObject &messageObj);
+    // everything queued, gap markers included, in order;
+    //   if queue is empty, waits up to timeoutMs for a push() or wakeUp()
+    QVector<DBusMessageObject> takeAll(unsigned long timeoutMs = 0);
+    // makes current or next waiting takeAll() return at once
+    void wakeUp();
+
+    // messages in queue, without gap markers
+    int size() const;
+    // total since construction
+    quint64 droppedCount() const;
+
+private:
+    bool isEmptyLocked() const;
+    void dropNewestLocked(const DBusMessageObject &messageObj);
+    void dropOldestLocked();
+
+private:
+    mutable QMutex m_mutex;
+    QWaitCondition m_notEmpty;
+    QVector<DBusMessageObject> m_items;
+    int m_head = 0;          // items before it are already dropped
+    int m_messages = 0;
+    int m_capacity;
+    OverflowPolicy m_policy;
+    quint64 m_dropped = 0;
+    quint64 m_overflows = 0; // pushes into full queue since it was last not full
+    bool m_wakeUp = false;
+};
+
+#endif // MESSAGEQUEUE_H
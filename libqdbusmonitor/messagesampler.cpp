@@ -0,0 +1,197 @@
+#include <dbus/dbus.h>
+#include <QDateTime>
+
+#include "messagesampler.h"
+
+
+// load is measured over windows this long
+static const qint64 RATE_WINDOW_MS = 1000;
+static const int AUTO_RATIO_SCALE = 1000000;
+
+
+bool SamplingConfig::isEnabled() const
+{
+    return !typeRatios.isEmpty() || !interfaceRatios.isEmpty() || autoMaxRate > 0;
+}
+
+bool SamplingConfig::addSpec(const QString &spec, QString *errorString)
+{
+    const int eq = spec.lastIndexOf(QLatin1Char('='));
+    bool ok = false;
+    const double ratio = (eq > 0) ? spec.midRef(eq + 1).toDouble(&ok) : 0;
+    if (!ok || ratio <= 0 || ratio > 1) {
+        if (errorString) {
+            *errorString = QStringLiteral("Bad sampling spec '%1', expected <type or interface>=<ratio in (0, 1]>")
+                    .arg(spec);
+        }
+        return false;
+    }
+
+    const QString what = spec.left(eq).trimmed();
+    if (what == QLatin1String("signal")) {
+        typeRatios.insert(DBUS_MESSAGE_TYPE_SIGNAL, ratio);
+    } else if (what == QLatin1String("method_call")) {
+        typeRatios.insert(DBUS_MESSAGE_TYPE_METHOD_CALL, ratio);
+    } else if (what.contains(QLatin1Char('.'))) {
+        interfaceRatios.insert(what, ratio);
+    } else {
+        if (errorString) {
+            // replies follow their calls, errors are always kept
+            *errorString = QStringLiteral("Only signal, method_call or interface names can be sampled, not '%1'")
+                    .arg(what);
+        }
+        return false;
+    }
+    return true;
+}
+
+
+MessageSampler::MessageSampler()
+    : m_random(static_cast<quint64>(QDateTime::currentMSecsSinceEpoch()) | 1)
+    , m_sampledOut(0)
+    , m_autoRatio(AUTO_RATIO_SCALE)
+{
+}
+
+void MessageSampler::setConfig(const SamplingConfig &config)
+{
+    m_config = config;
+    m_enabled = config.isEnabled();
+    m_calls.clear();
+    m_oldCalls.clear();
+    m_windowMessages = 0;
+    m_window.start();
+    m_autoRatio.store(AUTO_RATIO_SCALE);
+}
+
+SamplingConfig MessageSampler::config() const
+{
+    return m_config;
+}
+
+double MessageSampler::sample(DBusMessage *message)
+{
+    if (!m_enabled) {
+        return 1;
+    }
+    updateRate();
+
+    const int type = dbus_message_get_type(message);
+    switch (type) {
+    case DBUS_MESSAGE_TYPE_ERROR:
+    case DBUS_MESSAGE_TYPE_METHOD_RETURN: {
+        QByteArray key(dbus_message_get_destination(message));
+        key.append(' ');
+        key.append(QByteArray::number(dbus_message_get_reply_serial(message)));
+        const double weight = lookupCall(key);
+        if (type == DBUS_MESSAGE_TYPE_ERROR) {
+            return 1;
+        }
+        if (weight == 0) {
+            m_sampledOut.fetchAndAddRelaxed(1);
+        }
+        return weight;
+    }
+    case DBUS_MESSAGE_TYPE_METHOD_CALL:
+    case DBUS_MESSAGE_TYPE_SIGNAL:
+        break;
+    default:
+        return 1;
+    }
+
+    const double ratio = ratioFor(message, type);
+    double weight = 1;
+    if (ratio < 1) {
+        weight = (random() < ratio) ? 1 / ratio : 0;
+    }
+    if (type == DBUS_MESSAGE_TYPE_METHOD_CALL && !dbus_message_get_no_reply(message)) {
+        QByteArray key(dbus_message_get_sender(message));
+        key.append(' ');
+        key.append(QByteArray::number(dbus_message_get_serial(message)));
+        trackCall(key, weight);
+    }
+    if (weight == 0) {
+        m_sampledOut.fetchAndAddRelaxed(1);
+    }
+    return weight;
+}
+
+quint64 MessageSampler::sampledOutCount() const
+{
+    return m_sampledOut.load();
+}
+
+double MessageSampler::autoRatio() const
+{
+    return static_cast<double>(m_autoRatio.load()) / AUTO_RATIO_SCALE;
+}
+
+double MessageSampler::ratioFor(DBusMessage *message, int type) const
+{
+    double ratio = 1;
+    const char *iface = dbus_message_get_interface(message);
+    auto it = iface ? m_config.interfaceRatios.constFind(QString::fromUtf8(iface))
+                    : m_config.interfaceRatios.constEnd();
+    if (it != m_config.interfaceRatios.constEnd()) {
+        ratio = it.value();
+    } else {
+        ratio = m_config.typeRatios.value(type, 1);
+    }
+    return ratio * autoRatio();
+}
+
+void MessageSampler::updateRate()
+{
+    m_windowMessages++;
+    const qint64 elapsed = m_window.elapsed();
+    if (elapsed < RATE_WINDOW_MS) {
+        return;
+    }
+    double ratio = 1;
+    if (m_config.autoMaxRate > 0) {
+        const double rate = m_windowMessages * 1000.0 / elapsed;
+        if (rate > m_config.autoMaxRate) {
+            ratio = m_config.autoMaxRate / rate;
+        }
+    }
+    m_autoRatio.store(qMax(1, static_cast<int>(ratio * AUTO_RATIO_SCALE)));
+    m_windowMessages = 0;
+    m_window.restart();
+}
+
+double MessageSampler::lookupCall(const QByteArray &key)
+{
+    auto it = m_calls.find(key);
+    if (it != m_calls.end()) {
+        const double weight = it.value();
+        m_calls.erase(it);
+        return weight;
+    }
+    it = m_oldCalls.find(key);
+    if (it != m_oldCalls.end()) {
+        const double weight = it.value();
+        m_oldCalls.erase(it);
+        return weight;
+    }
+    return 1; // call was not seen
+}
+
+void MessageSampler::trackCall(const QByteArray &key, double weight)
+{
+    if (m_calls.size() >= MaxTrackedCalls / 2) {
+        // calls without reply for this long are not going to get one
+        m_oldCalls.swap(m_calls);
+        m_calls.clear();
+    }
+    m_calls.insert(key, weight);
+}
+
+double MessageSampler::random()
+{
+    // xorshift64*, uniform in [0, 1)
+    m_random ^= m_random >> 12;
+    m_random ^= m_random << 25;
+    m_random ^= m_random >> 27;
+    const quint64 r = m_random * Q_UINT64_C(2685821657736338717);
+    return static_cast<double>(r >> 11) / static_cast<double>(Q_UINT64_C(1) << 53);
+}
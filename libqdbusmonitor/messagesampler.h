@@ -0,0 +1,89 @@
+#ifndef MESSAGESAMPLER_H
+#define MESSAGESAMPLER_H
+
+#include <QAtomicInteger>
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+
+#include "libqdbusmonitor.h"
+
+typedef struct DBusMessage DBusMessage;
+
+
+// Which share of messages to keep, each ratio is in (0, 1]
+struct LIBQDBUSMONITOR_API SamplingConfig {
+    // by DBUS_MESSAGE_TYPE_SIGNAL or DBUS_MESSAGE_TYPE_METHOD_CALL
+    QHash<int, double> typeRatios;
+    // by interface name, takes precedence over type ratio
+    QHash<QString, double> interfaceRatios;
+    // When more messages per second than this arrive, all ratios are
+    //   lowered further to bring them down to about this rate; 0 disables
+    double autoMaxRate = 0;
+
+    bool isEnabled() const;
+
+    // Each spec is "<type>=<ratio>" or "<interface>=<ratio>", for example
+    //   "signal=0.1" or "org.freedesktop.DBus.Properties=0.01"
+    bool addSpec(const QString &spec, QString *errorString = nullptr);
+};
+
+
+/**
+ * Decides on capture thread which messages are recorded when sampling.
+ *
+ * A kept message gets weight 1/ratio, the number of captured messages it
+ * stands for; sums of weights are unbiased estimates of real totals.
+ * Errors are always kept with weight 1. Method calls and their replies
+ * are kept or dropped together: a call expecting a reply is remembered
+ * with its weight, and the reply inherits it, so every recorded reply
+ * has its call and reply latencies are not skewed. Replies to calls that
+ * were not seen are kept as they are.
+ * Not thread-safe except sampledOutCount() and autoRatio().
+ */
+class LIBQDBUSMONITOR_API MessageSampler
+{
+public:
+    // calls waiting for a reply that are remembered, older are forgotten
+    static const int MaxTrackedCalls = 65536;
+
+public:
+    MessageSampler();
+
+    void setConfig(const SamplingConfig &config);
+    SamplingConfig config() const;
+
+    // Weight of message if it is to be kept, 0 if it is sampled out.
+    //   Must see every message that passed the filter, to measure the rate.
+    double sample(DBusMessage *message);
+
+    // total since construction
+    quint64 sampledOutCount() const;
+    // current load factor applied on top of configured ratios, 1 if none
+    double autoRatio() const;
+
+private:
+    double ratioFor(DBusMessage *message, int type) const;
+    void updateRate();
+    double lookupCall(const QByteArray &key);
+    void trackCall(const QByteArray &key, double weight);
+    double random();
+
+private:
+    SamplingConfig m_config;
+    bool m_enabled = false;
+    // (sender, serial) of calls expecting a reply -> their weight;
+    //   two generations so that old entries are forgotten in bulk
+    QHash<QByteArray, double> m_calls;
+    QHash<QByteArray, double> m_oldCalls;
+    QElapsedTimer m_window;
+    quint64 m_windowMessages = 0;
+    quint64 m_random;
+    QAtomicInteger<quint64> m_sampledOut;
+    // ratio scaled by 1e6, to be read from other threads
+    QAtomicInteger<int> m_autoRatio;
+};
+
+#endif // MESSAGESAMPLER_H
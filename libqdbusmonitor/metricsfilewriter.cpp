@@ -0,0 +1,51 @@
+#include <QLoggingCategory>
+#include <QSaveFile>
+#include "metricsfilewriter.h"
+
+
+Q_LOGGING_CATEGORY(logMetrics, "monitor.metrics")
+
+
+MetricsFileWriter::MetricsFileWriter(BusMetrics *metrics, QObject *parent)
+    : QObject(parent)
+    , m_metrics(metrics)
+{
+    connect(&m_timer, &QTimer::timeout, this, &MetricsFileWriter::writeNow);
+}
+
+void MetricsFileWriter::setFileName(const QString &fileName)
+{
+    m_fileName = fileName;
+}
+
+QString MetricsFileWriter::fileName() const
+{
+    return m_fileName;
+}
+
+void MetricsFileWriter::start(int intervalMs)
+{
+    m_timer.start(intervalMs);
+    writeNow();
+}
+
+void MetricsFileWriter::stop()
+{
+    m_timer.stop();
+}
+
+bool MetricsFileWriter::writeNow()
+{
+    Q_EMIT aboutToWrite();
+    const QByteArray text = m_metrics->prometheusText();
+
+    QSaveFile file(m_fileName);
+    // temporary file does not end with .prom, so collector ignores it
+    if (!file.open(QIODevice::WriteOnly) || file.write(text) != text.size() || !file.commit()) {
+        const QString errorString = file.errorString();
+        qCWarning(logMetrics) << "Failed to write" << m_fileName << ":" << errorString;
+        Q_EMIT writeError(errorString);
+        return false;
+    }
+    return true;
+}
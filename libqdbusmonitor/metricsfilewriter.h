@@ -0,0 +1,45 @@
+#ifndef METRICSFILEWRITER_H
+#define METRICSFILEWRITER_H
+
+#include <QObject>
+#include <QString>
+#include <QTimer>
+
+#include "libqdbusmonitor.h"
+#include "busmetrics.h"
+
+
+/**
+ * Periodically writes BusMetrics to a file for node_exporter's textfile
+ * collector. File is replaced atomically (written to a temporary file in
+ * the same directory, then renamed), so collector never sees half of it.
+ * Runs on the thread it lives in, usually the main one; one write is
+ * a few kilobytes.
+ */
+class LIBQDBUSMONITOR_API MetricsFileWriter: public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit MetricsFileWriter(BusMetrics *metrics, QObject *parent = nullptr);
+
+    void setFileName(const QString &fileName);
+    QString fileName() const;
+    void start(int intervalMs);
+    void stop();
+
+public Q_SLOTS:
+    bool writeNow();
+
+Q_SIGNALS:
+    // connected slots can update gauges in BusMetrics before they are written
+    void aboutToWrite();
+    void writeError(const QString &errorString);
+
+private:
+    BusMetrics *m_metrics = nullptr;
+    QString m_fileName;
+    QTimer m_timer;
+};
+
+#endif // METRICSFILEWRITER_H
@@ -0,0 +1,128 @@
+#include <algorithm>
+#include <dbus/dbus.h>
+#include "nameownerhistory.h"
+#include "utils.h"
+
+
+static bool changeTimeLess(qint64 timeMs, const NameOwnerHistory::Change &change)
+{
+    return timeMs < change.time;
+}
+
+
+void NameOwnerHistory::setOwner(const QString &name, const QString &owner, qint64 timeMs)
+{
+    if (name.isEmpty() || Utils::isNumericAddress(name)) {
+        return;
+    }
+    QMutexLocker guard(&m_mutex);
+    QVector<Change> &changes = m_changes[name];
+    // after any change at the same time, those were seen before this one
+    const auto pos = std::upper_bound(changes.begin(), changes.end(), timeMs, changeTimeLess);
+    if (pos != changes.begin() && (pos - 1)->owner == owner) {
+        return;
+    }
+    Change change;
+    change.time = timeMs;
+    change.owner = owner;
+    changes.insert(pos, change);
+    m_changeCount++;
+    if (!owner.isEmpty()) {
+        QStringList &names = m_addressNames[owner];
+        if (!names.contains(name)) {
+            names.append(name);
+        }
+    }
+}
+
+bool NameOwnerHistory::add(const DBusMessageObject &messageObj)
+{
+    // NameOwnerChanged(STRING name, STRING old_owner, STRING new_owner)
+    if (messageObj.type != DBUS_MESSAGE_TYPE_SIGNAL
+            || messageObj.member != QLatin1String("NameOwnerChanged")
+            || messageObj.interface != QLatin1String(DBUS_INTERFACE_DBUS)
+            || messageObj.contents.size() != 3) {
+        return false;
+    }
+    // anyone can emit a signal with this interface, only bus driver is trusted
+    if (messageObj.senderAddress != QLatin1String(DBUS_SERVICE_DBUS)
+            && !messageObj.senderNames.contains(QLatin1String(DBUS_SERVICE_DBUS))) {
+        return false;
+    }
+    setOwner(messageObj.contents.at(0).toString(), messageObj.contents.at(2).toString(),
+             messageObj.timestamp.toMSecsSinceEpoch());
+    return true;
+}
+
+void NameOwnerHistory::clear()
+{
+    QMutexLocker guard(&m_mutex);
+    m_changes.clear();
+    m_addressNames.clear();
+    m_changeCount = 0;
+}
+
+QString NameOwnerHistory::ownerAt(const QString &name, qint64 timeMs) const
+{
+    QMutexLocker guard(&m_mutex);
+    return ownerAtLocked(name, timeMs);
+}
+
+QString NameOwnerHistory::ownerAt(const QString &name, const QDateTime &time) const
+{
+    return ownerAt(name, time.toMSecsSinceEpoch());
+}
+
+QStringList NameOwnerHistory::namesAt(const QString &address, qint64 timeMs) const
+{
+    QStringList ret;
+    QMutexLocker guard(&m_mutex);
+    const auto it = m_addressNames.constFind(address);
+    if (it == m_addressNames.constEnd()) {
+        return ret;
+    }
+    // a connection owns few names over its life
+    for (const QString &name: it.value()) {
+        if (ownerAtLocked(name, timeMs) == address) {
+            ret.append(name);
+        }
+    }
+    return ret;
+}
+
+QStringList NameOwnerHistory::namesAt(const QString &address, const QDateTime &time) const
+{
+    return namesAt(address, time.toMSecsSinceEpoch());
+}
+
+QVector<NameOwnerHistory::Change> NameOwnerHistory::changes(const QString &name) const
+{
+    QMutexLocker guard(&m_mutex);
+    return m_changes.value(name);
+}
+
+QStringList NameOwnerHistory::names() const
+{
+    QMutexLocker guard(&m_mutex);
+    return m_changes.keys();
+}
+
+int NameOwnerHistory::changeCount() const
+{
+    QMutexLocker guard(&m_mutex);
+    return m_changeCount;
+}
+
+QString NameOwnerHistory::ownerAtLocked(const QString &name, qint64 timeMs) const
+{
+    const auto it = m_changes.constFind(name);
+    if (it == m_changes.constEnd()) {
+        return QString();
+    }
+    const QVector<Change> &changes = it.value();
+    const auto pos = std::upper_bound(changes.constBegin(), changes.constEnd(), timeMs, changeTimeLess);
+    if (pos == changes.constBegin()) {
+        return QString();
+    }
+    return (pos - 1)->owner;
+}
@@ -0,0 +1,68 @@
+#ifndef NAMEOWNERHISTORY_H
+#define NAMEOWNERHISTORY_H
+
+#include <QDateTime>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include "libqdbusmonitor.h"
+#include "dbusmessageobject.h"
+
+
+/**
+ * Who owned which well-known bus name, and when.
+ *
+ * Kept as a log of NameOwnerChanged events: per name a vector of
+ * ownership changes sorted by time, so ownerAt() is a binary search.
+ * Live capture appends in time order; changes older than the last one,
+ * as from several capture files read in any order, are inserted in place.
+ * Output written with DBusMonitorThread::setRecordNameOwners() has the
+ * owners at start and every change, whatever the filter left out.
+ *
+ * Unique names are not recorded, they have one owner for their whole
+ * life. Nothing expires: names change owners rarely compared to
+ * message traffic.
+ *
+ * Capture thread adds, anyone queries; every call takes the lock once.
+ */
+class LIBQDBUSMONITOR_API NameOwnerHistory
+{
+public:
+    struct Change {
+        qint64  time = 0;   // ms since epoch
+        QString owner;      // unique name from this time on, empty when released
+    };
+
+    // empty owner: name was released at that time
+    void setOwner(const QString &name, const QString &owner, qint64 timeMs);
+    // Takes NameOwnerChanged signals of the bus driver, ignores any other
+    //   message; returns true if it was one. Rebuilds history from a capture.
+    bool add(const DBusMessageObject &messageObj);
+    void clear();
+
+    // empty if name had no owner at that time, or was never seen
+    QString ownerAt(const QString &name, qint64 timeMs) const;
+    QString ownerAt(const QString &name, const QDateTime &time) const;
+    // well-known names owned by a unique name at that time
+    QStringList namesAt(const QString &address, qint64 timeMs) const;
+    QStringList namesAt(const QString &address, const QDateTime &time) const;
+
+    QVector<Change> changes(const QString &name) const;
+    QStringList names() const;
+    int changeCount() const;
+
+private:
+    QString ownerAtLocked(const QString &name, qint64 timeMs) const;
+
+private:
+    mutable QMutex m_mutex;
+    QHash<QString, QVector<Change>> m_changes;
+    // every well-known name an address ever owned, for namesAt()
+    QHash<QString, QStringList> m_addressNames;
+    int m_changeCount = 0;
+};
+
+#endif // NAMEOWNERHISTORY_H
@@ -0,0 +1,218 @@
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <dbus/dbus.h>
+#include "peerstats.h"
+
+
+// latency buckets per doubling of latency
+static const int BUCKETS_PER_OCTAVE = 4;
+
+
+static QString processKey(uint pid, const QString &exe, const QString &address)
+{
+    if (pid == 0) {
+        // no credentials, the connection is all we know
+        return address;
+    }
+    return exe + QLatin1String(" [") + QString::number(pid) + QLatin1Char(']');
+}
+
+static int latencyBucket(double latencyMs)
+{
+    if (latencyMs <= 1) {
+        return 0;
+    }
+    const int bucket = static_cast<int>(std::ceil(BUCKETS_PER_OCTAVE * std::log2(latencyMs)));
+    return qMin(bucket, PeerStats::LatencyBucketCount - 1);
+}
+
+static double bucketUpperBound(int bucket)
+{
+    return std::pow(2.0, static_cast<double>(bucket) / BUCKETS_PER_OCTAVE);
+}
+
+
+PeerStats::PeerStats()
+    : m_peers(DimensionCount)
+{
+}
+
+void PeerStats::add(const DBusMessageObject &messageObj)
+{
+    if (messageObj.isGap() || messageObj.senderAddress.isEmpty()) {
+        return;
+    }
+    const double weight = messageObj.weight;
+    const double bytes = messageObj.size * weight;
+    // keys are built before locking, capture threads only wait for counting
+    const QString senderProcess = processKey(messageObj.senderPid, messageObj.senderExe,
+                                             messageObj.senderAddress);
+    const bool hasDestination = !messageObj.destinationAddress.isEmpty();
+    const QString destinationProcess = hasDestination ? processKey(messageObj.destinationPid,
+                                                                   messageObj.destinationExe,
+                                                                   messageObj.destinationAddress)
+                                                      : QString();
+
+    QMutexLocker guard(&m_mutex);
+    Counters &senderConnection = peerLocked(ByConnection, messageObj.senderAddress);
+    Counters &sender = peerLocked(ByProcess, senderProcess);
+    if (!messageObj.senderNames.isEmpty()) {
+        senderConnection.names = messageObj.senderNames;
+    }
+    senderConnection.bytesSent += bytes;
+    sender.bytesSent += bytes;
+    if (hasDestination) {
+        Counters &destinationConnection = peerLocked(ByConnection, messageObj.destinationAddress);
+        Counters &destination = peerLocked(ByProcess, destinationProcess);
+        if (!messageObj.destinationNames.isEmpty()) {
+            destinationConnection.names = messageObj.destinationNames;
+        }
+        destinationConnection.bytesReceived += bytes;
+        destination.bytesReceived += bytes;
+        if (messageObj.type == DBUS_MESSAGE_TYPE_METHOD_CALL) {
+            destinationConnection.callsReceived += weight;
+            destination.callsReceived += weight;
+        }
+    }
+
+    switch (messageObj.type) {
+    case DBUS_MESSAGE_TYPE_METHOD_CALL:
+        senderConnection.callsSent += weight;
+        sender.callsSent += weight;
+        m_calls.addCall(messageObj);
+        break;
+    case DBUS_MESSAGE_TYPE_SIGNAL:
+        senderConnection.signalsSent += weight;
+        sender.signalsSent += weight;
+        break;
+    case DBUS_MESSAGE_TYPE_ERROR:
+        senderConnection.errorsSent += weight;
+        sender.errorsSent += weight;
+        // errors are replies too
+        Q_FALLTHROUGH();
+    case DBUS_MESSAGE_TYPE_METHOD_RETURN: {
+        // latency belongs to whoever answered
+        CallTracker::Reply reply;
+        if (m_calls.takeReply(messageObj, &reply)) {
+            const int bucket = latencyBucket(reply.latencyMs);
+            for (Counters *counters: {&senderConnection, &sender}) {
+                counters->answeredCalls += reply.weight;
+                counters->latencySumMs += reply.latencyMs * reply.weight;
+                counters->latencyBuckets[bucket] += reply.weight;
+            }
+        }
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+void PeerStats::clear()
+{
+    QMutexLocker guard(&m_mutex);
+    for (QHash<QString, Counters> &peers: m_peers) {
+        peers.clear();
+    }
+    m_calls.clear();
+}
+
+QVector<PeerStats::Entry> PeerStats::top(Dimension dimension, int count, SortKey sortKey)
+{
+    QVector<Entry> entries;
+    {
+        QMutexLocker guard(&m_mutex);
+        const QHash<QString, Counters> &peers = m_peers.at(dimension);
+        entries.reserve(peers.size());
+        for (auto it = peers.constBegin(); it != peers.constEnd(); ++it) {
+            entries.append(toEntry(it.key(), it.value()));
+        }
+    }
+
+    std::function<bool(const Entry &, const Entry &)> lessThan;
+    switch (sortKey) {
+    case SortByName:
+        lessThan = [] (const Entry &a, const Entry &b) { return a.key < b.key; };
+        break;
+    case SortByCallsSent:
+        lessThan = [] (const Entry &a, const Entry &b) { return a.callsSent > b.callsSent; };
+        break;
+    case SortByCallsReceived:
+        lessThan = [] (const Entry &a, const Entry &b) { return a.callsReceived > b.callsReceived; };
+        break;
+    case SortBySignals:
+        lessThan = [] (const Entry &a, const Entry &b) { return a.signalsSent > b.signalsSent; };
+        break;
+    case SortByErrors:
+        lessThan = [] (const Entry &a, const Entry &b) { return a.errorsSent > b.errorsSent; };
+        break;
+    case SortByBytes:
+        lessThan = [] (const Entry &a, const Entry &b) {
+            return a.bytesSent + a.bytesReceived > b.bytesSent + b.bytesReceived;
+        };
+        break;
+    case SortByMeanLatency:
+        lessThan = [] (const Entry &a, const Entry &b) { return a.meanLatencyMs > b.meanLatencyMs; };
+        break;
+    case SortByP99Latency:
+        lessThan = [] (const Entry &a, const Entry &b) { return a.p99LatencyMs > b.p99LatencyMs; };
+        break;
+    }
+    const int n = (count > 0) ? qMin(count, entries.size()) : entries.size();
+    std::partial_sort(entries.begin(), entries.begin() + n, entries.end(), lessThan);
+    entries.resize(n);
+    return entries;
+}
+
+int PeerStats::peerCount(Dimension dimension)
+{
+    QMutexLocker guard(&m_mutex);
+    return m_peers.at(dimension).size();
+}
+
+QString PeerStats::otherKey()
+{
+    return QStringLiteral("(other)");
+}
+
+PeerStats::Counters &PeerStats::peerLocked(Dimension dimension, const QString &key)
+{
+    QHash<QString, Counters> &peers = m_peers[dimension];
+    const auto it = peers.find(key);
+    if (it != peers.end()) {
+        return it.value();
+    }
+    // short-lived clients get a new unique name each, keep memory bounded
+    if (peers.size() >= MaxPeers) {
+        return peers[otherKey()];
+    }
+    return peers[key];
+}
+
+PeerStats::Entry PeerStats::toEntry(const QString &key, const Counters &counters)
+{
+    Entry entry;
+    entry.key = key;
+    entry.names = counters.names.join(QLatin1String(", "));
+    entry.callsSent = counters.callsSent;
+    entry.callsReceived = counters.callsReceived;
+    entry.signalsSent = counters.signalsSent;
+    entry.errorsSent = counters.errorsSent;
+    entry.bytesSent = counters.bytesSent;
+    entry.bytesReceived = counters.bytesReceived;
+    entry.answeredCalls = counters.answeredCalls;
+    if (counters.answeredCalls > 0) {
+        entry.meanLatencyMs = counters.latencySumMs / counters.answeredCalls;
+        const double target = 0.99 * counters.answeredCalls;
+        double cumulative = 0;
+        for (int i = 0; i < LatencyBucketCount; i++) {
+            cumulative += counters.latencyBuckets[i];
+            if (cumulative >= target) {
+                entry.p99LatencyMs = bucketUpperBound(i);
+                break;
+            }
+        }
+    }
+    return entry;
+}
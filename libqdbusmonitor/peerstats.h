@@ -0,0 +1,103 @@
+#ifndef PEERSTATS_H
+#define PEERSTATS_H
+
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include "libqdbusmonitor.h"
+#include "calltracker.h"
+#include "dbusmessageobject.h"
+
+
+/**
+ * Totals per process and per connection since capture start (or clear()).
+ *
+ * For every peer: method calls sent and received, signals and errors
+ * sent, bytes sent and received, and latency of the calls it answered,
+ * as mean and 99th percentile. Counters are updated in add() for each
+ * message, reading them costs one pass over the peers, never over
+ * captured messages. Latency goes to a per-peer histogram with buckets
+ * 2^(1/4) apart starting at 1 ms, so p99 is the upper bound of its
+ * bucket, at most ~19% above the real value. Sampled messages count
+ * with their weight.
+ *
+ * Processes are keyed by executable and pid, connections by unique name.
+ * Peers beyond MaxPeers are counted together under OtherKey. Calls are
+ * paired with replies by a CallTracker. All methods lock one mutex.
+ */
+class LIBQDBUSMONITOR_API PeerStats
+{
+public:
+    enum Dimension {
+        ByProcess,
+        ByConnection,
+        DimensionCount
+    };
+
+    enum SortKey {
+        SortByName,
+        SortByCallsSent,
+        SortByCallsReceived,
+        SortBySignals,
+        SortByErrors,
+        SortByBytes,
+        SortByMeanLatency,
+        SortByP99Latency,
+    };
+
+    struct Entry {
+        QString key;
+        QString names;              // connections: well-known names, processes: empty
+        double  callsSent = 0;
+        double  callsReceived = 0;
+        double  signalsSent = 0;
+        double  errorsSent = 0;
+        double  bytesSent = 0;
+        double  bytesReceived = 0;
+        double  answeredCalls = 0;  // calls received that got a reply, latency is over these
+        double  meanLatencyMs = 0;
+        double  p99LatencyMs = 0;
+    };
+
+    static const int MaxPeers = 16 * 1024;
+    static const int LatencyBucketCount = 64;
+
+public:
+    PeerStats();
+
+    void add(const DBusMessageObject &messageObj);
+    void clear();
+
+    // count <= 0 means all
+    QVector<Entry> top(Dimension dimension, int count, SortKey sortKey = SortByCallsReceived);
+    int peerCount(Dimension dimension);
+
+    static QString otherKey();
+
+private:
+    struct Counters {
+        QStringList names;
+        double callsSent = 0;
+        double callsReceived = 0;
+        double signalsSent = 0;
+        double errorsSent = 0;
+        double bytesSent = 0;
+        double bytesReceived = 0;
+        double answeredCalls = 0;
+        double latencySumMs = 0;
+        double latencyBuckets[LatencyBucketCount] = {};
+    };
+
+    Counters &peerLocked(Dimension dimension, const QString &key);
+    static Entry toEntry(const QString &key, const Counters &counters);
+
+private:
+    QMutex m_mutex;
+    QVector<QHash<QString, Counters>> m_peers;   // indexed by Dimension
+    CallTracker m_calls;
+};
+
+#endif // PEERSTATS_H
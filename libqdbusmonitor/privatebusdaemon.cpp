@@ -0,0 +1,93 @@
+#include <QElapsedTimer>
+#include <QLoggingCategory>
+#include "privatebusdaemon.h"
+
+
+Q_LOGGING_CATEGORY(logDaemon, "monitor.daemon")
+
+
+PrivateBusDaemon::PrivateBusDaemon()
+    : m_executable(QStringLiteral("dbus-daemon"))
+{
+}
+
+PrivateBusDaemon::~PrivateBusDaemon()
+{
+    stop();
+}
+
+void PrivateBusDaemon::setExecutable(const QString &executable)
+{
+    m_executable = executable;
+}
+
+bool PrivateBusDaemon::start(int timeoutMs)
+{
+    stop();
+    m_errorString.clear();
+
+    m_dir.reset(new QTemporaryDir());
+    if (!m_dir->isValid()) {
+        m_errorString = QStringLiteral("Cannot create temporary directory");
+        m_dir.reset();
+        return false;
+    }
+
+    const QStringList args = {
+        QStringLiteral("--session"),
+        QStringLiteral("--nofork"),
+        QStringLiteral("--nopidfile"),
+        QStringLiteral("--print-address"),
+        QStringLiteral("--address=unix:tmpdir=") + m_dir->path(),
+    };
+    m_process.setProcessChannelMode(QProcess::ForwardedErrorChannel);
+    m_process.start(m_executable, args, QIODevice::ReadOnly);
+    if (!m_process.waitForStarted(timeoutMs)) {
+        m_errorString = m_process.errorString();
+        stop();
+        return false;
+    }
+
+    // address is the first line on stdout
+    QElapsedTimer timer;
+    timer.start();
+    while (!m_process.canReadLine()) {
+        const int remaining = timeoutMs - static_cast<int>(timer.elapsed());
+        if (remaining <= 0 || !m_process.waitForReadyRead(remaining)) {
+            m_errorString = QStringLiteral("dbus-daemon did not report its address");
+            stop();
+            return false;
+        }
+    }
+    m_address = QString::fromUtf8(m_process.readLine().trimmed());
+    qCDebug(logDaemon) << "Private bus daemon listening on" << m_address;
+    return true;
+}
+
+void PrivateBusDaemon::stop()
+{
+    if (m_process.state() != QProcess::NotRunning) {
+        m_process.terminate();
+        if (!m_process.waitForFinished(3000)) {
+            m_process.kill();
+            m_process.waitForFinished(1000);
+        }
+    }
+    m_address.clear();
+    m_dir.reset();
+}
+
+bool PrivateBusDaemon::isRunning() const
+{
+    return m_process.state() == QProcess::Running;
+}
+
+QString PrivateBusDaemon::address() const
+{
+    return m_address;
+}
+
+QString PrivateBusDaemon::errorString() const
+{
+    return m_errorString;
+}
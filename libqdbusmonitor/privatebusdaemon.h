@@ -0,0 +1,50 @@
+#ifndef PRIVATEBUSDAEMON_H
+#define PRIVATEBUSDAEMON_H
+
+#include <QProcess>
+#include <QScopedPointer>
+#include <QString>
+#include <QTemporaryDir>
+
+#include "libqdbusmonitor.h"
+
+
+/**
+ * Throwaway dbus-daemon listening in a temporary directory, for
+ * end-to-end testing and benchmarking without a real session bus:
+ *
+ *     PrivateBusDaemon daemon;
+ *     if (daemon.start()) {
+ *         monitor.startOnAddress(daemon.address());
+ *         // clients connect with dbus_connection_open_private(daemon.address())
+ *     }
+ *
+ * Uses session bus configuration, so BecomeMonitor is allowed.
+ * Daemon is killed and directory removed on stop() or destruction.
+ */
+class LIBQDBUSMONITOR_API PrivateBusDaemon
+{
+public:
+    PrivateBusDaemon();
+    ~PrivateBusDaemon();
+
+    // "dbus-daemon" from PATH by default
+    void setExecutable(const QString &executable);
+
+    // blocks until daemon prints its address
+    bool start(int timeoutMs = 5000);
+    void stop();
+    bool isRunning() const;
+
+    QString address() const;
+    QString errorString() const;
+
+private:
+    QString m_executable;
+    QProcess m_process;
+    QScopedPointer<QTemporaryDir> m_dir;
+    QString m_address;
+    QString m_errorString;
+};
+
+#endif // PRIVATEBUSDAEMON_H
@@ -0,0 +1,108 @@
+#include <utility>
+#include "spacesaving.h"
+
+
+SpaceSaving::SpaceSaving(int capacity)
+    : m_capacity(qMax(capacity, 1))
+{
+    m_heap.reserve(m_capacity);
+    m_index.reserve(m_capacity);
+}
+
+void SpaceSaving::add(const QString &key, double bytes, double count)
+{
+    const auto it = m_index.constFind(key);
+    if (it != m_index.constEnd()) {
+        const int i = it.value();
+        m_heap[i].count += count;
+        m_heap[i].bytes += bytes;
+        siftDown(i);
+        return;
+    }
+
+    if (m_heap.size() < m_capacity) {
+        Counter counter;
+        counter.key = key;
+        counter.count = count;
+        counter.bytes = bytes;
+        m_heap.append(counter);
+        m_index.insert(key, m_heap.size() - 1);
+        siftUp(m_heap.size() - 1);
+        return;
+    }
+
+    // evict the smallest counter, new key inherits its count
+    Counter &smallest = m_heap[0];
+    m_index.remove(smallest.key);
+    smallest.key = key;
+    smallest.error = smallest.count;
+    smallest.count += count;
+    smallest.bytes += bytes;
+    m_index.insert(key, 0);
+    siftDown(0);
+}
+
+void SpaceSaving::scale(double factor)
+{
+    for (Counter &counter: m_heap) {
+        counter.count *= factor;
+        counter.bytes *= factor;
+        counter.error *= factor;
+    }
+}
+
+void SpaceSaving::clear()
+{
+    m_heap.clear();
+    m_index.clear();
+}
+
+int SpaceSaving::capacity() const
+{
+    return m_capacity;
+}
+
+const QVector<SpaceSaving::Counter> &SpaceSaving::counters() const
+{
+    return m_heap;
+}
+
+void SpaceSaving::siftUp(int i)
+{
+    while (i > 0) {
+        const int parent = (i - 1) / 2;
+        if (m_heap.at(parent).count <= m_heap.at(i).count) {
+            break;
+        }
+        swapCounters(i, parent);
+        i = parent;
+    }
+}
+
+void SpaceSaving::siftDown(int i)
+{
+    const int size = m_heap.size();
+    for (;;) {
+        const int left = 2 * i + 1;
+        const int right = left + 1;
+        int smallest = i;
+        if (left < size && m_heap.at(left).count < m_heap.at(smallest).count) {
+            smallest = left;
+        }
+        if (right < size && m_heap.at(right).count < m_heap.at(smallest).count) {
+            smallest = right;
+        }
+        if (smallest == i) {
+            break;
+        }
+        swapCounters(i, smallest);
+        i = smallest;
+    }
+}
+
+void SpaceSaving::swapCounters(int i, int j)
+{
+    std::swap(m_heap[i], m_heap[j]);
+    m_index[m_heap.at(i).key] = i;
+    m_index[m_heap.at(j).key] = j;
+}
@@ -0,0 +1,56 @@
+#ifndef SPACESAVING_H
+#define SPACESAVING_H
+
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+#include "libqdbusmonitor.h"
+
+
+/**
+ * Space-Saving heavy hitters sketch (Metwally et al.) over string keys.
+ *
+ * Keeps at most capacity counters, no matter how many distinct keys are
+ * seen. Unknown key takes over the counter with the smallest count and
+ * inherits its value, which becomes the error bound of the new key.
+ * Any key whose true count exceeds total / capacity is guaranteed to be
+ * in the sketch. Counters live in an indexed min-heap, so add() is
+ * O(log capacity). Counts are doubles, so that they can be decayed.
+ * Not thread-safe.
+ */
+class LIBQDBUSMONITOR_API SpaceSaving
+{
+public:
+    struct Counter {
+        QString key;
+        double  count = 0;
+        double  bytes = 0;
+        double  error = 0;   // count may be overestimated by this much
+    };
+
+public:
+    explicit SpaceSaving(int capacity);
+
+    // count is more than 1 for sampled messages
+    void add(const QString &key, double bytes, double count = 1);
+    // multiplies all counters by factor, keeps their order
+    void scale(double factor);
+    void clear();
+
+    int capacity() const;
+    // in no particular order
+    const QVector<Counter> &counters() const;
+
+private:
+    void siftUp(int i);
+    void siftDown(int i);
+    void swapCounters(int i, int j);
+
+private:
+    int m_capacity;
+    QVector<Counter> m_heap;       // min-heap by count
+    QHash<QString, int> m_index;   // key -> position in m_heap
+};
+
+#endif // SPACESAVING_H
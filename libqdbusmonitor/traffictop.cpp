@@ -0,0 +1,140 @@
+#include <algorithm>
+#include <cmath>
+#include <dbus/dbus.h>
+#include "traffictop.h"
+
+
+// counters are decayed at most this often, and always before reading
+static const qint64 DECAY_STEP_MS = 250;
+
+
+TrafficTop::TrafficTop(int capacity, int timeConstantMs)
+    : m_timeConstant(qMax(timeConstantMs, 1) / 1000.0)
+{
+    for (int i = 0; i < DimensionCount; i++) {
+        m_sketches.append(SpaceSaving(capacity));
+    }
+    m_clock.start();
+}
+
+void TrafficTop::add(const DBusMessageObject &messageObj)
+{
+    if (messageObj.isGap()) {
+        return;
+    }
+    QString memberKey;
+    switch (messageObj.type) {
+    case DBUS_MESSAGE_TYPE_METHOD_CALL:
+    case DBUS_MESSAGE_TYPE_SIGNAL:
+        memberKey = messageObj.interface + QLatin1Char('.') + messageObj.member;
+        break;
+    case DBUS_MESSAGE_TYPE_ERROR:
+        memberKey = messageObj.errorName;
+        break;
+    default:
+        memberKey = messageObj.typeString;
+        break;
+    }
+    const QString &exeKey = messageObj.senderExe.isEmpty() ? messageObj.senderAddress
+                                                           : messageObj.senderExe;
+    // a sampled message stands for weight messages like it
+    const double weight = messageObj.weight;
+    const double bytes = messageObj.size * weight;
+
+    QMutexLocker guard(&m_mutex);
+    decayLocked();
+    m_messages += weight;
+    m_bytes += bytes;
+    m_sketches[ByMember].add(memberKey, bytes, weight);
+    if (!exeKey.isEmpty()) {
+        m_sketches[BySenderExe].add(exeKey, bytes, weight);
+    }
+    if (!messageObj.path.isEmpty()) {
+        m_sketches[ByPath].add(messageObj.path, bytes, weight);
+    }
+}
+
+void TrafficTop::clear()
+{
+    QMutexLocker guard(&m_mutex);
+    for (SpaceSaving &sketch: m_sketches) {
+        sketch.clear();
+    }
+    m_messages = 0;
+    m_bytes = 0;
+}
+
+QVector<TrafficTop::Entry> TrafficTop::top(Dimension dimension, int count, SortKey sortKey)
+{
+    QVector<Entry> entries;
+    {
+        QMutexLocker guard(&m_mutex);
+        decayLocked();
+        const QVector<SpaceSaving::Counter> &counters = m_sketches.at(dimension).counters();
+        entries.reserve(counters.size());
+        for (const SpaceSaving::Counter &counter: counters) {
+            Entry entry;
+            entry.key = counter.key;
+            entry.messageRate = counter.count / m_timeConstant;
+            entry.byteRate = counter.bytes / m_timeConstant;
+            entry.messageRateError = counter.error / m_timeConstant;
+            entries.append(entry);
+        }
+    }
+
+    const auto byMessages = [] (const Entry &a, const Entry &b) {
+        return a.messageRate > b.messageRate;
+    };
+    const auto byBytes = [] (const Entry &a, const Entry &b) {
+        return a.byteRate > b.byteRate;
+    };
+    const int n = qMin(qMax(count, 0), entries.size());
+    if (sortKey == SortByBytes) {
+        std::partial_sort(entries.begin(), entries.begin() + n, entries.end(), byBytes);
+    } else {
+        std::partial_sort(entries.begin(), entries.begin() + n, entries.end(), byMessages);
+    }
+    entries.resize(n);
+    return entries;
+}
+
+double TrafficTop::messageRate()
+{
+    QMutexLocker guard(&m_mutex);
+    decayLocked();
+    return m_messages / m_timeConstant;
+}
+
+double TrafficTop::byteRate()
+{
+    QMutexLocker guard(&m_mutex);
+    decayLocked();
+    return m_bytes / m_timeConstant;
+}
+
+QString TrafficTop::dimensionName(Dimension dimension)
+{
+    switch (dimension) {
+    case ByMember:    return QStringLiteral("interface.member");
+    case BySenderExe: return QStringLiteral("sender");
+    case ByPath:      return QStringLiteral("path");
+    default:          break;
+    }
+    return QString();
+}
+
+void TrafficTop::decayLocked()
+{
+    const qint64 now = m_clock.elapsed();
+    const qint64 dt = now - m_lastDecay;
+    if (dt < DECAY_STEP_MS) {
+        return;
+    }
+    m_lastDecay = now;
+    const double factor = std::exp(-(dt / 1000.0) / m_timeConstant);
+    for (SpaceSaving &sketch: m_sketches) {
+        sketch.scale(factor);
+    }
+    m_messages *= factor;
+    m_bytes *= factor;
+}
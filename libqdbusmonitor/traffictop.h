@@ -0,0 +1,77 @@
+#ifndef TRAFFICTOP_H
+#define TRAFFICTOP_H
+
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QString>
+#include <QVector>
+
+#include "libqdbusmonitor.h"
+#include "dbusmessageobject.h"
+#include "spacesaving.h"
+
+
+/**
+ * Live "who is flooding the bus" statistics.
+ *
+ * Messages are counted per interface.member (error name for errors),
+ * per sender executable and per object path, each in its own bounded
+ * SpaceSaving sketch, so memory does not grow with number of distinct
+ * paths. Counts decay exponentially with timeConstantMs, which turns
+ * them into moving average rates: rate = decayed count / time constant.
+ *
+ * add() is meant to be called on capture thread (connect it with
+ * Qt::DirectConnection to DBusMonitorThread::messageReceived), readers
+ * may be on any thread, access is serialized with a mutex.
+ */
+class LIBQDBUSMONITOR_API TrafficTop
+{
+public:
+    enum Dimension {
+        ByMember,
+        BySenderExe,
+        ByPath,
+        DimensionCount
+    };
+
+    enum SortKey {
+        SortByMessages,
+        SortByBytes
+    };
+
+    struct Entry {
+        QString key;
+        double  messageRate = 0;      // per second
+        double  byteRate = 0;
+        double  messageRateError = 0; // messageRate may be overestimated by this much
+    };
+
+    static const int DefaultCapacity = 256;
+    static const int DefaultTimeConstantMs = 5000;
+
+public:
+    explicit TrafficTop(int capacity = DefaultCapacity, int timeConstantMs = DefaultTimeConstantMs);
+
+    void add(const DBusMessageObject &messageObj);
+    void clear();
+
+    QVector<Entry> top(Dimension dimension, int count, SortKey sortKey = SortByMessages);
+    double messageRate();
+    double byteRate();
+
+    static QString dimensionName(Dimension dimension);
+
+private:
+    void decayLocked();
+
+private:
+    QMutex m_mutex;
+    QVector<SpaceSaving> m_sketches;   // indexed by Dimension
+    double m_messages = 0;
+    double m_bytes = 0;
+    double m_timeConstant;             // seconds
+    QElapsedTimer m_clock;
+    qint64 m_lastDecay = 0;
+};
+
+#endif // TRAFFICTOP_H
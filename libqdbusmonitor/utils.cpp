@@ -1,8 +1,11 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <QFile>
 #include <QString>
+#include <QVector>
 #include <dbus/dbus.h>
 #include "utils.h"
+#include "dbusmessageobject.h"
 
 namespace Utils {
 
@@ -19,6 +22,8 @@ QString dbusMessageTypeToString(int message_type)
         return QStringLiteral("error");
     case DBUS_MESSAGE_TYPE_SIGNAL:
         return QStringLiteral("signal");
+    case DBusMessageObject::GapType:
+        return QStringLiteral("gap");
     default:
         return QStringLiteral("(unknown message type)");
     }
@@ -47,6 +52,43 @@ QString pid2filename(uint pid)
     readlink(path, outbuf, sizeof(outbuf) - 1);
     return QString::fromUtf8(outbuf);
 }
+
+QStringList pid2cmdline(uint pid)
+{
+    QFile file(QStringLiteral("/proc/%1/cmdline").arg(pid));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QStringList();
+    }
+    // arguments are NUL-terminated
+    QStringList ret;
+    const QByteArray data = file.readAll();
+    for (const QByteArray &arg: data.split('\0')) {
+        ret.append(QString::fromUtf8(arg));
+    }
+    if (!ret.isEmpty() && ret.last().isEmpty()) {
+        ret.removeLast();
+    }
+    return ret;
+}
+
+QString pid2cgroup(uint pid)
+{
+    QFile file(QStringLiteral("/proc/%1/cgroup").arg(pid));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QString();
+    }
+    // "hierarchy-ID:controllers:path" lines
+    QString ret;
+    for (const QByteArray &line: file.readAll().split('\n')) {
+        if (line.startsWith("0::")) {
+            return QString::fromUtf8(line.mid(3));
+        }
+        if (line.contains(":name=systemd:")) {
+            ret = QString::fromUtf8(line.mid(line.indexOf(":name=systemd:") + 14));
+        }
+    }
+    return ret;
+}
 #elif Q_OS_WIN
 #include <windows.h>
 QString pid2filename(uint pid)
@@ -61,13 +103,49 @@ QString pid2filename(uint pid)
     }
     return QString();
 }
+
+QStringList pid2cmdline(uint pid)
+{
+    Q_UNUSED(pid)
+    return QStringList();
+}
+
+QString pid2cgroup(uint pid)
+{
+    Q_UNUSED(pid)
+    return QString();
+}
 #else
 QString pid2filename(uint pid)
 {
     qDebug() << "pid2filename() not implemented for this platform!";
     return QString();
 }
+
+QStringList pid2cmdline(uint pid)
+{
+    Q_UNUSED(pid)
+    return QStringList();
+}
+
+QString pid2cgroup(uint pid)
+{
+    Q_UNUSED(pid)
+    return QString();
+}
 #endif
 
 
+QString cgroup2unit(const QString &cgroup)
+{
+    const QVector<QStringRef> parts = cgroup.splitRef(QLatin1Char('/'), QString::SkipEmptyParts);
+    for (int i = parts.size() - 1; i >= 0; i--) {
+        if (parts.at(i).endsWith(QLatin1String(".service")) || parts.at(i).endsWith(QLatin1String(".scope"))) {
+            return parts.at(i).toString();
+        }
+    }
+    return QString();
+}
+
+
 } // namespace Utils
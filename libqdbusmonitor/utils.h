@@ -2,6 +2,7 @@
 #define UTILS_H
 
 #include <QString>
+#include <QStringList>
 #include "libqdbusmonitor.h"
 
 namespace Utils {
@@ -10,6 +11,11 @@ LIBQDBUSMONITOR_API QString dbusMessageTypeToString(int message_type);
 LIBQDBUSMONITOR_API bool isNumericAddress(const QString &busName);
 [[noreturn]] LIBQDBUSMONITOR_API void fatal_oom(const char *where);
 LIBQDBUSMONITOR_API QString pid2filename(uint pid);
+LIBQDBUSMONITOR_API QStringList pid2cmdline(uint pid);
+// unified hierarchy path, or the systemd one on cgroup v1
+LIBQDBUSMONITOR_API QString pid2cgroup(uint pid);
+// innermost .service or .scope in cgroup path
+LIBQDBUSMONITOR_API QString cgroup2unit(const QString &cgroup);
 
 }
 
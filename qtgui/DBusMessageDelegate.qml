@@ -1,217 +1,142 @@
 import QtQuick 2.0
 import QtQuick.Controls 2.0
+import QtQuick.Controls 1.4 as C1
+import QDBusMonitor 1.0
 
+// Texts come preformatted from DBusMessagesModel display roles,
+//   keep this flat: every item here is created for each visible row
 ItemDelegate {
     id: delegate
-    implicitHeight: mainRow.height + 5
+    implicitHeight: rowHeight + (argumentsLoader.active ? argumentsLoader.height + 5 : 0) + 5
     // width: parent.width // set from parent
     // highlighted: ListView.isCurrentItem // set from parent
 
     signal showReply(int id)
     signal showRequest(int id)
+    // expanded row wants argumentsModel created, collapsed one destroyed
+    signal toggleArguments()
 
     property int serial
     property int replySerial
-    property string typeString: ""
+    property int kind: DBusMessagesModel.InvalidKind
+    property string senderText
+    property string destinationText
+    property string callText
+    property int argumentCount
+    // ArgumentTreeModel of an expanded row, null when collapsed
+    property QtObject argumentsModel: null
 
-    property bool isSignal:       typeString === "signal"
-    property bool isError:        typeString === "error"
-    property bool isMethodCall:   typeString === "method call"
-    property bool isMethodReturn: typeString === "method return"
-
-    property string senderAddress
-    property string senderExe
-    property int    senderPid
-    property var    senderNames: undefined // JavaScript array (QStringList)
-    property string senderNamesStr
-    property string senderNamesStrShort
-
-    property string destinationAddress
-    property string destinationExe
-    property int    destinationPid
-    property var    destinationNames: undefined // JavaScript array (QStringList)
-    property string destinationNamesStr
-    property string destinationNamesStrShort
-
-    property string msgPath: ""
-    property string msgInterface: ""
-    property string msgMember: ""
-
-    property int longNamesTruncateLimit: 60
     property int innerRectMargin: 5
-
-    property color colorBorderSignal: "green"
-    property color colorBorderError: "red"
-    property color colorBorderNormal: "black"
-    property color colorAddress: "gray"
-    property color colorInterface: "#6c3109"
-    property color colorMember: "#c06121"
-    property color colorPath: "black"
-    property color colorExe: "#0b2a8f"
-
-    function truncateString(s, limit) {
-        var ret = s;
-        if (ret.length > limit) {
-            ret = ret.substring(0, limit-3) + '...';
+    property int argumentsHeight: 250
+    readonly property real rowHeight: Math.max(senderRect.height, destRect.visible ? destRect.height : 0)
+
+    readonly property bool isSignal: kind === DBusMessagesModel.SignalKind
+    readonly property bool isGap: kind === DBusMessagesModel.GapKind
+
+    Text {
+        id: expandToggle
+        width: 15
+        anchors.verticalCenter: senderRect.verticalCenter
+        text: argumentCount > 0 ? (argumentsModel ? "\u25BE" : "\u25B8") : ""
+        MouseArea {
+            anchors.fill: parent
+            enabled: argumentCount > 0
+            onClicked: toggleArguments()
         }
-        return ret;
     }
 
-    Component.onCompleted: {
-        // ^^ create a string like: "org.freedesktop.Notifications,org.kde.StatusNotifierHost-4344,
-        //                           org.kde.plasmashell,com.canonical.Unity"
-        if (senderNames !== undefined) {
-            senderNamesStr = senderNames.join(", ");
-            senderNamesStrShort = truncateString(senderNamesStr, longNamesTruncateLimit);
-        }
-        if (destinationNames !== undefined) {
-            destinationNamesStr = destinationNames.join(", ");
-            destinationNamesStrShort = truncateString(destinationNamesStr, longNamesTruncateLimit);
+    Rectangle {
+        id: senderRect
+        anchors.left: expandToggle.right
+        radius: isSignal ? innerRectMargin*2 : innerRectMargin
+        border.width: isGap ? 0 : 2
+        border.color: isSignal ? "green" : (kind === DBusMessagesModel.ErrorKind ? "red" : "black")
+        width: senderLabel.implicitWidth + innerRectMargin*2
+        height: senderLabel.implicitHeight + innerRectMargin*2
+
+        Text {
+            id: senderLabel
+            x: innerRectMargin
+            y: innerRectMargin
+            textFormat: Text.StyledText
+            text: senderText
         }
     }
 
-    Row {
-        id: mainRow
-        height: senderRect.height > destRect.height ? senderRect.height : destRect.height
-        spacing: 5
-
-        Rectangle {
-            id: senderRect
-            radius: isSignal ? innerRectMargin*2 : innerRectMargin
-            border.width: 2
-            border.color: isSignal ? colorBorderSignal : (isError ? colorBorderError : colorBorderNormal)
-            implicitWidth: innerCol1.width + innerRectMargin*2
-            implicitHeight: innerCol1.height + innerRectMargin*2
-
-
-            Column {
-                id: innerCol1
-                spacing: 2
-                anchors.top: parent.top
-                anchors.left: parent.left
-                anchors.margins: innerRectMargin
-
-                Row {
-                    Text {
-                        text: "[" + senderAddress + "] "
-                        color: colorAddress
-                    }
-                    Text {
-                        text: senderNamesStrShort
-                        font.bold: true
-                    }
-                }
-
-                Text {
-                    text: senderExe + " (pid: " + senderPid + ")"
-                    color: colorExe
-                    font.italic: true
-                }
-
-                Text {
-                    text: "path: " + msgPath
-                    // visible: isSignal
-                    visible: msgPath !== ""
-                    color: colorPath
-                }
+    Text {
+        id: callLabel
+        anchors.left: senderRect.right
+        anchors.leftMargin: 5
+        visible: !isSignal && !isGap
+        text: callText
+    }
 
-                Row {
-                    visible: isSignal
-                    Text {
-                        text: msgInterface + "."
-                        color: colorInterface
-                        font.bold: true
-                    }
-                    Text {
-                        text: msgMember + "()"
-                        color: colorMember
-                        font.bold: true
-                    }
-                }
-            }
+    Rectangle {
+        id: destRect
+        anchors.left: callLabel.right
+        anchors.leftMargin: 5
+        radius: innerRectMargin
+        visible: !isSignal && !isGap
+        border.width: 2
+        border.color: kind === DBusMessagesModel.ErrorKind ? "red" : "black"
+        width: destLabel.implicitWidth + innerRectMargin*2
+        height: destLabel.implicitHeight + innerRectMargin*2
+
+        Text {
+            id: destLabel
+            x: innerRectMargin
+            y: innerRectMargin
+            textFormat: Text.StyledText
+            text: destinationText
         }
+    }
 
-        Column {
-            spacing: 5
-            Text {
-                text: isMethodCall ? "  =>  " : (isMethodReturn ? " <= " : "")
-                visible: !isSignal
-            }
-            Text {
-                text: isMethodCall ? serial : replySerial
-                visible: !isSignal
+    // a link instead of a Button, which is a dozen items by itself
+    Text {
+        anchors.left: destRect.right
+        anchors.leftMargin: 5
+        anchors.verticalCenter: destRect.verticalCenter
+        visible: kind === DBusMessagesModel.MethodCallKind || kind === DBusMessagesModel.MethodReturnKind
+        textFormat: Text.StyledText
+        text: kind === DBusMessagesModel.MethodCallKind ? "<a href=\"#\">" + qsTr("To reply") + "</a>"
+                                                        : "<a href=\"#\">" + qsTr("To request") + "</a>"
+        onLinkActivated: {
+            if (kind === DBusMessagesModel.MethodCallKind) {
+                showReply(serial);
+            } else {
+                showRequest(replySerial);
             }
         }
+    }
 
-        Rectangle {
-            id: destRect
-            radius: innerRectMargin
-            visible: !isSignal
-            border.width: 2
-            border.color: isError ? colorBorderError : colorBorderNormal
-            implicitWidth: innerCol2.width + innerRectMargin*2
-            implicitHeight: innerCol2.height + innerRectMargin*2
-
-            Column {
-                id: innerCol2
-                spacing: 2
-                anchors.top: parent.top
-                anchors.left: parent.left
-                anchors.margins: innerRectMargin
-
-                Row {
-                    Text {
-                        text: "[" + destinationAddress + "] "
-                        color: colorAddress
-                    }
-                    Text {
-                        text: destinationNamesStrShort
-                        font.bold: true
-                    }
-                }
-
-                Text {
-                    text: destinationExe + " (pid: " + destinationPid + ")"
-                    color: colorExe
-                    font.italic: true
-                }
-
-                Text {
-                    text: "path: " + msgPath
-                    visible: msgPath !== ""
-                    color: colorPath
-                }
-
-                Row {
-                    visible: !isSignal && !isMethodReturn
-                    Text {
-                        text: msgInterface + "."
-                        color: colorInterface
-                        font.bold: true
-                    }
-                    Text {
-                        text: msgMember + "()"
-                        color: colorMember
-                        font.bold: true
-                    }
-                }
+    // view with its delegates exists only while row is expanded
+    Loader {
+        id: argumentsLoader
+        y: rowHeight + 5
+        x: expandToggle.width
+        width: parent.width - x
+        height: argumentsHeight
+        active: argumentsModel !== null
+        sourceComponent: C1.TreeView {
+            model: argumentsModel
+            headerVisible: false
+            C1.TableViewColumn {
+                role: "name"
+                width: 250
             }
+            C1.TableViewColumn {
+                role: "value"
+                width: 600
+            }
+            // nodes of collapsed branches are dropped
+            onCollapsed: model.release(index)
         }
+    }
 
-        Button {
-            id: btnToReply
-            visible: isMethodCall
-            text: qsTr("To reply")
-            onClicked: showReply(serial)
-        }
-
-        Button {
-            id: btnToCall
-            visible: isMethodReturn
-            text: qsTr("To request")
-            onClicked: showRequest(replySerial)
+    Component.onDestruction: {
+        if (argumentsModel) {
+            argumentsModel.destroy();
         }
-
     }
 
     onClicked: {
@@ -0,0 +1,140 @@
+import QtQuick 2.0
+import QtQuick.Controls 2.0
+
+// Per-process / per-connection totals over app.peerStats (PeerStatsModel)
+Rectangle {
+    id: peersView
+    border.color: "gray"
+    border.width: 1
+
+    property var peersModel: app.peerStats
+    property int numberColumnWidth: 70
+    property var columns: [
+        { title: qsTr("Calls out"), column: 1, role: "callsSent" },
+        { title: qsTr("Calls in"), column: 2, role: "callsReceived" },
+        { title: qsTr("Signals"), column: 3, role: "signalsSent" },
+        { title: qsTr("Errors"), column: 4, role: "errorsSent" },
+        { title: qsTr("Bytes"), column: 5, role: "bytes" },
+        { title: qsTr("Mean ms"), column: 6, role: "meanLatency" },
+        { title: qsTr("p99 ms"), column: 7, role: "p99Latency" }
+    ]
+
+    function formatCount(value) {
+        if (value >= 1024 * 1024) {
+            return (value / (1024 * 1024)).toFixed(1) + " M";
+        }
+        if (value >= 1024) {
+            return (value / 1024).toFixed(1) + " K";
+        }
+        return value.toFixed(0);
+    }
+
+    Column {
+        id: header
+        anchors {
+            left: parent.left
+            right: parent.right
+            top: parent.top
+            margins: 5
+        }
+        spacing: 5
+
+        Row {
+            spacing: 10
+            ComboBox {
+                width: 200
+                model: [qsTr("Process"), qsTr("Connection")]
+                currentIndex: peersView.peersModel.dimension
+                onActivated: {
+                    peersView.peersModel.dimension = index;
+                }
+            }
+            Label {
+                anchors.verticalCenter: parent.verticalCenter
+                text: qsTr("%1 peers").arg(peersView.peersModel.peerCount)
+            }
+        }
+
+        // click a column title to sort by it
+        Row {
+            width: parent.width
+            Repeater {
+                model: peersView.columns
+                delegate: Label {
+                    width: peersView.numberColumnWidth
+                    text: modelData.title + (peersView.peersModel.sortColumn === modelData.column ? " ▼" : "")
+                    font.bold: true
+                    MouseArea {
+                        anchors.fill: parent
+                        onClicked: {
+                            peersView.peersModel.sortColumn = modelData.column;
+                        }
+                    }
+                }
+            }
+            Label {
+                width: header.width - peersView.columns.length * peersView.numberColumnWidth
+                text: qsTr("Name") + (peersView.peersModel.sortColumn === 0 ? " ▼" : "")
+                font.bold: true
+                MouseArea {
+                    anchors.fill: parent
+                    onClicked: {
+                        peersView.peersModel.sortColumn = 0;
+                    }
+                }
+            }
+        }
+    }
+
+    ListView {
+        anchors {
+            left: parent.left
+            right: parent.right
+            top: header.bottom
+            bottom: parent.bottom
+            margins: 5
+        }
+        clip: true
+        model: peersView.peersModel
+
+        delegate: Row {
+            width: parent.width
+            Label {
+                width: peersView.numberColumnWidth
+                text: peersView.formatCount(model.callsSent)
+            }
+            Label {
+                width: peersView.numberColumnWidth
+                text: peersView.formatCount(model.callsReceived)
+            }
+            Label {
+                width: peersView.numberColumnWidth
+                text: peersView.formatCount(model.signalsSent)
+            }
+            Label {
+                width: peersView.numberColumnWidth
+                text: peersView.formatCount(model.errorsSent)
+                color: model.errorsSent > 0 ? "red" : "black"
+            }
+            Label {
+                width: peersView.numberColumnWidth
+                text: peersView.formatCount(model.bytesSent + model.bytesReceived)
+            }
+            Label {
+                width: peersView.numberColumnWidth
+                text: model.meanLatency.toFixed(1)
+            }
+            Label {
+                width: peersView.numberColumnWidth
+                text: model.p99Latency.toFixed(0)
+            }
+            Label {
+                width: parent.width - peersView.columns.length * peersView.numberColumnWidth
+                text: model.names === "" ? model.key : model.key + " (" + model.names + ")"
+                elide: Text.ElideMiddle
+            }
+        }
+
+        ScrollBar.vertical: ScrollBar { }
+    }
+}
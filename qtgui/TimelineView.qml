@@ -0,0 +1,75 @@
+import QtQuick 2.0
+import QtQuick.Controls 2.0
+import QDBusMonitor 1.0
+
+// Sequence diagram over all captured messages, lanes are connections
+Rectangle {
+    id: timelineView
+    border.color: "gray"
+    border.width: 1
+
+    property int labelWidth: 250
+
+    Row {
+        id: header
+        anchors {
+            left: parent.left
+            right: parent.right
+            top: parent.top
+            margins: 5
+        }
+        spacing: 10
+
+        Button {
+            text: qsTr("Fit all")
+            onClicked: timeline.fitAll()
+        }
+        CheckBox {
+            text: qsTr("Follow")
+            checked: timeline.followTail
+            onClicked: timeline.followTail = checked
+        }
+        Label {
+            anchors.verticalCenter: parent.verticalCenter
+            text: qsTr("%1 - %2, %3 messages%4")
+                    .arg(Qt.formatDateTime(timeline.viewStart, "hh:mm:ss.zzz"))
+                    .arg(Qt.formatDateTime(timeline.viewEnd, "hh:mm:ss.zzz"))
+                    .arg(timeline.visibleMessages)
+                    .arg(timeline.detailed ? "" : qsTr(" (density)"))
+        }
+    }
+
+    Item {
+        id: lanes
+        clip: true
+        anchors {
+            left: parent.left
+            right: parent.right
+            top: header.bottom
+            bottom: parent.bottom
+            margins: 5
+        }
+
+        Timeline {
+            id: timeline
+            source: app.messagesModel
+            x: labelWidth
+            width: parent.width - labelWidth
+            height: parent.height
+        }
+
+        // only lane names are QML items, one per lane
+        Repeater {
+            model: timeline.laneNames
+            delegate: Text {
+                width: labelWidth - 5
+                height: timeline.laneHeight
+                y: index * timeline.laneHeight - timeline.laneScroll
+                visible: y + height > 0 && y < lanes.height
+                verticalAlignment: Text.AlignVCenter
+                elide: Text.ElideMiddle
+                text: modelData
+            }
+        }
+    }
+}
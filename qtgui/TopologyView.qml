@@ -0,0 +1,87 @@
+import QtQuick 2.0
+import QtQuick.Controls 2.0
+import QDBusMonitor 1.0
+
+// Who-talks-to-whom graph over app.topology (BusTopologyModel)
+Rectangle {
+    id: topologyView
+    border.color: "gray"
+    border.width: 1
+
+    property var topologyModel: app.topology
+
+    Row {
+        id: header
+        anchors {
+            left: parent.left
+            right: parent.right
+            top: parent.top
+            margins: 5
+        }
+        spacing: 10
+
+        Label {
+            text: qsTr("%1 connections, %2 edges%3")
+                    .arg(topologyView.topologyModel.nodeCount)
+                    .arg(topologyView.topologyModel.edgeCount)
+                    .arg(topologyView.topologyModel.droppedEdges > 0
+                         ? qsTr(", %1 not tracked").arg(topologyView.topologyModel.droppedEdges) : "")
+        }
+        Label {
+            text: graph.selectedNode === "" ? qsTr("Click a connection to see what it calls")
+                                            : qsTr("Calls from %1:").arg(graph.selectedNode)
+        }
+    }
+
+    Item {
+        id: graphArea
+        clip: true
+        anchors {
+            left: parent.left
+            right: dependencies.visible ? dependencies.left : parent.right
+            top: header.bottom
+            bottom: parent.bottom
+            margins: 5
+        }
+
+        TopologyGraph {
+            id: graph
+            source: topologyView.topologyModel
+            anchors.fill: parent
+        }
+
+        // only node names are QML items, one per node
+        Repeater {
+            model: graph.labels
+            delegate: Text {
+                x: modelData.left ? modelData.x - width - 8 : modelData.x + 8
+                y: modelData.y - height / 2
+                // TopologyGraphItem::LabelMargin
+                width: Math.min(implicitWidth, 160)
+                elide: Text.ElideMiddle
+                text: modelData.text
+            }
+        }
+    }
+
+    ListView {
+        id: dependencies
+        visible: graph.selectedNode !== ""
+        width: 350
+        anchors {
+            right: parent.right
+            top: header.bottom
+            bottom: parent.bottom
+            margins: 5
+        }
+        clip: true
+        model: graph.selectedDependencies
+        delegate: Label {
+            width: parent.width
+            elide: Text.ElideMiddle
+            text: modelData
+        }
+
+        ScrollBar.vertical: ScrollBar { }
+    }
+}
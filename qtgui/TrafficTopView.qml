@@ -0,0 +1,105 @@
+import QtQuick 2.0
+import QtQuick.Controls 2.0
+
+// Top talkers table over app.trafficTop (TrafficTopModel)
+Rectangle {
+    id: topView
+    border.color: "gray"
+    border.width: 1
+
+    property var topModel: app.trafficTop
+    property int rateColumnWidth: 90
+
+    function formatRate(value) {
+        if (value >= 1024 * 1024) {
+            return (value / (1024 * 1024)).toFixed(1) + " M";
+        }
+        if (value >= 1024) {
+            return (value / 1024).toFixed(1) + " K";
+        }
+        return value.toFixed(1);
+    }
+
+    Column {
+        id: header
+        anchors {
+            left: parent.left
+            right: parent.right
+            top: parent.top
+            margins: 5
+        }
+        spacing: 5
+
+        Row {
+            spacing: 10
+            ComboBox {
+                width: 200
+                model: [qsTr("Interface.member"), qsTr("Sender"), qsTr("Path")]
+                currentIndex: topView.topModel.dimension
+                onActivated: {
+                    topView.topModel.dimension = index;
+                }
+            }
+            Label {
+                anchors.verticalCenter: parent.verticalCenter
+                text: qsTr("%1 msg/s, %2B/s")
+                        .arg(topView.formatRate(topView.topModel.messageRate))
+                        .arg(topView.formatRate(topView.topModel.byteRate))
+            }
+        }
+
+        // click a column title to sort by it
+        Row {
+            width: parent.width
+            Repeater {
+                model: [
+                    { title: qsTr("Msg/s"), column: 1, width: topView.rateColumnWidth },
+                    { title: qsTr("Bytes/s"), column: 2, width: topView.rateColumnWidth },
+                    { title: qsTr("Name"), column: 0, width: header.width - 2 * topView.rateColumnWidth }
+                ]
+                delegate: Label {
+                    width: modelData.width
+                    text: modelData.title + (topView.topModel.sortColumn === modelData.column ? " ▼" : "")
+                    font.bold: true
+                    MouseArea {
+                        anchors.fill: parent
+                        onClicked: {
+                            topView.topModel.sortColumn = modelData.column;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    ListView {
+        anchors {
+            left: parent.left
+            right: parent.right
+            top: header.bottom
+            bottom: parent.bottom
+            margins: 5
+        }
+        clip: true
+        model: topView.topModel
+
+        delegate: Row {
+            width: parent.width
+            Label {
+                width: topView.rateColumnWidth
+                text: topView.formatRate(model.messageRate)
+            }
+            Label {
+                width: topView.rateColumnWidth
+                text: topView.formatRate(model.byteRate)
+            }
+            Label {
+                width: parent.width - 2 * topView.rateColumnWidth
+                text: model.key
+                elide: Text.ElideMiddle
+            }
+        }
+
+        ScrollBar.vertical: ScrollBar { }
+    }
+}
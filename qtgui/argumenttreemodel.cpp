@@ -0,0 +1,224 @@
+#include <iterator>
+#include "argumenttreemodel.h"
+
+
+struct ArgumentTreeModel::Node {
+    QVariant value;     // for range nodes, the whole container being sliced
+    QString name;
+    Node *parent = nullptr;
+    int row = 0;
+    // range node stands for elements [first, first + count) of value
+    bool isRange = false;
+    int first = 0;
+    int count = 0;
+    bool fetched = false;
+    std::vector<std::unique_ptr<Node>> children;
+};
+
+
+ArgumentTreeModel::ArgumentTreeModel(const QVariantList &arguments, QObject *parent)
+    : QAbstractItemModel(parent)
+    , m_root(new Node)
+{
+    m_root->value = arguments;
+    // few top level arguments, no point in waiting for fetchMore()
+    populate(m_root.get());
+}
+
+ArgumentTreeModel::~ArgumentTreeModel()
+{
+}
+
+QHash<int, QByteArray> ArgumentTreeModel::roleNames() const
+{
+    static const QHash<int, QByteArray> r = {
+        {Name,       QByteArrayLiteral("name")},
+        {Value,      QByteArrayLiteral("value")},
+        {ChildCount, QByteArrayLiteral("childCount")},
+    };
+    return r;
+}
+
+QModelIndex ArgumentTreeModel::index(int row, int column, const QModelIndex &parent) const
+{
+    const Node *node = nodeFor(parent);
+    if (column != 0 || row < 0 || static_cast<size_t>(row) >= node->children.size()) {
+        return QModelIndex();
+    }
+    return createIndex(row, 0, node->children[static_cast<size_t>(row)].get());
+}
+
+QModelIndex ArgumentTreeModel::parent(const QModelIndex &index) const
+{
+    if (!index.isValid()) {
+        return QModelIndex();
+    }
+    Node *parentNode = nodeFor(index)->parent;
+    if (parentNode == m_root.get()) {
+        return QModelIndex();
+    }
+    return createIndex(parentNode->row, 0, parentNode);
+}
+
+int ArgumentTreeModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.column() > 0) {
+        return 0;
+    }
+    return static_cast<int>(nodeFor(parent)->children.size());
+}
+
+int ArgumentTreeModel::columnCount(const QModelIndex &parent) const
+{
+    Q_UNUSED(parent)
+    return 1;
+}
+
+bool ArgumentTreeModel::hasChildren(const QModelIndex &parent) const
+{
+    const Node *node = nodeFor(parent);
+    return !node->children.empty() || elementCount(node) > 0;
+}
+
+QVariant ArgumentTreeModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid()) {
+        return QVariant();
+    }
+    const Node *node = nodeFor(index);
+    switch (role) {
+    case Qt::DisplayRole:
+        return node->name + QLatin1String(": ") + summary(node);
+    case Role::Name:
+        return node->name;
+    case Role::Value:
+        return summary(node);
+    case Role::ChildCount:
+        return elementCount(node);
+    }
+    return QVariant();
+}
+
+bool ArgumentTreeModel::canFetchMore(const QModelIndex &parent) const
+{
+    const Node *node = nodeFor(parent);
+    return !node->fetched && elementCount(node) > 0;
+}
+
+void ArgumentTreeModel::fetchMore(const QModelIndex &parent)
+{
+    Node *node = nodeFor(parent);
+    if (node->fetched) {
+        return;
+    }
+    const int count = elementCount(node);
+    if (count <= 0) {
+        node->fetched = true;
+        return;
+    }
+    const int rows = (count > ChunkSize && !node->isRange) ? (count + ChunkSize - 1) / ChunkSize : count;
+    beginInsertRows(parent, 0, rows - 1);
+    populate(node);
+    endInsertRows();
+}
+
+void ArgumentTreeModel::release(const QModelIndex &index)
+{
+    Node *node = nodeFor(index);
+    if (node == m_root.get() || node->children.empty()) {
+        return;
+    }
+    beginRemoveRows(index, 0, static_cast<int>(node->children.size()) - 1);
+    node->children.clear();
+    node->fetched = false;
+    endRemoveRows();
+}
+
+ArgumentTreeModel::Node *ArgumentTreeModel::nodeFor(const QModelIndex &index) const
+{
+    if (!index.isValid()) {
+        return m_root.get();
+    }
+    return static_cast<Node *>(index.internalPointer());
+}
+
+int ArgumentTreeModel::elementCount(const Node *node)
+{
+    if (node->isRange) {
+        return node->count;
+    }
+    switch (node->value.type()) {
+    case QVariant::List:
+        return node->value.toList().size();
+    case QVariant::Map:
+        return node->value.toMap().size();
+    default:
+        return 0;
+    }
+}
+
+QString ArgumentTreeModel::summary(const Node *node)
+{
+    if (node->isRange) {
+        return tr("%n element(s)", nullptr, node->count);
+    }
+    switch (node->value.type()) {
+    case QVariant::Invalid:
+        return QString();
+    case QVariant::Bool:
+        return node->value.toBool() ? QStringLiteral("true") : QStringLiteral("false");
+    case QVariant::List:
+        return QStringLiteral("array [%1]").arg(elementCount(node));
+    case QVariant::Map:
+        return QStringLiteral("dict {%1}").arg(elementCount(node));
+    default:
+        return node->value.toString();
+    }
+}
+
+void ArgumentTreeModel::populate(Node *node)
+{
+    node->fetched = true;
+    const int count = elementCount(node);
+    const int first = node->isRange ? node->first : 0;
+
+    const auto addChild = [node] (const QString &name, const QVariant &value) -> Node * {
+        Node *child = new Node;
+        child->name = name;
+        child->value = value;
+        child->parent = node;
+        child->row = static_cast<int>(node->children.size());
+        node->children.emplace_back(child);
+        return child;
+    };
+
+    if (count > ChunkSize && !node->isRange) {
+        node->children.reserve(static_cast<size_t>((count + ChunkSize - 1) / ChunkSize));
+        for (int start = 0; start < count; start += ChunkSize) {
+            const int size = qMin(ChunkSize, count - start);
+            Node *range = addChild(QStringLiteral("[%1 … %2]").arg(start).arg(start + size - 1),
+                                   node->value);
+            range->isRange = true;
+            range->first = start;
+            range->count = size;
+        }
+        return;
+    }
+
+    node->children.reserve(static_cast<size_t>(count));
+    if (node->value.type() == QVariant::Map) {
+        const QVariantMap map = node->value.toMap();
+        auto it = map.constBegin();
+        std::advance(it, first);
+        for (int i = 0; i < count; i++, ++it) {
+            addChild(it.key(), it.value());
+        }
+    } else {
+        const QVariantList list = node->value.toList();
+        const bool topLevel = (node->parent == nullptr);
+        for (int i = first; i < first + count; i++) {
+            addChild(topLevel ? QStringLiteral("arg %1").arg(i) : QStringLiteral("[%1]").arg(i),
+                     list.at(i));
+        }
+    }
+}
@@ -0,0 +1,63 @@
+#ifndef ARGUMENTTREEMODEL_H
+#define ARGUMENTTREEMODEL_H
+
+#include <memory>
+#include <vector>
+#include <QAbstractItemModel>
+#include <QVariant>
+
+
+/**
+ * Tree over decoded arguments of one message, for the expanded row.
+ *
+ * Nodes are created only when their parent is expanded: rowCount() is 0
+ * until the view calls fetchMore(), while hasChildren() and childCount
+ * role tell it there is something to expand. Containers with more than
+ * ChunkSize elements get intermediate "[first … last]" range nodes, so
+ * a 50k element array is 50 rows until one of them is expanded. Values
+ * are implicitly shared with the message, nothing is deep-copied.
+ * release() drops the children of a collapsed node again.
+ */
+class ArgumentTreeModel: public QAbstractItemModel
+{
+    Q_OBJECT
+
+public:
+    enum Role {
+        Name = Qt::UserRole + 1,
+        Value,
+        ChildCount,
+    };
+
+    static const int ChunkSize = 1000;
+
+public:
+    explicit ArgumentTreeModel(const QVariantList &arguments, QObject *parent = nullptr);
+    ~ArgumentTreeModel() override;
+
+    QHash<int, QByteArray> roleNames() const override;
+    QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const override;
+    QModelIndex parent(const QModelIndex &index) const override;
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    bool hasChildren(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    bool canFetchMore(const QModelIndex &parent) const override;
+    void fetchMore(const QModelIndex &parent) override;
+
+public Q_SLOTS:
+    void release(const QModelIndex &index);
+
+private:
+    struct Node;
+
+    Node *nodeFor(const QModelIndex &index) const;
+    static int elementCount(const Node *node);
+    static QString summary(const Node *node);
+    static void populate(Node *node);
+
+private:
+    std::unique_ptr<Node> m_root;
+};
+
+#endif // ARGUMENTTREEMODEL_H
@@ -0,0 +1,53 @@
+#include "bustopologymodel.h"
+
+
+// graph is redrawn on every refresh, once a second is enough
+static const int REFRESH_INTERVAL_MS = 1000;
+
+
+BusTopologyModel::BusTopologyModel(BusTopology *topology, QObject *parent)
+    : QObject(parent)
+    , m_topology(topology)
+{
+    m_timer.setInterval(REFRESH_INTERVAL_MS);
+    connect(&m_timer, &QTimer::timeout, this, &BusTopologyModel::refresh);
+}
+
+BusTopology *BusTopologyModel::topology() const { return m_topology; }
+
+const QVector<BusTopology::Node> &BusTopologyModel::nodes() const { return m_nodes; }
+
+const QVector<BusTopology::Edge> &BusTopologyModel::edges() const { return m_edges; }
+
+qint64 BusTopologyModel::lastSeen() const { return m_lastSeen; }
+
+bool BusTopologyModel::isActive() const { return m_timer.isActive(); }
+
+void BusTopologyModel::setActive(bool active)
+{
+    if (active == m_timer.isActive()) {
+        return;
+    }
+    if (active) {
+        m_timer.start();
+        refresh();
+    } else {
+        m_timer.stop();
+    }
+    Q_EMIT activeChanged();
+}
+
+int BusTopologyModel::nodeCount() const { return m_nodes.size(); }
+
+int BusTopologyModel::edgeCount() const { return m_edges.size(); }
+
+quint64 BusTopologyModel::droppedEdges() const { return m_droppedEdges; }
+
+void BusTopologyModel::refresh()
+{
+    m_nodes = m_topology->nodes();
+    m_edges = m_topology->edges();
+    m_lastSeen = m_topology->lastSeen();
+    m_droppedEdges = m_topology->droppedEdges();
+    Q_EMIT refreshed();
+}
@@ -0,0 +1,54 @@
+#ifndef BUSTOPOLOGYMODEL_H
+#define BUSTOPOLOGYMODEL_H
+
+#include <QObject>
+#include <QTimer>
+#include <QVector>
+
+#include "bustopology.h"
+
+
+/**
+ * Periodically refreshed copy of BusTopology nodes and edges for the
+ * GUI thread, see TopologyGraphItem. Refreshes only while active.
+ */
+class BusTopologyModel: public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(bool active READ isActive WRITE setActive NOTIFY activeChanged)
+    Q_PROPERTY(int nodeCount READ nodeCount NOTIFY refreshed)
+    Q_PROPERTY(int edgeCount READ edgeCount NOTIFY refreshed)
+    Q_PROPERTY(quint64 droppedEdges READ droppedEdges NOTIFY refreshed)
+
+public:
+    explicit BusTopologyModel(BusTopology *topology, QObject *parent = nullptr);
+
+    BusTopology *topology() const;
+    const QVector<BusTopology::Node> &nodes() const;
+    const QVector<BusTopology::Edge> &edges() const;
+    // newest message time, ms since epoch
+    qint64 lastSeen() const;
+
+    bool isActive() const;
+    void setActive(bool active);
+    int nodeCount() const;
+    int edgeCount() const;
+    quint64 droppedEdges() const;
+
+public Q_SLOTS:
+    void refresh();
+
+Q_SIGNALS:
+    void activeChanged();
+    void refreshed();
+
+private:
+    BusTopology *m_topology = nullptr;
+    QVector<BusTopology::Node> m_nodes;
+    QVector<BusTopology::Edge> m_edges;
+    qint64 m_lastSeen = 0;
+    quint64 m_droppedEdges = 0;
+    QTimer m_timer;
+};
+
+#endif // BUSTOPOLOGYMODEL_H
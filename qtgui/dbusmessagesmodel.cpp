@@ -1,8 +1,47 @@
 #include "dbusmessagesmodel.h"
+#include "argumenttreemodel.h"
+
+
+// names of a well-known address joined, longer lists are cut
+static const int NAMES_TRUNCATE_LIMIT = 60;
+
+
+static QString joinNames(const QStringList &names)
+{
+    QString ret = names.join(QLatin1String(", "));
+    if (ret.length() > NAMES_TRUNCATE_LIMIT) {
+        ret.truncate(NAMES_TRUNCATE_LIMIT - 3);
+        ret.append(QLatin1String("..."));
+    }
+    return ret.toHtmlEscaped();
+}
+
+// "[:1.42] org.foo.Bar" line and "exe (pid: N)" line
+static void appendEndpoint(QString &out, const QString &address, const QStringList &names,
+                           const QString &exe, uint pid)
+{
+    out += QLatin1String("<font color=\"gray\">[") + address.toHtmlEscaped()
+         + QLatin1String("]</font> <b>") + joinNames(names) + QLatin1String("</b>")
+         + QLatin1String("<br><font color=\"#0b2a8f\"><i>") + exe.toHtmlEscaped()
+         + QLatin1String(" (pid: ") + QString::number(pid) + QLatin1String(")</i></font>");
+}
+
+static void appendPathMember(QString &out, const DBusMessageObject &dmsg, bool withMember)
+{
+    if (!dmsg.path.isEmpty()) {
+        out += QLatin1String("<br>path: ") + dmsg.path.toHtmlEscaped();
+    }
+    if (withMember) {
+        out += QLatin1String("<br><b><font color=\"#6c3109\">") + dmsg.interface.toHtmlEscaped()
+             + QLatin1String(".</font><font color=\"#c06121\">") + dmsg.member.toHtmlEscaped()
+             + QLatin1String("()</font></b>");
+    }
+}
+
 
 DBusMessagesModel::DBusMessagesModel(QObject *parent)
     : QAbstractListModel(parent)
-    , m_mutex(QMutex::Recursive)
+    , m_displayCache(DisplayCacheSize)
 {
 }
 
@@ -25,6 +64,13 @@ QHash<int, QByteArray> DBusMessagesModel::roleNames() const
         {Path,               QByteArrayLiteral("path")},
         {Interface,          QByteArrayLiteral("interface")},
         {Member,             QByteArrayLiteral("member")},
+        {Bus,                QByteArrayLiteral("bus")},
+        {Dropped,            QByteArrayLiteral("dropped")},
+        {MessageKind,        QByteArrayLiteral("kind")},
+        {SenderText,         QByteArrayLiteral("senderText")},
+        {DestinationText,    QByteArrayLiteral("destinationText")},
+        {CallText,           QByteArrayLiteral("callText")},
+        {ArgumentCount,      QByteArrayLiteral("argumentCount")},
     };
     return r;
 }
@@ -32,8 +78,12 @@ QHash<int, QByteArray> DBusMessagesModel::roleNames() const
 int DBusMessagesModel::rowCount(const QModelIndex &parent) const
 {
     Q_UNUSED(parent)
-    QMutexLocker guard(&m_mutex);
-    return m_data.size();
+    return m_store.size();
+}
+
+const MessageStore &DBusMessagesModel::store() const
+{
+    return m_store;
 }
 
 
@@ -45,12 +95,11 @@ QVariant DBusMessagesModel::data(const QModelIndex &index, int role) const
     }
 
     int row = index.row();
-    QMutexLocker guard(&m_mutex);
-    if ((row < 0) || (row >= m_data.size())) {
+    if ((row < 0) || (row >= m_store.size())) {
         return ret;
     }
 
-    const DBusMessageObject &dmsg = m_data.at(row);
+    const DBusMessageObject &dmsg = m_store.at(row);
     switch (role) {
     case Role::Serial:             ret = dmsg.serial;             break;
     case Role::ReplySerial:        ret = dmsg.replySerial;        break;
@@ -68,39 +117,104 @@ QVariant DBusMessagesModel::data(const QModelIndex &index, int role) const
     case Role::Path:               ret = dmsg.path;               break;
     case Role::Interface:          ret = dmsg.interface;          break;
     case Role::Member:             ret = dmsg.member;             break;
+    case Role::Bus:                ret = dmsg.bus;                break;
+    case Role::Dropped:            ret = dmsg.dropped;            break;
+    case Role::MessageKind:        ret = dmsg.type;               break;
+    case Role::SenderText:         ret = displayData(row).senderText;      break;
+    case Role::DestinationText:    ret = displayData(row).destinationText; break;
+    case Role::CallText:           ret = displayData(row).callText;        break;
+    case Role::ArgumentCount:      ret = dmsg.contents.size();    break;
     }
     return ret;
 }
 
+const DBusMessagesModel::DisplayData &DBusMessagesModel::displayData(int row) const
+{
+    const DisplayData *cached = m_displayCache.object(row);
+    if (cached) {
+        return *cached;
+    }
+
+    const DBusMessageObject &dmsg = m_store.at(row);
+    DisplayData *data = new DisplayData;
+    switch (dmsg.type) {
+    case GapKind:
+        data->senderText = QLatin1String("<font color=\"red\"><i>")
+                + tr("... %1 messages dropped ...").arg(dmsg.dropped)
+                + QLatin1String("</i></font>");
+        break;
+    case SignalKind:
+        if (!dmsg.bus.isEmpty()) {
+            data->senderText = QLatin1String("<font color=\"gray\"><i>") + dmsg.bus.toHtmlEscaped()
+                    + QLatin1String("</i></font> ");
+        }
+        appendEndpoint(data->senderText, dmsg.senderAddress, dmsg.senderNames,
+                       dmsg.senderExe, dmsg.senderPid);
+        appendPathMember(data->senderText, dmsg, true);
+        break;
+    default:
+        if (!dmsg.bus.isEmpty()) {
+            data->senderText = QLatin1String("<font color=\"gray\"><i>") + dmsg.bus.toHtmlEscaped()
+                    + QLatin1String("</i></font> ");
+        }
+        appendEndpoint(data->senderText, dmsg.senderAddress, dmsg.senderNames,
+                       dmsg.senderExe, dmsg.senderPid);
+        appendPathMember(data->senderText, dmsg, false);
+        appendEndpoint(data->destinationText, dmsg.destinationAddress, dmsg.destinationNames,
+                       dmsg.destinationExe, dmsg.destinationPid);
+        appendPathMember(data->destinationText, dmsg, dmsg.type == MethodCallKind);
+        if (dmsg.type == MethodCallKind) {
+            data->callText = QLatin1String("  =>  \n") + QString::number(dmsg.serial);
+        } else if (dmsg.type == MethodReturnKind) {
+            data->callText = QLatin1String(" <= \n") + QString::number(dmsg.replySerial);
+        } else {
+            data->callText = QLatin1String("\n") + QString::number(dmsg.replySerial);
+        }
+        break;
+    }
+    m_displayCache.insert(row, data);
+    return *data;
+}
+
 void DBusMessagesModel::addMessage(const DBusMessageObject &dmsg)
 {
-    QMutexLocker guard(&m_mutex);
-    beginInsertRows(QModelIndex(), m_data.size(), m_data.size());
-    m_data.append(dmsg);
+    beginInsertRows(QModelIndex(), m_store.size(), m_store.size());
+    m_store.append(dmsg);
     endInsertRows();
 }
 
 void DBusMessagesModel::addMessage(DBusMessageObject &&dmsg)
 {
-    QMutexLocker guard(&m_mutex);
-    beginInsertRows(QModelIndex(), m_data.size(), m_data.size());
-    m_data.append(dmsg);
+    beginInsertRows(QModelIndex(), m_store.size(), m_store.size());
+    m_store.append(std::move(dmsg));
     endInsertRows();
 }
 
+void DBusMessagesModel::addMessages(QVector<DBusMessageObject> &&batch)
+{
+    if (batch.isEmpty()) {
+        return;
+    }
+    beginInsertRows(QModelIndex(), m_store.size(), m_store.size() + batch.size() - 1);
+    for (DBusMessageObject &dmsg: batch) {
+        m_store.append(std::move(dmsg));
+    }
+    endInsertRows();
+    batch.clear();
+}
+
 void DBusMessagesModel::clear()
 {
-    QMutexLocker guard(&m_mutex);
     beginResetModel();
-    m_data.clear();
+    m_store.clear();
+    m_displayCache.clear();
     endResetModel();
 }
 
 int DBusMessagesModel::findSerial(uint serial) const
 {
-    QMutexLocker guard(&m_mutex);
-    for (int idx = 0; idx < m_data.size(); idx++) {
-        const auto &msg = m_data.at(idx);
+    for (int idx = 0; idx < m_store.size(); idx++) {
+        const auto &msg = m_store.at(idx);
         if (msg.serial == serial) {
             return idx;
         }
@@ -110,12 +224,19 @@ int DBusMessagesModel::findSerial(uint serial) const
 
 int DBusMessagesModel::findReplySerial(uint serial) const
 {
-    QMutexLocker guard(&m_mutex);
-    for (int idx = 0; idx < m_data.size(); idx++) {
-        const auto &msg = m_data.at(idx);
+    for (int idx = 0; idx < m_store.size(); idx++) {
+        const auto &msg = m_store.at(idx);
         if (msg.replySerial == serial) {
             return idx;
         }
     }
     return -1;
 }
+
+QObject *DBusMessagesModel::argumentsModel(int row) const
+{
+    if ((row < 0) || (row >= m_store.size())) {
+        return nullptr;
+    }
+    return new ArgumentTreeModel(m_store.at(row).contents);
+}
@@ -2,19 +2,36 @@
 #define DBUSMESSAGESMODEL_H
 
 #include <QAbstractListModel>
+#include <QCache>
 #include <QHash>
 #include <QByteArray>
-#include <QVector>
-#include <QMutex>
 
 #include "dbusmessageobject.h"
+#include "messagestore.h"
 
 
+// Display roles (kind, senderText, destinationText, callText) are built
+//   in C++ as styled text when a row is first shown and cached, so that
+//   delegates need no JavaScript and only a few Text items.
 class DBusMessagesModel : public QAbstractListModel
 {
     Q_OBJECT
 
 public:
+    // message type for QML, compared as int instead of typeString
+    enum Kind {
+        GapKind = DBusMessageObject::GapType,
+        InvalidKind = 0,
+        MethodCallKind,
+        MethodReturnKind,
+        ErrorKind,
+        SignalKind,
+    };
+    Q_ENUM(Kind)
+
+    // rows whose display strings are kept
+    static const int DisplayCacheSize = 4096;
+
     enum Role {
         Serial = Qt::UserRole + 1,
         ReplySerial,
@@ -32,6 +49,13 @@ public:
         Path,
         Interface,
         Member,
+        Bus,
+        Dropped,
+        MessageKind,
+        SenderText,
+        DestinationText,
+        CallText,
+        ArgumentCount,
     };
 
 public:
@@ -41,18 +65,34 @@ public:
     int rowCount(const QModelIndex &parent = QModelIndex()) const override;
     QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
 
+    const MessageStore &store() const;
+
 public Q_SLOTS:
     void addMessage(const DBusMessageObject &dmsg);
     void addMessage(DBusMessageObject &&dmsg);
+    // one row insertion for the whole batch
+    void addMessages(QVector<DBusMessageObject> &&batch);
     void clear();
 
     int findSerial(uint serial) const;
     int findReplySerial(uint serial) const;
+    // Tree over contents of one message, built as it is expanded;
+    //   not parented, QML owns it and should destroy() it on collapse
+    QObject *argumentsModel(int row) const;
+
+private:
+    struct DisplayData {
+        QString senderText;
+        QString destinationText;
+        QString callText;
+    };
+    const DisplayData &displayData(int row) const;
 
 private:
     QHash<int, QByteArray> m_roles;
-    QVector<DBusMessageObject> m_data;
-    mutable QMutex m_mutex;
+    MessageStore m_store;
+    // messages never change, so entries stay valid until clear()
+    mutable QCache<int, DisplayData> m_displayCache;
 };
 
 #endif // DBUSMESSAGESMODEL_H
@@ -1,6 +1,7 @@
 import QtQuick 2.0
 import QtQuick.Window 2.0
 import QtQuick.Controls 2.0
+import QtQuick.Dialogs 1.2
 
 Window {
     visible: true
@@ -21,7 +22,7 @@ Window {
 
         Button {
             text: qsTr("Start on session bus")
-            enabled: !monitor.isMonitorActive
+            enabled: !sessionMonitor.isMonitorActive
             onClicked: {
                 app.startOnSessionBus();
             }
@@ -29,7 +30,7 @@ Window {
 
         Button {
             text: qsTr("Start on system bus")
-            enabled: !monitor.isMonitorActive
+            enabled: !systemMonitor.isMonitorActive
             onClicked: {
                 app.startOnSystemBus();
             }
@@ -37,7 +38,7 @@ Window {
 
         Button {
             text: qsTr("Stop monitor")
-            enabled: monitor.isMonitorActive
+            enabled: sessionMonitor.isMonitorActive || systemMonitor.isMonitorActive
             onClicked: {
                 app.stopMonitor();
             }
@@ -50,6 +51,133 @@ Window {
             }
         }
 
+        TextField {
+            id: filterField
+            width: 400
+            selectByMouse: true
+            placeholderText: qsTr("Filter: type='signal',interface='org.foo.Bar'; exe='plasmashell'")
+            color: app.messagesView.filterError === "" ? "black" : "red"
+            onAccepted: {
+                app.messagesView.filterText = text;
+            }
+        }
+
+        Label {
+            visible: app.messagesView.rescanning || app.messagesView.filterError !== ""
+            text: app.messagesView.rescanning ? qsTr("Filtering...") : app.messagesView.filterError
+        }
+
+        Label {
+            visible: app.droppedMessages > 0
+            text: qsTr("Dropped: %1").arg(app.droppedMessages)
+            color: "red"
+        }
+
+        Label {
+            text: qsTr("UI: %1 updates/s, %2% busy, max %3 ms")
+                    .arg(app.uiScheduler.updatesPerSecond.toFixed(0))
+                    .arg(app.uiScheduler.busyPercent.toFixed(1))
+                    .arg(app.uiScheduler.maxUpdateMs.toFixed(1))
+        }
+
+        CheckBox {
+            id: cbShowTop
+            checked: false
+            text: qsTr("Top talkers")
+            onCheckedChanged: {
+                app.trafficTop.active = checked;
+            }
+        }
+
+        CheckBox {
+            id: cbShowPeers
+            checked: false
+            text: qsTr("Peers")
+            onCheckedChanged: {
+                app.peerStats.active = checked;
+            }
+        }
+
+        CheckBox {
+            id: cbTimeline
+            checked: false
+            text: qsTr("Timeline")
+            onCheckedChanged: {
+                if (checked) {
+                    cbTopology.checked = false;
+                }
+            }
+        }
+
+        CheckBox {
+            id: cbTopology
+            checked: false
+            text: qsTr("Graph")
+            onCheckedChanged: {
+                if (checked) {
+                    cbTimeline.checked = false;
+                }
+                app.topology.active = checked;
+            }
+        }
+
+        CheckBox {
+            id: cbPause
+            checked: app.paused
+            text: app.paused ? qsTr("Paused (%1 new)").arg(app.stagedMessages) : qsTr("Pause")
+            onClicked: {
+                app.paused = checked;
+            }
+        }
+
+        CheckBox {
+            id: cbExtendSelection
+            checked: false
+            text: qsTr("Extend selection")
+        }
+
+        ComboBox {
+            id: exportScope
+            width: 150
+            // values are MonitorApp::exportMessages() scopes
+            model: [ qsTr("All messages"), qsTr("Filtered view"), qsTr("Selection") ]
+            property var scopes: [ "all", "view", "selection" ]
+        }
+
+        ComboBox {
+            id: exportFormat
+            width: 100
+            model: [ "json", "csv", "pcap" ]
+        }
+
+        Button {
+            text: qsTr("Export...")
+            visible: !app.exporter.running
+            onClicked: {
+                exportDialog.open();
+            }
+        }
+
+        ProgressBar {
+            visible: app.exporter.running
+            anchors.verticalCenter: parent.verticalCenter
+            value: app.exporter.progress
+        }
+
+        Button {
+            text: qsTr("Cancel export")
+            visible: app.exporter.running
+            onClicked: {
+                app.exporter.cancel();
+            }
+        }
+
+        Label {
+            visible: !app.exporter.running && app.exporter.errorString !== ""
+            text: app.exporter.errorString
+            color: "red"
+        }
+
         CheckBox {
             id: cbAutoScroll
             checked: true
@@ -67,55 +195,65 @@ Window {
 
     ListView {
         id: messagesView
+        visible: !cbTimeline.checked && !cbTopology.checked
         anchors {
             top: flow1.bottom
             left: parent.left
-            right: parent.right
+            right: cbShowPeers.checked ? peersView.left : (cbShowTop.checked ? topView.left : parent.right)
             bottom: parent.bottom
             margins: 5
         }
-        model: app.messagesModel
+        model: app.messagesView
         interactive: true
         clip: true
 
+        // selection is view rows between anchor and currentIndex
+        property int selectionAnchor: -1
+        property int selectionFirst: selectionAnchor < 0 ? currentIndex : Math.min(selectionAnchor, currentIndex)
+        property int selectionLast: selectionAnchor < 0 ? currentIndex : Math.max(selectionAnchor, currentIndex)
+
         delegate: DBusMessageDelegate {
             id: delegate
             width: parent.width
-            highlighted: ListView.isCurrentItem
+            highlighted: index >= messagesView.selectionFirst && index <= messagesView.selectionLast
 
             serial: model.serial
             replySerial: model.replySerial
-            typeString: model.typeString
-
-            senderAddress: model.senderAddress
-            senderExe: model.senderExe
-            senderPid: model.senderPid
-            senderNames: model.senderNames
+            kind: model.kind
+            senderText: model.senderText
+            destinationText: model.destinationText
+            callText: model.callText
+            argumentCount: model.argumentCount
 
-            destinationAddress: model.destinationAddress
-            destinationExe: model.destinationExe
-            destinationPid: model.destinationPid
-            destinationNames: model.destinationNames
-
-            msgPath: model.path
-            msgInterface: model.interface
-            msgMember: model.member
+            onToggleArguments: {
+                if (argumentsModel) {
+                    argumentsModel.destroy();
+                    argumentsModel = null;
+                } else {
+                    argumentsModel = app.messagesModel.argumentsModel(app.messagesView.sourceRow(index));
+                }
+            }
 
             onClicked: {
+                if (!cbExtendSelection.checked || messagesView.selectionAnchor < 0) {
+                    messagesView.selectionAnchor = index;
+                }
                 messagesView.currentIndex = index;
             }
 
             onShowReply: {
                 cbAutoScroll.checked = false;  // disable autoscroll
-                var idx = app.messagesModel.findReplySerial(id);
+                var idx = app.messagesView.findReplySerial(id);
                 messagesView.positionViewAtIndex(idx, ListView.Center);
+                messagesView.selectionAnchor = idx;
                 messagesView.currentIndex = idx;
             }
 
             onShowRequest: {
                 cbAutoScroll.checked = false;  // disable autoscroll
-                var idx = app.messagesModel.findSerial(id);
+                var idx = app.messagesView.findSerial(id);
                 messagesView.positionViewAtIndex(idx, ListView.Center);
+                messagesView.selectionAnchor = idx;
                 messagesView.currentIndex = idx;
             }
         }
@@ -123,6 +261,57 @@ Window {
         ScrollBar.vertical: ScrollBar { }
     }
 
+    TimelineView {
+        id: timelineView
+        visible: cbTimeline.checked
+        anchors.fill: messagesView
+    }
+
+    TopologyView {
+        id: topologyView
+        visible: cbTopology.checked
+        anchors.fill: messagesView
+    }
+
+    TrafficTopView {
+        id: topView
+        visible: cbShowTop.checked
+        width: cbShowPeers.checked ? peersView.width : 500
+        // upper half when peers are shown too
+        height: (parent.height - flow1.height) / 2
+        anchors {
+            top: flow1.bottom
+            right: parent.right
+            bottom: cbShowPeers.checked ? undefined : parent.bottom
+            margins: 5
+        }
+    }
+
+    PeerStatsView {
+        id: peersView
+        visible: cbShowPeers.checked
+        width: 750
+        anchors {
+            top: cbShowTop.checked ? topView.bottom : flow1.bottom
+            right: parent.right
+            bottom: parent.bottom
+            margins: 5
+        }
+    }
+
+    FileDialog {
+        id: exportDialog
+        title: qsTr("Export messages")
+        selectExisting: false
+        nameFilters: [ qsTr("JSON Lines (*.json *.jsonl)"), qsTr("CSV (*.csv)"),
+                       qsTr("pcap (*.pcap)"), qsTr("All files (*)") ]
+        onAccepted: {
+            app.exportMessages(fileUrl, exportFormat.currentText,
+                               exportScope.scopes[exportScope.currentIndex],
+                               messagesView.selectionFirst, messagesView.selectionLast);
+        }
+    }
+
     Connections {
         target: app
         onAutoScroll: {
@@ -0,0 +1,125 @@
+#include <QFile>
+#include <QLoggingCategory>
+#include <QtConcurrent/QtConcurrentRun>
+
+#include "bufferedwriter.h"
+#include "messageexporter.h"
+
+
+Q_LOGGING_CATEGORY(logExport, "monitor.export")
+
+
+static const int PROGRESS_INTERVAL_MS = 100;
+
+
+MessageExporter::MessageExporter(QObject *parent)
+    : QObject(parent)
+    , m_cancel(0)
+    , m_done(0)
+{
+    connect(&m_watcher, &QFutureWatcher<QString>::finished, this, &MessageExporter::onFinished);
+    m_progressTimer.setInterval(PROGRESS_INTERVAL_MS);
+    connect(&m_progressTimer, &QTimer::timeout, this, &MessageExporter::updateProgress);
+}
+
+MessageExporter::~MessageExporter()
+{
+    cancel();
+    m_watcher.waitForFinished();
+}
+
+bool MessageExporter::start(const QString &fileName, MessageFormat::Format format,
+                            const MessageStore::Snapshot &snapshot, const QVector<int> &rows, bool allRows)
+{
+    if (isRunning()) {
+        return false;
+    }
+    m_cancel.store(0);
+    m_done.store(0);
+    m_total = allRows ? snapshot.size() : rows.size();
+    m_exported = 0;
+    m_errorString.clear();
+
+    QAtomicInt *cancelFlag = &m_cancel;
+    QAtomicInt *done = &m_done;
+    const int total = m_total;
+    m_watcher.setFuture(QtConcurrent::run([=] () -> QString {
+        BufferedWriter out;
+        if (!out.open(fileName)) {
+            return out.errorString();
+        }
+        QByteArray chunk = MessageFormat::fileHeader(format);
+        for (int i = 0; i < total; i++) {
+            MessageFormat::append(chunk, snapshot.at(allRows ? i : rows.at(i)), format);
+            if ((i + 1) % ChunkSize == 0) {
+                if (!out.write(chunk)) {
+                    return out.errorString();
+                }
+                chunk.resize(0);
+                done->store(i + 1);
+                if (cancelFlag->load()) {
+                    out.close();
+                    QFile::remove(fileName);
+                    return tr("Export cancelled");
+                }
+            }
+        }
+        if (!out.write(chunk) || !out.flush()) {
+            return out.errorString();
+        }
+        out.close();
+        done->store(total);
+        return QString();
+    }));
+
+    m_progressTimer.start();
+    Q_EMIT runningChanged();
+    Q_EMIT progressChanged();
+    return true;
+}
+
+bool MessageExporter::isRunning() const
+{
+    return m_watcher.isRunning();
+}
+
+double MessageExporter::progress() const
+{
+    return (m_total > 0) ? static_cast<double>(m_exported) / m_total : 0;
+}
+
+int MessageExporter::exportedMessages() const
+{
+    return m_exported;
+}
+
+QString MessageExporter::errorString() const
+{
+    return m_errorString;
+}
+
+void MessageExporter::cancel()
+{
+    m_cancel.store(1);
+}
+
+void MessageExporter::onFinished()
+{
+    m_progressTimer.stop();
+    m_errorString = m_watcher.result();
+    updateProgress();
+    if (!m_errorString.isEmpty()) {
+        qCWarning(logExport) << "Export failed:" << m_errorString;
+    }
+    Q_EMIT runningChanged();
+    Q_EMIT finished(m_errorString.isEmpty());
+}
+
+void MessageExporter::updateProgress()
+{
+    const int done = m_done.load();
+    if (done != m_exported) {
+        m_exported = done;
+        Q_EMIT progressChanged();
+    }
+}
@@ -0,0 +1,71 @@
+#ifndef MESSAGEEXPORTER_H
+#define MESSAGEEXPORTER_H
+
+#include <QAtomicInt>
+#include <QFutureWatcher>
+#include <QObject>
+#include <QTimer>
+#include <QVector>
+
+#include "messageformat.h"
+#include "messagestore.h"
+
+
+/**
+ * Writes stored messages to a file on a pool thread.
+ *
+ * Works on a MessageStore::Snapshot and, for filtered views and
+ * selections, a vector of row numbers, so nothing is copied before the
+ * export starts and capture can go on meanwhile. Messages are formatted
+ * in chunks of ChunkSize; between chunks the worker publishes progress
+ * and checks for cancel(). A cancelled export removes its partial file.
+ * One export at a time.
+ */
+class MessageExporter: public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(bool running READ isRunning NOTIFY runningChanged)
+    Q_PROPERTY(double progress READ progress NOTIFY progressChanged)
+    Q_PROPERTY(int exportedMessages READ exportedMessages NOTIFY progressChanged)
+    Q_PROPERTY(QString errorString READ errorString NOTIFY finished)
+
+public:
+    static const int ChunkSize = 4096;
+
+public:
+    explicit MessageExporter(QObject *parent = nullptr);
+    ~MessageExporter() override;
+
+    // rows index into snapshot; with allRows, rows are ignored and
+    //   the whole snapshot is written
+    bool start(const QString &fileName, MessageFormat::Format format,
+               const MessageStore::Snapshot &snapshot, const QVector<int> &rows, bool allRows);
+
+    bool isRunning() const;
+    double progress() const;
+    int exportedMessages() const;
+    QString errorString() const;
+
+public Q_SLOTS:
+    void cancel();
+
+Q_SIGNALS:
+    void runningChanged();
+    void progressChanged();
+    void finished(bool ok);
+
+private Q_SLOTS:
+    void onFinished();
+    void updateProgress();
+
+private:
+    QFutureWatcher<QString> m_watcher;  // result is error string, empty on success
+    QTimer m_progressTimer;
+    QAtomicInt m_cancel;
+    QAtomicInt m_done;
+    int m_total = 0;
+    int m_exported = 0;
+    QString m_errorString;
+};
+
+#endif // MESSAGEEXPORTER_H
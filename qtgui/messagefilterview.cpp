@@ -0,0 +1,262 @@
+#include <QtConcurrent/QtConcurrentMap>
+#include <QLoggingCategory>
+
+#include "messagefilterview.h"
+
+
+Q_LOGGING_CATEGORY(logView, "monitor.view")
+
+
+static const int RESCAN_CHUNK_ROWS = 16384;
+
+
+namespace {
+
+// QtConcurrent::mapped() wants result_type from functor
+struct RescanChunk
+{
+    typedef QVector<int> result_type;
+
+    MessageStore::Snapshot snapshot;
+    MessageFilter filter;
+
+    QVector<int> operator()(const QPair<int, int> &range) const
+    {
+        QVector<int> ret;
+        for (int row = range.first; row < range.second; row++) {
+            if (filter.matchMessage(snapshot.at(row))) {
+                ret.append(row);
+            }
+        }
+        return ret;
+    }
+};
+
+} // namespace
+
+
+MessageFilterView::MessageFilterView(DBusMessagesModel *source, QObject *parent)
+    : QAbstractListModel(parent)
+    , m_source(source)
+{
+    QObject::connect(source, &QAbstractItemModel::rowsInserted,
+                     this, &MessageFilterView::onSourceRowsInserted);
+    QObject::connect(source, &QAbstractItemModel::modelReset,
+                     this, &MessageFilterView::onSourceReset);
+    startRescan();
+}
+
+MessageFilterView::~MessageFilterView()
+{
+    cancelRescan();
+}
+
+QHash<int, QByteArray> MessageFilterView::roleNames() const
+{
+    if (!m_source) {
+        return QHash<int, QByteArray>();
+    }
+    return m_source->roleNames();
+}
+
+int MessageFilterView::rowCount(const QModelIndex &parent) const
+{
+    Q_UNUSED(parent)
+    return m_rows.size();
+}
+
+QVariant MessageFilterView::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || !m_source) {
+        return QVariant();
+    }
+    const int row = index.row();
+    if ((row < 0) || (row >= m_rows.size())) {
+        return QVariant();
+    }
+    return m_source->data(m_source->index(m_rows.at(row)), role);
+}
+
+QString MessageFilterView::filterText() const { return m_filterText; }
+
+QVector<int> MessageFilterView::rows() const { return m_rows; }
+
+QString MessageFilterView::filterError() const { return m_filterError; }
+
+bool MessageFilterView::isRescanning() const { return m_rescanWatcher != nullptr; }
+
+MessageFilter MessageFilterView::filter() const { return m_filter; }
+
+void MessageFilterView::setFilterText(const QString &text)
+{
+    if (text == m_filterText) {
+        return;
+    }
+    m_filterText = text;
+    Q_EMIT filterTextChanged();
+
+    MessageFilter newFilter;
+    QString errorString;
+    if (!newFilter.setRules(MessageFilter::splitRules(text), &errorString)) {
+        // keep showing results of previous filter
+        m_filterError = errorString;
+        Q_EMIT filterErrorChanged();
+        return;
+    }
+    if (!m_filterError.isEmpty()) {
+        m_filterError.clear();
+        Q_EMIT filterErrorChanged();
+    }
+    setFilter(newFilter);
+}
+
+void MessageFilterView::setFilter(const MessageFilter &filter)
+{
+    m_filter = filter;
+    startRescan();
+}
+
+int MessageFilterView::sourceRow(int row) const
+{
+    if ((row < 0) || (row >= m_rows.size())) {
+        return -1;
+    }
+    return m_rows.at(row);
+}
+
+int MessageFilterView::findSerial(uint serial) const
+{
+    if (!m_source) {
+        return -1;
+    }
+    const MessageStore &store = m_source->store();
+    for (int idx = 0; idx < m_rows.size(); idx++) {
+        if (store.at(m_rows.at(idx)).serial == serial) {
+            return idx;
+        }
+    }
+    return -1;
+}
+
+int MessageFilterView::findReplySerial(uint serial) const
+{
+    if (!m_source) {
+        return -1;
+    }
+    const MessageStore &store = m_source->store();
+    for (int idx = 0; idx < m_rows.size(); idx++) {
+        if (store.at(m_rows.at(idx)).replySerial == serial) {
+            return idx;
+        }
+    }
+    return -1;
+}
+
+void MessageFilterView::onSourceRowsInserted(const QModelIndex &parent, int first, int last)
+{
+    Q_UNUSED(parent)
+    if (m_rescanWatcher) {
+        // these rows will be tested with new filter when rescan finishes
+        return;
+    }
+
+    const MessageStore &store = m_source->store();
+    QVector<int> matched;
+    for (int row = first; row <= last; row++) {
+        if (m_filter.matchMessage(store.at(row))) {
+            matched.append(row);
+        }
+    }
+    if (matched.isEmpty()) {
+        return;
+    }
+
+    beginInsertRows(QModelIndex(), m_rows.size(), m_rows.size() + matched.size() - 1);
+    m_rows += matched;
+    endInsertRows();
+}
+
+void MessageFilterView::onSourceReset()
+{
+    const bool wasRescanning = isRescanning();
+    cancelRescan();
+    beginResetModel();
+    m_rows.clear();
+    endResetModel();
+    if (wasRescanning) {
+        Q_EMIT rescanningChanged();
+    }
+}
+
+void MessageFilterView::startRescan()
+{
+    const bool wasRescanning = isRescanning();
+    cancelRescan();
+    if (!m_source) {
+        return;
+    }
+
+    const MessageStore::Snapshot snapshot = m_source->store().snapshot();
+    m_rescanSize = snapshot.size();
+
+    QList<QPair<int, int>> ranges;
+    for (int first = 0; first < m_rescanSize; first += RESCAN_CHUNK_ROWS) {
+        ranges.append(qMakePair(first, qMin(first + RESCAN_CHUNK_ROWS, m_rescanSize)));
+    }
+
+    RescanChunk scanner;
+    scanner.snapshot = snapshot;
+    scanner.filter = m_filter;
+
+    qCDebug(logView) << "rescanning" << m_rescanSize << "rows in" << ranges.size() << "chunks";
+
+    m_rescanWatcher = new QFutureWatcher<QVector<int>>(this);
+    QObject::connect(m_rescanWatcher, &QFutureWatcherBase::finished,
+                     this, &MessageFilterView::onRescanFinished);
+    m_rescanWatcher->setFuture(QtConcurrent::mapped(ranges, scanner));
+
+    if (!wasRescanning) {
+        Q_EMIT rescanningChanged();
+    }
+}
+
+void MessageFilterView::cancelRescan()
+{
+    if (!m_rescanWatcher) {
+        return;
+    }
+    // watcher does not block on destruction, workers stop at the next chunk
+    m_rescanWatcher->disconnect(this);
+    m_rescanWatcher->cancel();
+    m_rescanWatcher->deleteLater();
+    m_rescanWatcher = nullptr;
+}
+
+void MessageFilterView::onRescanFinished()
+{
+    QFutureWatcher<QVector<int>> *watcher = m_rescanWatcher;
+    if (!watcher || !m_source) {
+        return;
+    }
+    m_rescanWatcher = nullptr;
+
+    QVector<int> rows;
+    const QList<QVector<int>> parts = watcher->future().results();
+    for (const QVector<int> &part: parts) {
+        rows += part;
+    }
+    watcher->deleteLater();
+
+    // messages that arrived while rescan was running
+    const MessageStore &store = m_source->store();
+    for (int row = m_rescanSize; row < store.size(); row++) {
+        if (m_filter.matchMessage(store.at(row))) {
+            rows.append(row);
+        }
+    }
+
+    beginResetModel();
+    m_rows = rows;
+    endResetModel();
+    Q_EMIT rescanningChanged();
+}
@@ -0,0 +1,74 @@
+#ifndef MESSAGEFILTERVIEW_H
+#define MESSAGEFILTERVIEW_H
+
+#include <QAbstractListModel>
+#include <QFutureWatcher>
+#include <QPointer>
+#include <QVector>
+
+#include "dbusmessagesmodel.h"
+#include "messagefilter.h"
+
+
+/**
+ * Filtered view over DBusMessagesModel rows, keeping a vector of matching
+ * source rows. Appended messages are tested once, when they are inserted.
+ * Changing the filter rescans the store in parallel chunks in background,
+ * and the new row vector replaces the old one in one model reset.
+ * Any number of views can share one source model.
+ */
+class MessageFilterView: public QAbstractListModel
+{
+    Q_OBJECT
+    Q_PROPERTY(QString filterText READ filterText WRITE setFilterText NOTIFY filterTextChanged)
+    Q_PROPERTY(QString filterError READ filterError NOTIFY filterErrorChanged)
+    Q_PROPERTY(bool rescanning READ isRescanning NOTIFY rescanningChanged)
+
+public:
+    explicit MessageFilterView(DBusMessagesModel *source, QObject *parent = nullptr);
+    ~MessageFilterView() override;
+
+    QHash<int, QByteArray> roleNames() const override;
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+    QString filterText() const;
+    void setFilterText(const QString &text);
+    QString filterError() const;
+    bool isRescanning() const;
+
+    MessageFilter filter() const;
+    void setFilter(const MessageFilter &filter);
+    // source rows of this view, in order; shared, not copied
+    QVector<int> rows() const;
+
+public Q_SLOTS:
+    int sourceRow(int row) const;
+    int findSerial(uint serial) const;
+    int findReplySerial(uint serial) const;
+
+Q_SIGNALS:
+    void filterTextChanged();
+    void filterErrorChanged();
+    void rescanningChanged();
+
+private Q_SLOTS:
+    void onSourceRowsInserted(const QModelIndex &parent, int first, int last);
+    void onSourceReset();
+    void onRescanFinished();
+
+private:
+    void startRescan();
+    void cancelRescan();
+
+private:
+    QPointer<DBusMessagesModel> m_source;
+    MessageFilter m_filter;
+    QString m_filterText;
+    QString m_filterError;
+    QVector<int> m_rows;
+    QFutureWatcher<QVector<int>> *m_rescanWatcher = nullptr;
+    int m_rescanSize = 0; // source rows covered by running rescan
+};
+
+#endif // MESSAGEFILTERVIEW_H
@@ -0,0 +1,52 @@
+#include "messagestore.h"
+
+
+int MessageStore::size() const
+{
+    return m_size.loadAcquire();
+}
+
+const DBusMessageObject &MessageStore::at(int i) const
+{
+    return m_chunks[i / ChunkSize]->items[i % ChunkSize];
+}
+
+DBusMessageObject &MessageStore::slotForAppend()
+{
+    const int n = m_size.load();
+    if (n == m_chunks.size() * ChunkSize) {
+        QSharedPointer<Chunk> chunk(new Chunk);
+        QMutexLocker guard(&m_mutex);
+        m_chunks.append(chunk);
+    }
+    // at() does not detach list; slot is not visible to readers until m_size is published
+    return m_chunks.at(n / ChunkSize)->items[n % ChunkSize];
+}
+
+void MessageStore::append(const DBusMessageObject &msg)
+{
+    slotForAppend() = msg;
+    m_size.storeRelease(m_size.load() + 1);
+}
+
+void MessageStore::append(DBusMessageObject &&msg)
+{
+    slotForAppend() = std::move(msg);
+    m_size.storeRelease(m_size.load() + 1);
+}
+
+void MessageStore::clear()
+{
+    QMutexLocker guard(&m_mutex);
+    m_chunks.clear();
+    m_size.storeRelease(0);
+}
+
+MessageStore::Snapshot MessageStore::snapshot() const
+{
+    Snapshot ret;
+    QMutexLocker guard(&m_mutex);
+    ret.m_chunks = m_chunks;
+    ret.m_size = m_size.loadAcquire();
+    return ret;
+}
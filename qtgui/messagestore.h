@@ -0,0 +1,63 @@
+#ifndef MESSAGESTORE_H
+#define MESSAGESTORE_H
+
+#include <QAtomicInt>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QVector>
+
+#include "dbusmessageobject.h"
+
+
+/**
+ * Append-only storage for captured messages, shared by all views.
+ *
+ * Only one thread (GUI) appends and clears, and it may use at() directly.
+ * Any other thread reads through a Snapshot, which keeps its chunks alive
+ * even if the store is cleared meanwhile. Chunks are fixed-size arrays
+ * allocated whole, appending only assigns a slot past the published size,
+ * so readers bounded by that size need no locking.
+ */
+class MessageStore
+{
+public:
+    static const int ChunkSize = 4096;
+    struct Chunk {
+        DBusMessageObject items[ChunkSize];
+    };
+
+    class Snapshot
+    {
+    public:
+        int size() const { return m_size; }
+        const DBusMessageObject &at(int i) const {
+            return m_chunks[i / ChunkSize]->items[i % ChunkSize];
+        }
+
+    private:
+        friend class MessageStore;
+        QVector<QSharedPointer<Chunk>> m_chunks;
+        int m_size = 0;
+    };
+
+public:
+    MessageStore() = default;
+
+    int size() const;
+    const DBusMessageObject &at(int i) const;
+    void append(const DBusMessageObject &msg);
+    void append(DBusMessageObject &&msg);
+    void clear();
+
+    Snapshot snapshot() const;
+
+private:
+    DBusMessageObject &slotForAppend();
+
+private:
+    mutable QMutex m_mutex; // guards m_chunks list against concurrent snapshot()
+    QVector<QSharedPointer<Chunk>> m_chunks;
+    QAtomicInt m_size;
+};
+
+#endif // MESSAGESTORE_H
@@ -1,8 +1,13 @@
 #include <QQmlContext>
+#include <QQuickWindow>
+#include <QScreen>
+#include <QtQml>
 #include <QDebug>
 #include <QLoggingCategory>
 
 #include "monitorapp.h"
+#include "timelineitem.h"
+#include "topologygraphitem.h"
 
 
 Q_LOGGING_CATEGORY(logApp, "monitor.app")
@@ -10,6 +15,11 @@ Q_LOGGING_CATEGORY(logApp, "monitor.app")
 
 MonitorApp::MonitorApp(int &argc, char **argv)
     : QGuiApplication(argc, argv)
+    , m_queue(MessageQueue::DefaultCapacity, MessageQueue::OverflowPolicy::DropOldest)
+    , m_messagesView(&m_messages)
+    , m_topModel(&m_top)
+    , m_peersModel(&m_peers)
+    , m_topologyModel(&m_topology)
 {
 }
 
@@ -18,7 +28,12 @@ bool MonitorApp::init()
 {
     // context properties first
     m_engine.rootContext()->setContextProperty(QLatin1String("app"), this);
-    m_engine.rootContext()->setContextProperty(QLatin1String("monitor"), &m_thread);
+    m_engine.rootContext()->setContextProperty(QLatin1String("sessionMonitor"), &m_sessionThread);
+    m_engine.rootContext()->setContextProperty(QLatin1String("systemMonitor"), &m_systemThread);
+    qmlRegisterUncreatableType<DBusMessagesModel>("QDBusMonitor", 1, 0, "DBusMessagesModel",
+                                                  QStringLiteral("Only for Kind enum"));
+    qmlRegisterType<TimelineItem>("QDBusMonitor", 1, 0, "Timeline");
+    qmlRegisterType<TopologyGraphItem>("QDBusMonitor", 1, 0, "TopologyGraph");
     // load main QML
     m_engine.load(QUrl(QStringLiteral("qrc:/main.qml")));
     if (m_engine.rootObjects().isEmpty()) {
@@ -26,6 +41,15 @@ bool MonitorApp::init()
         return false;
     }
 
+    // pace UI updates to the display
+    QQuickWindow *window = qobject_cast<QQuickWindow *>(m_engine.rootObjects().first());
+    if (window && window->screen() && window->screen()->refreshRate() > 0) {
+        m_scheduler.setFrameInterval(qRound(1000.0 / window->screen()->refreshRate()));
+    }
+    m_rowsTask = m_scheduler.addTask([this] () {
+        takeQueuedMessages();
+    });
+
     QObject::connect(&m_engine, &QQmlEngine::quit, [this] () {
         qCDebug(logApp) << "should_exit!";
         m_should_exit = true;
@@ -36,8 +60,25 @@ bool MonitorApp::init()
 
     qRegisterMetaType<DBusMessageObject>();
 
-    QObject::connect(&m_thread, &DBusMonitorThread::messageReceived,
-                     this, &MonitorApp::onMessageReceived);
+    m_merger.setQueueLimit(MessageQueue::DefaultCapacity, MessageQueue::OverflowPolicy::DropOldest);
+    m_merger.addSource(&m_sessionThread);
+    m_merger.addSource(&m_systemThread);
+    // at most one batch per frame, see UiUpdateScheduler
+    QObject::connect(&m_merger, &MessageMerger::messageReceived,
+                     this, [this] (const DBusMessageObject &dmsg) {
+        if (m_queue.push(dmsg)) {
+            m_scheduler.schedule(m_rowsTask);
+        }
+    }, Qt::DirectConnection);
+    // counted right on capture threads, model only reads snapshots
+    for (DBusMonitorThread *thread: {&m_sessionThread, &m_systemThread}) {
+        QObject::connect(thread, &DBusMonitorThread::messageReceived,
+                         this, [this] (const DBusMessageObject &dmsg) {
+            m_top.add(dmsg);
+            m_peers.add(dmsg);
+            m_topology.add(dmsg);
+        }, Qt::DirectConnection);
+    }
 
     return true;
 }
@@ -48,25 +89,148 @@ bool MonitorApp::shouldExit() const { return m_should_exit; }
 
 QObject *MonitorApp::messagesModelObj() { return static_cast<QObject *>(&m_messages); }
 
-void MonitorApp::startOnSessionBus() { m_thread.startOnSessionBus(); }
+QObject *MonitorApp::messagesViewObj() { return static_cast<QObject *>(&m_messagesView); }
+
+QObject *MonitorApp::trafficTopObj() { return static_cast<QObject *>(&m_topModel); }
+
+QObject *MonitorApp::peerStatsObj() { return static_cast<QObject *>(&m_peersModel); }
+
+QObject *MonitorApp::topologyObj() { return static_cast<QObject *>(&m_topologyModel); }
+
+QObject *MonitorApp::uiSchedulerObj() { return static_cast<QObject *>(&m_scheduler); }
+
+QObject *MonitorApp::exporterObj() { return static_cast<QObject *>(&m_exporter); }
 
-void MonitorApp::startOnSystemBus() { m_thread.startOnSystemBus(); }
+quint64 MonitorApp::droppedMessages() const { return m_droppedMessages; }
+
+QObject *MonitorApp::createMessagesView(const QString &filterText)
+{
+    // additional independent view over the same messages, owned by QML
+    MessageFilterView *view = new MessageFilterView(&m_messages);
+    view->setFilterText(filterText);
+    QQmlEngine::setObjectOwnership(view, QQmlEngine::JavaScriptOwnership);
+    return view;
+}
+
+void MonitorApp::startOnSessionBus() { m_sessionThread.startOnSessionBus(); }
+
+void MonitorApp::startOnSystemBus() { m_systemThread.startOnSystemBus(); }
 
 void MonitorApp::stopMonitor()
 {
-    if (m_thread.isRunning()) {
-        m_thread.requestInterruption();
-        m_thread.wait(1000);
+    for (DBusMonitorThread *thread: {&m_sessionThread, &m_systemThread}) {
+        if (thread->isRunning()) {
+            thread->stop();
+        }
+    }
+    // both are woken up by stop(), and they emit right into this object
+    m_sessionThread.wait();
+    m_systemThread.wait();
+}
+
+bool MonitorApp::isPaused() const { return m_paused; }
+
+void MonitorApp::setPaused(bool paused)
+{
+    if (paused == m_paused) {
+        return;
+    }
+    m_paused = paused;
+    if (!m_paused) {
+        // whatever is still queued goes in the same insertion
+        takeQueuedMessages();
     }
+    Q_EMIT pausedChanged();
 }
 
+int MonitorApp::stagedMessages() const { return m_stagedMessages; }
+
 void MonitorApp::clearLog()
 {
+    // messages captured before clearing must not show up on next frame
+    m_queue.takeAll();
+    m_staging.clear();
+    if (m_stagedMessages != 0) {
+        m_stagedMessages = 0;
+        Q_EMIT stagedMessagesChanged();
+    }
     m_messages.clear();
+    m_top.clear();
+    m_peers.clear();
+    m_topology.clear();
+    m_topologyModel.refresh();
 }
 
-void MonitorApp::onMessageReceived(const DBusMessageObject &dmsg)
+bool MonitorApp::exportMessages(const QUrl &fileUrl, const QString &formatName, const QString &scope,
+                                int firstRow, int lastRow)
 {
-    m_messages.addMessage(dmsg);
-    Q_EMIT autoScroll();
+    MessageFormat::Format format = MessageFormat::Format::JsonLines;
+    if (!MessageFormat::formatFromString(formatName, &format)) {
+        qCWarning(logApp) << "Unknown export format:" << formatName;
+        return false;
+    }
+    const QString fileName = fileUrl.isLocalFile() ? fileUrl.toLocalFile() : fileUrl.toString();
+
+    // rows and snapshot are taken together, so rows are all inside it
+    const MessageStore::Snapshot snapshot = m_messages.store().snapshot();
+    if (scope == QLatin1String("all")) {
+        return m_exporter.start(fileName, format, snapshot, QVector<int>(), true);
+    }
+    const QVector<int> viewRows = m_messagesView.rows();
+    if (scope == QLatin1String("view")) {
+        return m_exporter.start(fileName, format, snapshot, viewRows, false);
+    }
+    if (scope == QLatin1String("selection")) {
+        if (firstRow > lastRow) {
+            qSwap(firstRow, lastRow);
+        }
+        firstRow = qMax(0, firstRow);
+        lastRow = qMin(lastRow, viewRows.size() - 1);
+        if (firstRow > lastRow) {
+            return false;
+        }
+        return m_exporter.start(fileName, format, snapshot, viewRows.mid(firstRow, lastRow - firstRow + 1), false);
+    }
+    qCWarning(logApp) << "Unknown export scope:" << scope;
+    return false;
+}
+
+void MonitorApp::takeQueuedMessages()
+{
+    QVector<DBusMessageObject> batch = m_queue.takeAll();
+    if (m_paused) {
+        // visible model is left alone, only the counter changes
+        if (!batch.isEmpty()) {
+            m_stagedMessages += batch.size();
+            m_staging.append(std::move(batch));
+            Q_EMIT stagedMessagesChanged();
+        }
+    } else {
+        if (!m_staging.isEmpty()) {
+            QVector<DBusMessageObject> all;
+            all.reserve(m_stagedMessages + batch.size());
+            for (QVector<DBusMessageObject> &staged: m_staging) {
+                for (DBusMessageObject &dmsg: staged) {
+                    all.append(std::move(dmsg));
+                }
+            }
+            for (DBusMessageObject &dmsg: batch) {
+                all.append(std::move(dmsg));
+            }
+            batch.swap(all);
+            m_staging.clear();
+            m_stagedMessages = 0;
+            Q_EMIT stagedMessagesChanged();
+        }
+        if (!batch.isEmpty()) {
+            m_messages.addMessages(std::move(batch));
+            Q_EMIT autoScroll();
+        }
+    }
+
+    const quint64 dropped = m_queue.droppedCount() + m_merger.droppedCount();
+    if (dropped != m_droppedMessages) {
+        m_droppedMessages = dropped;
+        Q_EMIT droppedMessagesChanged();
+    }
 }
@@ -3,9 +3,18 @@
 
 #include <QGuiApplication>
 #include <QQmlApplicationEngine>
+#include <QUrl>
 
 #include "dbusmessagesmodel.h"
+#include "messagefilterview.h"
+#include "traffictopmodel.h"
+#include "peerstatsmodel.h"
+#include "bustopologymodel.h"
 #include "dbusmonitorthread.h"
+#include "messagemerger.h"
+#include "messagequeue.h"
+#include "uiupdatescheduler.h"
+#include "messageexporter.h"
 
 
 class MonitorApp: public QGuiApplication
@@ -13,6 +22,16 @@ class MonitorApp: public QGuiApplication
     Q_OBJECT
     Q_PROPERTY(bool shouldExit READ shouldExit NOTIFY shouldExitChanged)
     Q_PROPERTY(QObject* messagesModel READ messagesModelObj NOTIFY messagesModelChanged)
+    Q_PROPERTY(QObject* messagesView READ messagesViewObj CONSTANT)
+    Q_PROPERTY(QObject* trafficTop READ trafficTopObj CONSTANT)
+    Q_PROPERTY(quint64 droppedMessages READ droppedMessages NOTIFY droppedMessagesChanged)
+    Q_PROPERTY(QObject* peerStats READ peerStatsObj CONSTANT)
+    Q_PROPERTY(QObject* topology READ topologyObj CONSTANT)
+    Q_PROPERTY(QObject* uiScheduler READ uiSchedulerObj CONSTANT)
+    Q_PROPERTY(QObject* exporter READ exporterObj CONSTANT)
+    // capture goes on while paused, messages wait in staging buffer
+    Q_PROPERTY(bool paused READ isPaused WRITE setPaused NOTIFY pausedChanged)
+    Q_PROPERTY(int stagedMessages READ stagedMessages NOTIFY stagedMessagesChanged)
 
 public:
     MonitorApp(int &argc, char **argv);
@@ -22,22 +41,61 @@ public Q_SLOTS:
     QQmlApplicationEngine *engine();
     bool shouldExit() const;
     QObject *messagesModelObj();
+    QObject *messagesViewObj();
+    QObject *trafficTopObj();
+    QObject *peerStatsObj();
+    QObject *topologyObj();
+    QObject *uiSchedulerObj();
+    QObject *exporterObj();
+    quint64 droppedMessages() const;
+    bool isPaused() const;
+    void setPaused(bool paused);
+    int stagedMessages() const;
+    QObject *createMessagesView(const QString &filterText);
     void startOnSessionBus();
     void startOnSystemBus();
     void stopMonitor();
     void clearLog();
-    void onMessageReceived(const DBusMessageObject &dmsg);
+    // scope is "all", "view" (filtered messagesView) or "selection", that
+    //   is messagesView rows firstRow..lastRow; format as in MessageFormat
+    bool exportMessages(const QUrl &fileUrl, const QString &formatName, const QString &scope,
+                        int firstRow = -1, int lastRow = -1);
+    void takeQueuedMessages();
 
 Q_SIGNALS:
     void shouldExitChanged();
     void messagesModelChanged();
     void autoScroll();
+    void droppedMessagesChanged();
+    void pausedChanged();
+    void stagedMessagesChanged();
 
 private:
     bool                   m_should_exit = false;
     QQmlApplicationEngine  m_engine;
-    DBusMonitorThread      m_thread;
+    // both can run at once, merger puts their messages in timestamp order
+    DBusMonitorThread      m_sessionThread;
+    DBusMonitorThread      m_systemThread;
+    MessageMerger          m_merger;
+    // between merger thread and the model, so a slow UI cannot eat all memory
+    MessageQueue           m_queue;
+    quint64                m_droppedMessages = 0;
     DBusMessagesModel      m_messages;
+    MessageFilterView      m_messagesView;
+    // new rows and autoscroll are applied once per frame, whatever the message rate
+    UiUpdateScheduler      m_scheduler;
+    int                    m_rowsTask = -1;
+    // batches taken from m_queue while paused, inserted in one go on resume
+    bool                   m_paused = false;
+    QVector<QVector<DBusMessageObject>> m_staging;
+    int                    m_stagedMessages = 0;
+    TrafficTop             m_top;
+    TrafficTopModel        m_topModel;
+    PeerStats              m_peers;
+    PeerStatsModel         m_peersModel;
+    BusTopology            m_topology;
+    BusTopologyModel       m_topologyModel;
+    MessageExporter        m_exporter;
 };
 
 
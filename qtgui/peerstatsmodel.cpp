@@ -0,0 +1,126 @@
+#include "peerstatsmodel.h"
+
+
+// refreshing more often only makes numbers flicker
+static const int REFRESH_INTERVAL_MS = 1000;
+
+
+PeerStatsModel::PeerStatsModel(PeerStats *stats, QObject *parent)
+    : QAbstractListModel(parent)
+    , m_stats(stats)
+{
+    m_timer.setInterval(REFRESH_INTERVAL_MS);
+    connect(&m_timer, &QTimer::timeout, this, &PeerStatsModel::refresh);
+}
+
+QHash<int, QByteArray> PeerStatsModel::roleNames() const
+{
+    static const QHash<int, QByteArray> r = {
+        {Key,           QByteArrayLiteral("key")},
+        {Names,         QByteArrayLiteral("names")},
+        {CallsSent,     QByteArrayLiteral("callsSent")},
+        {CallsReceived, QByteArrayLiteral("callsReceived")},
+        {SignalsSent,   QByteArrayLiteral("signalsSent")},
+        {ErrorsSent,    QByteArrayLiteral("errorsSent")},
+        {BytesSent,     QByteArrayLiteral("bytesSent")},
+        {BytesReceived, QByteArrayLiteral("bytesReceived")},
+        {MeanLatency,   QByteArrayLiteral("meanLatency")},
+        {P99Latency,    QByteArrayLiteral("p99Latency")},
+    };
+    return r;
+}
+
+int PeerStatsModel::rowCount(const QModelIndex &parent) const
+{
+    Q_UNUSED(parent)
+    return m_entries.size();
+}
+
+QVariant PeerStatsModel::data(const QModelIndex &index, int role) const
+{
+    QVariant ret;
+    if (!index.isValid() || index.row() < 0 || index.row() >= m_entries.size()) {
+        return ret;
+    }
+    const PeerStats::Entry &entry = m_entries.at(index.row());
+    switch (role) {
+    case Role::Key:           ret = entry.key;           break;
+    case Role::Names:         ret = entry.names;         break;
+    case Role::CallsSent:     ret = entry.callsSent;     break;
+    case Role::CallsReceived: ret = entry.callsReceived; break;
+    case Role::SignalsSent:   ret = entry.signalsSent;   break;
+    case Role::ErrorsSent:    ret = entry.errorsSent;    break;
+    case Role::BytesSent:     ret = entry.bytesSent;     break;
+    case Role::BytesReceived: ret = entry.bytesReceived; break;
+    case Role::MeanLatency:   ret = entry.meanLatencyMs; break;
+    case Role::P99Latency:    ret = entry.p99LatencyMs;  break;
+    }
+    return ret;
+}
+
+int PeerStatsModel::dimension() const { return m_dimension; }
+
+void PeerStatsModel::setDimension(int dimension)
+{
+    if (dimension < 0 || dimension >= PeerStats::DimensionCount || dimension == m_dimension) {
+        return;
+    }
+    m_dimension = static_cast<PeerStats::Dimension>(dimension);
+    Q_EMIT dimensionChanged();
+    refresh();
+}
+
+int PeerStatsModel::sortColumn() const { return m_sortColumn; }
+
+void PeerStatsModel::setSortColumn(int column)
+{
+    if (column < KeyColumn || column > P99LatencyColumn || column == m_sortColumn) {
+        return;
+    }
+    m_sortColumn = column;
+    Q_EMIT sortColumnChanged();
+    refresh();
+}
+
+int PeerStatsModel::rowLimit() const { return m_rowLimit; }
+
+void PeerStatsModel::setRowLimit(int limit)
+{
+    if (limit == m_rowLimit) {
+        return;
+    }
+    m_rowLimit = limit;
+    Q_EMIT rowLimitChanged();
+    refresh();
+}
+
+bool PeerStatsModel::isActive() const { return m_timer.isActive(); }
+
+void PeerStatsModel::setActive(bool active)
+{
+    if (active == m_timer.isActive()) {
+        return;
+    }
+    if (active) {
+        m_timer.start();
+        refresh();
+    } else {
+        m_timer.stop();
+    }
+    Q_EMIT activeChanged();
+}
+
+int PeerStatsModel::peerCount() const { return m_peerCount; }
+
+void PeerStatsModel::refresh()
+{
+    QVector<PeerStats::Entry> entries = m_stats->top(m_dimension, m_rowLimit,
+                                                     static_cast<PeerStats::SortKey>(m_sortColumn));
+    m_peerCount = m_stats->peerCount(m_dimension);
+
+    // few hundred rows, reset is cheaper than matching them up
+    beginResetModel();
+    m_entries.swap(entries);
+    endResetModel();
+    Q_EMIT refreshed();
+}
@@ -0,0 +1,91 @@
+#ifndef PEERSTATSMODEL_H
+#define PEERSTATSMODEL_H
+
+#include <QAbstractListModel>
+#include <QTimer>
+#include <QVector>
+
+#include "peerstats.h"
+
+
+/**
+ * Periodically refreshed snapshot of PeerStats for one dimension,
+ * as a table: key, calls sent and received, signals, errors, bytes,
+ * mean and p99 latency. Only the top rowLimit peers by the sort column
+ * are shown. Counters are kept by PeerStats as messages arrive, a
+ * refresh only reads them.
+ */
+class PeerStatsModel: public QAbstractListModel
+{
+    Q_OBJECT
+    Q_PROPERTY(int dimension READ dimension WRITE setDimension NOTIFY dimensionChanged)
+    Q_PROPERTY(int sortColumn READ sortColumn WRITE setSortColumn NOTIFY sortColumnChanged)
+    Q_PROPERTY(int rowLimit READ rowLimit WRITE setRowLimit NOTIFY rowLimitChanged)
+    Q_PROPERTY(bool active READ isActive WRITE setActive NOTIFY activeChanged)
+    Q_PROPERTY(int peerCount READ peerCount NOTIFY refreshed)
+
+public:
+    enum Role {
+        Key = Qt::UserRole + 1,
+        Names,
+        CallsSent,
+        CallsReceived,
+        SignalsSent,
+        ErrorsSent,
+        BytesSent,
+        BytesReceived,
+        MeanLatency,
+        P99Latency,
+    };
+
+    // same order as PeerStats::SortKey
+    enum Column {
+        KeyColumn,
+        CallsSentColumn,
+        CallsReceivedColumn,
+        SignalsColumn,
+        ErrorsColumn,
+        BytesColumn,
+        MeanLatencyColumn,
+        P99LatencyColumn,
+    };
+    Q_ENUM(Column)
+
+public:
+    explicit PeerStatsModel(PeerStats *stats, QObject *parent = nullptr);
+
+    QHash<int, QByteArray> roleNames() const override;
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+    int dimension() const;
+    void setDimension(int dimension);
+    int sortColumn() const;
+    void setSortColumn(int column);
+    int rowLimit() const;
+    void setRowLimit(int limit);
+    bool isActive() const;
+    void setActive(bool active);
+    int peerCount() const;
+
+public Q_SLOTS:
+    void refresh();
+
+Q_SIGNALS:
+    void dimensionChanged();
+    void sortColumnChanged();
+    void rowLimitChanged();
+    void activeChanged();
+    void refreshed();
+
+private:
+    PeerStats *m_stats = nullptr;
+    PeerStats::Dimension m_dimension = PeerStats::ByProcess;
+    int m_sortColumn = CallsReceivedColumn;
+    int m_rowLimit = 200;
+    QVector<PeerStats::Entry> m_entries;
+    int m_peerCount = 0;
+    QTimer m_timer;
+};
+
+#endif // PEERSTATSMODEL_H
@@ -0,0 +1,424 @@
+#include <algorithm>
+#include <cmath>
+#include <string.h>
+#include <QMouseEvent>
+#include <QSGGeometryNode>
+#include <QSGVertexColorMaterial>
+#include <QtMath>
+#include <QWheelEvent>
+
+#include "timelineitem.h"
+
+
+// zoom limits: from 10 us to 1 hour per pixel
+static const double MIN_MS_PER_PIXEL = 0.01;
+static const double MAX_MS_PER_PIXEL = 3600.0 * 1000;
+// share of width left empty after the newest message when following tail
+static const double TAIL_MARGIN = 0.05;
+
+typedef QSGGeometry::ColoredPoint2D Vertex;
+
+
+namespace {
+
+struct Rgb {
+    uchar r, g, b;
+};
+
+const Rgb COLOR_CALL   = {0x1f, 0x5f, 0xbf};
+const Rgb COLOR_RETURN = {0x2e, 0x8b, 0x57};
+const Rgb COLOR_ERROR  = {0xd0, 0x20, 0x20};
+const Rgb COLOR_SIGNAL = {0xe0, 0x80, 0x00};
+const Rgb COLOR_LANE   = {0xe0, 0xe0, 0xe0};
+// density bands go from light to dark as count grows
+const Rgb COLOR_BAND_LOW  = {0xc6, 0xdb, 0xef};
+const Rgb COLOR_BAND_HIGH = {0x08, 0x30, 0x6b};
+
+Rgb typeColor(int type)
+{
+    switch (type) {
+    case DBusMessagesModel::MethodCallKind:   return COLOR_CALL;
+    case DBusMessagesModel::MethodReturnKind: return COLOR_RETURN;
+    case DBusMessagesModel::ErrorKind:        return COLOR_ERROR;
+    default:                                  return COLOR_SIGNAL;
+    }
+}
+
+Rgb mix(const Rgb &a, const Rgb &b, double t)
+{
+    return Rgb{static_cast<uchar>(a.r + (b.r - a.r) * t),
+               static_cast<uchar>(a.g + (b.g - a.g) * t),
+               static_cast<uchar>(a.b + (b.b - a.b) * t)};
+}
+
+void addVertex(QVector<Vertex> &out, float x, float y, const Rgb &c)
+{
+    Vertex v;
+    v.set(x, y, c.r, c.g, c.b, 255);
+    out.append(v);
+}
+
+void addRect(QVector<Vertex> &out, float x0, float y0, float x1, float y1, const Rgb &c)
+{
+    addVertex(out, x0, y0, c);
+    addVertex(out, x1, y0, c);
+    addVertex(out, x0, y1, c);
+    addVertex(out, x1, y0, c);
+    addVertex(out, x1, y1, c);
+    addVertex(out, x0, y1, c);
+}
+
+// vertical arrow from y0 to y1 at x
+void addArrow(QVector<Vertex> &out, float x, float y0, float y1, const Rgb &c)
+{
+    const float dir = (y1 > y0) ? 1.0f : -1.0f;
+    addRect(out, x - 0.5f, qMin(y0, y1), x + 0.5f, qMax(y0, y1), c);
+    addVertex(out, x, y1, c);
+    addVertex(out, x - 3, y1 - 6 * dir, c);
+    addVertex(out, x + 3, y1 - 6 * dir, c);
+}
+
+} // namespace
+
+
+TimelineItem::TimelineItem(QQuickItem *parent)
+    : QQuickItem(parent)
+{
+    setFlag(ItemHasContents, true);
+    setAcceptedMouseButtons(Qt::LeftButton);
+}
+
+QObject *TimelineItem::source() const
+{
+    return m_source;
+}
+
+void TimelineItem::setSource(QObject *source)
+{
+    DBusMessagesModel *model = qobject_cast<DBusMessagesModel *>(source);
+    if (model == m_source) {
+        return;
+    }
+    if (m_source) {
+        disconnect(m_source, nullptr, this, nullptr);
+    }
+    m_source = model;
+    if (m_source) {
+        connect(m_source, &QAbstractItemModel::rowsInserted, this, &TimelineItem::onRowsInserted);
+        connect(m_source, &QAbstractItemModel::modelReset, this, &TimelineItem::rebuild);
+    }
+    rebuild();
+    Q_EMIT sourceChanged();
+}
+
+qreal TimelineItem::laneHeight() const { return m_laneHeight; }
+
+void TimelineItem::setLaneHeight(qreal height)
+{
+    if (height <= 0 || qFuzzyCompare(height, m_laneHeight)) {
+        return;
+    }
+    m_laneHeight = height;
+    Q_EMIT laneHeightChanged();
+    viewUpdated();
+}
+
+qreal TimelineItem::laneScroll() const { return m_laneScroll; }
+QStringList TimelineItem::laneNames() const { return m_laneNames; }
+bool TimelineItem::followTail() const { return m_followTail; }
+
+void TimelineItem::setFollowTail(bool follow)
+{
+    if (follow == m_followTail) {
+        return;
+    }
+    m_followTail = follow;
+    Q_EMIT followTailChanged();
+    if (m_followTail) {
+        scrollToTail();
+        viewUpdated();
+    }
+}
+
+QDateTime TimelineItem::viewStart() const
+{
+    return QDateTime::fromMSecsSinceEpoch(static_cast<qint64>(m_viewStart));
+}
+
+QDateTime TimelineItem::viewEnd() const
+{
+    return QDateTime::fromMSecsSinceEpoch(static_cast<qint64>(m_viewStart + width() * m_msPerPixel));
+}
+
+int TimelineItem::visibleMessages() const
+{
+    size_t first = 0;
+    size_t last = 0;
+    visibleRange(&first, &last);
+    return static_cast<int>(last - first);
+}
+
+bool TimelineItem::isDetailed() const
+{
+    return visibleMessages() <= MaxDetailedMessages;
+}
+
+void TimelineItem::zoom(qreal factor, qreal x)
+{
+    if (factor <= 0) {
+        return;
+    }
+    const double anchor = m_viewStart + x * m_msPerPixel;
+    m_msPerPixel = qBound(MIN_MS_PER_PIXEL, m_msPerPixel * factor, MAX_MS_PER_PIXEL);
+    m_viewStart = anchor - x * m_msPerPixel;
+    if (m_followTail) {
+        scrollToTail();
+    }
+    viewUpdated();
+}
+
+void TimelineItem::fitAll()
+{
+    if (m_events.empty()) {
+        return;
+    }
+    const double span = m_events.back().time - m_events.front().time;
+    m_msPerPixel = qBound(MIN_MS_PER_PIXEL, span / qMax<qreal>(1, width() * (1 - TAIL_MARGIN)), MAX_MS_PER_PIXEL);
+    m_viewStart = m_events.front().time;
+    setFollowTail(false);
+    viewUpdated();
+}
+
+QSGNode *TimelineItem::updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *data)
+{
+    Q_UNUSED(data)
+    QSGGeometryNode *node = static_cast<QSGGeometryNode *>(oldNode);
+    if (!node) {
+        node = new QSGGeometryNode;
+        QSGGeometry *geometry = new QSGGeometry(QSGGeometry::defaultAttributes_ColoredPoint2D(), 0);
+        geometry->setDrawingMode(QSGGeometry::DrawTriangles);
+        node->setGeometry(geometry);
+        node->setFlag(QSGNode::OwnsGeometry);
+        node->setMaterial(new QSGVertexColorMaterial);
+        node->setFlag(QSGNode::OwnsMaterial);
+        m_geometryDirty = true;
+    }
+    if (!m_geometryDirty) {
+        return node;
+    }
+    m_geometryDirty = false;
+
+    const float w = static_cast<float>(width());
+    const float h = static_cast<float>(height());
+    const float lh = static_cast<float>(m_laneHeight);
+    const int laneFirst = qMax(0, static_cast<int>(m_laneScroll / m_laneHeight));
+    const int laneLast = qMin(m_laneNames.size(), static_cast<int>((m_laneScroll + height()) / m_laneHeight) + 1);
+    const auto laneY = [this, lh] (int lane) {
+        return lane * lh + lh / 2 - static_cast<float>(m_laneScroll);
+    };
+
+    QVector<Vertex> vertices;
+    for (int lane = laneFirst; lane < laneLast; lane++) {
+        const float y = (lane + 1) * lh - static_cast<float>(m_laneScroll);
+        addRect(vertices, 0, y - 1, w, y, COLOR_LANE);
+    }
+
+    size_t first = 0;
+    size_t last = 0;
+    visibleRange(&first, &last);
+
+    if (last - first <= static_cast<size_t>(MaxDetailedMessages)) {
+        vertices.reserve(vertices.size() + static_cast<int>(last - first) * 9);
+        for (size_t i = first; i < last; i++) {
+            const Event &e = m_events[i];
+            const float x = static_cast<float>((e.time - m_viewStart) / m_msPerPixel);
+            const Rgb color = typeColor(e.type);
+            const float y0 = laneY(e.from);
+            if (e.to < 0 || e.to == e.from || e.type == DBusMessagesModel::SignalKind) {
+                if (e.from >= laneFirst && e.from < laneLast) {
+                    addRect(vertices, x - 0.5f, y0 - lh * 0.3f, x + 0.5f, y0 + lh * 0.3f, color);
+                }
+                continue;
+            }
+            const float y1 = laneY(e.to);
+            if (qMax(y0, y1) < 0 || qMin(y0, y1) > h) {
+                continue;
+            }
+            addArrow(vertices, x, y0, y1, color);
+        }
+    } else {
+        // activity of both endpoints is counted, per lane and bucket
+        const int lanes = laneLast - laneFirst;
+        const int columns = qMax(1, static_cast<int>(std::ceil(w / BandWidth)));
+        std::vector<quint32> counts(static_cast<size_t>(qMax(0, lanes) * columns), 0);
+        const double msPerColumn = m_msPerPixel * BandWidth;
+        for (size_t i = first; i < last; i++) {
+            const Event &e = m_events[i];
+            const int column = qBound(0, static_cast<int>((e.time - m_viewStart) / msPerColumn), columns - 1);
+            if (e.from >= laneFirst && e.from < laneLast) {
+                counts[static_cast<size_t>((e.from - laneFirst) * columns + column)]++;
+            }
+            if (e.to >= laneFirst && e.to < laneLast && e.to != e.from) {
+                counts[static_cast<size_t>((e.to - laneFirst) * columns + column)]++;
+            }
+        }
+        const quint32 maxCount = counts.empty() ? 0 : *std::max_element(counts.begin(), counts.end());
+        const double scale = (maxCount > 0) ? 1.0 / std::log1p(static_cast<double>(maxCount)) : 0;
+        for (int lane = 0; lane < lanes; lane++) {
+            const float y = laneY(laneFirst + lane);
+            for (int column = 0; column < columns; column++) {
+                const quint32 count = counts[static_cast<size_t>(lane * columns + column)];
+                if (count == 0) {
+                    continue;
+                }
+                const Rgb color = mix(COLOR_BAND_LOW, COLOR_BAND_HIGH, std::log1p(static_cast<double>(count)) * scale);
+                const float x = static_cast<float>(column * BandWidth);
+                addRect(vertices, x, y - lh * 0.3f, x + BandWidth, y + lh * 0.3f, color);
+            }
+        }
+    }
+
+    QSGGeometry *geometry = node->geometry();
+    geometry->allocate(vertices.size());
+    if (!vertices.isEmpty()) {
+        memcpy(geometry->vertexDataAsColoredPoint2D(), vertices.constData(),
+               static_cast<size_t>(vertices.size()) * sizeof(Vertex));
+    }
+    node->markDirty(QSGNode::DirtyGeometry);
+    return node;
+}
+
+void TimelineItem::geometryChanged(const QRectF &newGeometry, const QRectF &oldGeometry)
+{
+    QQuickItem::geometryChanged(newGeometry, oldGeometry);
+    if (m_followTail) {
+        scrollToTail();
+    }
+    viewUpdated();
+}
+
+void TimelineItem::mousePressEvent(QMouseEvent *event)
+{
+    m_lastMousePos = event->localPos();
+    event->accept();
+}
+
+void TimelineItem::mouseMoveEvent(QMouseEvent *event)
+{
+    const QPointF delta = event->localPos() - m_lastMousePos;
+    m_lastMousePos = event->localPos();
+    if (!qFuzzyIsNull(delta.x())) {
+        setFollowTail(false);
+        m_viewStart -= delta.x() * m_msPerPixel;
+    }
+    const qreal maxScroll = qMax<qreal>(0, m_laneNames.size() * m_laneHeight - height());
+    m_laneScroll = qBound<qreal>(0, m_laneScroll - delta.y(), maxScroll);
+    viewUpdated();
+    event->accept();
+}
+
+void TimelineItem::wheelEvent(QWheelEvent *event)
+{
+    // one wheel notch (120) zooms by 2^(1/4)
+    zoom(qPow(2.0, -event->angleDelta().y() / 480.0), event->posF().x());
+    event->accept();
+}
+
+void TimelineItem::onRowsInserted(const QModelIndex &parent, int first, int last)
+{
+    Q_UNUSED(parent)
+    appendRows(first, last);
+    if (m_followTail) {
+        scrollToTail();
+    }
+    viewUpdated();
+}
+
+void TimelineItem::rebuild()
+{
+    m_events.clear();
+    m_laneIndex.clear();
+    m_laneNames.clear();
+    m_laneScroll = 0;
+    if (m_source && m_source->rowCount() > 0) {
+        appendRows(0, m_source->rowCount() - 1);
+    }
+    Q_EMIT lanesChanged();
+    if (m_followTail) {
+        scrollToTail();
+    }
+    viewUpdated();
+}
+
+int TimelineItem::laneFor(const QString &address, const QStringList &names)
+{
+    if (address.isEmpty()) {
+        return -1;
+    }
+    const auto it = m_laneIndex.constFind(address);
+    if (it != m_laneIndex.constEnd()) {
+        return it.value();
+    }
+    const int lane = m_laneNames.size();
+    m_laneIndex.insert(address, lane);
+    m_laneNames.append(names.isEmpty() ? address : names.first() + QLatin1String(" (") + address + QLatin1Char(')'));
+    return lane;
+}
+
+void TimelineItem::appendRows(int first, int last)
+{
+    if (!m_source) {
+        return;
+    }
+    const int lanesBefore = m_laneNames.size();
+    const MessageStore &store = m_source->store();
+    m_events.reserve(m_events.size() + static_cast<size_t>(last - first + 1));
+    for (int row = first; row <= last; row++) {
+        const DBusMessageObject &dmsg = store.at(row);
+        if (dmsg.isGap()) {
+            continue;
+        }
+        Event e;
+        e.time = dmsg.timestamp.toMSecsSinceEpoch();
+        e.from = laneFor(dmsg.senderAddress, dmsg.senderNames);
+        e.to = laneFor(dmsg.destinationAddress, dmsg.destinationNames);
+        e.type = dmsg.type;
+        if (e.from < 0) {
+            if (e.to < 0) {
+                continue;
+            }
+            std::swap(e.from, e.to);
+        }
+        m_events.push_back(e);
+    }
+    if (m_laneNames.size() != lanesBefore) {
+        Q_EMIT lanesChanged();
+    }
+}
+
+void TimelineItem::scrollToTail()
+{
+    if (m_events.empty()) {
+        return;
+    }
+    m_viewStart = m_events.back().time - width() * m_msPerPixel * (1 - TAIL_MARGIN);
+}
+
+void TimelineItem::viewUpdated()
+{
+    m_geometryDirty = true;
+    update();
+    Q_EMIT viewChanged();
+}
+
+void TimelineItem::visibleRange(size_t *first, size_t *last) const
+{
+    // merger keeps timestamps ordered, so events are sorted by time
+    const double viewEnd = m_viewStart + width() * m_msPerPixel;
+    const auto begin = std::lower_bound(m_events.begin(), m_events.end(), m_viewStart,
+                                        [] (const Event &e, double t) { return e.time < t; });
+    const auto end = std::upper_bound(begin, m_events.end(), viewEnd,
+                                      [] (double t, const Event &e) { return t < e.time; });
+    *first = static_cast<size_t>(begin - m_events.begin());
+    *last = static_cast<size_t>(end - m_events.begin());
+}
@@ -0,0 +1,116 @@
+#ifndef TIMELINEITEM_H
+#define TIMELINEITEM_H
+
+#include <vector>
+#include <QDateTime>
+#include <QHash>
+#include <QPointer>
+#include <QQuickItem>
+#include <QStringList>
+
+#include "dbusmessagesmodel.h"
+
+
+/**
+ * Sequence diagram of captured messages over time, drawn straight into
+ * the scene graph.
+ *
+ * Every connection (unique bus address) gets a horizontal lane, time goes
+ * from left to right. Method calls, replies and errors are vertical arrows
+ * from sender lane to destination lane, signals are ticks on sender lane.
+ * When more than MaxDetailedMessages are visible, messages are instead
+ * counted into BandWidth pixels wide buckets per lane and drawn as density
+ * bands, brighter for more messages. Either way the whole picture is one
+ * vertex-colored geometry node, rebuilt only when data or view changes.
+ *
+ * Events are indexed incrementally from source model rowsInserted(), one
+ * small record per message, so that a million of them fit in a few
+ * megabytes and the visible range is found by binary search.
+ * Drag pans, wheel zooms around the cursor.
+ */
+class TimelineItem: public QQuickItem
+{
+    Q_OBJECT
+    Q_PROPERTY(QObject *source READ source WRITE setSource NOTIFY sourceChanged)
+    Q_PROPERTY(qreal laneHeight READ laneHeight WRITE setLaneHeight NOTIFY laneHeightChanged)
+    Q_PROPERTY(qreal laneScroll READ laneScroll NOTIFY viewChanged)
+    Q_PROPERTY(QStringList laneNames READ laneNames NOTIFY lanesChanged)
+    Q_PROPERTY(bool followTail READ followTail WRITE setFollowTail NOTIFY followTailChanged)
+    Q_PROPERTY(QDateTime viewStart READ viewStart NOTIFY viewChanged)
+    Q_PROPERTY(QDateTime viewEnd READ viewEnd NOTIFY viewChanged)
+    Q_PROPERTY(int visibleMessages READ visibleMessages NOTIFY viewChanged)
+    Q_PROPERTY(bool detailed READ isDetailed NOTIFY viewChanged)
+
+public:
+    static const int MaxDetailedMessages = 20000;
+    static const int BandWidth = 2;
+
+public:
+    explicit TimelineItem(QQuickItem *parent = nullptr);
+
+    QObject *source() const;
+    void setSource(QObject *source);
+    qreal laneHeight() const;
+    void setLaneHeight(qreal height);
+    qreal laneScroll() const;
+    QStringList laneNames() const;
+    bool followTail() const;
+    void setFollowTail(bool follow);
+    QDateTime viewStart() const;
+    QDateTime viewEnd() const;
+    int visibleMessages() const;
+    bool isDetailed() const;
+
+public Q_SLOTS:
+    // factor > 1 zooms out, x is the point that stays in place
+    void zoom(qreal factor, qreal x);
+    void fitAll();
+
+Q_SIGNALS:
+    void sourceChanged();
+    void laneHeightChanged();
+    void lanesChanged();
+    void followTailChanged();
+    void viewChanged();
+
+protected:
+    QSGNode *updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *data) override;
+    void geometryChanged(const QRectF &newGeometry, const QRectF &oldGeometry) override;
+    void mousePressEvent(QMouseEvent *event) override;
+    void mouseMoveEvent(QMouseEvent *event) override;
+    void wheelEvent(QWheelEvent *event) override;
+
+private Q_SLOTS:
+    void onRowsInserted(const QModelIndex &parent, int first, int last);
+    void rebuild();
+
+private:
+    struct Event {
+        qint64 time;   // ms since epoch
+        qint32 from;   // lane
+        qint32 to;     // lane, -1 for broadcast signals
+        qint32 type;
+    };
+
+    int laneFor(const QString &address, const QStringList &names);
+    void appendRows(int first, int last);
+    void scrollToTail();
+    void viewUpdated();
+    // [first, last) of m_events inside the view
+    void visibleRange(size_t *first, size_t *last) const;
+
+private:
+    QPointer<DBusMessagesModel> m_source;
+    std::vector<Event> m_events;
+    QHash<QString, int> m_laneIndex;
+    QStringList m_laneNames;
+    qreal m_laneHeight = 24;
+    qreal m_laneScroll = 0;
+    double m_viewStart = 0;     // ms since epoch
+    double m_msPerPixel = 10;
+    bool m_followTail = true;
+    bool m_geometryDirty = true;
+    QPointF m_lastMousePos;
+};
+
+#endif // TIMELINEITEM_H
@@ -0,0 +1,348 @@
+#include <algorithm>
+#include <cmath>
+#include <string.h>
+#include <QFileInfo>
+#include <QHash>
+#include <QMouseEvent>
+#include <QSGGeometryNode>
+#include <QSGVertexColorMaterial>
+#include <QtMath>
+
+#include "topologygraphitem.h"
+
+
+// half size of a node square, and how close a click has to be to pick it
+static const float NODE_RADIUS = 4.0f;
+static const qreal PICK_DISTANCE = 12;
+
+typedef QSGGeometry::ColoredPoint2D Vertex;
+
+
+namespace {
+
+struct Rgb {
+    uchar r, g, b;
+};
+
+const Rgb COLOR_NODE       = {0x30, 0x30, 0x30};
+const Rgb COLOR_SELECTED   = {0xe0, 0x80, 0x00};
+const Rgb COLOR_DEPENDENCY = {0xe0, 0x80, 0x00};
+const Rgb COLOR_DEPENDENT  = {0x2e, 0x8b, 0x57};
+// edges fade from new to old as they approach idle timeout
+const Rgb COLOR_EDGE_NEW   = {0x1f, 0x5f, 0xbf};
+const Rgb COLOR_EDGE_OLD   = {0xe0, 0xe0, 0xe0};
+
+Rgb mix(const Rgb &a, const Rgb &b, double t)
+{
+    return Rgb{static_cast<uchar>(a.r + (b.r - a.r) * t),
+               static_cast<uchar>(a.g + (b.g - a.g) * t),
+               static_cast<uchar>(a.b + (b.b - a.b) * t)};
+}
+
+void addVertex(QVector<Vertex> &out, const QPointF &p, const Rgb &c)
+{
+    Vertex v;
+    v.set(static_cast<float>(p.x()), static_cast<float>(p.y()), c.r, c.g, c.b, 255);
+    out.append(v);
+}
+
+void addSquare(QVector<Vertex> &out, const QPointF &center, float half, const Rgb &c)
+{
+    const QPointF dx(half, 0);
+    const QPointF dy(0, half);
+    addVertex(out, center - dx - dy, c);
+    addVertex(out, center + dx - dy, c);
+    addVertex(out, center - dx + dy, c);
+    addVertex(out, center + dx - dy, c);
+    addVertex(out, center + dx + dy, c);
+    addVertex(out, center - dx + dy, c);
+}
+
+// arrow from p0 to p1 with head at p1
+void addArrow(QVector<Vertex> &out, const QPointF &p0, const QPointF &p1, qreal thickness, const Rgb &c)
+{
+    const QPointF d = p1 - p0;
+    const qreal length = std::hypot(d.x(), d.y());
+    if (length < 1) {
+        return;
+    }
+    const QPointF dir = d / length;
+    const QPointF normal(-dir.y(), dir.x());
+    const qreal headLength = qMin<qreal>(8, length / 2);
+    const QPointF shaftEnd = p1 - dir * headLength;
+    const QPointF side = normal * (thickness / 2);
+    addVertex(out, p0 - side, c);
+    addVertex(out, p0 + side, c);
+    addVertex(out, shaftEnd - side, c);
+    addVertex(out, p0 + side, c);
+    addVertex(out, shaftEnd + side, c);
+    addVertex(out, shaftEnd - side, c);
+    const QPointF headSide = normal * (thickness / 2 + 3);
+    addVertex(out, p1, c);
+    addVertex(out, shaftEnd - headSide, c);
+    addVertex(out, shaftEnd + headSide, c);
+}
+
+QString nodeLabel(const BusTopology::Node &node)
+{
+    QString label = node.names.isEmpty() ? node.address : node.names.first();
+    if (!node.exe.isEmpty()) {
+        label += QLatin1String(" [") + QFileInfo(node.exe).fileName() + QLatin1Char(']');
+    }
+    return label;
+}
+
+} // namespace
+
+
+TopologyGraphItem::TopologyGraphItem(QQuickItem *parent)
+    : QQuickItem(parent)
+{
+    setFlag(ItemHasContents, true);
+    setAcceptedMouseButtons(Qt::LeftButton);
+}
+
+QObject *TopologyGraphItem::source() const
+{
+    return m_source;
+}
+
+void TopologyGraphItem::setSource(QObject *source)
+{
+    BusTopologyModel *model = qobject_cast<BusTopologyModel *>(source);
+    if (model == m_source) {
+        return;
+    }
+    if (m_source) {
+        disconnect(m_source, nullptr, this, nullptr);
+    }
+    m_source = model;
+    if (m_source) {
+        connect(m_source, &BusTopologyModel::refreshed, this, &TopologyGraphItem::rebuild);
+    }
+    rebuild();
+    Q_EMIT sourceChanged();
+}
+
+int TopologyGraphItem::maxNodes() const { return m_maxNodes; }
+
+void TopologyGraphItem::setMaxNodes(int count)
+{
+    if (count < 1 || count == m_maxNodes) {
+        return;
+    }
+    m_maxNodes = count;
+    Q_EMIT maxNodesChanged();
+    rebuild();
+}
+
+QVariantList TopologyGraphItem::labels() const { return m_labels; }
+
+QString TopologyGraphItem::selectedNode() const { return m_selectedNode; }
+
+void TopologyGraphItem::setSelectedNode(const QString &address)
+{
+    if (address == m_selectedNode) {
+        return;
+    }
+    m_selectedNode = address;
+    Q_EMIT selectedNodeChanged();
+    updateDependencies();
+    m_geometryDirty = true;
+    update();
+}
+
+QStringList TopologyGraphItem::selectedDependencies() const { return m_selectedDependencies; }
+
+QSGNode *TopologyGraphItem::updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *data)
+{
+    Q_UNUSED(data)
+    QSGGeometryNode *node = static_cast<QSGGeometryNode *>(oldNode);
+    if (!node) {
+        node = new QSGGeometryNode;
+        QSGGeometry *geometry = new QSGGeometry(QSGGeometry::defaultAttributes_ColoredPoint2D(), 0);
+        geometry->setDrawingMode(QSGGeometry::DrawTriangles);
+        node->setGeometry(geometry);
+        node->setFlag(QSGNode::OwnsGeometry);
+        node->setMaterial(new QSGVertexColorMaterial);
+        node->setFlag(QSGNode::OwnsMaterial);
+        m_geometryDirty = true;
+    }
+    if (!m_geometryDirty) {
+        return node;
+    }
+    m_geometryDirty = false;
+
+    const qint64 now = m_source ? m_source->lastSeen() : 0;
+    const double idleTimeout = m_source ? m_source->topology()->idleTimeoutMs() : 1;
+    const int selected = [this] () -> int {
+        for (int i = 0; i < m_nodes.size(); i++) {
+            if (m_nodes.at(i).address == m_selectedNode) {
+                return i;
+            }
+        }
+        return -1;
+    }();
+
+    QVector<Vertex> vertices;
+    vertices.reserve(m_edges.size() * 9 + m_nodes.size() * 6);
+    // faded edges first, so that colored ones stay on top
+    for (int pass = 0; pass < 2; pass++) {
+        for (const GraphEdge &edge: m_edges) {
+            const bool related = (edge.from == selected || edge.to == selected);
+            if (related != (pass == 1)) {
+                continue;
+            }
+            Rgb color;
+            if (edge.from == selected) {
+                color = COLOR_DEPENDENCY;
+            } else if (edge.to == selected) {
+                color = COLOR_DEPENDENT;
+            } else {
+                const double age = qBound(0.0, (now - edge.lastSeen) / idleTimeout, 1.0);
+                // with a selection, unrelated edges step back
+                color = mix(COLOR_EDGE_NEW, COLOR_EDGE_OLD, (selected >= 0) ? qMax(age, 0.8) : age);
+            }
+            const QPointF p0 = m_nodes.at(edge.from).pos;
+            const QPointF p1 = m_nodes.at(edge.to).pos;
+            const QPointF d = p1 - p0;
+            const qreal length = std::hypot(d.x(), d.y());
+            if (length <= 2 * NODE_RADIUS) {
+                continue;
+            }
+            // stop at node border
+            const QPointF inset = d / length * (NODE_RADIUS + 1);
+            addArrow(vertices, p0 + inset, p1 - inset, 1 + std::log10(1 + edge.messages), color);
+        }
+    }
+    for (int i = 0; i < m_nodes.size(); i++) {
+        addSquare(vertices, m_nodes.at(i).pos, (i == selected) ? NODE_RADIUS * 1.5f : NODE_RADIUS,
+                  (i == selected) ? COLOR_SELECTED : COLOR_NODE);
+    }
+
+    QSGGeometry *geometry = node->geometry();
+    geometry->allocate(vertices.size());
+    if (!vertices.isEmpty()) {
+        memcpy(geometry->vertexDataAsColoredPoint2D(), vertices.constData(),
+               static_cast<size_t>(vertices.size()) * sizeof(Vertex));
+    }
+    node->markDirty(QSGNode::DirtyGeometry);
+    return node;
+}
+
+void TopologyGraphItem::geometryChanged(const QRectF &newGeometry, const QRectF &oldGeometry)
+{
+    QQuickItem::geometryChanged(newGeometry, oldGeometry);
+    layout();
+}
+
+void TopologyGraphItem::mousePressEvent(QMouseEvent *event)
+{
+    QString picked;
+    qreal best = PICK_DISTANCE * PICK_DISTANCE;
+    for (const GraphNode &node: m_nodes) {
+        const QPointF d = node.pos - event->localPos();
+        const qreal distance = QPointF::dotProduct(d, d);
+        if (distance <= best) {
+            best = distance;
+            picked = node.address;
+        }
+    }
+    setSelectedNode(picked);
+    event->accept();
+}
+
+void TopologyGraphItem::rebuild()
+{
+    m_nodes.clear();
+    m_edges.clear();
+    if (m_source) {
+        // busiest connections, then by name so that positions are stable
+        QVector<BusTopology::Node> nodes = m_source->nodes();
+        const int count = qMin(m_maxNodes, nodes.size());
+        std::partial_sort(nodes.begin(), nodes.begin() + count, nodes.end(),
+                          [] (const BusTopology::Node &a, const BusTopology::Node &b) {
+            return a.messagesSent + a.messagesReceived > b.messagesSent + b.messagesReceived;
+        });
+        nodes.resize(count);
+        QHash<QString, int> index;
+        m_nodes.reserve(count);
+        for (const BusTopology::Node &node: nodes) {
+            m_nodes.append(GraphNode{node.address, nodeLabel(node), QPointF()});
+        }
+        std::sort(m_nodes.begin(), m_nodes.end(), [] (const GraphNode &a, const GraphNode &b) {
+            return a.label < b.label;
+        });
+        for (int i = 0; i < m_nodes.size(); i++) {
+            index.insert(m_nodes.at(i).address, i);
+        }
+
+        // one edge per direction, interfaces merged
+        QHash<QPair<int, int>, int> edgeIndex;
+        for (const BusTopology::Edge &edge: m_source->edges()) {
+            const int from = index.value(edge.from, -1);
+            const int to = index.value(edge.to, -1);
+            if (from < 0 || to < 0 || from == to) {
+                continue;
+            }
+            const QPair<int, int> key(from, to);
+            const auto it = edgeIndex.constFind(key);
+            if (it == edgeIndex.constEnd()) {
+                edgeIndex.insert(key, m_edges.size());
+                m_edges.append(GraphEdge{from, to, edge.messages, edge.lastSeen});
+            } else {
+                GraphEdge &merged = m_edges[it.value()];
+                merged.messages += edge.messages;
+                merged.lastSeen = qMax(merged.lastSeen, edge.lastSeen);
+            }
+        }
+    }
+    updateDependencies();
+    layout();
+}
+
+void TopologyGraphItem::layout()
+{
+    const QPointF center(width() / 2, height() / 2);
+    const qreal radius = qMax<qreal>(20, qMin(width() / 2 - LabelMargin, height() / 2 - 10));
+    m_labels.clear();
+    for (int i = 0; i < m_nodes.size(); i++) {
+        const qreal angle = 2 * M_PI * i / m_nodes.size() - M_PI / 2;
+        GraphNode &node = m_nodes[i];
+        node.pos = center + QPointF(std::cos(angle), std::sin(angle)) * radius;
+        QVariantMap label;
+        label.insert(QStringLiteral("text"), node.label);
+        label.insert(QStringLiteral("x"), node.pos.x());
+        label.insert(QStringLiteral("y"), node.pos.y());
+        label.insert(QStringLiteral("left"), node.pos.x() < center.x());
+        m_labels.append(label);
+    }
+    Q_EMIT labelsChanged();
+    m_geometryDirty = true;
+    update();
+}
+
+void TopologyGraphItem::updateDependencies()
+{
+    QStringList dependencies;
+    if (m_source && !m_selectedNode.isEmpty()) {
+        QHash<QString, QString> labels;
+        for (const BusTopology::Node &node: m_source->nodes()) {
+            labels.insert(node.address, nodeLabel(node));
+        }
+        QVector<BusTopology::Edge> edges = m_source->topology()->edgesFrom(m_selectedNode);
+        std::sort(edges.begin(), edges.end(), [] (const BusTopology::Edge &a, const BusTopology::Edge &b) {
+            return a.messages > b.messages;
+        });
+        for (const BusTopology::Edge &edge: edges) {
+            const QString to = edge.to.isEmpty() ? tr("(broadcast)") : labels.value(edge.to, edge.to);
+            dependencies.append(QStringLiteral("%1 %2: %3")
+                                .arg(qRound64(edge.messages)).arg(to)
+                                .arg(edge.interface.isEmpty() ? tr("(no interface)") : edge.interface));
+        }
+    }
+    if (dependencies != m_selectedDependencies) {
+        m_selectedDependencies = dependencies;
+        Q_EMIT selectedDependenciesChanged();
+    }
+}
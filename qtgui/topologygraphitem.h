@@ -0,0 +1,96 @@
+#ifndef TOPOLOGYGRAPHITEM_H
+#define TOPOLOGYGRAPHITEM_H
+
+#include <QPointer>
+#include <QQuickItem>
+#include <QStringList>
+#include <QVariantList>
+#include <QVector>
+
+#include "bustopologymodel.h"
+
+
+/**
+ * Who-talks-to-whom graph of the busiest connections, drawn straight
+ * into the scene graph like TimelineItem.
+ *
+ * Up to maxNodes connections with most traffic are placed on a circle,
+ * edges between them (all interfaces merged) are arrows from caller to
+ * callee, thicker for more messages and fading as they approach the
+ * BusTopology idle timeout. Broadcast signals have no edge. Clicking a
+ * connection selects it: its outgoing edges (what it depends on) and
+ * incoming ones are colored, and selectedDependencies lists the former
+ * per interface. Node names are exposed as labels for QML Text items.
+ * Everything is rebuilt on source refresh, which is O(nodes + edges).
+ */
+class TopologyGraphItem: public QQuickItem
+{
+    Q_OBJECT
+    Q_PROPERTY(QObject *source READ source WRITE setSource NOTIFY sourceChanged)
+    Q_PROPERTY(int maxNodes READ maxNodes WRITE setMaxNodes NOTIFY maxNodesChanged)
+    // list of {text, x, y, left}: label for node at x, y; left ones go left of it
+    Q_PROPERTY(QVariantList labels READ labels NOTIFY labelsChanged)
+    Q_PROPERTY(QString selectedNode READ selectedNode WRITE setSelectedNode NOTIFY selectedNodeChanged)
+    Q_PROPERTY(QStringList selectedDependencies READ selectedDependencies NOTIFY selectedDependenciesChanged)
+
+public:
+    static const int DefaultMaxNodes = 48;
+    // room left around the circle for labels
+    static const int LabelMargin = 160;
+
+public:
+    explicit TopologyGraphItem(QQuickItem *parent = nullptr);
+
+    QObject *source() const;
+    void setSource(QObject *source);
+    int maxNodes() const;
+    void setMaxNodes(int count);
+    QVariantList labels() const;
+    QString selectedNode() const;
+    void setSelectedNode(const QString &address);
+    QStringList selectedDependencies() const;
+
+Q_SIGNALS:
+    void sourceChanged();
+    void maxNodesChanged();
+    void labelsChanged();
+    void selectedNodeChanged();
+    void selectedDependenciesChanged();
+
+protected:
+    QSGNode *updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *data) override;
+    void geometryChanged(const QRectF &newGeometry, const QRectF &oldGeometry) override;
+    void mousePressEvent(QMouseEvent *event) override;
+
+private Q_SLOTS:
+    void rebuild();
+
+private:
+    struct GraphNode {
+        QString address;
+        QString label;
+        QPointF pos;
+    };
+
+    struct GraphEdge {
+        int     from;
+        int     to;
+        double  messages;
+        qint64  lastSeen;   // ms since epoch
+    };
+
+    void layout();
+    void updateDependencies();
+
+private:
+    QPointer<BusTopologyModel> m_source;
+    int m_maxNodes = DefaultMaxNodes;
+    QVector<GraphNode> m_nodes;
+    QVector<GraphEdge> m_edges;
+    QVariantList m_labels;
+    QString m_selectedNode;
+    QStringList m_selectedDependencies;
+    bool m_geometryDirty = true;
+};
+
+#endif // TOPOLOGYGRAPHITEM_H
@@ -0,0 +1,125 @@
+#include <algorithm>
+#include "traffictopmodel.h"
+
+
+// refreshing more often only makes numbers flicker
+static const int REFRESH_INTERVAL_MS = 1000;
+
+
+TrafficTopModel::TrafficTopModel(TrafficTop *top, QObject *parent)
+    : QAbstractListModel(parent)
+    , m_top(top)
+{
+    m_timer.setInterval(REFRESH_INTERVAL_MS);
+    connect(&m_timer, &QTimer::timeout, this, &TrafficTopModel::refresh);
+}
+
+QHash<int, QByteArray> TrafficTopModel::roleNames() const
+{
+    static const QHash<int, QByteArray> r = {
+        {Key,              QByteArrayLiteral("key")},
+        {MessageRate,      QByteArrayLiteral("messageRate")},
+        {ByteRate,         QByteArrayLiteral("byteRate")},
+        {MessageRateError, QByteArrayLiteral("messageRateError")},
+    };
+    return r;
+}
+
+int TrafficTopModel::rowCount(const QModelIndex &parent) const
+{
+    Q_UNUSED(parent)
+    return m_entries.size();
+}
+
+QVariant TrafficTopModel::data(const QModelIndex &index, int role) const
+{
+    QVariant ret;
+    if (!index.isValid() || index.row() < 0 || index.row() >= m_entries.size()) {
+        return ret;
+    }
+    const TrafficTop::Entry &entry = m_entries.at(index.row());
+    switch (role) {
+    case Role::Key:              ret = entry.key;              break;
+    case Role::MessageRate:      ret = entry.messageRate;      break;
+    case Role::ByteRate:         ret = entry.byteRate;         break;
+    case Role::MessageRateError: ret = entry.messageRateError; break;
+    }
+    return ret;
+}
+
+int TrafficTopModel::dimension() const { return m_dimension; }
+
+void TrafficTopModel::setDimension(int dimension)
+{
+    if (dimension < 0 || dimension >= TrafficTop::DimensionCount || dimension == m_dimension) {
+        return;
+    }
+    m_dimension = static_cast<TrafficTop::Dimension>(dimension);
+    Q_EMIT dimensionChanged();
+    refresh();
+}
+
+int TrafficTopModel::sortColumn() const { return m_sortColumn; }
+
+void TrafficTopModel::setSortColumn(int column)
+{
+    if (column == m_sortColumn) {
+        return;
+    }
+    m_sortColumn = column;
+    Q_EMIT sortColumnChanged();
+    refresh();
+}
+
+int TrafficTopModel::rowLimit() const { return m_rowLimit; }
+
+void TrafficTopModel::setRowLimit(int limit)
+{
+    if (limit == m_rowLimit) {
+        return;
+    }
+    m_rowLimit = limit;
+    Q_EMIT rowLimitChanged();
+    refresh();
+}
+
+bool TrafficTopModel::isActive() const { return m_timer.isActive(); }
+
+void TrafficTopModel::setActive(bool active)
+{
+    if (active == m_timer.isActive()) {
+        return;
+    }
+    if (active) {
+        m_timer.start();
+        refresh();
+    } else {
+        m_timer.stop();
+    }
+    Q_EMIT activeChanged();
+}
+
+double TrafficTopModel::messageRate() const { return m_messageRate; }
+
+double TrafficTopModel::byteRate() const { return m_byteRate; }
+
+void TrafficTopModel::refresh()
+{
+    const TrafficTop::SortKey sortKey = (m_sortColumn == ByteRateColumn) ? TrafficTop::SortByBytes
+                                                                         : TrafficTop::SortByMessages;
+    QVector<TrafficTop::Entry> entries = m_top->top(m_dimension, m_rowLimit, sortKey);
+    if (m_sortColumn == KeyColumn) {
+        // top entries by messages, listed by name
+        std::sort(entries.begin(), entries.end(), [] (const TrafficTop::Entry &a, const TrafficTop::Entry &b) {
+            return a.key < b.key;
+        });
+    }
+    m_messageRate = m_top->messageRate();
+    m_byteRate = m_top->byteRate();
+
+    // few dozen rows, reset is cheaper than matching them up
+    beginResetModel();
+    m_entries.swap(entries);
+    endResetModel();
+    Q_EMIT refreshed();
+}
@@ -0,0 +1,80 @@
+#ifndef TRAFFICTOPMODEL_H
+#define TRAFFICTOPMODEL_H
+
+#include <QAbstractListModel>
+#include <QTimer>
+#include <QVector>
+
+#include "traffictop.h"
+
+
+/**
+ * Periodically refreshed snapshot of TrafficTop for one dimension,
+ * as a table: key, messages per second, bytes per second. Only the top
+ * rowLimit entries by the sort column are shown.
+ */
+class TrafficTopModel: public QAbstractListModel
+{
+    Q_OBJECT
+    Q_PROPERTY(int dimension READ dimension WRITE setDimension NOTIFY dimensionChanged)
+    Q_PROPERTY(int sortColumn READ sortColumn WRITE setSortColumn NOTIFY sortColumnChanged)
+    Q_PROPERTY(int rowLimit READ rowLimit WRITE setRowLimit NOTIFY rowLimitChanged)
+    Q_PROPERTY(bool active READ isActive WRITE setActive NOTIFY activeChanged)
+    Q_PROPERTY(double messageRate READ messageRate NOTIFY refreshed)
+    Q_PROPERTY(double byteRate READ byteRate NOTIFY refreshed)
+
+public:
+    enum Role {
+        Key = Qt::UserRole + 1,
+        MessageRate,
+        ByteRate,
+        MessageRateError,
+    };
+
+    enum Column {
+        KeyColumn,
+        MessageRateColumn,
+        ByteRateColumn,
+    };
+    Q_ENUM(Column)
+
+public:
+    explicit TrafficTopModel(TrafficTop *top, QObject *parent = nullptr);
+
+    QHash<int, QByteArray> roleNames() const override;
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+    int dimension() const;
+    void setDimension(int dimension);
+    int sortColumn() const;
+    void setSortColumn(int column);
+    int rowLimit() const;
+    void setRowLimit(int limit);
+    bool isActive() const;
+    void setActive(bool active);
+    double messageRate() const;
+    double byteRate() const;
+
+public Q_SLOTS:
+    void refresh();
+
+Q_SIGNALS:
+    void dimensionChanged();
+    void sortColumnChanged();
+    void rowLimitChanged();
+    void activeChanged();
+    void refreshed();
+
+private:
+    TrafficTop *m_top = nullptr;
+    TrafficTop::Dimension m_dimension = TrafficTop::ByMember;
+    int m_sortColumn = MessageRateColumn;
+    int m_rowLimit = 50;
+    QVector<TrafficTop::Entry> m_entries;
+    double m_messageRate = 0;
+    double m_byteRate = 0;
+    QTimer m_timer;
+};
+
+#endif // TRAFFICTOPMODEL_H
@@ -0,0 +1,103 @@
+#include "uiupdatescheduler.h"
+
+
+static const int STATS_INTERVAL_MS = 1000;
+
+
+UiUpdateScheduler::UiUpdateScheduler(QObject *parent)
+    : QObject(parent)
+    , m_pending(0)
+    , m_tickRequested(0)
+{
+    m_tickTimer.setSingleShot(true);
+    m_tickTimer.setTimerType(Qt::PreciseTimer);
+    connect(&m_tickTimer, &QTimer::timeout, this, &UiUpdateScheduler::tick);
+    m_statsTimer.setInterval(STATS_INTERVAL_MS);
+    connect(&m_statsTimer, &QTimer::timeout, this, &UiUpdateScheduler::publishStats);
+    m_clock.start();
+    m_statsTimer.start();
+}
+
+int UiUpdateScheduler::addTask(const Task &task)
+{
+    if (m_tasks.size() >= MaxTasks) {
+        return -1;
+    }
+    m_tasks.append(task);
+    return m_tasks.size() - 1;
+}
+
+void UiUpdateScheduler::schedule(int taskId)
+{
+    if (taskId < 0 || taskId >= MaxTasks) {
+        return;
+    }
+    m_pending.fetchAndOrOrdered(1u << taskId);
+    // only the first request since last tick posts an event
+    if (m_tickRequested.testAndSetOrdered(0, 1)) {
+        QMetaObject::invokeMethod(this, "startTick", Qt::QueuedConnection);
+    }
+}
+
+int UiUpdateScheduler::frameInterval() const { return m_frameInterval; }
+
+void UiUpdateScheduler::setFrameInterval(int ms)
+{
+    ms = qMax(1, ms);
+    if (ms == m_frameInterval) {
+        return;
+    }
+    m_frameInterval = ms;
+    Q_EMIT frameIntervalChanged();
+}
+
+double UiUpdateScheduler::updatesPerSecond() const { return m_updatesPerSecond; }
+double UiUpdateScheduler::busyPercent() const { return m_busyPercent; }
+double UiUpdateScheduler::averageUpdateMs() const { return m_averageUpdateMs; }
+double UiUpdateScheduler::maxUpdateMs() const { return m_maxUpdateMs; }
+
+void UiUpdateScheduler::startTick()
+{
+    // right away if last frame was long ago, otherwise on the next one
+    const qint64 sinceLast = m_clock.elapsed() - m_lastTick;
+    m_tickTimer.start(static_cast<int>(qMax<qint64>(0, m_frameInterval - sinceLast)));
+}
+
+void UiUpdateScheduler::tick()
+{
+    // requests from now on need another tick
+    m_tickRequested.store(0);
+    const quint32 pending = m_pending.fetchAndStoreOrdered(0);
+
+    const qint64 start = m_clock.nsecsElapsed();
+    for (int i = 0; i < m_tasks.size(); i++) {
+        if (pending & (1u << i)) {
+            m_tasks.at(i)();
+        }
+    }
+    const qint64 busy = m_clock.nsecsElapsed() - start;
+
+    m_lastTick = m_clock.elapsed();
+    m_windowTicks++;
+    m_windowBusyNs += busy;
+    m_windowMaxNs = qMax(m_windowMaxNs, busy);
+}
+
+void UiUpdateScheduler::publishStats()
+{
+    const qint64 now = m_clock.nsecsElapsed();
+    const qint64 window = now - m_windowStart;
+    if (window <= 0) {
+        return;
+    }
+    m_updatesPerSecond = m_windowTicks * 1e9 / window;
+    m_busyPercent = 100.0 * m_windowBusyNs / window;
+    m_averageUpdateMs = (m_windowTicks > 0) ? m_windowBusyNs / 1e6 / m_windowTicks : 0;
+    m_maxUpdateMs = m_windowMaxNs / 1e6;
+
+    m_windowStart = now;
+    m_windowTicks = 0;
+    m_windowBusyNs = 0;
+    m_windowMaxNs = 0;
+    Q_EMIT statsChanged();
+}
@@ -0,0 +1,89 @@
+#ifndef UIUPDATESCHEDULER_H
+#define UIUPDATESCHEDULER_H
+
+#include <functional>
+#include <QAtomicInteger>
+#include <QElapsedTimer>
+#include <QObject>
+#include <QTimer>
+#include <QVector>
+
+
+/**
+ * Runs pending GUI updates at most once per frame.
+ *
+ * Owner registers update tasks (insert new rows, scroll, refresh counters)
+ * with addTask(). Any thread may schedule() a task any number of times;
+ * the task runs once on the next tick, together with everything else
+ * scheduled meanwhile. Ticks are at least frameInterval apart and only
+ * happen when something is pending, so GUI thread work depends on frame
+ * rate, not on message rate: at most one queued call and one timer per
+ * frame, however many messages arrive.
+ *
+ * The time spent in ticks is measured and published once per second as
+ * updatesPerSecond, busyPercent (share of wall time) and the average and
+ * maximum tick duration.
+ */
+class UiUpdateScheduler: public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(int frameInterval READ frameInterval WRITE setFrameInterval NOTIFY frameIntervalChanged)
+    Q_PROPERTY(double updatesPerSecond READ updatesPerSecond NOTIFY statsChanged)
+    Q_PROPERTY(double busyPercent READ busyPercent NOTIFY statsChanged)
+    Q_PROPERTY(double averageUpdateMs READ averageUpdateMs NOTIFY statsChanged)
+    Q_PROPERTY(double maxUpdateMs READ maxUpdateMs NOTIFY statsChanged)
+
+public:
+    typedef std::function<void()> Task;
+
+    static const int MaxTasks = 32;
+    static const int DefaultFrameInterval = 16;
+
+public:
+    explicit UiUpdateScheduler(QObject *parent = nullptr);
+
+    // GUI thread only; tasks run in the order they were added
+    int addTask(const Task &task);
+    // thread-safe
+    void schedule(int taskId);
+
+    int frameInterval() const;
+    void setFrameInterval(int ms);
+
+    double updatesPerSecond() const;
+    double busyPercent() const;
+    double averageUpdateMs() const;
+    double maxUpdateMs() const;
+
+Q_SIGNALS:
+    void frameIntervalChanged();
+    void statsChanged();
+
+private Q_SLOTS:
+    void startTick();
+    void tick();
+    void publishStats();
+
+private:
+    QVector<Task> m_tasks;
+    QAtomicInteger<quint32> m_pending;   // bit per task
+    QAtomicInt m_tickRequested;
+    int m_frameInterval = DefaultFrameInterval;
+    QTimer m_tickTimer;
+    QTimer m_statsTimer;
+    QElapsedTimer m_clock;
+    qint64 m_lastTick = 0;               // ms on m_clock
+
+    // current stats window
+    qint64 m_windowStart = 0;            // ns on m_clock
+    int m_windowTicks = 0;
+    qint64 m_windowBusyNs = 0;
+    qint64 m_windowMaxNs = 0;
+
+    double m_updatesPerSecond = 0;
+    double m_busyPercent = 0;
+    double m_averageUpdateMs = 0;
+    double m_maxUpdateMs = 0;
+};
+
+#endif // UIUPDATESCHEDULER_H
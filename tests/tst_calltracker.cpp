@@ -0,0 +1,110 @@
+#include <dbus/dbus.h>
+#include <QtTest>
+
+#include "calltracker.h"
+
+
+static const QString BUS = QStringLiteral("session");
+static const QString CALLER = QStringLiteral(":1.1");
+static const QString SERVICE = QStringLiteral(":1.2");
+
+
+static DBusMessageObject call(qint64 timeMs, uint serial, double weight = 1)
+{
+    DBusMessageObject ret;
+    ret.timestamp = QDateTime::fromMSecsSinceEpoch(timeMs);
+    ret.type = DBUS_MESSAGE_TYPE_METHOD_CALL;
+    ret.bus = BUS;
+    ret.senderAddress = CALLER;
+    ret.destinationAddress = SERVICE;
+    ret.serial = serial;
+    ret.weight = weight;
+    return ret;
+}
+
+static DBusMessageObject reply(qint64 timeMs, uint replySerial, int type = DBUS_MESSAGE_TYPE_METHOD_RETURN)
+{
+    DBusMessageObject ret;
+    ret.timestamp = QDateTime::fromMSecsSinceEpoch(timeMs);
+    ret.type = type;
+    ret.bus = BUS;
+    ret.senderAddress = SERVICE;
+    ret.destinationAddress = CALLER;
+    ret.replySerial = replySerial;
+    return ret;
+}
+
+
+class TestCallTracker: public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void pairsReplies();
+    void noReplyExpected();
+    void expires();
+};
+
+
+void TestCallTracker::pairsReplies()
+{
+    CallTracker tracker;
+    QVERIFY(tracker.addCall(call(1000, 5, 4)));
+    QVERIFY(tracker.addCall(call(1000, 6)));
+    QCOMPARE(tracker.pendingCount(), 2);
+
+    CallTracker::Reply result;
+    QVERIFY(tracker.takeReply(reply(1250, 5), &result));
+    QCOMPARE(result.latencyMs, Q_INT64_C(250));
+    // reply is sampled together with its call
+    QCOMPARE(result.weight, 4.0);
+    // only once
+    QVERIFY(!tracker.takeReply(reply(1300, 5), &result));
+
+    // same serial from another bus or caller is another call
+    DBusMessageObject other = reply(1300, 6, DBUS_MESSAGE_TYPE_ERROR);
+    other.bus = QStringLiteral("system");
+    QVERIFY(!tracker.takeReply(other, &result));
+    other.bus = BUS;
+    QVERIFY(tracker.takeReply(other, &result));
+    QCOMPARE(result.latencyMs, Q_INT64_C(300));
+    QCOMPARE(tracker.pendingCount(), 0);
+}
+
+void TestCallTracker::noReplyExpected()
+{
+    CallTracker tracker;
+    DBusMessageObject messageObj = call(1000, 7);
+    messageObj.noReply = true;
+    QVERIFY(tracker.addCall(messageObj));
+    QCOMPARE(tracker.pendingCount(), 0);
+
+    // never waited for, so never counted as unanswered
+    tracker.addCall(call(1000 + 2 * CallTracker::CallTimeoutMs, 8));
+    QCOMPARE(tracker.expiredCount(), static_cast<quint64>(0));
+}
+
+void TestCallTracker::expires()
+{
+    CallTracker tracker;
+    tracker.addCall(call(1000, 1));
+    // not older than timeout yet
+    tracker.addCall(call(1000 + CallTracker::CallTimeoutMs, 2));
+    QCOMPARE(tracker.expiredCount(), static_cast<quint64>(0));
+    tracker.addCall(call(1000 + 2 * CallTracker::CallTimeoutMs, 3));
+    QCOMPARE(tracker.expiredCount(), static_cast<quint64>(1));
+    QCOMPARE(tracker.pendingCount(), 2);
+
+    CallTracker::Reply result;
+    QVERIFY(!tracker.takeReply(reply(2000 + 2 * CallTracker::CallTimeoutMs, 1), &result));
+    QVERIFY(tracker.takeReply(reply(2000 + 2 * CallTracker::CallTimeoutMs, 2), &result));
+
+    tracker.clear();
+    QCOMPARE(tracker.pendingCount(), 0);
+    QCOMPARE(tracker.expiredCount(), static_cast<quint64>(0));
+}
+
+
+QTEST_GUILESS_MAIN(TestCallTracker)
+
+#include "tst_calltracker.moc"
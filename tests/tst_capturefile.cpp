@@ -0,0 +1,352 @@
+#include <dbus/dbus.h>
+#include <QtEndian>
+#include <QtTest>
+
+#include "capturefile.h"
+#include "messageformat.h"
+#include "utils.h"
+
+
+static const qint64 START_MS = 1500000000000LL;
+
+
+static DBusMessageObject makeMessage(int i, qint64 timeMs)
+{
+    DBusMessageObject ret;
+    ret.timestamp = QDateTime::fromMSecsSinceEpoch(timeMs);
+    ret.bus = QStringLiteral("session");
+    ret.type = DBUS_MESSAGE_TYPE_METHOD_CALL;
+    ret.typeString = Utils::dbusMessageTypeToString(ret.type);
+    ret.serial = static_cast<uint>(i + 1);
+    ret.senderPid = 1000;
+    ret.size = 128;
+    ret.weight = (i % 3 == 0) ? 10 : 1;
+    ret.noReply = (i % 4 == 0);
+    ret.senderAddress = QStringLiteral(":1.%1").arg(i % 7);
+    ret.senderExe = QStringLiteral("/usr/bin/client");
+    ret.destinationAddress = QStringLiteral(":1.42");
+    ret.destinationNames = QStringList{QStringLiteral("org.example.Service")};
+    ret.path = QStringLiteral("/org/example/Obj%1").arg(i);
+    ret.interface = QStringLiteral("org.example.Iface");
+    ret.member = QStringLiteral("Call");
+    ret.contents = QVariantList{i, QStringLiteral("argument %1").arg(i), true};
+    return ret;
+}
+
+// one message per second from START_MS, every tenth is a gap marker
+static QVector<DBusMessageObject> makeMessages(int count)
+{
+    QVector<DBusMessageObject> ret;
+    for (int i = 0; i < count; i++) {
+        const qint64 timeMs = START_MS + i * 1000;
+        if (i % 10 == 9) {
+            DBusMessageObject gap = DBusMessageObject::gapMarker(QDateTime::fromMSecsSinceEpoch(timeMs), i);
+            gap.bus = QStringLiteral("session");
+            ret.append(gap);
+        } else {
+            ret.append(makeMessage(i, timeMs));
+        }
+    }
+    return ret;
+}
+
+static bool writeCapture(const QString &fileName, const QVector<DBusMessageObject> &messages,
+                         int blockSize, qint64 *blocksEnd = nullptr)
+{
+    CaptureFileWriter writer(blockSize);
+    if (!writer.open(fileName)) {
+        return false;
+    }
+    for (const DBusMessageObject &messageObj: messages) {
+        if (!writer.append(messageObj)) {
+            return false;
+        }
+    }
+    if (!writer.flushBlock()) {
+        return false;
+    }
+    if (blocksEnd) {
+        *blocksEnd = writer.fileSize();
+    }
+    return writer.close();
+}
+
+static QVector<DBusMessageObject> readAll(CaptureFileReader &reader)
+{
+    QVector<DBusMessageObject> ret;
+    for (int i = 0; i < reader.blocks().size(); i++) {
+        if (!reader.readBlock(i, &ret)) {
+            return QVector<DBusMessageObject>();
+        }
+    }
+    return ret;
+}
+
+static void compareMessages(const QVector<DBusMessageObject> &actual, const QVector<DBusMessageObject> &expected)
+{
+    QCOMPARE(actual.size(), expected.size());
+    for (int i = 0; i < actual.size(); i++) {
+        QVERIFY2(actual.at(i) == expected.at(i), qPrintable(QStringLiteral("message %1 differs").arg(i)));
+    }
+}
+
+
+class TestCaptureFile: public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void init();
+    void roundTrip();
+    void readRange();
+    void unorderedTimestamps();
+    void missingIndex();
+    void olderAndNewerRecords();
+    void rejectsOtherFiles();
+    void corruptBlockHeader_data();
+    void corruptBlockHeader();
+
+private:
+    QScopedPointer<QTemporaryDir> m_dir;
+    QString m_fileName;
+};
+
+
+void TestCaptureFile::init()
+{
+    m_dir.reset(new QTemporaryDir);
+    QVERIFY(m_dir->isValid());
+    m_fileName = m_dir->filePath(QStringLiteral("test.qdbmcap"));
+}
+
+void TestCaptureFile::roundTrip()
+{
+    const QVector<DBusMessageObject> messages = makeMessages(500);
+    QVERIFY(writeCapture(m_fileName, messages, 4096));
+
+    CaptureFileReader reader;
+    QVERIFY2(reader.open(m_fileName), qPrintable(reader.errorString()));
+    QVERIFY(reader.blocks().size() > 1);
+
+    // index describes the blocks in file order
+    quint32 total = 0;
+    qint64 previousOffset = 0;
+    qint64 previousLast = 0;
+    for (const CaptureBlockInfo &block: reader.blocks()) {
+        QVERIFY(block.offset > previousOffset);
+        QVERIFY(block.messageCount > 0);
+        QVERIFY(block.firstTimestamp <= block.lastTimestamp);
+        QVERIFY(block.firstTimestamp > previousLast);
+        previousOffset = block.offset;
+        previousLast = block.lastTimestamp;
+        total += block.messageCount;
+    }
+    QCOMPARE(total, static_cast<quint32>(messages.size()));
+    QCOMPARE(reader.blocks().first().firstTimestamp, START_MS);
+    QCOMPARE(reader.blocks().last().lastTimestamp, messages.last().timestamp.toMSecsSinceEpoch());
+
+    compareMessages(readAll(reader), messages);
+}
+
+void TestCaptureFile::readRange()
+{
+    const QVector<DBusMessageObject> messages = makeMessages(500);
+    QVERIFY(writeCapture(m_fileName, messages, 4096));
+
+    CaptureFileReader reader;
+    QVERIFY2(reader.open(m_fileName), qPrintable(reader.errorString()));
+
+    // bounds are inclusive
+    QVector<DBusMessageObject> range;
+    QVERIFY(reader.readRange(QDateTime::fromMSecsSinceEpoch(START_MS + 100 * 1000),
+                             QDateTime::fromMSecsSinceEpoch(START_MS + 199 * 1000), &range));
+    compareMessages(range, messages.mid(100, 100));
+
+    // open ends
+    range.clear();
+    QVERIFY(reader.readRange(QDateTime(), QDateTime::fromMSecsSinceEpoch(START_MS + 9500), &range));
+    compareMessages(range, messages.mid(0, 10));
+    range.clear();
+    QVERIFY(reader.readRange(QDateTime::fromMSecsSinceEpoch(START_MS + 490 * 1000), QDateTime(), &range));
+    compareMessages(range, messages.mid(490));
+
+    // outside of capture
+    range.clear();
+    QVERIFY(reader.readRange(QDateTime::fromMSecsSinceEpoch(START_MS - 10000),
+                             QDateTime::fromMSecsSinceEpoch(START_MS - 1), &range));
+    QVERIFY(range.isEmpty());
+}
+
+void TestCaptureFile::unorderedTimestamps()
+{
+    // merged buses: a late message with an early timestamp in the middle of a block
+    QVector<DBusMessageObject> messages;
+    messages.append(makeMessage(0, START_MS + 5000));
+    messages.append(makeMessage(1, START_MS + 1000));
+    messages.append(makeMessage(2, START_MS + 9000));
+    messages.append(makeMessage(3, START_MS + 7000));
+    QVERIFY(writeCapture(m_fileName, messages, CaptureFileWriter::DefaultBlockSize));
+
+    CaptureFileReader reader;
+    QVERIFY2(reader.open(m_fileName), qPrintable(reader.errorString()));
+    QCOMPARE(reader.blocks().size(), 1);
+    QCOMPARE(reader.blocks().first().firstTimestamp, START_MS + 1000);
+    QCOMPARE(reader.blocks().first().lastTimestamp, START_MS + 9000);
+
+    QVector<DBusMessageObject> range;
+    QVERIFY(reader.readRange(QDateTime::fromMSecsSinceEpoch(START_MS),
+                             QDateTime::fromMSecsSinceEpoch(START_MS + 2000), &range));
+    compareMessages(range, messages.mid(1, 1));
+}
+
+void TestCaptureFile::missingIndex()
+{
+    const QVector<DBusMessageObject> messages = makeMessages(500);
+    qint64 blocksEnd = 0;
+    QVERIFY(writeCapture(m_fileName, messages, 4096, &blocksEnd));
+
+    CaptureFileReader reader;
+    QVERIFY2(reader.open(m_fileName), qPrintable(reader.errorString()));
+    const QVector<CaptureBlockInfo> indexed = reader.blocks();
+    reader.close();
+
+    // not closed properly: no index and trailer, blocks are scanned
+    QVERIFY(QFile::resize(m_fileName, blocksEnd));
+    QVERIFY2(reader.open(m_fileName), qPrintable(reader.errorString()));
+    QCOMPARE(reader.blocks().size(), indexed.size());
+    for (int i = 0; i < indexed.size(); i++) {
+        QCOMPARE(reader.blocks().at(i).offset, indexed.at(i).offset);
+        QCOMPARE(reader.blocks().at(i).firstTimestamp, indexed.at(i).firstTimestamp);
+        QCOMPARE(reader.blocks().at(i).lastTimestamp, indexed.at(i).lastTimestamp);
+        QCOMPARE(reader.blocks().at(i).messageCount, indexed.at(i).messageCount);
+    }
+    compareMessages(readAll(reader), messages);
+    reader.close();
+
+    // last block cut short by a crash is left out
+    QVERIFY(QFile::resize(m_fileName, blocksEnd - 10));
+    QVERIFY2(reader.open(m_fileName), qPrintable(reader.errorString()));
+    QCOMPARE(reader.blocks().size(), indexed.size() - 1);
+    const QVector<DBusMessageObject> read = readAll(reader);
+    compareMessages(read, messages.mid(0, read.size()));
+    QVERIFY(!read.isEmpty());
+}
+
+void TestCaptureFile::olderAndNewerRecords()
+{
+    DBusMessageObject messageObj = makeMessage(1, START_MS);
+    QByteArray current;
+    MessageFormat::appendBinary(current, messageObj);
+
+    // size and bus, dropped, weight and noReply were appended later
+    //   (u32, null QString, u64, double, bool), records without them still read
+    const int trailingSize = 4 + 4 + 8 + 8 + 1;
+    messageObj.bus.clear();
+    QByteArray record;
+    MessageFormat::appendBinary(record, messageObj);
+    record.chop(trailingSize);
+    qToLittleEndian<quint32>(static_cast<quint32>(record.size() - 4), reinterpret_cast<uchar *>(record.data()));
+
+    DBusMessageObject expected = messageObj;
+    expected.size = 0;
+    expected.weight = 1;
+    expected.noReply = false;
+    DBusMessageObject read;
+    read.dropped = 5;
+    int pos = 0;
+    QVERIFY(MessageFormat::readBinary(record, &pos, &read));
+    QCOMPARE(pos, record.size());
+    QVERIFY(read == expected);
+
+    // fields a newer version appends are skipped
+    record = current;
+    record.append("\x01\x02\x03\x04", 4);
+    qToLittleEndian<quint32>(static_cast<quint32>(record.size() - 4), reinterpret_cast<uchar *>(record.data()));
+    record += current;
+    pos = 0;
+    QVERIFY(MessageFormat::readBinary(record, &pos, &read));
+    QVERIFY(read == makeMessage(1, START_MS));
+    QVERIFY(MessageFormat::readBinary(record, &pos, &read));
+    QVERIFY(read == makeMessage(1, START_MS));
+    QCOMPARE(pos, record.size());
+}
+
+void TestCaptureFile::rejectsOtherFiles()
+{
+    CaptureFileReader reader;
+    QVERIFY(!reader.open(m_dir->filePath(QStringLiteral("missing.qdbmcap"))));
+
+    QFile file(m_fileName);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write("{\"type\": \"signal\"}\n");
+    file.close();
+    QVERIFY(!reader.open(m_fileName));
+    QCOMPARE(reader.errorString(), QStringLiteral("Not a capture file"));
+
+    // any layout change bumps the version, readers must not guess
+    QVERIFY(writeCapture(m_fileName, makeMessages(10), 4096));
+    QVERIFY(file.open(QIODevice::ReadWrite));
+    file.seek(8);
+    file.write("\x63\x00\x00\x00", 4);
+    file.close();
+    QVERIFY(!reader.open(m_fileName));
+    QCOMPARE(reader.errorString(), QStringLiteral("Unsupported capture file version"));
+}
+
+void TestCaptureFile::corruptBlockHeader_data()
+{
+    QTest::addColumn<int>("field");     // offset in block header
+    QTest::addColumn<quint32>("value");
+    QTest::addColumn<QString>("error");
+
+    // first block header follows the 16 byte file header
+    QTest::newRow("huge raw size") << 12 << 0xfffffff0u << QStringLiteral("Corrupted block header");
+    QTest::newRow("negative as int raw size") << 12 << 0x80000000u << QStringLiteral("Corrupted block header");
+    QTest::newRow("raw size too small") << 12 << 8u << QStringLiteral("Corrupted block data");
+    QTest::newRow("huge stored size") << 16 << 0x7fffffffu << QStringLiteral("Corrupted block header");
+    QTest::newRow("stored size too small") << 16 << 8u << QStringLiteral("Corrupted block data");
+}
+
+void TestCaptureFile::corruptBlockHeader()
+{
+    QFETCH(int, field);
+    QFETCH(quint32, value);
+    QFETCH(QString, error);
+
+    const QVector<DBusMessageObject> messages = makeMessages(50);
+    qint64 blocksEnd = 0;
+    QVERIFY(writeCapture(m_fileName, messages, CaptureFileWriter::DefaultBlockSize, &blocksEnd));
+
+    QFile file(m_fileName);
+    QVERIFY(file.open(QIODevice::ReadWrite));
+    uchar bytes[4];
+    qToLittleEndian<quint32>(value, bytes);
+    file.seek(16 + field);
+    file.write(reinterpret_cast<const char *>(bytes), sizeof(bytes));
+    file.close();
+
+    // index still points at the block, its header is checked when read
+    CaptureFileReader reader;
+    QVERIFY2(reader.open(m_fileName), qPrintable(reader.errorString()));
+    QCOMPARE(reader.blocks().size(), 1);
+    QVector<DBusMessageObject> read;
+    QVERIFY(!reader.readBlock(0, &read));
+    QCOMPARE(reader.errorString(), error);
+    QVERIFY(read.isEmpty());
+    QVERIFY(!reader.readRange(QDateTime(), QDateTime(), &read));
+    reader.close();
+
+    // without index, a block with impossible stored size ends the scan
+    QVERIFY(QFile::resize(m_fileName, blocksEnd));
+    QVERIFY2(reader.open(m_fileName), qPrintable(reader.errorString()));
+    if (field == 16 && value > static_cast<quint32>(CaptureFileWriter::MaxBlockSize)) {
+        QVERIFY(reader.blocks().isEmpty());
+    } else if (reader.blocks().size() == 1) {
+        QVERIFY(!reader.readBlock(0, &read));
+    }
+}
+
+
+QTEST_GUILESS_MAIN(TestCaptureFile)
+
+#include "tst_capturefile.moc"
@@ -0,0 +1,278 @@
+#include <dbus/dbus.h>
+#include <QtTest>
+
+#include "messagefilter.h"
+
+
+// signal /org/example/Obj org.example.Iface.Changed("hello", 42) from :1.5
+static DBusMessage *newSignal(const char *member = "Changed")
+{
+    DBusMessage *message = dbus_message_new_signal("/org/example/Obj", "org.example.Iface", member);
+    dbus_message_set_sender(message, ":1.5");
+    const char *str = "hello";
+    dbus_int32_t number = 42;
+    dbus_message_append_args(message,
+                             DBUS_TYPE_STRING, &str,
+                             DBUS_TYPE_INT32, &number,
+                             DBUS_TYPE_INVALID);
+    return message;
+}
+
+// what the decoder makes of newSignal()
+static DBusMessageObject resolvedSignal()
+{
+    DBusMessageObject ret;
+    ret.type = DBUS_MESSAGE_TYPE_SIGNAL;
+    ret.path = QStringLiteral("/org/example/Obj");
+    ret.interface = QStringLiteral("org.example.Iface");
+    ret.member = QStringLiteral("Changed");
+    ret.senderAddress = QStringLiteral(":1.5");
+    ret.senderNames = QStringList{QStringLiteral("org.example.Service")};
+    ret.senderPid = 1234;
+    ret.senderExe = QStringLiteral("/usr/bin/example-service");
+    ret.contents = QVariantList{QStringLiteral("hello"), 42};
+    return ret;
+}
+
+Q_DECLARE_METATYPE(MessageFilter::Match)
+
+
+class TestMessageFilter: public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void compileErrors_data();
+    void compileErrors();
+    void emptyFilterPassesEverything();
+    void matchHeader_data();
+    void matchHeader();
+    void matchMessage_data();
+    void matchMessage();
+    void gapsAlwaysMatch();
+    void daemonMatchRules();
+    void nonStringArgsStayLocal_data();
+    void nonStringArgsStayLocal();
+    void splitRules();
+};
+
+
+void TestMessageFilter::compileErrors_data()
+{
+    QTest::addColumn<QString>("rule");
+    QTest::addColumn<QString>("error");
+
+    QTest::newRow("unknown key") << QStringLiteral("colour='red'")
+                                 << QStringLiteral("Unknown match rule key: colour");
+    QTest::newRow("unknown type") << QStringLiteral("type='broadcast'")
+                                  << QStringLiteral("Unknown message type: broadcast");
+    QTest::newRow("pid not a number") << QStringLiteral("pid='init'")
+                                      << QStringLiteral("PID must be a number: init");
+    QTest::newRow("arg1namespace") << QStringLiteral("arg1namespace='a.b'")
+                                   << QStringLiteral("Unknown match rule key: arg1namespace");
+    QTest::newRow("unterminated quote") << QStringLiteral("member='Changed")
+                                        << QStringLiteral("Unterminated quote in value of key: member");
+}
+
+void TestMessageFilter::compileErrors()
+{
+    QFETCH(QString, rule);
+    QFETCH(QString, error);
+
+    MessageFilter filter;
+    QString errorString;
+    QVERIFY(!filter.addRule(rule, &errorString));
+    QCOMPARE(errorString, error);
+    QVERIFY(filter.isEmpty());
+
+    // a bad rule leaves the previous ones in place
+    QVERIFY(filter.setRules(QStringList{QStringLiteral("type='signal'")}));
+    QVERIFY(!filter.setRules(QStringList{QStringLiteral("member='A'"), rule}));
+    QCOMPARE(filter.rules(), QStringList{QStringLiteral("type='signal'")});
+}
+
+void TestMessageFilter::emptyFilterPassesEverything()
+{
+    MessageFilter filter;
+    DBusMessage *message = newSignal();
+    QCOMPARE(filter.matchHeader(message), MessageFilter::Match::Accepted);
+    QVERIFY(filter.matchMessage(resolvedSignal(), message));
+    dbus_message_unref(message);
+}
+
+void TestMessageFilter::matchHeader_data()
+{
+    QTest::addColumn<QStringList>("rules");
+    QTest::addColumn<MessageFilter::Match>("match");
+
+    QTest::newRow("type and interface")
+            << QStringList{QStringLiteral("type='signal',interface='org.example.Iface'")}
+            << MessageFilter::Match::Accepted;
+    QTest::newRow("type list")
+            << QStringList{QStringLiteral("type='error|signal'")}
+            << MessageFilter::Match::Accepted;
+    QTest::newRow("other member")
+            << QStringList{QStringLiteral("member='Removed'")}
+            << MessageFilter::Match::Rejected;
+    QTest::newRow("any of rules")
+            << QStringList{QStringLiteral("member='Removed'"), QStringLiteral("member='Changed'")}
+            << MessageFilter::Match::Accepted;
+    QTest::newRow("path namespace")
+            << QStringList{QStringLiteral("path_namespace='/org/example'")}
+            << MessageFilter::Match::Accepted;
+    QTest::newRow("path namespace prefix only")
+            << QStringList{QStringLiteral("path_namespace='/org/ex'")}
+            << MessageFilter::Match::Rejected;
+    QTest::newRow("string arg")
+            << QStringList{QStringLiteral("arg0='hello'")}
+            << MessageFilter::Match::Accepted;
+    QTest::newRow("number arg")
+            << QStringList{QStringLiteral("arg1='42'")}
+            << MessageFilter::Match::Accepted;
+    QTest::newRow("other number arg")
+            << QStringList{QStringLiteral("arg1='43'")}
+            << MessageFilter::Match::Rejected;
+    QTest::newRow("same unique sender")
+            << QStringList{QStringLiteral("sender=':1.5'")}
+            << MessageFilter::Match::Accepted;
+    QTest::newRow("other unique sender")
+            << QStringList{QStringLiteral("sender=':1.6'")}
+            << MessageFilter::Match::Rejected;
+    QTest::newRow("well-known sender")
+            << QStringList{QStringLiteral("sender='org.example.Service'")}
+            << MessageFilter::Match::NeedsDetails;
+    QTest::newRow("pid")
+            << QStringList{QStringLiteral("member='Changed',sender_pid='1234'")}
+            << MessageFilter::Match::NeedsDetails;
+    QTest::newRow("pid, rejected by header")
+            << QStringList{QStringLiteral("member='Removed',sender_pid='1234'")}
+            << MessageFilter::Match::Rejected;
+}
+
+void TestMessageFilter::matchHeader()
+{
+    QFETCH(QStringList, rules);
+    QFETCH(MessageFilter::Match, match);
+
+    MessageFilter filter;
+    QString errorString;
+    QVERIFY2(filter.setRules(rules, &errorString), qPrintable(errorString));
+    DBusMessage *message = newSignal();
+    QCOMPARE(filter.matchHeader(message), match);
+    dbus_message_unref(message);
+}
+
+void TestMessageFilter::matchMessage_data()
+{
+    QTest::addColumn<QString>("rule");
+    QTest::addColumn<bool>("matches");
+
+    QTest::newRow("well-known sender") << QStringLiteral("sender='org.example.Service'") << true;
+    QTest::newRow("other well-known sender") << QStringLiteral("sender='org.example.Other'") << false;
+    QTest::newRow("sender pid") << QStringLiteral("sender_pid='1234'") << true;
+    QTest::newRow("destination pid") << QStringLiteral("destination_pid='1234'") << false;
+    QTest::newRow("any pid") << QStringLiteral("pid='1234'") << true;
+    QTest::newRow("exe file name") << QStringLiteral("exe='example-service'") << true;
+    QTest::newRow("exe full path") << QStringLiteral("sender_exe='/usr/bin/example-service'") << true;
+    QTest::newRow("exe other path") << QStringLiteral("sender_exe='/bin/example-service'") << false;
+    QTest::newRow("number arg") << QStringLiteral("arg1='42'") << true;
+    QTest::newRow("arg out of range") << QStringLiteral("arg2='42'") << false;
+}
+
+void TestMessageFilter::matchMessage()
+{
+    QFETCH(QString, rule);
+    QFETCH(bool, matches);
+
+    MessageFilter filter;
+    QString errorString;
+    QVERIFY2(filter.addRule(rule, &errorString), qPrintable(errorString));
+
+    // decided on resolved fields alone, and with raw header taking precedence
+    QCOMPARE(filter.matchMessage(resolvedSignal()), matches);
+    DBusMessage *message = newSignal();
+    QCOMPARE(filter.matchMessage(resolvedSignal(), message), matches);
+    dbus_message_unref(message);
+}
+
+void TestMessageFilter::gapsAlwaysMatch()
+{
+    MessageFilter filter;
+    QVERIFY(filter.addRule(QStringLiteral("member='Nothing'")));
+    QVERIFY(!filter.matchMessage(resolvedSignal()));
+    QVERIFY(filter.matchMessage(DBusMessageObject::gapMarker(QDateTime::currentDateTime(), 3)));
+}
+
+void TestMessageFilter::daemonMatchRules()
+{
+    MessageFilter filter;
+    QVERIFY(filter.setRules(QStringList{
+        QStringLiteral("type='signal',interface='org.example.Iface',sender_pid='1234'"),
+        QStringLiteral("member='Changed',arg1='42',arg0='it'\\''s'"),
+    }));
+    // pid and numeric arg are left to the filter, quotes are escaped
+    QCOMPARE(filter.daemonMatchRules(), (QStringList{
+        QStringLiteral("type='signal',interface='org.example.Iface'"),
+        QStringLiteral("member='Changed',arg0='it'\\''s'"),
+    }));
+
+    // a rule with no daemon terms needs all traffic
+    QVERIFY(filter.addRule(QStringLiteral("type='signal|error'")));
+    QVERIFY(filter.daemonMatchRules().isEmpty());
+}
+
+void TestMessageFilter::nonStringArgsStayLocal_data()
+{
+    QTest::addColumn<QString>("rule");
+    QTest::addColumn<QString>("daemonRule");
+
+    QTest::newRow("object path") << QStringLiteral("arg0='/org/foo'") << QString();
+    QTest::newRow("signature") << QStringLiteral("arg1='a{sv}'") << QString();
+    QTest::newRow("double") << QStringLiteral("arg2='1.5'") << QString();
+    QTest::newRow("string") << QStringLiteral("arg0='hello'") << QStringLiteral("arg0='hello'");
+    QTest::newRow("path of string or path") << QStringLiteral("arg0path='/org/'") << QStringLiteral("arg0path='/org/'");
+    QTest::newRow("path of signature") << QStringLiteral("arg1path='a{sv}'") << QString();
+}
+
+void TestMessageFilter::nonStringArgsStayLocal()
+{
+    QFETCH(QString, rule);
+    QFETCH(QString, daemonRule);
+
+    // daemon compares argN to strings only, so it would drop a message
+    //   with object path, signature or double argument the filter accepts
+    MessageFilter filter;
+    QVERIFY(filter.addRule(QStringLiteral("member='Changed',") + rule));
+    const QString expected = daemonRule.isEmpty() ? QStringLiteral("member='Changed'")
+                                                  : QStringLiteral("member='Changed',") + daemonRule;
+    QCOMPARE(filter.daemonMatchRules(), QStringList{expected});
+
+    DBusMessage *message = dbus_message_new_signal("/org/example/Obj", "org.example.Iface", "Changed");
+    const char *path = "/org/foo";
+    const char *signature = "a{sv}";
+    double number = 1.5;
+    dbus_message_append_args(message,
+                             DBUS_TYPE_OBJECT_PATH, &path,
+                             DBUS_TYPE_SIGNATURE, &signature,
+                             DBUS_TYPE_DOUBLE, &number,
+                             DBUS_TYPE_INVALID);
+    const bool stringRule = (rule == QLatin1String("arg0='hello'"));
+    QCOMPARE(filter.matchHeader(message), stringRule ? MessageFilter::Match::Rejected
+                                                     : MessageFilter::Match::Accepted);
+    dbus_message_unref(message);
+}
+
+void TestMessageFilter::splitRules()
+{
+    QCOMPARE(MessageFilter::splitRules(QStringLiteral(" type='signal';member='a;b'\n\ninterface='x.y' ")),
+             (QStringList{
+                 QStringLiteral("type='signal'"),
+                 QStringLiteral("member='a;b'"),
+                 QStringLiteral("interface='x.y'"),
+             }));
+}
+
+
+QTEST_GUILESS_MAIN(TestMessageFilter)
+
+#include "tst_messagefilter.moc"
@@ -0,0 +1,185 @@
+#include <dbus/dbus.h>
+#include <QtTest>
+
+#include "dbusmonitorthread.h"
+#include "messagemerger.h"
+#include "privatebusdaemon.h"
+#include "utils.h"
+
+
+// Monitors are not started unless a test needs a running source; their
+//   messageReceived() is emitted by the test, as if they captured something.
+static DBusMessageObject makeMessage(const QString &bus, qint64 timeMs, int serial)
+{
+    DBusMessageObject ret;
+    ret.timestamp = QDateTime::fromMSecsSinceEpoch(timeMs);
+    ret.bus = bus;
+    ret.type = DBUS_MESSAGE_TYPE_SIGNAL;
+    ret.typeString = Utils::dbusMessageTypeToString(ret.type);
+    ret.serial = static_cast<uint>(serial);
+    ret.member = QStringLiteral("Tick");
+    return ret;
+}
+
+
+class TestMessageMerger: public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void ordersByTimestamp();
+    void stoppedSourcesDoNotHoldBack();
+    void overflowIsRecorded();
+    void runningSourcesHoldBack();
+
+private:
+    // collects output of merger, read it only after finish()
+    void collect(MessageMerger *merger, QVector<DBusMessageObject> *output);
+};
+
+
+void TestMessageMerger::collect(MessageMerger *merger, QVector<DBusMessageObject> *output)
+{
+    connect(merger, &MessageMerger::messageReceived, this, [output] (const DBusMessageObject &messageObj) {
+        output->append(messageObj);
+    }, Qt::DirectConnection);
+}
+
+void TestMessageMerger::ordersByTimestamp()
+{
+    DBusMonitorThread session, system;
+    MessageMerger merger;
+    QVector<DBusMessageObject> output;
+    collect(&merger, &output);
+    merger.addSource(&session);
+    merger.addSource(&system);
+
+    // in the future, so nothing is emitted before finish()
+    const qint64 base = QDateTime::currentMSecsSinceEpoch() + 3600 * 1000;
+    const QString a = QStringLiteral("session");
+    const QString b = QStringLiteral("system");
+    Q_EMIT session.messageReceived(makeMessage(a, base + 1, 1));
+    Q_EMIT system.messageReceived(makeMessage(b, base + 2, 2));
+    Q_EMIT system.messageReceived(makeMessage(b, base + 3, 3));
+    Q_EMIT session.messageReceived(makeMessage(a, base + 4, 4));
+    Q_EMIT session.messageReceived(makeMessage(a, base + 6, 6));
+    Q_EMIT session.messageReceived(makeMessage(a, base + 6, 7));   // same time keeps source order
+    Q_EMIT system.messageReceived(makeMessage(b, base + 5, 5));
+    Q_EMIT system.messageReceived(makeMessage(b, base + 8, 9));
+    Q_EMIT session.messageReceived(makeMessage(a, base + 7, 8));
+    merger.finish();
+    QCOMPARE(output.size(), 9);
+    for (int i = 0; i < output.size(); i++) {
+        QCOMPARE(output.at(i).serial, static_cast<uint>(i + 1));
+    }
+    QCOMPARE(merger.droppedCount(), static_cast<quint64>(0));
+}
+
+void TestMessageMerger::stoppedSourcesDoNotHoldBack()
+{
+    DBusMonitorThread session;
+    MessageMerger merger;
+    QAtomicInt received;
+    connect(&merger, &MessageMerger::messageReceived, this, [&received] (const DBusMessageObject &) {
+        received.fetchAndAddRelaxed(1);
+    }, Qt::DirectConnection);
+    merger.addSource(&session);
+
+    // a source that is not running delivers nothing more, so what it
+    //   delivered is emitted without waiting for finish()
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    for (int i = 0; i < 10; i++) {
+        Q_EMIT session.messageReceived(makeMessage(QStringLiteral("session"), now - 1000 + i, i));
+    }
+    QTRY_COMPARE(received.load(), 10);
+    merger.finish();
+}
+
+void TestMessageMerger::overflowIsRecorded()
+{
+    DBusMonitorThread session;
+    MessageMerger merger;
+    merger.setQueueLimit(3, MessageQueue::OverflowPolicy::DropNewest);
+    QVector<DBusMessageObject> output;
+    collect(&merger, &output);
+    merger.addSource(&session);
+
+    // how many are lost depends on when merger collects the queue,
+    //   but every lost message is accounted for in a gap marker
+    const qint64 base = QDateTime::currentMSecsSinceEpoch() + 3600 * 1000;
+    for (int i = 0; i < 100; i++) {
+        Q_EMIT session.messageReceived(makeMessage(QStringLiteral("session"), base + i, i));
+    }
+    merger.finish();
+
+    quint64 delivered = 0;
+    quint64 dropped = 0;
+    qint64 previous = 0;
+    for (const DBusMessageObject &messageObj: output) {
+        const qint64 ts = messageObj.timestamp.toMSecsSinceEpoch();
+        QVERIFY(ts >= previous);
+        previous = ts;
+        if (messageObj.isGap()) {
+            dropped += messageObj.dropped;
+        } else {
+            delivered++;
+        }
+    }
+    QCOMPARE(delivered + dropped, static_cast<quint64>(100));
+    QCOMPARE(merger.droppedCount(), dropped);
+    QVERIFY(dropped > 0);
+}
+
+void TestMessageMerger::runningSourcesHoldBack()
+{
+    PrivateBusDaemon daemon;
+    if (!daemon.start()) {
+        QSKIP(qPrintable(QStringLiteral("No dbus-daemon: ") + daemon.errorString()));
+    }
+
+    // running sources capture nothing from the bus, only what the test emits
+    const QStringList nothing{QStringLiteral("member='NoSuchMember'")};
+    DBusMonitorThread fast, slow;
+    MessageMerger merger;
+    QVector<DBusMessageObject> output;
+    collect(&merger, &output);
+    merger.addSource(&fast);
+    merger.addSource(&slow);
+    QVERIFY(fast.startOnAddress(daemon.address(), nothing));
+    QVERIFY(slow.startOnAddress(daemon.address(), nothing));
+
+    // Both deliver more often than IdleSourceMs, one with a larger capture
+    //   delay; its messages are older than what the other one has already
+    //   delivered, and still must come out first.
+    const int count = 60;
+    for (int i = 0; i < count; i++) {
+        const qint64 now = QDateTime::currentMSecsSinceEpoch();
+        Q_EMIT fast.messageReceived(makeMessage(QStringLiteral("fast"), now, 2 * i));
+        Q_EMIT slow.messageReceived(makeMessage(QStringLiteral("slow"), now - 40, 2 * i + 1));
+        QThread::msleep(5);
+    }
+
+    fast.stop();
+    slow.stop();
+    QVERIFY(fast.wait(5000));
+    QVERIFY(slow.wait(5000));
+    merger.finish();
+
+    // bus traffic of monitors starting up, if any, is older and left out
+    QVector<DBusMessageObject> ticks;
+    for (const DBusMessageObject &messageObj: output) {
+        if (messageObj.member == QLatin1String("Tick")) {
+            ticks.append(messageObj);
+        }
+    }
+    QCOMPARE(ticks.size(), 2 * count);
+    for (int i = 1; i < ticks.size(); i++) {
+        QVERIFY2(ticks.at(i - 1).timestamp <= ticks.at(i).timestamp,
+                 qPrintable(QStringLiteral("message %1 is out of order").arg(i)));
+    }
+}
+
+
+QTEST_GUILESS_MAIN(TestMessageMerger)
+
+#include "tst_messagemerger.moc"
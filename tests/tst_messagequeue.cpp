@@ -0,0 +1,172 @@
+#include <dbus/dbus.h>
+#include <QElapsedTimer>
+#include <QtTest>
+
+#include "messagequeue.h"
+
+
+static const qint64 START_MS = 1500000000000LL;
+
+
+static DBusMessageObject makeMessage(int serial)
+{
+    DBusMessageObject ret;
+    ret.timestamp = QDateTime::fromMSecsSinceEpoch(START_MS + serial);
+    ret.type = DBUS_MESSAGE_TYPE_SIGNAL;
+    ret.serial = static_cast<uint>(serial);
+    return ret;
+}
+
+static void pushRange(MessageQueue &queue, int first, int last)
+{
+    for (int serial = first; serial <= last; serial++) {
+        queue.push(makeMessage(serial));
+    }
+}
+
+// queue contents as text: serials of messages, "gap<dropped>@<serial of its time>" for gaps
+static QStringList describe(const QVector<DBusMessageObject> &items)
+{
+    QStringList ret;
+    for (const DBusMessageObject &messageObj: items) {
+        if (messageObj.isGap()) {
+            ret.append(QStringLiteral("gap%1@%2").arg(messageObj.dropped)
+                       .arg(messageObj.timestamp.toMSecsSinceEpoch() - START_MS));
+        } else {
+            ret.append(QString::number(messageObj.serial));
+        }
+    }
+    return ret;
+}
+
+static QStringList split(const char *text)
+{
+    return QString::fromLatin1(text).split(QLatin1Char(' '), QString::SkipEmptyParts);
+}
+
+
+class TestMessageQueue: public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void belowCapacity();
+    void overflow_data();
+    void overflow();
+    void takeAllStartsOver();
+    void lowerCapacity();
+    void wakeUp();
+    void policyFromString();
+};
+
+Q_DECLARE_METATYPE(MessageQueue::OverflowPolicy)
+
+
+void TestMessageQueue::belowCapacity()
+{
+    MessageQueue queue(10);
+    QVERIFY(queue.push(makeMessage(1)));    // was empty
+    QVERIFY(!queue.push(makeMessage(2)));
+    pushRange(queue, 3, 10);
+    QCOMPARE(queue.size(), 10);
+    QCOMPARE(describe(queue.takeAll()), split("1 2 3 4 5 6 7 8 9 10"));
+    QCOMPARE(queue.size(), 0);
+    QCOMPARE(queue.droppedCount(), static_cast<quint64>(0));
+    QVERIFY(queue.takeAll().isEmpty());
+}
+
+void TestMessageQueue::overflow_data()
+{
+    QTest::addColumn<MessageQueue::OverflowPolicy>("policy");
+    QTest::addColumn<int>("pushed");
+    QTest::addColumn<QStringList>("expected");
+
+    QTest::newRow("drop newest") << MessageQueue::OverflowPolicy::DropNewest << 6
+                                 << split("1 2 3 gap3@4");
+    QTest::newRow("drop oldest") << MessageQueue::OverflowPolicy::DropOldest << 6
+                                 << split("gap3@1 4 5 6");
+    // first overflowing push replaces the oldest, next 15 are dropped,
+    //   the one after them replaces the oldest again
+    QTest::newRow("sample") << MessageQueue::OverflowPolicy::Sample << 20
+                            << split("gap2@1 3 4 gap15@5 20");
+}
+
+void TestMessageQueue::overflow()
+{
+    QFETCH(MessageQueue::OverflowPolicy, policy);
+    QFETCH(int, pushed);
+    QFETCH(QStringList, expected);
+
+    MessageQueue queue(3, policy);
+    pushRange(queue, 1, pushed);
+    // gap markers do not count
+    QCOMPARE(queue.size(), 3);
+    QCOMPARE(queue.droppedCount(), static_cast<quint64>(pushed - 3));
+    QCOMPARE(describe(queue.takeAll()), expected);
+}
+
+void TestMessageQueue::takeAllStartsOver()
+{
+    MessageQueue queue(2, MessageQueue::OverflowPolicy::DropNewest);
+    pushRange(queue, 1, 4);
+    QCOMPARE(describe(queue.takeAll()), split("1 2 gap2@3"));
+
+    // consumer caught up: no new gap until queue is full again
+    pushRange(queue, 5, 7);
+    QCOMPARE(describe(queue.takeAll()), split("5 6 gap1@7"));
+    QCOMPARE(queue.droppedCount(), static_cast<quint64>(3));
+
+    // with sampling, the count of overflowing pushes starts over too
+    queue.setOverflowPolicy(MessageQueue::OverflowPolicy::Sample);
+    pushRange(queue, 8, 10);
+    QCOMPARE(describe(queue.takeAll()), split("gap1@8 9 10"));
+    pushRange(queue, 11, 13);
+    QCOMPARE(describe(queue.takeAll()), split("gap1@11 12 13"));
+}
+
+void TestMessageQueue::lowerCapacity()
+{
+    MessageQueue queue(3, MessageQueue::OverflowPolicy::DropOldest);
+    pushRange(queue, 1, 3);
+    queue.setCapacity(2);
+    QCOMPARE(queue.capacity(), 2);
+    QCOMPARE(queue.size(), 3);
+
+    // queued messages are kept until the next push makes room
+    queue.push(makeMessage(4));
+    QCOMPARE(queue.size(), 2);
+    QCOMPARE(describe(queue.takeAll()), split("gap2@1 3 4"));
+}
+
+void TestMessageQueue::wakeUp()
+{
+    MessageQueue queue;
+    QElapsedTimer timer;
+    timer.start();
+    queue.wakeUp();
+    QVERIFY(queue.takeAll(10000).isEmpty());
+    QVERIFY(timer.elapsed() < 5000);
+
+    // only once
+    timer.restart();
+    QVERIFY(queue.takeAll(50).isEmpty());
+    QVERIFY(timer.elapsed() >= 40);
+}
+
+void TestMessageQueue::policyFromString()
+{
+    MessageQueue::OverflowPolicy policy = MessageQueue::OverflowPolicy::DropNewest;
+    QVERIFY(MessageQueue::policyFromString(QStringLiteral("drop-oldest"), &policy));
+    QCOMPARE(policy, MessageQueue::OverflowPolicy::DropOldest);
+    QVERIFY(MessageQueue::policyFromString(QStringLiteral("sample"), &policy));
+    QCOMPARE(policy, MessageQueue::OverflowPolicy::Sample);
+    QVERIFY(MessageQueue::policyFromString(QStringLiteral("drop-newest"), &policy));
+    QCOMPARE(policy, MessageQueue::OverflowPolicy::DropNewest);
+    QVERIFY(!MessageQueue::policyFromString(QStringLiteral("block"), &policy));
+    QCOMPARE(policy, MessageQueue::OverflowPolicy::DropNewest);
+}
+
+
+QTEST_GUILESS_MAIN(TestMessageQueue)
+
+#include "tst_messagequeue.moc"
@@ -0,0 +1,132 @@
+#include <dbus/dbus.h>
+#include <QtTest>
+
+#include "nameownerhistory.h"
+
+
+static const QString NAME = QStringLiteral("org.example.Service");
+
+
+static DBusMessageObject nameOwnerChanged(qint64 timeMs, const QString &name,
+                                          const QString &oldOwner, const QString &newOwner)
+{
+    DBusMessageObject ret;
+    ret.timestamp = QDateTime::fromMSecsSinceEpoch(timeMs);
+    ret.type = DBUS_MESSAGE_TYPE_SIGNAL;
+    ret.senderAddress = QStringLiteral(DBUS_SERVICE_DBUS);
+    ret.path = QStringLiteral(DBUS_PATH_DBUS);
+    ret.interface = QStringLiteral(DBUS_INTERFACE_DBUS);
+    ret.member = QStringLiteral("NameOwnerChanged");
+    ret.contents = QVariantList{name, oldOwner, newOwner};
+    return ret;
+}
+
+
+class TestNameOwnerHistory: public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void ownerAt();
+    void outOfOrder();
+    void namesAt();
+    void addFromMessages();
+};
+
+
+void TestNameOwnerHistory::ownerAt()
+{
+    NameOwnerHistory history;
+    history.setOwner(NAME, QStringLiteral(":1.1"), 1000);
+    history.setOwner(NAME, QString(), 2000);
+    history.setOwner(NAME, QStringLiteral(":1.7"), 3000);
+
+    QCOMPARE(history.ownerAt(NAME, 999), QString());
+    // a change applies from its own time on
+    QCOMPARE(history.ownerAt(NAME, 1000), QStringLiteral(":1.1"));
+    QCOMPARE(history.ownerAt(NAME, 1999), QStringLiteral(":1.1"));
+    QCOMPARE(history.ownerAt(NAME, 2500), QString());
+    QCOMPARE(history.ownerAt(NAME, 3000), QStringLiteral(":1.7"));
+    QCOMPARE(history.ownerAt(NAME, QDateTime::fromMSecsSinceEpoch(100000)), QStringLiteral(":1.7"));
+    QCOMPARE(history.ownerAt(QStringLiteral("org.example.Unknown"), 3000), QString());
+
+    // repeated owner is not a change, unique names are not recorded
+    history.setOwner(NAME, QStringLiteral(":1.7"), 4000);
+    history.setOwner(QStringLiteral(":1.7"), QStringLiteral(":1.7"), 4000);
+    QCOMPARE(history.changeCount(), 3);
+    QCOMPARE(history.names(), QStringList{NAME});
+
+    history.clear();
+    QCOMPARE(history.changeCount(), 0);
+    QCOMPARE(history.ownerAt(NAME, 3000), QString());
+}
+
+void TestNameOwnerHistory::outOfOrder()
+{
+    // as from capture files read in any order
+    NameOwnerHistory history;
+    history.setOwner(NAME, QStringLiteral(":1.7"), 3000);
+    history.setOwner(NAME, QStringLiteral(":1.1"), 1000);
+    history.setOwner(NAME, QString(), 2000);
+
+    const QVector<NameOwnerHistory::Change> changes = history.changes(NAME);
+    QCOMPARE(changes.size(), 3);
+    QCOMPARE(changes.at(0).time, Q_INT64_C(1000));
+    QCOMPARE(changes.at(1).time, Q_INT64_C(2000));
+    QCOMPARE(changes.at(2).time, Q_INT64_C(3000));
+    QCOMPARE(history.ownerAt(NAME, 1500), QStringLiteral(":1.1"));
+    QCOMPARE(history.ownerAt(NAME, 2500), QString());
+
+    // several changes at the same time: the one seen last wins
+    history.setOwner(NAME, QStringLiteral(":1.9"), 3000);
+    QCOMPARE(history.ownerAt(NAME, 3000), QStringLiteral(":1.9"));
+}
+
+void TestNameOwnerHistory::namesAt()
+{
+    const QString other = QStringLiteral("org.example.Other");
+    NameOwnerHistory history;
+    history.setOwner(NAME, QStringLiteral(":1.1"), 1000);
+    history.setOwner(other, QStringLiteral(":1.1"), 1500);
+    history.setOwner(NAME, QStringLiteral(":1.2"), 2000);
+
+    QCOMPARE(history.namesAt(QStringLiteral(":1.1"), 500), QStringList());
+    QCOMPARE(history.namesAt(QStringLiteral(":1.1"), 1200), QStringList{NAME});
+    QCOMPARE(history.namesAt(QStringLiteral(":1.1"), 1700), (QStringList{NAME, other}));
+    QCOMPARE(history.namesAt(QStringLiteral(":1.1"), 2000), QStringList{other});
+    QCOMPARE(history.namesAt(QStringLiteral(":1.2"), QDateTime::fromMSecsSinceEpoch(2000)), QStringList{NAME});
+    QCOMPARE(history.namesAt(QStringLiteral(":1.3"), 2000), QStringList());
+}
+
+void TestNameOwnerHistory::addFromMessages()
+{
+    NameOwnerHistory history;
+    QVERIFY(history.add(nameOwnerChanged(1000, NAME, QString(), QStringLiteral(":1.1"))));
+    QVERIFY(history.add(nameOwnerChanged(2000, NAME, QStringLiteral(":1.1"), QString())));
+    QCOMPARE(history.ownerAt(NAME, 1500), QStringLiteral(":1.1"));
+    QCOMPARE(history.ownerAt(NAME, 2500), QString());
+
+    // only the bus driver is trusted
+    DBusMessageObject forged = nameOwnerChanged(3000, NAME, QString(), QStringLiteral(":1.66"));
+    forged.senderAddress = QStringLiteral(":1.66");
+    QVERIFY(!history.add(forged));
+
+    // bus driver addressed by its name is fine too
+    DBusMessageObject named = nameOwnerChanged(4000, NAME, QString(), QStringLiteral(":1.4"));
+    named.senderAddress = QStringLiteral(":1.0");
+    named.senderNames = QStringList{QStringLiteral(DBUS_SERVICE_DBUS)};
+    QVERIFY(history.add(named));
+
+    DBusMessageObject other = nameOwnerChanged(5000, NAME, QString(), QStringLiteral(":1.5"));
+    other.member = QStringLiteral("NameAcquired");
+    QVERIFY(!history.add(other));
+
+    QCOMPARE(history.ownerAt(NAME, 3500), QString());
+    QCOMPARE(history.ownerAt(NAME, 5500), QStringLiteral(":1.4"));
+    QCOMPARE(history.changeCount(), 3);
+}
+
+
+QTEST_GUILESS_MAIN(TestNameOwnerHistory)
+
+#include "tst_nameownerhistory.moc"
@@ -0,0 +1,254 @@
+#include <dbus/dbus.h>
+#include <QtTest>
+
+#include "dbusmonitorthread.h"
+#include "privatebusdaemon.h"
+
+
+// plain libdbus client of the private bus
+class BusClient
+{
+public:
+    explicit BusClient(const QString &address)
+    {
+        DBusError error = DBUS_ERROR_INIT;
+        m_conn = dbus_connection_open_private(address.toUtf8().constData(), &error);
+        if (m_conn && !dbus_bus_register(m_conn, &error)) {
+            close();
+        }
+        dbus_error_free(&error);
+    }
+
+    ~BusClient()
+    {
+        close();
+    }
+
+    bool isConnected() const { return m_conn != nullptr; }
+
+    QString uniqueName() const
+    {
+        return QString::fromUtf8(dbus_bus_get_unique_name(m_conn));
+    }
+
+    bool requestName(const char *name)
+    {
+        DBusError error = DBUS_ERROR_INIT;
+        const int ret = dbus_bus_request_name(m_conn, name, DBUS_NAME_FLAG_DO_NOT_QUEUE, &error);
+        dbus_error_free(&error);
+        return ret == DBUS_REQUEST_NAME_REPLY_PRIMARY_OWNER;
+    }
+
+    // sends org.example.Test.<member>("hello", 7) from /org/example/Test,
+    //   returns size of the message as the bus delivers it, sender added
+    int sendSignal(const char *member)
+    {
+        DBusMessage *message = dbus_message_new_signal("/org/example/Test", "org.example.Test", member);
+        const char *str = "hello";
+        dbus_uint32_t number = 7;
+        dbus_message_append_args(message,
+                                 DBUS_TYPE_STRING, &str,
+                                 DBUS_TYPE_UINT32, &number,
+                                 DBUS_TYPE_INVALID);
+        dbus_connection_send(m_conn, message, nullptr);
+        dbus_connection_flush(m_conn);
+
+        DBusMessage *delivered = dbus_message_copy(message);
+        dbus_message_set_sender(delivered, dbus_bus_get_unique_name(m_conn));
+        char *marshalled = nullptr;
+        int size = 0;
+        dbus_message_marshal(delivered, &marshalled, &size);
+        dbus_free(marshalled);
+        dbus_message_unref(delivered);
+        dbus_message_unref(message);
+        return size;
+    }
+
+private:
+    void close()
+    {
+        if (m_conn) {
+            dbus_connection_close(m_conn);
+            dbus_connection_unref(m_conn);
+            m_conn = nullptr;
+        }
+    }
+
+private:
+    DBusConnection *m_conn = nullptr;
+};
+
+
+class TestPrivateBus: public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void capturesTraffic();
+    void filtersTraffic();
+    void credentialsOfNewClient_data();
+    void credentialsOfNewClient();
+    void recordsNameOwners();
+
+private:
+    PrivateBusDaemon m_daemon;
+};
+
+
+void TestPrivateBus::initTestCase()
+{
+    qRegisterMetaType<DBusMessageObject>();
+    if (!m_daemon.start()) {
+        QSKIP(qPrintable(QStringLiteral("No dbus-daemon: ") + m_daemon.errorString()));
+    }
+}
+
+void TestPrivateBus::capturesTraffic()
+{
+    DBusMonitorThread monitor;
+    QVector<DBusMessageObject> received;
+    QObject receiver;   // goes first, with anything still queued for it
+    connect(&monitor, &DBusMonitorThread::messageReceived, &receiver, [&received] (const DBusMessageObject &messageObj) {
+        if (messageObj.member == QLatin1String("Ping")) {
+            received.append(messageObj);
+        }
+    }, Qt::QueuedConnection);
+    QVERIFY(monitor.startOnAddress(m_daemon.address()));
+    QCOMPARE(monitor.busName(), m_daemon.address());
+
+    BusClient client(m_daemon.address());
+    QVERIFY(client.isConnected());
+    QVERIFY(client.requestName("org.example.Test"));
+    const int size = client.sendSignal("Ping");
+
+    QTRY_COMPARE(received.size(), 1);
+    const DBusMessageObject &messageObj = received.first();
+    QCOMPARE(messageObj.type, DBUS_MESSAGE_TYPE_SIGNAL);
+    QCOMPARE(messageObj.bus, m_daemon.address());
+    QCOMPARE(messageObj.path, QStringLiteral("/org/example/Test"));
+    QCOMPARE(messageObj.interface, QStringLiteral("org.example.Test"));
+    QCOMPARE(messageObj.contents, (QVariantList{QStringLiteral("hello"), 7u}));
+    QCOMPARE(messageObj.senderAddress, client.uniqueName());
+    // name was acquired before the signal was sent
+    QVERIFY(messageObj.senderNames.contains(QStringLiteral("org.example.Test")));
+    // computed while parsing, without marshalling a copy
+    QCOMPARE(messageObj.size, static_cast<uint>(size));
+
+    QCOMPARE(monitor.nameOwnerHistory().ownerAt(QStringLiteral("org.example.Test"), messageObj.timestamp),
+             client.uniqueName());
+
+    monitor.stop();
+    QVERIFY(monitor.wait(5000));
+}
+
+void TestPrivateBus::filtersTraffic()
+{
+    DBusMonitorThread monitor;
+    MessageFilter filter;
+    QVERIFY(filter.addRule(QStringLiteral("member='Ping',arg1='7'")));
+    monitor.setFilter(filter);
+    QVector<DBusMessageObject> received;
+    QObject receiver;
+    connect(&monitor, &DBusMonitorThread::messageReceived, &receiver, [&received] (const DBusMessageObject &messageObj) {
+        received.append(messageObj);
+    }, Qt::QueuedConnection);
+    QVERIFY(monitor.startOnAddress(m_daemon.address(), filter.daemonMatchRules()));
+
+    BusClient client(m_daemon.address());
+    QVERIFY(client.isConnected());
+    client.sendSignal("Other");
+    client.sendSignal("Ping");
+
+    // bus driver traffic and the first signal are left out
+    QTRY_COMPARE(received.size(), 1);
+    QCOMPARE(received.first().member, QStringLiteral("Ping"));
+
+    monitor.stop();
+    QVERIFY(monitor.wait(5000));
+    QCoreApplication::processEvents();
+    QCOMPARE(received.size(), 1);
+}
+
+void TestPrivateBus::credentialsOfNewClient_data()
+{
+    QTest::addColumn<int>("decodeThreads");
+
+    // without workers, messages are decoded on capture thread itself
+    QTest::newRow("no workers") << 0;
+    QTest::newRow("two workers") << 2;
+}
+
+void TestPrivateBus::credentialsOfNewClient()
+{
+    QFETCH(int, decodeThreads);
+
+    DBusMonitorThread monitor;
+    monitor.setDecodeThreads(decodeThreads);
+    QVector<DBusMessageObject> received;
+    QObject receiver;
+    connect(&monitor, &DBusMonitorThread::messageReceived, &receiver, [&received] (const DBusMessageObject &messageObj) {
+        if (messageObj.member == QLatin1String("Ping")) {
+            received.append(messageObj);
+        }
+    }, Qt::QueuedConnection);
+    QVERIFY(monitor.startOnAddress(m_daemon.address()));
+
+    // connects after capture started, signal follows its Hello right away
+    BusClient client(m_daemon.address());
+    QVERIFY(client.isConnected());
+    client.sendSignal("Ping");
+
+    QTRY_COMPARE(received.size(), 1);
+    const DBusMessageObject &messageObj = received.first();
+    QVERIFY(messageObj.senderCredentials);
+    QCOMPARE(messageObj.senderPid, static_cast<uint>(QCoreApplication::applicationPid()));
+    QCOMPARE(messageObj.senderCredentials->pid, messageObj.senderPid);
+    QVERIFY(!messageObj.senderExe.isEmpty());
+
+    monitor.stop();
+    QVERIFY(monitor.wait(5000));
+}
+
+void TestPrivateBus::recordsNameOwners()
+{
+    BusClient early(m_daemon.address());
+    QVERIFY(early.isConnected());
+    QVERIFY(early.requestName("org.example.Early"));
+
+    DBusMonitorThread monitor;
+    MessageFilter filter;
+    QVERIFY(filter.addRule(QStringLiteral("member='Ping'")));
+    monitor.setFilter(filter);
+    monitor.setRecordNameOwners(true);
+    // as rebuilt from a capture file
+    NameOwnerHistory history;
+    int pings = 0;
+    QObject receiver;
+    connect(&monitor, &DBusMonitorThread::messageReceived, &receiver, [&history, &pings] (const DBusMessageObject &messageObj) {
+        if (!history.add(messageObj) && messageObj.member == QLatin1String("Ping")) {
+            pings++;
+        }
+    }, Qt::QueuedConnection);
+    QVERIFY(monitor.startOnAddress(m_daemon.address(), filter.daemonMatchRules()));
+
+    BusClient late(m_daemon.address());
+    QVERIFY(late.isConnected());
+    QVERIFY(late.requestName("org.example.Late"));
+    late.sendSignal("Ping");
+
+    QTRY_COMPARE(pings, 1);
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    QCOMPARE(history.ownerAt(QStringLiteral("org.example.Early"), now), early.uniqueName());
+    QCOMPARE(history.ownerAt(QStringLiteral("org.example.Late"), now), late.uniqueName());
+    // unique names are not recorded
+    QVERIFY(!history.names().contains(late.uniqueName()));
+
+    monitor.stop();
+    QVERIFY(monitor.wait(5000));
+}
+
+
+QTEST_GUILESS_MAIN(TestPrivateBus)
+
+#include "tst_privatebus.moc"
@@ -0,0 +1,134 @@
+#include <QtTest>
+
+#include "spacesaving.h"
+
+
+static const SpaceSaving::Counter *findCounter(const SpaceSaving &sketch, const QString &key)
+{
+    for (const SpaceSaving::Counter &counter: sketch.counters()) {
+        if (counter.key == key) {
+            return &counter;
+        }
+    }
+    return nullptr;
+}
+
+
+class TestSpaceSaving: public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void exactBelowCapacity();
+    void heavyHitters();
+    void scale();
+};
+
+
+void TestSpaceSaving::exactBelowCapacity()
+{
+    SpaceSaving sketch(4);
+    sketch.add(QStringLiteral("a"), 100);
+    sketch.add(QStringLiteral("b"), 10);
+    sketch.add(QStringLiteral("a"), 50);
+    sketch.add(QStringLiteral("c"), 1, 16);    // sampled: stands for 16 messages
+    QCOMPARE(sketch.counters().size(), 3);
+
+    const SpaceSaving::Counter *a = findCounter(sketch, QStringLiteral("a"));
+    QVERIFY(a);
+    QCOMPARE(a->count, 2.0);
+    QCOMPARE(a->bytes, 150.0);
+    QCOMPARE(a->error, 0.0);
+    const SpaceSaving::Counter *c = findCounter(sketch, QStringLiteral("c"));
+    QVERIFY(c);
+    QCOMPARE(c->count, 16.0);
+
+    sketch.clear();
+    QVERIFY(sketch.counters().isEmpty());
+    QCOMPARE(sketch.capacity(), 4);
+}
+
+void TestSpaceSaving::heavyHitters()
+{
+    const int capacity = 20;
+    SpaceSaving sketch(capacity);
+    QHash<QString, int> exact;
+    int total = 0;
+
+    // three heavy keys among a long tail of rare ones, interleaved
+    quint32 random = 12345;
+    for (int i = 0; i < 20000; i++) {
+        random = random * 1103515245u + 12345u;
+        QString key;
+        switch (i % 10) {
+        case 0:
+        case 1:
+        case 2:
+            key = QStringLiteral("heavy.a");
+            break;
+        case 3:
+        case 4:
+            key = QStringLiteral("heavy.b");
+            break;
+        case 5:
+            key = QStringLiteral("heavy.c");
+            break;
+        default:
+            key = QStringLiteral("rare.%1").arg((random >> 8) % 5000);
+            break;
+        }
+        sketch.add(key, 10);
+        exact[key]++;
+        total++;
+    }
+
+    QCOMPARE(sketch.counters().size(), capacity);
+    double sum = 0;
+    for (const SpaceSaving::Counter &counter: sketch.counters()) {
+        // never underestimates, overestimates by at most error
+        const int trueCount = exact.value(counter.key);
+        QVERIFY(counter.count >= trueCount);
+        QVERIFY(counter.count - counter.error <= trueCount);
+        QVERIFY(counter.error <= total / capacity);
+        sum += counter.count;
+    }
+    // evicted counts are inherited, not lost
+    QCOMPARE(sum, static_cast<double>(total));
+
+    // every key above total / capacity is kept
+    for (auto it = exact.constBegin(); it != exact.constEnd(); ++it) {
+        if (it.value() > total / capacity) {
+            QVERIFY2(findCounter(sketch, it.key()), qPrintable(it.key()));
+        }
+    }
+    QVERIFY(findCounter(sketch, QStringLiteral("heavy.c")));
+}
+
+void TestSpaceSaving::scale()
+{
+    SpaceSaving sketch(2);
+    sketch.add(QStringLiteral("a"), 100, 8);
+    sketch.add(QStringLiteral("b"), 10, 4);
+    sketch.add(QStringLiteral("c"), 10, 1);     // evicts b
+    QVERIFY(!findCounter(sketch, QStringLiteral("b")));
+
+    sketch.scale(0.5);
+    const SpaceSaving::Counter *a = findCounter(sketch, QStringLiteral("a"));
+    const SpaceSaving::Counter *c = findCounter(sketch, QStringLiteral("c"));
+    QVERIFY(a && c);
+    QCOMPARE(a->count, 4.0);
+    QCOMPARE(a->bytes, 50.0);
+    QCOMPARE(c->count, 2.5);
+    QCOMPARE(c->error, 2.0);
+
+    // heap order is kept: the smallest counter is still evicted first
+    sketch.add(QStringLiteral("d"), 0, 1);
+    QVERIFY(findCounter(sketch, QStringLiteral("a")));
+    QVERIFY(!findCounter(sketch, QStringLiteral("c")));
+    QCOMPARE(findCounter(sketch, QStringLiteral("d"))->count, 3.5);
+}
+
+
+QTEST_GUILESS_MAIN(TestSpaceSaving)
+
+#include "tst_spacesaving.moc"